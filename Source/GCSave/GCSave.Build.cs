@@ -15,6 +15,12 @@ public class GCSave : ModuleRules
                 ModuleDirectory + "/GCSave",
                 ModuleDirectory + "/GCSave/GlobalSave",
                 ModuleDirectory + "/GCSave/PlayerSave",
+                ModuleDirectory + "/GCSave/ServerSave",
+                ModuleDirectory + "/GCSave/Format",
+                ModuleDirectory + "/GCSave/Storage",
+                ModuleDirectory + "/GCSave/Pipeline",
+                ModuleDirectory + "/GCSave/Profiling",
+                ModuleDirectory + "/GCSave/Commandlet",
             }
         );
 
@@ -2,6 +2,8 @@
 
 #include "GCSave.h"
 
+#include "Pipeline/GameSaveThrottle.h"
+
 IMPLEMENT_MODULE(FGCSaveModule, GCSave)
 
 
@@ -11,4 +13,5 @@ void FGCSaveModule::StartupModule()
 
 void FGCSaveModule::ShutdownModule()
 {
+	FGameSaveThrottle::Get().Shutdown();
 }
@@ -0,0 +1,515 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "GameSaveMigrateCommandlet.h"
+
+#include "Format/GameSaveEncryption.h"
+#include "Format/GameSaveHeader.h"
+#include "Format/GameSaveSerializer.h"
+#include "GlobalSave/GlobalSave.h"
+#include "Pipeline/GameSavePipeline.h"
+#include "PlayerSave/PlayerSave.h"
+#include "Profiling/GameSaveSizeProfiler.h"
+#include "Profiling/GameSaveSoakTest.h"
+#include "GCSaveLogs.h"
+
+#include "Async/ParallelFor.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "UObject/GarbageCollection.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(GameSaveMigrateCommandlet)
+
+
+namespace GameSaveMigrateCommandlet
+{
+	//
+	// State and outcome of one file
+	//
+	struct FFileResult
+	{
+	public:
+		FString File;
+
+		FString ClassPath;
+
+		//
+		// Data version in the header of the file, before any migration step ran
+		//
+		int32 FromVersion{ 0 };
+
+		int32 ToVersion{ 0 };
+
+		int64 OldBytes{ 0 };
+
+		int64 NewBytes{ 0 };
+
+		//
+		// Time spent reading, decrypting, migrating and deserializing
+		//
+		double LoadSeconds{ 0.0 };
+
+		//
+		// Time spent initializing the object on the game thread
+		//
+		double PostLoadSeconds{ 0.0 };
+
+		//
+		// Time spent serializing, validating and writing
+		//
+		double SaveSeconds{ 0.0 };
+
+		bool bEncrypted{ false };
+
+		//
+		// Whether the file has a header of this plugin, otherwise FromVersion is taken from the loaded object
+		//
+		bool bHasHeader{ false };
+
+		bool bWritten{ false };
+
+		//
+		// Reason the file failed, empty if it succeeded
+		//
+		FString Error;
+
+		//
+		// Data left for the game thread when the object could not be deserialized on a worker thread
+		//
+		TArray<uint8> PendingData;
+
+		USaveGame* SaveObject{ nullptr };
+
+		//
+		// Object loaded again from the upgraded data, created on a worker thread
+		//
+		USaveGame* ValidationObject{ nullptr };
+
+	public:
+		bool IsSuccess() const { return Error.IsEmpty(); }
+
+	};
+
+	/**
+	 * Reads, decrypts, migrates and deserializes the file, can be called from any thread
+	 */
+	static void LoadFile(FFileResult& Result)
+	{
+		const auto StartTime{ FPlatformTime::Seconds() };
+
+		TArray<uint8> Data;
+
+		if (!FFileHelper::LoadFileToArray(Data, *Result.File))
+		{
+			Result.Error = TEXT("Failed to read the file");
+			return;
+		}
+
+		Result.OldBytes = Data.Num();
+
+		FGameSaveHeader Header;
+
+		if (FGameSaveSerializer::ReadHeader(Data, Header))
+		{
+			Result.ClassPath = Header.ClassPath;
+			Result.FromVersion = Header.DataVersion;
+			Result.bEncrypted = Header.IsEncrypted();
+			Result.bHasHeader = true;
+		}
+
+		if (!FGameSaveEncryption::DecryptData(Data))
+		{
+			Result.Error = TEXT("Failed to decrypt the data");
+		}
+		else if (!FGameSaveSerializer::MigrateData(Data))
+		{
+			Result.Error = TEXT("A migration step failed");
+		}
+		else if (FGameSaveSerializer::CanLoadOnAnyThread(Data))
+		{
+			Result.SaveObject = FGameSaveSerializer::LoadFromMemory_AnyThread(Data);
+
+			if (!Result.SaveObject)
+			{
+				Result.Error = TEXT("Failed to deserialize the data");
+			}
+		}
+		else
+		{
+			Result.PendingData = MoveTemp(Data);
+		}
+
+		Result.LoadSeconds = FPlatformTime::Seconds() - StartTime;
+	}
+
+	/**
+	 * Finishes the load and runs the post-load of the class, must be called on the game thread
+	 */
+	static void InitializeSave(FFileResult& Result)
+	{
+		const auto StartTime{ FPlatformTime::Seconds() };
+
+		if (Result.SaveObject)
+		{
+			FGameSaveSerializer::FinishAsyncLoad(Result.SaveObject);
+		}
+		else
+		{
+			Result.SaveObject = FGameSaveSerializer::LoadFromMemory(Result.PendingData);
+			Result.PendingData.Empty();
+		}
+
+		if (!Result.SaveObject)
+		{
+			Result.Error = TEXT("Failed to deserialize the data");
+			return;
+		}
+
+		Result.ClassPath = Result.SaveObject->GetClass()->GetPathName();
+
+		const auto SlotName{ FPaths::GetBaseFilename(Result.File) };
+
+		// The post-load handles the fixups of older data versions, there is no game instance or local player to initialize it with.
+		// Migration steps may already have raised the version of the object, so FromVersion keeps the one of the file.
+
+		if (auto* GlobalSave{ Cast<UGlobalSave>(Result.SaveObject) })
+		{
+			const auto SavedVersion{ GlobalSave->GetSavedDataVersion() };
+
+			Result.FromVersion = Result.bHasHeader ? Result.FromVersion : SavedVersion;
+			Result.ToVersion = GlobalSave->GetLatestDataVersion();
+
+			if (!GlobalSave->CanLoadDataVersion(SavedVersion))
+			{
+				Result.Error = FString::Printf(TEXT("Data version(%d) is not supported"), SavedVersion);
+				return;
+			}
+
+			GlobalSave->InitializeSaveGame(nullptr, SlotName);
+		}
+		else if (auto* PlayerSave{ Cast<UPlayerSave>(Result.SaveObject) })
+		{
+			const auto SavedVersion{ PlayerSave->GetSavedDataVersion() };
+
+			Result.FromVersion = Result.bHasHeader ? Result.FromVersion : SavedVersion;
+			Result.ToVersion = PlayerSave->GetLatestDataVersion();
+
+			if (!PlayerSave->CanLoadDataVersion(SavedVersion))
+			{
+				Result.Error = FString::Printf(TEXT("Data version(%d) is not supported"), SavedVersion);
+				return;
+			}
+
+			PlayerSave->InitializeSaveGame(nullptr, SlotName);
+		}
+		else
+		{
+			Result.Error = TEXT("Not a global save or player save");
+		}
+
+		Result.PostLoadSeconds = FPlatformTime::Seconds() - StartTime;
+	}
+
+	static bool UseUnversionedSerialization(const USaveGame* SaveObject)
+	{
+		if (const auto* GlobalSave{ Cast<UGlobalSave>(SaveObject) })
+		{
+			return GlobalSave->UseUnversionedSerialization();
+		}
+
+		if (const auto* PlayerSave{ Cast<UPlayerSave>(SaveObject) })
+		{
+			return PlayerSave->UseUnversionedSerialization();
+		}
+
+		return false;
+	}
+
+	/**
+	 * Serializes the object with the latest data version, validates the data and writes it, can be called from any thread
+	 *
+	 * Note:
+	 *	Only safe while the game thread does not touch the objects, which is the case while it waits for the batch
+	 */
+	static void SaveFile(FFileResult& Result, const FString& OutputFile, bool bWrite)
+	{
+		const auto StartTime{ FPlatformTime::Seconds() };
+		const auto bUnversioned{ UseUnversionedSerialization(Result.SaveObject) };
+
+		TArray<uint8> Data;
+
+		if (!FGameSaveSerializer::SaveToMemory(Result.SaveObject, Result.ToVersion, bUnversioned, Data))
+		{
+			Result.Error = TEXT("Failed to serialize the upgraded data");
+			return;
+		}
+
+		if (!FGameSaveSizeProfiler::CheckSizeBudget(Result.SaveObject->GetClass(), Data.Num(), Result.File))
+		{
+			Result.Error = TEXT("The upgraded data is over the size budget of its class");
+			return;
+		}
+
+		// The upgraded data must load again and produce the same payload
+
+		FGameSaveHeader Header;
+		FGameSaveHeader ValidationHeader;
+		TArray<uint8> ValidationData;
+
+		Result.ValidationObject = FGameSaveSerializer::CanLoadOnAnyThread(Data) ? FGameSaveSerializer::LoadFromMemory_AnyThread(Data) : nullptr;
+
+		if (!Result.ValidationObject
+			|| !FGameSaveSerializer::SaveToMemory(Result.ValidationObject, Result.ToVersion, bUnversioned, ValidationData)
+			|| !FGameSaveSerializer::ReadHeader(Data, Header)
+			|| !FGameSaveSerializer::ReadHeader(ValidationData, ValidationHeader)
+			|| (Header.PayloadHash != ValidationHeader.PayloadHash))
+		{
+			Result.Error = TEXT("The upgraded data does not load back to the same payload");
+			return;
+		}
+
+		if ((Result.bEncrypted || FGameSaveEncryption::ShouldEncrypt()) && !FGameSaveEncryption::EncryptData(Data))
+		{
+			Result.Error = TEXT("Failed to encrypt the upgraded data");
+			return;
+		}
+
+		Result.NewBytes = Data.Num();
+
+		if (bWrite)
+		{
+			if (!FFileHelper::SaveArrayToFile(Data, *OutputFile))
+			{
+				Result.Error = FString::Printf(TEXT("Failed to write file(%s)"), *OutputFile);
+				return;
+			}
+
+			Result.bWritten = true;
+		}
+
+		Result.SaveSeconds = FPlatformTime::Seconds() - StartTime;
+	}
+
+	static bool WriteReport(const FString& ReportFile, const TArray<FFileResult>& Results)
+	{
+		TArray<FString> Lines;
+		Lines.Add(TEXT("File,Class,FromVersion,ToVersion,OldBytes,NewBytes,LoadMs,PostLoadMs,SaveMs,Written,Error"));
+
+		for (const auto& Result : Results)
+		{
+			Lines.Add(FString::Printf(TEXT("\"%s\",\"%s\",%d,%d,%lld,%lld,%.3f,%.3f,%.3f,%d,\"%s\""),
+				*Result.File, *Result.ClassPath, Result.FromVersion, Result.ToVersion, Result.OldBytes, Result.NewBytes,
+				Result.LoadSeconds * 1000.0, Result.PostLoadSeconds * 1000.0, Result.SaveSeconds * 1000.0,
+				Result.bWritten ? 1 : 0, *Result.Error.Replace(TEXT("\""), TEXT("\"\""))));
+		}
+
+		return FFileHelper::SaveStringArrayToFile(Lines, *ReportFile);
+	}
+}
+
+
+UGameSaveMigrateCommandlet::UGameSaveMigrateCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UGameSaveMigrateCommandlet::Main(const FString& Params)
+{
+	using namespace GameSaveMigrateCommandlet;
+
+	TArray<FString> Tokens;
+	TArray<FString> Switches;
+	TMap<FString, FString> ParamVals;
+	ParseCommandLine(*Params, Tokens, Switches, ParamVals);
+
+	const auto Path{ ParamVals.Contains(TEXT("Path")) ? ParamVals[TEXT("Path")] : FPaths::ProjectSavedDir() / TEXT("SaveGames") };
+	const auto OutputPath{ ParamVals.FindRef(TEXT("Output")) };
+	const auto ReportFile{ ParamVals.FindRef(TEXT("Report")) };
+	const auto BatchSize{ FMath::Max(ParamVals.Contains(TEXT("BatchSize")) ? FCString::Atoi(*ParamVals[TEXT("BatchSize")]) : 512, 1) };
+	const auto bRecursive{ Switches.Contains(TEXT("Recursive")) };
+	const auto bWrite{ Switches.Contains(TEXT("Write")) };
+
+	// Collect files, the side slots of blobs are raw payloads and are left as they are
+
+	TArray<FString> Files;
+	const auto bIsDirectory{ IFileManager::Get().DirectoryExists(*Path) };
+
+	if (bIsDirectory)
+	{
+		if (bRecursive)
+		{
+			IFileManager::Get().FindFilesRecursive(Files, *Path, TEXT("*.sav"), true, false);
+		}
+		else
+		{
+			IFileManager::Get().FindFiles(Files, *(Path / TEXT("*.sav")), true, false);
+
+			for (auto& File : Files)
+			{
+				File = Path / File;
+			}
+		}
+
+		Files.RemoveAll([](const FString& File) { return FGameSavePipeline::IsBlobSlotName(FPaths::GetBaseFilename(File)); });
+		Files.Sort();
+	}
+	else
+	{
+		Files.Add(Path);
+	}
+
+	TArray<FFileResult> Results;
+	Results.SetNum(Files.Num());
+
+	for (int32 Index{ 0 }; Index < Files.Num(); ++Index)
+	{
+		Results[Index].File = Files[Index];
+	}
+
+	auto GetOutputFile
+	{
+		[&Path, &OutputPath, bIsDirectory](const FString& File)
+		{
+			if (OutputPath.IsEmpty())
+			{
+				return File;
+			}
+
+			if (!bIsDirectory)
+			{
+				return OutputPath / FPaths::GetCleanFilename(File);
+			}
+
+			auto RelativeFile{ File };
+			FPaths::MakePathRelativeTo(RelativeFile, *(Path / TEXT("")));
+
+			return OutputPath / RelativeFile;
+		}
+	};
+
+	UE_LOG(LogGameCore_Save, Display, TEXT("UGameSaveMigrateCommandlet: Migrating %d files%s"), Files.Num(), bWrite ? TEXT("") : TEXT(" without writing them"));
+
+	const auto StartTime{ FPlatformTime::Seconds() };
+
+	// Files are processed in batches so that the objects of only one batch are alive at a time
+
+	for (int32 BatchStart{ 0 }; BatchStart < Results.Num(); BatchStart += BatchSize)
+	{
+		const auto BatchNum{ FMath::Min(BatchSize, Results.Num() - BatchStart) };
+		auto* Batch{ Results.GetData() + BatchStart };
+
+		{
+			FGCScopeGuard GCGuard;
+
+			ParallelFor(BatchNum,
+				[Batch](int32 Index)
+				{
+					LoadFile(Batch[Index]);
+				}
+			);
+		}
+
+		for (int32 Index{ 0 }; Index < BatchNum; ++Index)
+		{
+			if (Batch[Index].IsSuccess())
+			{
+				InitializeSave(Batch[Index]);
+			}
+		}
+
+		{
+			FGCScopeGuard GCGuard;
+
+			ParallelFor(BatchNum,
+				[Batch, &GetOutputFile, bWrite](int32 Index)
+				{
+					auto& Result{ Batch[Index] };
+
+					if (Result.IsSuccess())
+					{
+						SaveFile(Result, GetOutputFile(Result.File), bWrite);
+					}
+				}
+			);
+		}
+
+		// Release the objects of the batch
+
+		for (int32 Index{ 0 }; Index < BatchNum; ++Index)
+		{
+			auto& Result{ Batch[Index] };
+
+			if (Result.ValidationObject)
+			{
+				FGameSaveSerializer::FinishAsyncLoad(Result.ValidationObject);
+			}
+
+			Result.SaveObject = nullptr;
+			Result.ValidationObject = nullptr;
+			Result.PendingData.Empty();
+
+			if (!Result.IsSuccess())
+			{
+				UE_LOG(LogGameCore_Save, Error, TEXT("UGameSaveMigrateCommandlet: File(%s) failed: %s"), *Result.File, *Result.Error);
+			}
+		}
+
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+
+		UE_LOG(LogGameCore_Save, Display, TEXT("UGameSaveMigrateCommandlet: Processed %d/%d files"), BatchStart + BatchNum, Results.Num());
+	}
+
+	const auto TotalSeconds{ FPlatformTime::Seconds() - StartTime };
+
+	// Summary
+
+	auto NumFailed{ 0 };
+	auto NumUpgraded{ 0 };
+	auto NumWritten{ 0 };
+	int64 TotalOldBytes{ 0 };
+	int64 TotalNewBytes{ 0 };
+
+	TArray<double> LoadSamples;
+	TArray<double> PostLoadSamples;
+	TArray<double> SaveSamples;
+
+	for (const auto& Result : Results)
+	{
+		if (!Result.IsSuccess())
+		{
+			NumFailed++;
+			continue;
+		}
+
+		NumUpgraded += (Result.FromVersion != Result.ToVersion) ? 1 : 0;
+		NumWritten += Result.bWritten ? 1 : 0;
+		TotalOldBytes += Result.OldBytes;
+		TotalNewBytes += Result.NewBytes;
+
+		LoadSamples.Add(Result.LoadSeconds);
+		PostLoadSamples.Add(Result.PostLoadSeconds);
+		SaveSamples.Add(Result.SaveSeconds);
+	}
+
+	UE_LOG(LogGameCore_Save, Display, TEXT("UGameSaveMigrateCommandlet: %d files in %.2f s, %d failed, %d upgraded to a newer data version, %d written"),
+		Results.Num(), TotalSeconds, NumFailed, NumUpgraded, NumWritten);
+
+	UE_LOG(LogGameCore_Save, Display, TEXT("UGameSaveMigrateCommandlet: Size of succeeded files %lld -> %lld bytes (%+lld)"),
+		TotalOldBytes, TotalNewBytes, TotalNewBytes - TotalOldBytes);
+
+	UE_LOG(LogGameCore_Save, Display, TEXT("UGameSaveMigrateCommandlet: Load %s"), *FGameSaveLatencyStats::FromSamples(MoveTemp(LoadSamples)).ToString());
+	UE_LOG(LogGameCore_Save, Display, TEXT("UGameSaveMigrateCommandlet: PostLoad %s"), *FGameSaveLatencyStats::FromSamples(MoveTemp(PostLoadSamples)).ToString());
+	UE_LOG(LogGameCore_Save, Display, TEXT("UGameSaveMigrateCommandlet: Save %s"), *FGameSaveLatencyStats::FromSamples(MoveTemp(SaveSamples)).ToString());
+
+	if (!ReportFile.IsEmpty() && !WriteReport(ReportFile, Results))
+	{
+		UE_LOG(LogGameCore_Save, Error, TEXT("UGameSaveMigrateCommandlet: Failed to write report(%s)"), *ReportFile);
+		return 1;
+	}
+
+	return (NumFailed > 0) ? 1 : 0;
+}
@@ -0,0 +1,34 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+
+#include "GameSaveMigrateCommandlet.generated.h"
+
+
+/**
+ * Commandlet that upgrades and validates a directory of global and player save files in parallel
+ *
+ * Usage:
+ *	-run=GameSaveMigrate [-Path=<save file or directory>] [-Recursive] [-Write] [-Output=<directory>] [-Report=<csv file>] [-BatchSize=<files>]
+ *
+ * Tips:
+ *	Path defaults to the SaveGames directory of the project.
+ *	Each file is read, decrypted, migrated with FGameSaveMigrationRegistry and deserialized on worker threads,
+ *	then initialized on the game thread so that the post-load fixups of its class run, and finally serialized with the latest data version on worker threads.
+ *	The upgraded data is validated by loading it again and checking that it serializes to the same payload.
+ *	Files are only written with -Write, to Output if given (keeping their path relative to Path) or in place otherwise. Encrypted files stay encrypted.
+ *	The commandlet fails if any file fails, the failures, timings and size changes are logged and optionally written to a CSV report.
+ */
+UCLASS()
+class UGameSaveMigrateCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+public:
+	UGameSaveMigrateCommandlet();
+
+public:
+	virtual int32 Main(const FString& Params) override;
+
+};
@@ -0,0 +1,88 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "GameSaveSizeCommandlet.h"
+
+#include "Profiling/GameSaveSizeProfiler.h"
+#include "GCSaveLogs.h"
+
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/OutputDeviceRedirector.h"
+#include "Misc/Paths.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(GameSaveSizeCommandlet)
+
+
+UGameSaveSizeCommandlet::UGameSaveSizeCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UGameSaveSizeCommandlet::Main(const FString& Params)
+{
+	TArray<FString> Tokens;
+	TArray<FString> Switches;
+	TMap<FString, FString> ParamVals;
+	ParseCommandLine(*Params, Tokens, Switches, ParamVals);
+
+	const auto Path{ ParamVals.Contains(TEXT("Path")) ? ParamVals[TEXT("Path")] : FPaths::ProjectSavedDir() / TEXT("SaveGames") };
+	const auto MaxDepth{ ParamVals.Contains(TEXT("Depth")) ? FCString::Atoi(*ParamVals[TEXT("Depth")]) : 2 };
+	const auto bCheckBudget{ Switches.Contains(TEXT("Budget")) };
+
+	// Collect files
+
+	TArray<FString> Files;
+
+	if (IFileManager::Get().DirectoryExists(*Path))
+	{
+		IFileManager::Get().FindFiles(Files, *(Path / TEXT("*.sav")), true, false);
+
+		for (auto& File : Files)
+		{
+			File = Path / File;
+		}
+	}
+	else
+	{
+		Files.Add(Path);
+	}
+
+	// Profile each file
+
+	auto NumFailed{ 0 };
+	auto NumOverBudget{ 0 };
+
+	for (const auto& File : Files)
+	{
+		TArray<uint8> Data;
+		FGameSaveSizeReport Report;
+
+		if (!FFileHelper::LoadFileToArray(Data, *File) || !FGameSaveSizeProfiler::ProfileData(Data, Report, MaxDepth))
+		{
+			UE_LOG(LogGameCore_Save, Error, TEXT("UGameSaveSizeCommandlet: Failed to profile file(%s)"), *File);
+			NumFailed++;
+			continue;
+		}
+
+		Report.Name = FPaths::GetCleanFilename(File);
+		Report.Log(*GLog);
+
+		if (bCheckBudget)
+		{
+			const auto Budget{ FGameSaveSizeProfiler::GetSizeBudget(FSoftClassPath(Report.ClassPath).ResolveClass()) };
+
+			if ((Budget > 0) && (Report.TotalBytes > Budget))
+			{
+				UE_LOG(LogGameCore_Save, Error, TEXT("UGameSaveSizeCommandlet: File(%s) is %lld bytes, over its budget of %lld bytes"), *File, Report.TotalBytes, Budget);
+				NumOverBudget++;
+			}
+		}
+	}
+
+	UE_LOG(LogGameCore_Save, Display, TEXT("UGameSaveSizeCommandlet: Profiled %d files, %d failed, %d over budget"), Files.Num() - NumFailed, NumFailed, NumOverBudget);
+
+	return ((NumFailed > 0) || (NumOverBudget > 0)) ? 1 : 0;
+}
@@ -0,0 +1,30 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+
+#include "GameSaveSizeCommandlet.generated.h"
+
+
+/**
+ * Commandlet that logs the serialized size of each property of save files on disk
+ *
+ * Usage:
+ *	-run=GameSaveSize [-Path=<save file or directory>] [-Depth=<nested levels>] [-Budget]
+ *
+ * Tips:
+ *	Path defaults to the SaveGames directory of the project.
+ *	With -Budget, the commandlet fails if any file exceeds the size budget of its class.
+ */
+UCLASS()
+class UGameSaveSizeCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+public:
+	UGameSaveSizeCommandlet();
+
+public:
+	virtual int32 Main(const FString& Params) override;
+
+};
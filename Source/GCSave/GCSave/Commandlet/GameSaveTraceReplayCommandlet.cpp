@@ -0,0 +1,358 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "GameSaveTraceReplayCommandlet.h"
+
+#include "Format/GameSaveSerializer.h"
+#include "Pipeline/GameSaveIOQueue.h"
+#include "Pipeline/GameSavePipeline.h"
+#include "Profiling/GameSaveSoakTest.h"
+#include "Profiling/GameSaveTrace.h"
+#include "Profiling/GameSaveTraceReplaySave.h"
+#include "Storage/GameSaveStorage.h"
+#include "Storage/GameSaveStorage_Directory.h"
+#include "GCSaveLogs.h"
+
+#include "Async/TaskGraphInterfaces.h"
+#include "Containers/Ticker.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Guid.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "UObject/GarbageCollection.h"
+#include "UObject/StrongObjectPtr.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(GameSaveTraceReplayCommandlet)
+
+
+namespace GameSaveTraceReplayCommandlet
+{
+	//
+	// Number of issued operations after which unreferenced loaded saves are collected
+	//
+	static const int32 GC_INTERVAL{ 256 };
+
+	//
+	// Timings of the replayed operations, shared with the delegates of async operations
+	//
+	struct FReplayState
+	{
+	public:
+		//
+		// Number of async operations whose delegate has not been called yet
+		//
+		int32 NumInFlight{ 0 };
+
+		//
+		// Recorded successes that failed in the replay
+		//
+		int32 NumMismatches{ 0 };
+
+		TArray<double> StallSamples[static_cast<int32>(EGameSaveTraceOp::MAX)];
+
+		TArray<double> LatencySamples[static_cast<int32>(EGameSaveTraceOp::MAX)];
+
+	public:
+		void AddResult(const FGameSaveTraceEvent& Event, double Latency, bool bSuccess)
+		{
+			LatencySamples[static_cast<int32>(Event.Op)].Add(Latency);
+
+			if (Event.IsSuccess() && !bSuccess)
+			{
+				NumMismatches++;
+
+				UE_LOG(LogGameCore_Save, Warning, TEXT("UGameSaveTraceReplayCommandlet: %s of slot(%s) at %.3f s succeeded when recorded but failed in the replay"),
+					FGameSaveTraceEvent::GetOpName(Event.Op), *Event.SlotName, Event.Time);
+			}
+		}
+
+	};
+
+	/**
+	 * Returns the serialized size of a replay save with an empty payload
+	 */
+	static int64 MeasureOverhead()
+	{
+		TArray<uint8> Data;
+
+		FGameSaveSerializer::SaveToMemory(NewObject<UGameSaveTraceReplaySave>(), 0, false, Data);
+
+		return Data.Num();
+	}
+}
+
+
+UGameSaveTraceReplayCommandlet::UGameSaveTraceReplayCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UGameSaveTraceReplayCommandlet::Main(const FString& Params)
+{
+	using namespace GameSaveTraceReplayCommandlet;
+
+	TArray<FString> Tokens;
+	TArray<FString> Switches;
+	TMap<FString, FString> ParamVals;
+	ParseCommandLine(*Params, Tokens, Switches, ParamVals);
+
+	const auto TraceFile{ ParamVals.FindRef(TEXT("Trace")) };
+	const auto Speed{ ParamVals.Contains(TEXT("Speed")) ? FMath::Max(FCString::Atod(*ParamVals[TEXT("Speed")]), 0.0) : 1.0 };
+	const auto FrameSeconds{ (ParamVals.Contains(TEXT("FrameMs")) ? FMath::Max(FCString::Atod(*ParamVals[TEXT("FrameMs")]), 0.0) : 1000.0 / 60.0) / 1000.0 };
+	const auto NumIOWorkers{ ParamVals.Contains(TEXT("IOWorkers")) ? FCString::Atoi(*ParamVals[TEXT("IOWorkers")]) : 0 };
+	const auto TimeoutSeconds{ ParamVals.Contains(TEXT("Timeout")) ? FCString::Atod(*ParamVals[TEXT("Timeout")]) : 60.0 };
+	const auto Seed{ ParamVals.Contains(TEXT("Seed")) ? FCString::Atoi(*ParamVals[TEXT("Seed")]) : 0 };
+	const auto bKeep{ Switches.Contains(TEXT("Keep")) };
+
+	FGameSaveTrace Trace;
+
+	if (TraceFile.IsEmpty() || !Trace.LoadFromFile(TraceFile))
+	{
+		UE_LOG(LogGameCore_Save, Error, TEXT("UGameSaveTraceReplayCommandlet: Failed to load trace(%s), pass a trace file with -Trace=<file>"), *FGameSaveTrace::ResolveFilename(TraceFile));
+		return 1;
+	}
+
+	// Slots go to a temporary directory unless a storage type is given, real storages get prefixed slot names so that no slot of the game is touched
+
+	FString StorageTypeName;
+
+	const auto bExplicitStorage{ FParse::Value(FCommandLine::Get(), TEXT("GameSaveStorage="), StorageTypeName) };
+	const auto SandboxDirectory{ FPaths::ProjectSavedDir() / TEXT("GameSaveTraceReplay") / FGuid::NewGuid().ToString() };
+	const auto SlotPrefix{ bExplicitStorage ? FString(TEXT("TraceReplay_")) : FString() };
+
+	const auto Storage
+	{
+		bExplicitStorage
+		? IGameSaveStorage::Create(IGameSaveStorage::GetDefaultStorageType())
+		: StaticCastSharedRef<IGameSaveStorage>(MakeShared<FGameSaveStorage_Directory>(SandboxDirectory))
+	};
+
+	const auto Pipeline{ MakeShared<FGameSavePipeline>(Storage) };
+
+	if (NumIOWorkers > 0)
+	{
+		Pipeline->SetIOQueue(MakeShared<FGameSaveIOQueue>(NumIOWorkers));
+	}
+
+	UE_LOG(LogGameCore_Save, Display, TEXT("UGameSaveTraceReplayCommandlet: Replaying %d operations over %.2f s recorded, at speed %.2f with storage(%s)"),
+		Trace.Events.Num(), Trace.GetDuration(), Speed, *Storage->GetStorageName());
+
+	FRandomStream Random(Seed);
+	const auto Overhead{ MeasureOverhead() };
+
+	// Latest save written to each slot, reused by saves recorded as unchanged
+
+	TMap<FString, TStrongObjectPtr<UGameSaveTraceReplaySave>> LastSaves;
+
+	auto MakeSave
+	{
+		[&LastSaves, &Random, Overhead](const FString& SlotKey, const FGameSaveTraceEvent& Event)
+		{
+			auto& LastSave{ LastSaves.FindOrAdd(SlotKey) };
+
+			if (!LastSave.IsValid() || (Event.Outcome != EGameSaveTraceOutcome::Unchanged))
+			{
+				LastSave.Reset(NewObject<UGameSaveTraceReplaySave>());
+				LastSave->SetSerializedSize(Event.Size, Overhead, Random);
+			}
+
+			return LastSave.Get();
+		}
+	};
+
+	// Slots whose first operation is a successful load existed before the recording started
+
+	TSet<FString> SeenSlots;
+
+	for (const auto& Event : Trace.Events)
+	{
+		const auto SlotName{ SlotPrefix + Event.SlotName };
+		const auto SlotKey{ FString::Printf(TEXT("%d:%s"), Event.UserIndex, *SlotName) };
+
+		if (SeenSlots.Contains(SlotKey))
+		{
+			continue;
+		}
+
+		SeenSlots.Add(SlotKey);
+
+		const auto bIsLoad{ (Event.Op == EGameSaveTraceOp::SyncLoad) || (Event.Op == EGameSaveTraceOp::AsyncLoad) };
+
+		if (bIsLoad && Event.IsSuccess())
+		{
+			auto* SeedSave{ NewObject<UGameSaveTraceReplaySave>() };
+			SeedSave->SetSerializedSize(Event.Size, Overhead, Random);
+
+			Pipeline->SaveGameToSlot(SeedSave, 0, false, SlotName, Event.UserIndex);
+		}
+	}
+
+	// Issue the operations on schedule and tick once per frame until all of them have completed
+
+	const auto State{ MakeShared<FReplayState>() };
+	const auto StartTime{ FPlatformTime::Seconds() };
+
+	auto LastTickTime{ StartTime };
+	auto NextIndex{ 0 };
+	auto LastIssueTime{ StartTime };
+
+	while ((NextIndex < Trace.Events.Num()) || (State->NumInFlight > 0))
+	{
+		const auto FrameStartTime{ FPlatformTime::Seconds() };
+
+		while ((NextIndex < Trace.Events.Num()) && ((Speed <= 0.0) || (Trace.Events[NextIndex].Time / Speed <= FrameStartTime - StartTime)))
+		{
+			const auto& Event{ Trace.Events[NextIndex++] };
+			const auto SlotName{ SlotPrefix + Event.SlotName };
+			const auto SlotKey{ FString::Printf(TEXT("%d:%s"), Event.UserIndex, *SlotName) };
+			const auto IssueTime{ FPlatformTime::Seconds() };
+
+			switch (Event.Op)
+			{
+			case EGameSaveTraceOp::SyncSave:
+				{
+					const auto bSuccess{ Pipeline->SaveGameToSlot(MakeSave(SlotKey, Event), 0, false, SlotName, Event.UserIndex) };
+
+					State->AddResult(Event, FPlatformTime::Seconds() - IssueTime, bSuccess);
+				}
+				break;
+
+			case EGameSaveTraceOp::AsyncSave:
+				{
+					State->NumInFlight++;
+
+					Pipeline->AsyncSaveGameToSlot(MakeSave(SlotKey, Event), 0, false, SlotName, Event.UserIndex, FAsyncSaveGameToSlotDelegate::CreateLambda(
+						[State, Event, IssueTime](const FString&, const int32, bool bSuccess)
+						{
+							State->NumInFlight--;
+							State->AddResult(Event, FPlatformTime::Seconds() - IssueTime, bSuccess);
+						}
+					), Event.Priority);
+				}
+				break;
+
+			case EGameSaveTraceOp::SyncLoad:
+				{
+					const auto* LoadedSave{ Pipeline->LoadGameFromSlot(SlotName, Event.UserIndex) };
+
+					State->AddResult(Event, FPlatformTime::Seconds() - IssueTime, LoadedSave != nullptr);
+				}
+				break;
+
+			case EGameSaveTraceOp::AsyncLoad:
+				{
+					State->NumInFlight++;
+
+					Pipeline->AsyncLoadGameFromSlot(SlotName, Event.UserIndex, FAsyncLoadGameFromSlotDelegate::CreateLambda(
+						[State, Event, IssueTime](const FString&, const int32, USaveGame* LoadedSave)
+						{
+							State->NumInFlight--;
+							State->AddResult(Event, FPlatformTime::Seconds() - IssueTime, LoadedSave != nullptr);
+						}
+					));
+				}
+				break;
+
+			case EGameSaveTraceOp::Delete:
+				{
+					const auto bSuccess{ Pipeline->DeleteGameInSlot(SlotName, Event.UserIndex) };
+
+					LastSaves.Remove(SlotKey);
+
+					State->AddResult(Event, FPlatformTime::Seconds() - IssueTime, bSuccess);
+				}
+				break;
+
+			default:
+				break;
+			}
+
+			State->StallSamples[static_cast<int32>(Event.Op)].Add(FPlatformTime::Seconds() - IssueTime);
+			LastIssueTime = FPlatformTime::Seconds();
+
+			if ((NextIndex % GC_INTERVAL) == 0)
+			{
+				CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+			}
+		}
+
+		FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+
+		const auto TickTime{ FPlatformTime::Seconds() };
+		FTSTicker::GetCoreTicker().Tick(static_cast<float>(TickTime - LastTickTime));
+		LastTickTime = TickTime;
+
+		if ((NextIndex >= Trace.Events.Num()) && (TickTime - LastIssueTime > TimeoutSeconds))
+		{
+			UE_LOG(LogGameCore_Save, Error, TEXT("UGameSaveTraceReplayCommandlet: %d async operations did not complete within %.1f s"), State->NumInFlight, TimeoutSeconds);
+			break;
+		}
+
+		const auto SleepSeconds{ FrameSeconds - (FPlatformTime::Seconds() - FrameStartTime) };
+
+		if (SleepSeconds > 0.0)
+		{
+			FPlatformProcess::Sleep(static_cast<float>(SleepSeconds));
+		}
+	}
+
+	const auto TotalSeconds{ FPlatformTime::Seconds() - StartTime };
+	const auto bTimedOut{ State->NumInFlight > 0 };
+
+	// Summary next to the recorded latencies
+
+	TArray<double> RecordedSamples[static_cast<int32>(EGameSaveTraceOp::MAX)];
+
+	for (const auto& Event : Trace.Events)
+	{
+		RecordedSamples[static_cast<int32>(Event.Op)].Add(Event.Duration);
+	}
+
+	UE_LOG(LogGameCore_Save, Display, TEXT("UGameSaveTraceReplayCommandlet: %d operations in %.2f s (recorded %.2f s), %d recorded successes failed"),
+		Trace.Events.Num(), TotalSeconds, Trace.GetDuration(), State->NumMismatches);
+
+	for (int32 OpIndex{ 0 }; OpIndex < static_cast<int32>(EGameSaveTraceOp::MAX); ++OpIndex)
+	{
+		if (RecordedSamples[OpIndex].IsEmpty())
+		{
+			continue;
+		}
+
+		const auto* OpName{ FGameSaveTraceEvent::GetOpName(static_cast<EGameSaveTraceOp>(OpIndex)) };
+
+		UE_LOG(LogGameCore_Save, Display, TEXT("UGameSaveTraceReplayCommandlet: %s Stall %s"), OpName, *FGameSaveLatencyStats::FromSamples(MoveTemp(State->StallSamples[OpIndex])).ToString());
+		UE_LOG(LogGameCore_Save, Display, TEXT("UGameSaveTraceReplayCommandlet: %s Latency %s"), OpName, *FGameSaveLatencyStats::FromSamples(MoveTemp(State->LatencySamples[OpIndex])).ToString());
+		UE_LOG(LogGameCore_Save, Display, TEXT("UGameSaveTraceReplayCommandlet: %s Recorded %s"), OpName, *FGameSaveLatencyStats::FromSamples(MoveTemp(RecordedSamples[OpIndex])).ToString());
+	}
+
+	// Remove what the replay wrote
+
+	LastSaves.Empty();
+
+	if (!bTimedOut && !bKeep)
+	{
+		if (bExplicitStorage)
+		{
+			for (const auto& SlotKey : SeenSlots)
+			{
+				FString UserIndex;
+				FString SlotName;
+				SlotKey.Split(TEXT(":"), &UserIndex, &SlotName);
+
+				Pipeline->DeleteGameInSlot(SlotName, FCString::Atoi(*UserIndex));
+			}
+		}
+		else
+		{
+			IFileManager::Get().DeleteDirectory(*SandboxDirectory, false, true);
+		}
+	}
+
+	return (bTimedOut || (State->NumMismatches > 0)) ? 1 : 0;
+}
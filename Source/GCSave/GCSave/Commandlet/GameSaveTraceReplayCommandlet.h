@@ -0,0 +1,36 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+
+#include "GameSaveTraceReplayCommandlet.generated.h"
+
+
+/**
+ * Commandlet that replays a recorded trace of save and load traffic against the save pipeline, to benchmark changes offline
+ *
+ * Usage:
+ *	-run=GameSaveTraceReplay -Trace=<file> [-Speed=<factor>] [-FrameMs=<ms>] [-IOWorkers=<n>] [-Timeout=<seconds>] [-Seed=<n>] [-Keep] [-GameSaveStorage=<Type>]
+ *
+ * Tips:
+ *	Record traces with StartTraceRecording of the save subsystems or the "GameSave.Trace" console command, relative paths are relative to Saved/GameSaveTraces.
+ *	Runs headless, e.g. "UnrealEditor-Cmd <Project> -run=GameSaveTraceReplay -Trace=<file> -nullrhi -unattended" on a Linux build machine.
+ *	Each operation is issued at its recorded time divided by Speed, a Speed of 0 issues them all as fast as possible.
+ *	The core ticker runs once every FrameMs so that completions are dispatched per frame as in the game.
+ *	Saves use UGameSaveTraceReplaySave with random payloads of the recorded sizes, saves recorded as unchanged write the same data again.
+ *	Slots are written to a temporary directory that is deleted afterwards unless -Keep is given,
+ *	with -GameSaveStorage the storage of that type is used instead and the slot names are prefixed with "TraceReplay_".
+ *	The stall and latency of each operation type are logged next to the recorded ones, the commandlet fails if recorded successes fail.
+ */
+UCLASS()
+class UGameSaveTraceReplayCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+public:
+	UGameSaveTraceReplayCommandlet();
+
+public:
+	virtual int32 Main(const FString& Params) override;
+
+};
@@ -0,0 +1,123 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "GameSaveBlob.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(GameSaveBlob)
+
+
+namespace GameSaveBlob
+{
+	static thread_local FGameSaveBlobCollector* CurrentCollector{ nullptr };
+}
+
+
+void FGameSaveBlob::SetData(TArray<uint8> InData)
+{
+	if (InData.Num() == 0)
+	{
+		Reset();
+		return;
+	}
+
+	Hash = FIoHash::HashBuffer(InData.GetData(), InData.Num());
+	Size = InData.Num();
+	Data = MakeShared<const TArray<uint8>, ESPMode::ThreadSafe>(MoveTemp(InData));
+}
+
+void FGameSaveBlob::Reset()
+{
+	Hash = FIoHash();
+	Size = 0;
+	Data.Reset();
+}
+
+bool FGameSaveBlob::SetLoadedData(FGameSaveBlobDataPtr InData)
+{
+	if (!InData.IsValid() || (InData->Num() != Size) || (FIoHash::HashBuffer(InData->GetData(), InData->Num()) != Hash))
+	{
+		return false;
+	}
+
+	Data = InData;
+	return true;
+}
+
+bool FGameSaveBlob::Serialize(FArchive& Ar)
+{
+	if (Ar.IsCountingMemory())
+	{
+		if (Data.IsValid())
+		{
+			Ar.CountBytes(Data->Num(), Data->GetAllocatedSize());
+		}
+
+		return true;
+	}
+
+	auto SerializedHash{ Hash };
+
+	Ar << SerializedHash;
+	Ar << Size;
+
+	if (Ar.IsLoading())
+	{
+		// The payload stays valid when the same content is loaded again, e.g. when a checkpoint is restored
+
+		if (SerializedHash != Hash)
+		{
+			Data.Reset();
+		}
+
+		Hash = SerializedHash;
+	}
+	else if (Ar.IsSaving() && (Size > 0))
+	{
+		if (auto* Collector{ FGameSaveBlobCollector::GetCurrent() })
+		{
+			Collector->Blobs.Add(Hash, Data);
+		}
+	}
+
+	return true;
+}
+
+
+void FGameSaveBlobSet::Add(const FIoHash& InHash, const FGameSaveBlobDataPtr& InData)
+{
+	Hashes.AddUnique(InHash);
+
+	if (InData.IsValid())
+	{
+		Payloads.Add(InHash, InData);
+	}
+}
+
+void FGameSaveBlobSet::Append(const FGameSaveBlobSet& Other)
+{
+	for (const auto& OtherHash : Other.Hashes)
+	{
+		Add(OtherHash, Other.Payloads.FindRef(OtherHash));
+	}
+}
+
+
+FGameSaveBlobCollector::FGameSaveBlobCollector()
+	: Previous(GameSaveBlob::CurrentCollector)
+{
+	GameSaveBlob::CurrentCollector = this;
+}
+
+FGameSaveBlobCollector::~FGameSaveBlobCollector()
+{
+	GameSaveBlob::CurrentCollector = Previous;
+
+	if (Previous)
+	{
+		Previous->Blobs.Append(Blobs);
+	}
+}
+
+FGameSaveBlobCollector* FGameSaveBlobCollector::GetCurrent()
+{
+	return GameSaveBlob::CurrentCollector;
+}
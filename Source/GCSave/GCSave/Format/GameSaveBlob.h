@@ -0,0 +1,154 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "IO/IoHash.h"
+
+#include "GameSaveBlob.generated.h"
+
+using FGameSaveBlobDataPtr = TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe>;
+
+
+/**
+ * Delegate notifies that the payload of a blob has been loaded, the payload is nullptr if it could not be loaded
+ */
+DECLARE_DELEGATE_TwoParams(FGameSaveBlobLoadedDelegate, bool, FGameSaveBlobDataPtr);
+
+
+/**
+ * Large binary data of a save (screenshots, replay buffers ...) that is stored out of line in a side slot addressed by the hash of its content
+ *
+ * Tips:
+ *	The save itself only contains the hash and size, so the payload does not inflate every save and load.
+ *	The payload is only written when no side slot with the same content exists, and is shared by all saves of the user that reference it.
+ *	The payload of a loaded save is not loaded until SyncLoadBlob or AsyncLoadBlob of the save subsystem is called.
+ *
+ * Note:
+ *	Payloads are encrypted with the key of the saves when encryption is enabled. Side slots are deleted once no save of the user references them anymore.
+ *	A save whose blob was not loaded cannot be written once the side slot of the blob is gone.
+ */
+USTRUCT(BlueprintType)
+struct GCSAVE_API FGameSaveBlob
+{
+	GENERATED_BODY()
+public:
+	FGameSaveBlob() {}
+
+protected:
+	//
+	// Hash of the payload, zero if the blob is empty
+	//
+	FIoHash Hash;
+
+	int64 Size{ 0 };
+
+	//
+	// Payload, or nullptr if it has not been loaded
+	//
+	FGameSaveBlobDataPtr Data;
+
+public:
+	void SetData(TArray<uint8> InData);
+
+	void Reset();
+
+	/**
+	 * Sets the payload read from the side slot
+	 *
+	 * Note:
+	 *	Return false if the payload is not the content of this blob
+	 */
+	bool SetLoadedData(FGameSaveBlobDataPtr InData);
+
+	/**
+	 * Releases the payload from memory, it can be loaded again from the side slot
+	 *
+	 * Note:
+	 *	Only call this after the save has been written since the blob was set, otherwise the payload is lost
+	 */
+	void Unload() { Data.Reset(); }
+
+	bool IsEmpty() const { return Size == 0; }
+
+	bool IsLoaded() const { return IsEmpty() || Data.IsValid(); }
+
+	const FIoHash& GetHash() const { return Hash; }
+
+	int64 GetSize() const { return Size; }
+
+	/**
+	 * Returns the payload, or nullptr if it is empty or has not been loaded
+	 */
+	FGameSaveBlobDataPtr GetData() const { return Data; }
+
+	bool Serialize(FArchive& Ar);
+
+	bool operator==(const FGameSaveBlob& Other) const { return (Hash == Other.Hash) && (Size == Other.Size); }
+
+	bool operator!=(const FGameSaveBlob& Other) const { return !(*this == Other); }
+
+};
+
+template<>
+struct TStructOpsTypeTraits<FGameSaveBlob> : public TStructOpsTypeTraitsBase2<FGameSaveBlob>
+{
+	enum
+	{
+		WithSerializer = true,
+		WithIdenticalViaEquality = true,
+	};
+};
+
+
+/**
+ * Blobs referenced by serialized data
+ */
+struct FGameSaveBlobSet
+{
+public:
+	FGameSaveBlobSet() {}
+
+	//
+	// Hashes of all non-empty blobs, in the order they were serialized
+	//
+	TArray<FIoHash> Hashes;
+
+	//
+	// Payloads of the blobs that are loaded in memory
+	//
+	TMap<FIoHash, FGameSaveBlobDataPtr> Payloads;
+
+public:
+	void Add(const FIoHash& InHash, const FGameSaveBlobDataPtr& InData);
+
+	void Append(const FGameSaveBlobSet& Other);
+
+};
+
+
+/**
+ * Collects the blobs serialized by a saving archive on this thread while it is in scope
+ *
+ * Tips:
+ *	Collectors can be nested, the blobs are also added to the enclosing collector when the inner one goes out of scope
+ */
+class GCSAVE_API FGameSaveBlobCollector
+{
+public:
+	FGameSaveBlobCollector();
+	~FGameSaveBlobCollector();
+
+	FGameSaveBlobCollector(const FGameSaveBlobCollector&) = delete;
+	FGameSaveBlobCollector& operator=(const FGameSaveBlobCollector&) = delete;
+
+	/**
+	 * Returns the innermost collector of this thread, or nullptr if there is none
+	 */
+	static FGameSaveBlobCollector* GetCurrent();
+
+	FGameSaveBlobSet Blobs;
+
+protected:
+	FGameSaveBlobCollector* Previous{ nullptr };
+
+};
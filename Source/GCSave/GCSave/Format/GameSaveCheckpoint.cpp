@@ -0,0 +1,169 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "GameSaveCheckpoint.h"
+
+#include "Format/GameSaveSerializer.h"
+#include "GCSaveLogs.h"
+
+#include "GameFramework/SaveGame.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/Crc.h"
+#include "UObject/UnrealType.h"
+
+
+TSharedRef<const FGameSaveCheckpoint> FGameSaveCheckpoint::Capture(const USaveGame* SaveObject, FName InName, const FGameSaveCheckpoint* Previous)
+{
+	check(SaveObject);
+
+	auto Checkpoint{ MakeShared<FGameSaveCheckpoint>() };
+	Checkpoint->Name = InName;
+	Checkpoint->SaveGameClass = SaveObject->GetClass();
+	Checkpoint->CaptureTime = FPlatformTime::Seconds();
+
+	// Buffers can only be shared with a checkpoint of the same layout
+
+	if (Previous && (Previous->GetSaveGameClass() != SaveObject->GetClass()))
+	{
+		Previous = nullptr;
+	}
+
+	TArray<uint8> Bytes;
+	int32 PreviousIndex{ 0 };
+
+	for (TFieldIterator<FProperty> It(SaveObject->GetClass()); It; ++It)
+	{
+		const auto* Property{ *It };
+
+		if (!FGameSaveSerializer::IsSavedProperty(Property))
+		{
+			continue;
+		}
+
+		FGameSaveSerializer::SerializeProperty(SaveObject, Property, Bytes);
+
+		const auto PropertyName{ Property->GetFName() };
+		const auto Hash{ FCrc::MemCrc32(Bytes.GetData(), Bytes.Num()) };
+
+		// Properties are captured in the same order, so the previous one is usually at the same index
+
+		const FCapturedProperty* Shared{ nullptr };
+
+		if (Previous && Previous->Properties.IsValidIndex(PreviousIndex))
+		{
+			const auto& Candidate{ Previous->Properties[PreviousIndex++] };
+
+			if ((Candidate.PropertyName == PropertyName)
+				&& (Candidate.Hash == Hash)
+				&& (Candidate.Data->Num() == Bytes.Num())
+				&& (FMemory::Memcmp(Candidate.Data->GetData(), Bytes.GetData(), Bytes.Num()) == 0))
+			{
+				Shared = &Candidate;
+			}
+		}
+
+		if (Shared)
+		{
+			Checkpoint->Properties.Emplace(PropertyName, Hash, Shared->Data);
+		}
+		else
+		{
+			Checkpoint->Properties.Emplace(PropertyName, Hash, MakeShared<TArray<uint8>, ESPMode::ThreadSafe>(Bytes));
+		}
+	}
+
+	return Checkpoint;
+}
+
+bool FGameSaveCheckpoint::Restore(USaveGame* SaveObject, TArray<FName>* OutChangedProperties) const
+{
+	check(SaveObject);
+
+	const auto* Class{ SaveObject->GetClass() };
+
+	if (Class != SaveGameClass.Get())
+	{
+		UE_LOG(LogGameCore_Save, Error, TEXT("FGameSaveCheckpoint::Restore: Checkpoint(%s) was not captured from class(%s)"), *Name.ToString(), *GetNameSafe(Class));
+		return false;
+	}
+
+	auto bSuccess{ true };
+	TArray<uint8> CurrentBytes;
+
+	for (const auto& Captured : Properties)
+	{
+		const auto* Property{ FindFProperty<FProperty>(Class, Captured.PropertyName) };
+
+		if (!Property)
+		{
+			continue;
+		}
+
+		// Skip properties that still hold the captured value
+
+		FGameSaveSerializer::SerializeProperty(SaveObject, Property, CurrentBytes);
+
+		if ((CurrentBytes.Num() == Captured.Data->Num())
+			&& (FMemory::Memcmp(CurrentBytes.GetData(), Captured.Data->GetData(), CurrentBytes.Num()) == 0))
+		{
+			continue;
+		}
+
+		if (!FGameSaveSerializer::DeserializeProperty(SaveObject, Property, *Captured.Data))
+		{
+			UE_LOG(LogGameCore_Save, Error, TEXT("FGameSaveCheckpoint::Restore: Failed to restore property(%s) of checkpoint(%s)"), *Captured.PropertyName.ToString(), *Name.ToString());
+			bSuccess = false;
+		}
+
+		if (OutChangedProperties)
+		{
+			OutChangedProperties->Add(Captured.PropertyName);
+		}
+	}
+
+	return bSuccess;
+}
+
+int64 FGameSaveCheckpoint::GetTotalBytes() const
+{
+	int64 Total{ 0 };
+
+	for (const auto& Captured : Properties)
+	{
+		Total += Captured.Data->Num();
+	}
+
+	return Total;
+}
+
+int64 FGameSaveCheckpoint::GetUniqueBytes() const
+{
+	int64 Total{ 0 };
+
+	for (const auto& Captured : Properties)
+	{
+		if (Captured.Data.GetSharedReferenceCount() == 1)
+		{
+			Total += Captured.Data->Num();
+		}
+	}
+
+	return Total;
+}
+
+int64 FGameSaveCheckpoint::AccumulateBytes(TSet<const void*>& CountedBuffers) const
+{
+	int64 Total{ 0 };
+
+	for (const auto& Captured : Properties)
+	{
+		auto bAlreadyCounted{ false };
+		CountedBuffers.Add(&Captured.Data.Get(), &bAlreadyCounted);
+
+		if (!bAlreadyCounted)
+		{
+			Total += Captured.Data->Num();
+		}
+	}
+
+	return Total;
+}
@@ -0,0 +1,95 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Containers/Set.h"
+#include "Templates/SharedPointer.h"
+#include "UObject/WeakObjectPtrTemplates.h"
+
+class USaveGame;
+class UClass;
+
+
+/**
+ * In-memory snapshot of the saved properties of a save game object
+ *
+ * Tips:
+ *	Each property is kept as its own immutable buffer. Capturing with the previous checkpoint of the same object shares
+ *	the buffers of properties that have not changed since then, so checkpoints of mostly unchanged data cost only their changes.
+ *	Restoring writes the buffers back into the existing object, nothing is read from disk and no object is created.
+ */
+class GCSAVE_API FGameSaveCheckpoint
+{
+public:
+	FGameSaveCheckpoint() {}
+
+public:
+	/**
+	 * Captures the saved properties of the object
+	 *
+	 * Tips:
+	 *	If Previous is a checkpoint of the same class, unchanged properties share its buffers
+	 */
+	static TSharedRef<const FGameSaveCheckpoint> Capture(const USaveGame* SaveObject, FName InName, const FGameSaveCheckpoint* Previous = nullptr);
+
+	/**
+	 * Writes the captured properties back into the object, properties whose value did not change are not touched
+	 *
+	 * Note:
+	 *	Return false if the object is not of the captured class or a property could not be read
+	 */
+	bool Restore(USaveGame* SaveObject, TArray<FName>* OutChangedProperties = nullptr) const;
+
+	FName GetName() const { return Name; }
+
+	const UClass* GetSaveGameClass() const { return SaveGameClass.Get(); }
+
+	double GetCaptureTime() const { return CaptureTime; }
+
+	/**
+	 * Returns the size of all captured properties
+	 */
+	int64 GetTotalBytes() const;
+
+	/**
+	 * Returns the size of the properties whose buffer is not shared with other checkpoints
+	 */
+	int64 GetUniqueBytes() const;
+
+	/**
+	 * Returns the size of the buffers that are not in CountedBuffers yet and adds them to it
+	 *
+	 * Tips:
+	 *	Use the same set for several checkpoints to count shared buffers once
+	 */
+	int64 AccumulateBytes(TSet<const void*>& CountedBuffers) const;
+
+protected:
+	using FPropertyBuffer = TSharedRef<const TArray<uint8>, ESPMode::ThreadSafe>;
+
+	struct FCapturedProperty
+	{
+	public:
+		FCapturedProperty(FName InPropertyName, uint32 InHash, FPropertyBuffer InData)
+			: PropertyName(InPropertyName), Hash(InHash), Data(MoveTemp(InData))
+		{}
+
+		FName PropertyName;
+
+		uint32 Hash{ 0 };
+
+		FPropertyBuffer Data;
+	};
+
+	FName Name;
+
+	TWeakObjectPtr<const UClass> SaveGameClass;
+
+	double CaptureTime{ 0.0 };
+
+	//
+	// Captured properties in the order of the class
+	//
+	TArray<FCapturedProperty> Properties;
+
+};
@@ -0,0 +1,1022 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "GameSaveColumnar.h"
+
+#include "Format/GameSaveSerializer.h"
+#include "GCSaveLogs.h"
+
+#include "Math/VectorRegister.h"
+#include "Misc/ByteSwap.h"
+#include "Misc/ScopeLock.h"
+#include "UObject/EnumProperty.h"
+#include "UObject/UnrealType.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(GameSaveColumnar)
+
+
+namespace GameSaveColumnar
+{
+	//
+	// Type of the values of a column, values of up to 32 bits are stored in 32 bit lanes
+	//
+	enum class EColumnType : uint8
+	{
+		Bool,
+		Int32,
+		UInt32,
+		Float,
+		Int64,
+		UInt64,
+		Double,
+		MAX
+	};
+
+	//
+	// Transform applied to the values of a column before they are bit-packed
+	//
+	enum class EColumnCodec : uint8
+	{
+		// Values as they are, zigzag encoded if signed
+		Raw,
+
+		// Zigzag encoded difference to the previous value
+		Delta,
+
+		// Bits xor the bits of the previous value
+		Xor,
+		MAX
+	};
+
+	//
+	// Numeric field of the elements, nested structs and static arrays are flattened
+	//
+	struct FColumnField
+	{
+		//
+		// Path of the field in the element, e.g. "Location.X" or "Flags[2]"
+		//
+		FString Path;
+
+		const FProperty* Property{ nullptr };
+
+		EColumnType Type{ EColumnType::Int32 };
+
+		//
+		// Offset of the value from the start of the element
+		//
+		int32 Offset{ 0 };
+
+		//
+		// Size in bytes of the value in the element
+		//
+		int32 Size{ 0 };
+	};
+
+	static bool Is64Bit(EColumnType Type) { return Type >= EColumnType::Int64; }
+
+	static bool IsSigned(EColumnType Type) { return (Type == EColumnType::Int32) || (Type == EColumnType::Int64); }
+
+	static bool IsFloatingPoint(EColumnType Type) { return (Type == EColumnType::Float) || (Type == EColumnType::Double); }
+
+	static bool UsesZigZag(EColumnCodec Codec, EColumnType Type) { return (Codec == EColumnCodec::Delta) || ((Codec == EColumnCodec::Raw) && IsSigned(Type)); }
+
+
+	//////////////////////////////////////////////////////////////////
+	// Fields
+
+	static bool GetColumnType(const FProperty* Property, EColumnType& OutType)
+	{
+		if (const auto* EnumProperty{ CastField<FEnumProperty>(Property) })
+		{
+			return GetColumnType(EnumProperty->GetUnderlyingProperty(), OutType);
+		}
+
+		if (Property->IsA<FBoolProperty>())
+		{
+			OutType = EColumnType::Bool;
+		}
+		else if (Property->IsA<FInt8Property>() || Property->IsA<FInt16Property>() || Property->IsA<FIntProperty>())
+		{
+			OutType = EColumnType::Int32;
+		}
+		else if (Property->IsA<FByteProperty>() || Property->IsA<FUInt16Property>() || Property->IsA<FUInt32Property>())
+		{
+			OutType = EColumnType::UInt32;
+		}
+		else if (Property->IsA<FFloatProperty>())
+		{
+			OutType = EColumnType::Float;
+		}
+		else if (Property->IsA<FInt64Property>())
+		{
+			OutType = EColumnType::Int64;
+		}
+		else if (Property->IsA<FUInt64Property>())
+		{
+			OutType = EColumnType::UInt64;
+		}
+		else if (Property->IsA<FDoubleProperty>())
+		{
+			OutType = EColumnType::Double;
+		}
+		else
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+	/**
+	 * Flattens the fields of the struct, returns false if it has a field that cannot be stored in a column
+	 */
+	static bool GatherFields(const UScriptStruct* Struct, const FString& Prefix, int32 BaseOffset, TArray<FColumnField>& OutFields)
+	{
+		for (TFieldIterator<FProperty> It(Struct); It; ++It)
+		{
+			const auto* Property{ *It };
+
+			if (!FGameSaveSerializer::IsSavedProperty(Property))
+			{
+				continue;
+			}
+
+			for (int32 ArrayIndex{ 0 }; ArrayIndex < Property->ArrayDim; ++ArrayIndex)
+			{
+				auto Path{ Prefix + Property->GetName() };
+
+				if (Property->ArrayDim > 1)
+				{
+					Path += FString::Printf(TEXT("[%d]"), ArrayIndex);
+				}
+
+				const auto Offset{ BaseOffset + Property->GetOffset_ForInternal() + (Property->ElementSize * ArrayIndex) };
+
+				if (const auto* StructProperty{ CastField<FStructProperty>(Property) })
+				{
+					if (!GatherFields(StructProperty->Struct, Path + TEXT("."), Offset, OutFields))
+					{
+						return false;
+					}
+
+					continue;
+				}
+
+				EColumnType Type;
+
+				if (!GetColumnType(Property, Type))
+				{
+					return false;
+				}
+
+				auto& Field{ OutFields.AddDefaulted_GetRef() };
+				Field.Path = MoveTemp(Path);
+				Field.Property = Property;
+				Field.Type = Type;
+				Field.Offset = Offset;
+				Field.Size = Property->ElementSize;
+			}
+		}
+
+		return true;
+	}
+
+	static const UScriptStruct* GetElementStruct(const FArrayProperty* ArrayProperty)
+	{
+		const auto* StructProperty{ CastField<FStructProperty>(ArrayProperty->Inner) };
+
+		return StructProperty ? StructProperty->Struct : nullptr;
+	}
+
+	static FCriticalSection WarnedPropertiesCS;
+	static TSet<FString> WarnedProperties;
+
+	/**
+	 * Returns true the first time it is called for the property of the class, saves may run on worker threads
+	 */
+	static bool ShouldWarnProperty(const UClass* Class, const FProperty* Property)
+	{
+		FScopeLock Lock(&WarnedPropertiesCS);
+
+		bool bAlreadyWarned{ false };
+		WarnedProperties.Add(Class->GetPathName() + TEXT(":") + Property->GetName(), &bAlreadyWarned);
+
+		return !bAlreadyWarned;
+	}
+
+
+	//////////////////////////////////////////////////////////////////
+	// Values
+
+	template<typename T, typename U>
+	static FORCEINLINE T CastBits(const U& Value)
+	{
+		static_assert(sizeof(T) == sizeof(U), "Sizes must match");
+
+		T Result;
+		FMemory::Memcpy(&Result, &Value, sizeof(T));
+		return Result;
+	}
+
+	/**
+	 * Reads the value of the field as the bits of its column type
+	 */
+	static uint64 ReadValue(const FColumnField& Field, const uint8* ValuePtr)
+	{
+		switch (Field.Type)
+		{
+		case EColumnType::Bool:
+			return CastFieldChecked<FBoolProperty>(Field.Property)->GetPropertyValue(ValuePtr) ? 1 : 0;
+
+		case EColumnType::Int32:
+			switch (Field.Size)
+			{
+			case 1: return static_cast<uint32>(static_cast<int32>(*reinterpret_cast<const int8*>(ValuePtr)));
+			case 2: return static_cast<uint32>(static_cast<int32>(*reinterpret_cast<const int16*>(ValuePtr)));
+			default: return *reinterpret_cast<const uint32*>(ValuePtr);
+			}
+
+		case EColumnType::UInt32:
+			switch (Field.Size)
+			{
+			case 1: return *ValuePtr;
+			case 2: return *reinterpret_cast<const uint16*>(ValuePtr);
+			default: return *reinterpret_cast<const uint32*>(ValuePtr);
+			}
+
+		case EColumnType::Float:
+			return *reinterpret_cast<const uint32*>(ValuePtr);
+
+		default:
+			return *reinterpret_cast<const uint64*>(ValuePtr);
+		}
+	}
+
+	/**
+	 * Writes the bits of the column type to the field, integers narrower than their lane are truncated
+	 */
+	static void WriteValue(const FColumnField& Field, uint8* ValuePtr, uint64 Bits)
+	{
+		switch (Field.Type)
+		{
+		case EColumnType::Bool:
+			CastFieldChecked<FBoolProperty>(Field.Property)->SetPropertyValue(ValuePtr, Bits != 0);
+			break;
+
+		case EColumnType::Int32:
+		case EColumnType::UInt32:
+			switch (Field.Size)
+			{
+			case 1: *ValuePtr = static_cast<uint8>(Bits); break;
+			case 2: *reinterpret_cast<uint16*>(ValuePtr) = static_cast<uint16>(Bits); break;
+			default: *reinterpret_cast<uint32*>(ValuePtr) = static_cast<uint32>(Bits); break;
+			}
+			break;
+
+		case EColumnType::Float:
+			*reinterpret_cast<uint32*>(ValuePtr) = static_cast<uint32>(Bits);
+			break;
+
+		default:
+			*reinterpret_cast<uint64*>(ValuePtr) = Bits;
+			break;
+		}
+	}
+
+	/**
+	 * Converts the bits of a value between column types, used when the type of a field changed since it was saved
+	 */
+	static uint64 ConvertValue(uint64 Bits, EColumnType From, EColumnType To)
+	{
+		if (From == To)
+		{
+			return Bits;
+		}
+
+		if (IsFloatingPoint(From) || IsFloatingPoint(To))
+		{
+			double Value;
+
+			switch (From)
+			{
+			case EColumnType::Float: Value = CastBits<float>(static_cast<uint32>(Bits)); break;
+			case EColumnType::Double: Value = CastBits<double>(Bits); break;
+			case EColumnType::Int32: Value = static_cast<int32>(static_cast<uint32>(Bits)); break;
+			case EColumnType::Int64: Value = static_cast<double>(static_cast<int64>(Bits)); break;
+			default: Value = static_cast<double>(Bits); break;
+			}
+
+			switch (To)
+			{
+			case EColumnType::Float: return CastBits<uint32>(static_cast<float>(Value));
+			case EColumnType::Double: return CastBits<uint64>(Value);
+			case EColumnType::Bool: return (Value != 0.0) ? 1 : 0;
+			case EColumnType::Int32: return static_cast<uint32>(static_cast<int32>(Value));
+			case EColumnType::UInt32: return static_cast<uint32>(Value);
+			default: return static_cast<uint64>(static_cast<int64>(Value));
+			}
+		}
+
+		const auto Value{ (From == EColumnType::Int32) ? static_cast<int64>(static_cast<int32>(static_cast<uint32>(Bits))) : static_cast<int64>(Bits) };
+
+		switch (To)
+		{
+		case EColumnType::Bool: return (Value != 0) ? 1 : 0;
+		case EColumnType::Int32: return static_cast<uint32>(static_cast<int32>(Value));
+		case EColumnType::UInt32: return static_cast<uint32>(Value);
+		default: return static_cast<uint64>(Value);
+		}
+	}
+
+
+	//////////////////////////////////////////////////////////////////
+	// Codec
+
+	static FORCEINLINE uint32 ZigZag(uint32 Value) { return (Value << 1) ^ static_cast<uint32>(static_cast<int32>(Value) >> 31); }
+
+	static FORCEINLINE uint64 ZigZag(uint64 Value) { return (Value << 1) ^ static_cast<uint64>(static_cast<int64>(Value) >> 63); }
+
+	static FORCEINLINE uint32 UnZigZag(uint32 Value) { return (Value >> 1) ^ (0u - (Value & 1u)); }
+
+	static FORCEINLINE uint64 UnZigZag(uint64 Value) { return (Value >> 1) ^ (0ull - (Value & 1ull)); }
+
+	static FORCEINLINE uint32 GetBitWidth(uint32 Bits) { return (Bits != 0) ? (32 - static_cast<uint32>(FMath::CountLeadingZeros(Bits))) : 0; }
+
+	static FORCEINLINE uint32 GetBitWidth(uint64 Bits) { return (Bits != 0) ? (64 - static_cast<uint32>(FMath::CountLeadingZeros64(Bits))) : 0; }
+
+	template<typename T>
+	static FORCEINLINE T EncodeValue(T Value, T Previous, EColumnCodec Codec, bool bZigZag)
+	{
+		if (Codec == EColumnCodec::Delta)
+		{
+			Value -= Previous;
+		}
+		else if (Codec == EColumnCodec::Xor)
+		{
+			Value ^= Previous;
+		}
+
+		return bZigZag ? ZigZag(Value) : Value;
+	}
+
+	/**
+	 * Transforms the values with the codec and returns the bitwise or of the results
+	 */
+	static uint32 EncodeValues(const uint32* Values, uint32* OutValues, int32 Num, EColumnCodec Codec, bool bZigZag)
+	{
+		if (Num <= 0)
+		{
+			return 0;
+		}
+
+		OutValues[0] = EncodeValue<uint32>(Values[0], 0, Codec, bZigZag);
+
+		auto Bits{ OutValues[0] };
+		int32 Index{ 1 };
+
+		// Four values at a time, the previous values are the same four loaded one element earlier
+
+		auto BitsVector{ MakeVectorRegisterInt(0, 0, 0, 0) };
+
+		for (; Index + 4 <= Num; Index += 4)
+		{
+			auto Vector{ VectorIntLoad(Values + Index) };
+			const auto Previous{ VectorIntLoad(Values + Index - 1) };
+
+			if (Codec == EColumnCodec::Delta)
+			{
+				Vector = VectorIntSubtract(Vector, Previous);
+			}
+			else if (Codec == EColumnCodec::Xor)
+			{
+				Vector = VectorIntXor(Vector, Previous);
+			}
+
+			if (bZigZag)
+			{
+				Vector = VectorIntXor(VectorShiftLeftImm(Vector, 1), VectorShiftRightImmArithmetic(Vector, 31));
+			}
+
+			VectorIntStore(Vector, OutValues + Index);
+			BitsVector = VectorIntOr(BitsVector, Vector);
+		}
+
+		for (; Index < Num; ++Index)
+		{
+			OutValues[Index] = EncodeValue(Values[Index], Values[Index - 1], Codec, bZigZag);
+			Bits |= OutValues[Index];
+		}
+
+		alignas(16) uint32 Lanes[4];
+		VectorIntStoreAligned(BitsVector, Lanes);
+
+		return Bits | Lanes[0] | Lanes[1] | Lanes[2] | Lanes[3];
+	}
+
+	/**
+	 * Transforms the values with the codec and returns the bitwise or of the results
+	 *
+	 * Note:
+	 *	64 bit lanes are transformed one by one since not all platforms have 64 bit integer vector operations
+	 */
+	static uint64 EncodeValues(const uint64* Values, uint64* OutValues, int32 Num, EColumnCodec Codec, bool bZigZag)
+	{
+		uint64 Bits{ 0 };
+		uint64 Previous{ 0 };
+
+		for (int32 Index{ 0 }; Index < Num; ++Index)
+		{
+			OutValues[Index] = EncodeValue(Values[Index], Previous, Codec, bZigZag);
+			Bits |= OutValues[Index];
+			Previous = Values[Index];
+		}
+
+		return Bits;
+	}
+
+	/**
+	 * Reverts EncodeValues in place
+	 */
+	static void DecodeValues(uint32* Values, int32 Num, EColumnCodec Codec, bool bZigZag)
+	{
+		if (bZigZag)
+		{
+			const auto Zero{ MakeVectorRegisterInt(0, 0, 0, 0) };
+			const auto One{ MakeVectorRegisterInt(1, 1, 1, 1) };
+
+			int32 Index{ 0 };
+
+			for (; Index + 4 <= Num; Index += 4)
+			{
+				const auto Vector{ VectorIntLoad(Values + Index) };
+				const auto Sign{ VectorIntSubtract(Zero, VectorIntAnd(Vector, One)) };
+
+				VectorIntStore(VectorIntXor(VectorShiftRightImmLogical(Vector, 1), Sign), Values + Index);
+			}
+
+			for (; Index < Num; ++Index)
+			{
+				Values[Index] = UnZigZag(Values[Index]);
+			}
+		}
+
+		if ((Codec != EColumnCodec::Delta) && (Codec != EColumnCodec::Xor))
+		{
+			return;
+		}
+
+		// Prefix sum (or xor) of four values at a time, each lane is combined with the lanes before it in two shifted steps
+		// and then with the last value of the previous four
+
+		const auto bDelta{ Codec == EColumnCodec::Delta };
+		const auto ShiftOneMask{ MakeVectorRegisterInt(0, -1, -1, -1) };
+		const auto ShiftTwoMask{ MakeVectorRegisterInt(0, 0, -1, -1) };
+
+		auto Combine
+		{
+			[bDelta](const VectorRegister4Int& A, const VectorRegister4Int& B)
+			{
+				return bDelta ? VectorIntAdd(A, B) : VectorIntXor(A, B);
+			}
+		};
+
+		auto Carry{ MakeVectorRegisterInt(0, 0, 0, 0) };
+		int32 Index{ 0 };
+
+		for (; Index + 4 <= Num; Index += 4)
+		{
+			auto Vector{ VectorIntLoad(Values + Index) };
+			const auto VectorAsFloat{ VectorCastIntToFloat(Vector) };
+
+			Vector = Combine(Vector, VectorIntAnd(VectorCastFloatToInt(VectorSwizzle(VectorAsFloat, 0, 0, 1, 2)), ShiftOneMask));
+			Vector = Combine(Vector, VectorIntAnd(VectorCastFloatToInt(VectorSwizzle(VectorCastIntToFloat(Vector), 0, 0, 0, 1)), ShiftTwoMask));
+			Vector = Combine(Vector, Carry);
+
+			VectorIntStore(Vector, Values + Index);
+			Carry = VectorCastFloatToInt(VectorReplicate(VectorCastIntToFloat(Vector), 3));
+		}
+
+		for (Index = FMath::Max(Index, 1); Index < Num; ++Index)
+		{
+			Values[Index] = bDelta ? (Values[Index] + Values[Index - 1]) : (Values[Index] ^ Values[Index - 1]);
+		}
+	}
+
+	/**
+	 * Reverts EncodeValues in place
+	 */
+	static void DecodeValues(uint64* Values, int32 Num, EColumnCodec Codec, bool bZigZag)
+	{
+		for (int32 Index{ 0 }; Index < Num; ++Index)
+		{
+			auto Value{ bZigZag ? UnZigZag(Values[Index]) : Values[Index] };
+			const auto Previous{ (Index > 0) ? Values[Index - 1] : 0 };
+
+			if (Codec == EColumnCodec::Delta)
+			{
+				Value += Previous;
+			}
+			else if (Codec == EColumnCodec::Xor)
+			{
+				Value ^= Previous;
+			}
+
+			Values[Index] = Value;
+		}
+	}
+
+
+	//////////////////////////////////////////////////////////////////
+	// Bit Packing
+
+	/**
+	 * Writes values of up to 32 bits into a little-endian bit stream a word at a time
+	 */
+	struct FColumnBitWriter
+	{
+	public:
+		explicit FColumnBitWriter(TArray<uint8>& InBytes) : Bytes(InBytes) {}
+
+		TArray<uint8>& Bytes;
+
+		uint64 Accumulator{ 0 };
+
+		uint32 NumBits{ 0 };
+
+	public:
+		FORCEINLINE void Write(uint32 Bits, uint32 Width)
+		{
+			Accumulator |= static_cast<uint64>(Bits) << NumBits;
+			NumBits += Width;
+
+			if (NumBits >= 32)
+			{
+				const auto Word{ INTEL_ORDER32(static_cast<uint32>(Accumulator)) };
+				Bytes.Append(reinterpret_cast<const uint8*>(&Word), sizeof(Word));
+
+				Accumulator >>= 32;
+				NumBits -= 32;
+			}
+		}
+
+		void Flush()
+		{
+			for (; NumBits > 0; NumBits = (NumBits > 8) ? (NumBits - 8) : 0)
+			{
+				Bytes.Add(static_cast<uint8>(Accumulator));
+				Accumulator >>= 8;
+			}
+		}
+	};
+
+	/**
+	 * Reads values of up to 32 bits from a stream written by FColumnBitWriter
+	 */
+	struct FColumnBitReader
+	{
+	public:
+		explicit FColumnBitReader(const TArray<uint8>& InBytes) : Bytes(InBytes) {}
+
+		const TArray<uint8>& Bytes;
+
+		int32 Position{ 0 };
+
+		uint64 Accumulator{ 0 };
+
+		uint32 NumBits{ 0 };
+
+	public:
+		FORCEINLINE uint32 Read(uint32 Width)
+		{
+			if (NumBits < Width)
+			{
+				// The last word may be shorter than four bytes
+
+				uint32 Word{ 0 };
+				const auto NumRead{ FMath::Min<int32>(sizeof(Word), Bytes.Num() - Position) };
+
+				FMemory::Memcpy(&Word, Bytes.GetData() + Position, NumRead);
+				Position += NumRead;
+
+				Accumulator |= static_cast<uint64>(INTEL_ORDER32(Word)) << NumBits;
+				NumBits += 32;
+			}
+
+			const auto Bits{ static_cast<uint32>(Accumulator & ((1ull << Width) - 1)) };
+
+			Accumulator >>= Width;
+			NumBits -= Width;
+
+			return Bits;
+		}
+	};
+
+	static int64 GetPackedSize(int32 Num, uint32 Width)
+	{
+		return ((static_cast<int64>(Num) * Width) + 7) / 8;
+	}
+
+	static void PackValues(const uint32* Values, int32 Num, uint32 Width, TArray<uint8>& OutBytes)
+	{
+		OutBytes.Reset(GetPackedSize(Num, Width) + sizeof(uint32));
+
+		if (Width == 0)
+		{
+			return;
+		}
+
+		FColumnBitWriter Writer(OutBytes);
+
+		for (int32 Index{ 0 }; Index < Num; ++Index)
+		{
+			Writer.Write(Values[Index], Width);
+		}
+
+		Writer.Flush();
+	}
+
+	static void PackValues(const uint64* Values, int32 Num, uint32 Width, TArray<uint8>& OutBytes)
+	{
+		OutBytes.Reset(GetPackedSize(Num, Width) + sizeof(uint32));
+
+		if (Width == 0)
+		{
+			return;
+		}
+
+		FColumnBitWriter Writer(OutBytes);
+
+		// Values wider than 32 bits are written as their low word followed by the rest
+
+		const auto LowWidth{ FMath::Min<uint32>(Width, 32) };
+		const auto HighWidth{ Width - LowWidth };
+
+		for (int32 Index{ 0 }; Index < Num; ++Index)
+		{
+			Writer.Write(static_cast<uint32>(Values[Index]), LowWidth);
+
+			if (HighWidth > 0)
+			{
+				Writer.Write(static_cast<uint32>(Values[Index] >> 32), HighWidth);
+			}
+		}
+
+		Writer.Flush();
+	}
+
+	static void UnpackValues(const TArray<uint8>& Bytes, int32 Num, uint32 Width, uint32* OutValues)
+	{
+		if (Width == 0)
+		{
+			FMemory::Memzero(OutValues, sizeof(uint32) * Num);
+			return;
+		}
+
+		FColumnBitReader Reader(Bytes);
+
+		for (int32 Index{ 0 }; Index < Num; ++Index)
+		{
+			OutValues[Index] = Reader.Read(Width);
+		}
+	}
+
+	static void UnpackValues(const TArray<uint8>& Bytes, int32 Num, uint32 Width, uint64* OutValues)
+	{
+		if (Width == 0)
+		{
+			FMemory::Memzero(OutValues, sizeof(uint64) * Num);
+			return;
+		}
+
+		FColumnBitReader Reader(Bytes);
+
+		const auto LowWidth{ FMath::Min<uint32>(Width, 32) };
+		const auto HighWidth{ Width - LowWidth };
+
+		for (int32 Index{ 0 }; Index < Num; ++Index)
+		{
+			const uint64 Low{ Reader.Read(LowWidth) };
+			const uint64 High{ (HighWidth > 0) ? Reader.Read(HighWidth) : 0 };
+
+			OutValues[Index] = Low | (High << 32);
+		}
+	}
+
+
+	//////////////////////////////////////////////////////////////////
+	// Columns
+
+	/**
+	 * Encodes the values with the raw codec and the delta codec of the type, and packs the result that needs fewer bits
+	 */
+	template<typename T>
+	static void EncodeColumn(const TArray<T>& Values, EColumnType Type, EColumnCodec& OutCodec, uint32& OutWidth, TArray<uint8>& OutBytes)
+	{
+		TArray<T> Encoded;
+		Encoded.SetNumUninitialized(Values.Num());
+
+		OutCodec = EColumnCodec::Raw;
+		OutWidth = GetBitWidth(EncodeValues(Values.GetData(), Encoded.GetData(), Values.Num(), OutCodec, UsesZigZag(OutCodec, Type)));
+
+		if ((Type != EColumnType::Bool) && (OutWidth > 0))
+		{
+			const auto DeltaCodec{ IsFloatingPoint(Type) ? EColumnCodec::Xor : EColumnCodec::Delta };
+
+			TArray<T> DeltaEncoded;
+			DeltaEncoded.SetNumUninitialized(Values.Num());
+
+			const auto DeltaWidth{ GetBitWidth(EncodeValues(Values.GetData(), DeltaEncoded.GetData(), Values.Num(), DeltaCodec, UsesZigZag(DeltaCodec, Type))) };
+
+			if (DeltaWidth < OutWidth)
+			{
+				Encoded = MoveTemp(DeltaEncoded);
+				OutCodec = DeltaCodec;
+				OutWidth = DeltaWidth;
+			}
+		}
+
+		PackValues(Encoded.GetData(), Encoded.Num(), OutWidth, OutBytes);
+	}
+
+	template<typename T>
+	static bool DecodeColumn(const TArray<uint8>& Bytes, int32 Num, EColumnType Type, EColumnCodec Codec, uint32 Width, TArray<T>& OutValues)
+	{
+		if ((Width > sizeof(T) * 8) || (Bytes.Num() != GetPackedSize(Num, Width)))
+		{
+			return false;
+		}
+
+		OutValues.SetNumUninitialized(Num);
+
+		UnpackValues(Bytes, Num, Width, OutValues.GetData());
+		DecodeValues(OutValues.GetData(), Num, Codec, UsesZigZag(Codec, Type));
+
+		return true;
+	}
+
+	template<typename T>
+	static void GatherValues(FScriptArrayHelper& ArrayHelper, const FColumnField& Field, TArray<T>& OutValues)
+	{
+		OutValues.SetNumUninitialized(ArrayHelper.Num());
+
+		for (int32 Index{ 0 }; Index < OutValues.Num(); ++Index)
+		{
+			OutValues[Index] = static_cast<T>(ReadValue(Field, ArrayHelper.GetRawPtr(Index) + Field.Offset));
+		}
+	}
+
+	template<typename T>
+	static void ScatterValues(FScriptArrayHelper& ArrayHelper, const FColumnField& Field, EColumnType SavedType, const TArray<T>& Values)
+	{
+		for (int32 Index{ 0 }; Index < Values.Num(); ++Index)
+		{
+			WriteValue(Field, ArrayHelper.GetRawPtr(Index) + Field.Offset, ConvertValue(Values[Index], SavedType, Field.Type));
+		}
+	}
+
+	/**
+	 * Reads the columns of an array, and stores them into the array if it still exists
+	 */
+	static bool ReadColumns(FArchive& Ar, int32 NumColumns, int32 Num, FScriptArrayHelper* ArrayHelper, const TArray<FColumnField>& Fields)
+	{
+		TArray<uint32> Values32;
+		TArray<uint64> Values64;
+
+		for (int32 ColumnIndex{ 0 }; ColumnIndex < NumColumns; ++ColumnIndex)
+		{
+			FString Path;
+			uint8 TypeValue{ 0 };
+			uint8 CodecValue{ 0 };
+			uint8 Width{ 0 };
+			TArray<uint8> Bytes;
+
+			Ar << Path;
+			Ar << TypeValue;
+			Ar << CodecValue;
+			Ar << Width;
+			Ar << Bytes;
+
+			if (Ar.IsError() || (TypeValue >= static_cast<uint8>(EColumnType::MAX)) || (CodecValue >= static_cast<uint8>(EColumnCodec::MAX)))
+			{
+				return false;
+			}
+
+			const auto Type{ static_cast<EColumnType>(TypeValue) };
+			const auto Codec{ static_cast<EColumnCodec>(CodecValue) };
+
+			// Columns of removed fields are skipped, but still validated
+
+			const auto* Field{ ArrayHelper ? Fields.FindByPredicate([&Path](const FColumnField& Each) { return Each.Path == Path; }) : nullptr };
+
+			if (Is64Bit(Type))
+			{
+				if (!DecodeColumn(Bytes, Num, Type, Codec, Width, Values64))
+				{
+					return false;
+				}
+
+				if (Field)
+				{
+					ScatterValues(*ArrayHelper, *Field, Type, Values64);
+				}
+			}
+			else
+			{
+				if (!DecodeColumn(Bytes, Num, Type, Codec, Width, Values32))
+				{
+					return false;
+				}
+
+				if (Field)
+				{
+					ScatterValues(*ArrayHelper, *Field, Type, Values32);
+				}
+			}
+		}
+
+		return true;
+	}
+}
+
+
+void FGameSaveColumnar::GetColumnarProperties(const UClass* Class, TArray<const FArrayProperty*>& OutProperties)
+{
+	OutProperties.Reset();
+
+	if (!Class)
+	{
+		return;
+	}
+
+	for (TFieldIterator<FArrayProperty> It(Class); It; ++It)
+	{
+		const auto* Property{ *It };
+
+		if (!FGameSaveSerializer::IsSavedProperty(Property))
+		{
+			continue;
+		}
+
+		const auto* ElementStruct{ GameSaveColumnar::GetElementStruct(Property) };
+
+		if (!ElementStruct || !ElementStruct->IsChildOf(FGameSaveColumnarElement::StaticStruct()))
+		{
+			continue;
+		}
+
+		if (IsColumnarProperty(Property))
+		{
+			OutProperties.Add(Property);
+		}
+		else
+		{
+			// Called for every save, so each property of a class is only reported once
+
+			if (GameSaveColumnar::ShouldWarnProperty(Class, Property))
+			{
+				UE_LOG(LogGameCore_Save, Warning, TEXT("FGameSaveColumnar::GetColumnarProperties: Property(%s) of class(%s) is saved as usual because struct(%s) has fields that are not numeric"),
+					*Property->GetName(), *Class->GetName(), *ElementStruct->GetName());
+			}
+		}
+	}
+}
+
+bool FGameSaveColumnar::IsColumnarProperty(const FProperty* Property)
+{
+	const auto* ArrayProperty{ CastField<FArrayProperty>(Property) };
+
+	if (!ArrayProperty || (ArrayProperty->ArrayDim != 1))
+	{
+		return false;
+	}
+
+	const auto* ElementStruct{ GameSaveColumnar::GetElementStruct(ArrayProperty) };
+
+	if (!ElementStruct || !ElementStruct->IsChildOf(FGameSaveColumnarElement::StaticStruct()))
+	{
+		return false;
+	}
+
+	TArray<GameSaveColumnar::FColumnField> Fields;
+	return GameSaveColumnar::GatherFields(ElementStruct, FString(), 0, Fields);
+}
+
+void FGameSaveColumnar::WriteArrays(FArchive& Ar, const UObject* Object, const TArray<const FArrayProperty*>& Properties)
+{
+	using namespace GameSaveColumnar;
+
+	auto NumArrays{ Properties.Num() };
+	Ar << NumArrays;
+
+	TArray<FColumnField> Fields;
+	TArray<uint32> Values32;
+	TArray<uint64> Values64;
+	TArray<uint8> Bytes;
+
+	for (const auto* Property : Properties)
+	{
+		Fields.Reset();
+		GatherFields(GetElementStruct(Property), FString(), 0, Fields);
+
+		FScriptArrayHelper_InContainer ArrayHelper(Property, Object);
+
+		auto PropertyName{ Property->GetName() };
+		auto Num{ ArrayHelper.Num() };
+		auto NumColumns{ Fields.Num() };
+
+		Ar << PropertyName;
+		Ar << Num;
+		Ar << NumColumns;
+
+		for (const auto& Field : Fields)
+		{
+			auto Codec{ EColumnCodec::Raw };
+			uint32 Width{ 0 };
+
+			if (Is64Bit(Field.Type))
+			{
+				GatherValues(ArrayHelper, Field, Values64);
+				EncodeColumn(Values64, Field.Type, Codec, Width, Bytes);
+			}
+			else
+			{
+				GatherValues(ArrayHelper, Field, Values32);
+				EncodeColumn(Values32, Field.Type, Codec, Width, Bytes);
+			}
+
+			auto Path{ Field.Path };
+			auto TypeValue{ static_cast<uint8>(Field.Type) };
+			auto CodecValue{ static_cast<uint8>(Codec) };
+			auto WidthValue{ static_cast<uint8>(Width) };
+
+			Ar << Path;
+			Ar << TypeValue;
+			Ar << CodecValue;
+			Ar << WidthValue;
+			Ar << Bytes;
+		}
+	}
+}
+
+bool FGameSaveColumnar::ReadArrays(FArchive& Ar, UObject* Object)
+{
+	using namespace GameSaveColumnar;
+
+	int32 NumArrays{ 0 };
+	Ar << NumArrays;
+
+	if (Ar.IsError() || (NumArrays < 0))
+	{
+		return false;
+	}
+
+	TArray<FColumnField> Fields;
+
+	for (int32 ArrayIndex{ 0 }; ArrayIndex < NumArrays; ++ArrayIndex)
+	{
+		FString PropertyName;
+		int32 Num{ 0 };
+		int32 NumColumns{ 0 };
+
+		Ar << PropertyName;
+		Ar << Num;
+		Ar << NumColumns;
+
+		if (Ar.IsError() || (Num < 0) || (NumColumns < 0))
+		{
+			return false;
+		}
+
+		// Arrays that were removed or are no longer columnar keep their value, their columns are only read past
+
+		const auto* Property{ FindFProperty<FArrayProperty>(Object->GetClass(), *PropertyName) };
+
+		if (!IsColumnarProperty(Property))
+		{
+			UE_LOG(LogGameCore_Save, Warning, TEXT("FGameSaveColumnar::ReadArrays: Skipped columns of property(%s) that is no longer a columnar array of class(%s)"),
+				*PropertyName, *Object->GetClass()->GetName());
+
+			if (!ReadColumns(Ar, NumColumns, Num, nullptr, Fields))
+			{
+				return false;
+			}
+
+			continue;
+		}
+
+		Fields.Reset();
+		GatherFields(GetElementStruct(Property), FString(), 0, Fields);
+
+		// Fields without a column keep the default value of the struct
+
+		FScriptArrayHelper_InContainer ArrayHelper(Property, Object);
+		ArrayHelper.EmptyAndAddValues(Num);
+
+		if (!ReadColumns(Ar, NumColumns, Num, &ArrayHelper, Fields))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
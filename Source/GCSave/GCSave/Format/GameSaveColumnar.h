@@ -0,0 +1,91 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Serialization/ObjectAndNameAsStringProxyArchive.h"
+
+#include "GameSaveColumnar.generated.h"
+
+class UClass;
+class UObject;
+class FArrayProperty;
+class FProperty;
+
+
+/**
+ * Base of structs whose arrays are saved column by column
+ *
+ * Tips:
+ *	Saved TArray properties of a struct derived from this are written as one compressed column per field after the other properties,
+ *	which is much smaller and faster to load for large arrays of numbers (positions, health, flags ...).
+ *	Fields of the struct can be integers, floats, doubles, bools, enums, nested structs of those, or static arrays of those.
+ *
+ * Note:
+ *	Arrays of structs with any other field (strings, names, objects, containers ...) are saved as usual with a warning.
+ *	Saves that use unversioned serialization always save the arrays as usual.
+ */
+USTRUCT(BlueprintType)
+struct GCSAVE_API FGameSaveColumnarElement
+{
+	GENERATED_BODY()
+public:
+	FGameSaveColumnarElement() {}
+
+};
+
+
+/**
+ * Archive used to write the properties of a save game object, skipping the properties written separately
+ */
+class FGameSaveObjectArchive : public FObjectAndNameAsStringProxyArchive
+{
+public:
+	FGameSaveObjectArchive(FArchive& InInnerArchive, bool bInLoadIfFindFails)
+		: FObjectAndNameAsStringProxyArchive(InInnerArchive, bInLoadIfFindFails)
+	{}
+
+	TSet<const FProperty*> SkippedProperties;
+
+public:
+	virtual bool ShouldSkipProperty(const FProperty* InProperty) const override
+	{
+		return SkippedProperties.Contains(InProperty) || FObjectAndNameAsStringProxyArchive::ShouldSkipProperty(InProperty);
+	}
+
+};
+
+
+/**
+ * Reads and writes the columnar arrays of save game objects
+ *
+ * Tips:
+ *	Each field of the elements is encoded as one column with the smaller of a raw or a delta (xor for floats) transform, then bit-packed to the width of its largest value.
+ *	The transforms are vectorized, and columns are matched by field path on load so that fields can be added, removed or retyped.
+ */
+class GCSAVE_API FGameSaveColumnar
+{
+public:
+	/**
+	 * Returns the saved array properties of the class that are written as columns
+	 */
+	static void GetColumnarProperties(const UClass* Class, TArray<const FArrayProperty*>& OutProperties);
+
+	/**
+	 * Returns true if the property is an array of a struct derived from FGameSaveColumnarElement that only has numeric fields
+	 */
+	static bool IsColumnarProperty(const FProperty* Property);
+
+	/**
+	 * Writes the arrays of the object as columns
+	 */
+	static void WriteArrays(FArchive& Ar, const UObject* Object, const TArray<const FArrayProperty*>& Properties);
+
+	/**
+	 * Reads the columns written by WriteArrays into the arrays of the object, can be called from any thread
+	 *
+	 * Note:
+	 *	Return false if the data is corrupted, columns of missing arrays or fields are skipped
+	 */
+	static bool ReadArrays(FArchive& Ar, UObject* Object);
+
+};
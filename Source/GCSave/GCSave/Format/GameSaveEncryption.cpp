@@ -0,0 +1,287 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "GameSaveEncryption.h"
+
+#include "Format/GameSaveHeader.h"
+#include "Format/GameSaveSerializer.h"
+#include "GameSaveDeveloperSettings.h"
+#include "GCSaveLogs.h"
+
+#include "Async/ParallelFor.h"
+#include "Misc/Guid.h"
+#include "Misc/ScopeRWLock.h"
+#include "Misc/SecureHash.h"
+#include "Serialization/MemoryWriter.h"
+
+
+namespace GameSaveEncryption
+{
+	//
+	// Size of the chunks that are encrypted in parallel, must be a multiple of the AES block size
+	//
+	static constexpr int64 CHUNK_SIZE{ 64 * 1024 };
+
+	static_assert(CHUNK_SIZE % FAES::AESBlockSize == 0, "CHUNK_SIZE must be a multiple of the AES block size");
+
+	static FGameSaveKeyProvider KeyProvider;
+	static FRWLock KeyProviderLock;
+
+	/**
+	 * Writes the header over the header at the start of the data, the size of the header must not change
+	 */
+	static bool RewriteHeader(TArray<uint8>& InOutData, FGameSaveHeader& Header, int64 PayloadOffset)
+	{
+		TArray<uint8> HeaderBytes;
+		FMemoryWriter Writer(HeaderBytes, true);
+		Header.Serialize(Writer);
+
+		if (Writer.IsError() || (HeaderBytes.Num() != PayloadOffset))
+		{
+			return false;
+		}
+
+		FMemory::Memcpy(InOutData.GetData(), HeaderBytes.GetData(), HeaderBytes.Num());
+
+		return true;
+	}
+
+	//
+	// Label encrypted with the key to derive the key of the tag, so that the key itself is never used for both
+	//
+	static const ANSICHAR TAG_KEY_LABEL[]{ "GCSave/GameSaveEncryption/TagKey" };
+
+	static_assert(sizeof(TAG_KEY_LABEL) - 1 == FAES::FAESKey::KeySize, "TAG_KEY_LABEL must be as long as the key");
+
+	/**
+	 * Computes the tag of the data, the tag in its header must be zeroed
+	 */
+	static FSHAHash ComputeTag(const TArray<uint8>& InData, const FAES::FAESKey& Key)
+	{
+		uint8 TagKey[FAES::FAESKey::KeySize];
+		FMemory::Memcpy(TagKey, TAG_KEY_LABEL, sizeof(TagKey));
+
+		FAES::EncryptData(TagKey, sizeof(TagKey), Key);
+
+		FSHAHash Tag;
+		FSHA1::HMACBuffer(TagKey, sizeof(TagKey), InData.GetData(), InData.Num(), Tag.Hash);
+
+		FMemory::Memzero(TagKey, sizeof(TagKey));
+
+		return Tag;
+	}
+
+	/**
+	 * Compares the tags in constant time
+	 */
+	static bool TagsEqual(const FSHAHash& A, const FSHAHash& B)
+	{
+		uint8 Difference{ 0 };
+
+		for (int32 Index{ 0 }; Index < UE_ARRAY_COUNT(A.Hash); ++Index)
+		{
+			Difference |= A.Hash[Index] ^ B.Hash[Index];
+		}
+
+		return Difference == 0;
+	}
+}
+
+
+void FGameSaveEncryption::SetKeyProvider(FGameSaveKeyProvider InKeyProvider)
+{
+	FWriteScopeLock WriteLock(GameSaveEncryption::KeyProviderLock);
+
+	GameSaveEncryption::KeyProvider = MoveTemp(InKeyProvider);
+}
+
+bool FGameSaveEncryption::HasKeyProvider()
+{
+	FReadScopeLock ReadLock(GameSaveEncryption::KeyProviderLock);
+
+	return static_cast<bool>(GameSaveEncryption::KeyProvider);
+}
+
+bool FGameSaveEncryption::ShouldEncrypt()
+{
+	return GetDefault<UGameSaveDeveloperSettings>()->bEncryptSaves;
+}
+
+bool FGameSaveEncryption::EncryptData(TArray<uint8>& InOutData)
+{
+	FGameSaveHeader Header;
+	int64 PayloadOffset{ 0 };
+
+	if (!FGameSaveSerializer::ReadHeader(InOutData, Header, &PayloadOffset) || Header.IsEncrypted())
+	{
+		UE_LOG(LogGameCore_Save, Error, TEXT("FGameSaveEncryption::EncryptData: Data is not an unencrypted save of this plugin"));
+		return false;
+	}
+
+	if (!Header.HasEncryptionTag())
+	{
+		UE_LOG(LogGameCore_Save, Error, TEXT("FGameSaveEncryption::EncryptData: Format version(%d) of save of class(%s) has no room for the tag"), Header.FormatVersion, *Header.ClassPath);
+		return false;
+	}
+
+	FAES::FAESKey Key;
+
+	if (!GetKey(Key))
+	{
+		UE_LOG(LogGameCore_Save, Error, TEXT("FGameSaveEncryption::EncryptData: No key is available to encrypt save of class(%s)"), *Header.ClassPath);
+		return false;
+	}
+
+	auto* PayloadData{ InOutData.GetData() + PayloadOffset };
+	const auto PayloadSize{ InOutData.Num() - PayloadOffset };
+
+	const auto Guid{ FGuid::NewGuid() };
+
+	Header.Cipher = EGameSaveCipher::AES256_CTR;
+	Header.EncryptionNonce = (static_cast<uint64>(Guid.A) << 32) | Guid.B;
+
+	TransformPayload(PayloadData, PayloadSize, Header.EncryptionNonce, Key);
+
+	// The hash of the plain payload would let anyone confirm a guess of the data, so the ciphertext is hashed instead
+
+	Header.PayloadHash = FGameSaveHeader::HashPayload(PayloadData, PayloadSize);
+	Header.EncryptionTag = FSHAHash();
+
+	if (!GameSaveEncryption::RewriteHeader(InOutData, Header, PayloadOffset))
+	{
+		return false;
+	}
+
+	// The tag covers the header too, so neither the ciphertext nor the nonce or versions can be changed unnoticed
+
+	Header.EncryptionTag = GameSaveEncryption::ComputeTag(InOutData, Key);
+
+	return GameSaveEncryption::RewriteHeader(InOutData, Header, PayloadOffset);
+}
+
+bool FGameSaveEncryption::DecryptData(TArray<uint8>& InOutData)
+{
+	FGameSaveHeader Header;
+	int64 PayloadOffset{ 0 };
+
+	if (!FGameSaveSerializer::ReadHeader(InOutData, Header, &PayloadOffset) || !Header.IsEncrypted())
+	{
+		return true;
+	}
+
+	if (Header.Cipher != EGameSaveCipher::AES256_CTR)
+	{
+		UE_LOG(LogGameCore_Save, Error, TEXT("FGameSaveEncryption::DecryptData: Unknown cipher(%d) of save of class(%s)"), static_cast<int32>(Header.Cipher), *Header.ClassPath);
+		return false;
+	}
+
+	FAES::FAESKey Key;
+
+	if (!GetKey(Key))
+	{
+		UE_LOG(LogGameCore_Save, Error, TEXT("FGameSaveEncryption::DecryptData: No key is available to decrypt save of class(%s)"), *Header.ClassPath);
+		return false;
+	}
+
+	// Check the tag before anything of the ciphertext is used
+
+	if (Header.HasEncryptionTag())
+	{
+		const auto ExpectedTag{ Header.EncryptionTag };
+		Header.EncryptionTag = FSHAHash();
+
+		if (!GameSaveEncryption::RewriteHeader(InOutData, Header, PayloadOffset)
+			|| !GameSaveEncryption::TagsEqual(GameSaveEncryption::ComputeTag(InOutData, Key), ExpectedTag))
+		{
+			UE_LOG(LogGameCore_Save, Error, TEXT("FGameSaveEncryption::DecryptData: Save of class(%s) does not match its tag, the data was modified or the key is wrong"), *Header.ClassPath);
+			return false;
+		}
+	}
+
+	auto* PayloadData{ InOutData.GetData() + PayloadOffset };
+	const auto PayloadSize{ InOutData.Num() - PayloadOffset };
+
+	TransformPayload(PayloadData, PayloadSize, Header.EncryptionNonce, Key);
+
+	const auto PlainHash{ FGameSaveHeader::HashPayload(PayloadData, PayloadSize) };
+
+	// Data without a tag only has the hash of the decrypted payload to detect a wrong key
+
+	if (!Header.HasEncryptionTag() && (PlainHash != Header.PayloadHash))
+	{
+		UE_LOG(LogGameCore_Save, Error, TEXT("FGameSaveEncryption::DecryptData: Decrypted save of class(%s) does not match its hash, the key may be wrong"), *Header.ClassPath);
+		return false;
+	}
+
+	Header.Cipher = EGameSaveCipher::None;
+	Header.EncryptionNonce = 0;
+	Header.PayloadHash = PlainHash;
+
+	return GameSaveEncryption::RewriteHeader(InOutData, Header, PayloadOffset);
+}
+
+bool FGameSaveEncryption::IsEncrypted(const TArray<uint8>& InData)
+{
+	FGameSaveHeader Header;
+	return FGameSaveSerializer::ReadHeader(InData, Header) && Header.IsEncrypted();
+}
+
+
+bool FGameSaveEncryption::GetKey(FAES::FAESKey& OutKey)
+{
+	FGameSaveKeyProvider Provider;
+	{
+		FReadScopeLock ReadLock(GameSaveEncryption::KeyProviderLock);
+
+		Provider = GameSaveEncryption::KeyProvider;
+	}
+
+	return Provider && Provider(OutKey) && OutKey.IsValid();
+}
+
+void FGameSaveEncryption::TransformPayload(uint8* PayloadData, int64 PayloadSize, uint64 Nonce, const FAES::FAESKey& Key)
+{
+	const auto NumChunks{ static_cast<int32>(FMath::DivideAndRoundUp(PayloadSize, GameSaveEncryption::CHUNK_SIZE)) };
+
+	ParallelFor(NumChunks,
+		[PayloadData, PayloadSize, Nonce, &Key](int32 ChunkIndex)
+		{
+			const auto ChunkOffset{ ChunkIndex * GameSaveEncryption::CHUNK_SIZE };
+			const auto ChunkSize{ FMath::Min(GameSaveEncryption::CHUNK_SIZE, PayloadSize - ChunkOffset) };
+			const auto NumBlocks{ FMath::DivideAndRoundUp<int64>(ChunkSize, FAES::AESBlockSize) };
+
+			// Each counter block is the nonce followed by the index of the block in the payload
+
+			TArray<uint8> KeyStream;
+			KeyStream.SetNumUninitialized(NumBlocks * FAES::AESBlockSize);
+
+			for (int64 BlockIndex{ 0 }; BlockIndex < NumBlocks; ++BlockIndex)
+			{
+				const auto Counter{ static_cast<uint64>((ChunkOffset / FAES::AESBlockSize) + BlockIndex) };
+				auto* Block{ KeyStream.GetData() + (BlockIndex * FAES::AESBlockSize) };
+
+				FMemory::Memcpy(Block, &Nonce, sizeof(Nonce));
+				FMemory::Memcpy(Block + sizeof(Nonce), &Counter, sizeof(Counter));
+			}
+
+			FAES::EncryptData(KeyStream.GetData(), KeyStream.Num(), Key);
+
+			auto* ChunkData{ PayloadData + ChunkOffset };
+			int64 Offset{ 0 };
+
+			for (; Offset + sizeof(uint64) <= ChunkSize; Offset += sizeof(uint64))
+			{
+				uint64 Value, Stream;
+				FMemory::Memcpy(&Value, ChunkData + Offset, sizeof(uint64));
+				FMemory::Memcpy(&Stream, KeyStream.GetData() + Offset, sizeof(uint64));
+
+				Value ^= Stream;
+				FMemory::Memcpy(ChunkData + Offset, &Value, sizeof(uint64));
+			}
+
+			for (; Offset < ChunkSize; ++Offset)
+			{
+				ChunkData[Offset] ^= KeyStream[Offset];
+			}
+		}
+	);
+}
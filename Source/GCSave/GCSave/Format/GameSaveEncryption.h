@@ -0,0 +1,71 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Misc/AES.h"
+#include "Templates/Function.h"
+
+
+/**
+ * Callback that provides the key used to encrypt and decrypt saves
+ *
+ * Note:
+ *	Called on worker threads, return false if no key is available
+ */
+using FGameSaveKeyProvider = TFunction<bool(FAES::FAESKey& OutKey)>;
+
+
+/**
+ * Encrypts the payload of serialized save data in place
+ *
+ * Tips:
+ *	The header stays readable, so the class and versions of an encrypted save can still be probed without the key.
+ *	The payload is processed in fixed size chunks in parallel, and each chunk only needs a key stream buffer of its own size.
+ *	The block cipher is the engine's FAES, which uses the hardware AES instructions of the platform when the engine is built with them.
+ *	Counter mode alone does not detect changes of the ciphertext, so the header carries an HMAC-SHA1 tag of the whole data keyed with a key derived from the key.
+ */
+class GCSAVE_API FGameSaveEncryption
+{
+public:
+	/**
+	 * Sets the callback that provides the key, pass nullptr to remove it
+	 */
+	static void SetKeyProvider(FGameSaveKeyProvider InKeyProvider);
+
+	static bool HasKeyProvider();
+
+	/**
+	 * Returns true if saves should be encrypted before they are written
+	 */
+	static bool ShouldEncrypt();
+
+	/**
+	 * Encrypts the payload and records the cipher, the hash of the ciphertext and the tag in the header
+	 *
+	 * Note:
+	 *	Return false if the data is not written by this plugin, is already encrypted, has a format without a tag or no key is available
+	 */
+	static bool EncryptData(TArray<uint8>& InOutData);
+
+	/**
+	 * Checks the tag and decrypts the payload if it is encrypted, then clears the cipher and records the hash of the decrypted payload in the header
+	 *
+	 * Note:
+	 *	Return false if no key is available or the data does not match its tag (its hash for data written before tags existed)
+	 */
+	static bool DecryptData(TArray<uint8>& InOutData);
+
+	/**
+	 * Returns true if the payload of the data is encrypted
+	 */
+	static bool IsEncrypted(const TArray<uint8>& InData);
+
+protected:
+	static bool GetKey(FAES::FAESKey& OutKey);
+
+	/**
+	 * Applies the key stream to the payload, the same call encrypts and decrypts
+	 */
+	static void TransformPayload(uint8* PayloadData, int64 PayloadSize, uint64 Nonce, const FAES::FAESKey& Key);
+
+};
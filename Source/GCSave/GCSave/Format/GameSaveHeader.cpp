@@ -0,0 +1,157 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "GameSaveHeader.h"
+
+#include "GCSaveLogs.h"
+
+#include "Hash/CityHash.h"
+#include "UObject/Class.h"
+#include "UObject/SoftObjectPath.h"
+
+
+const uint32 FGameSaveHeader::MAGIC{ 0x56534347 };
+
+
+void FGameSaveHeader::Initialize(const UClass* SaveGameClass, int32 InDataVersion, EGameSaveFormatFlags InFlags)
+{
+	Magic = MAGIC;
+	FormatVersion = FGameSaveFormatVersion::LatestVersion;
+	PayloadSize = 0;
+	DataVersion = InDataVersion;
+	SchemaHash = 0;
+	PayloadHash = 0;
+	Cipher = EGameSaveCipher::None;
+	EncryptionNonce = 0;
+	Flags = InFlags;
+	ClassPath = SaveGameClass ? SaveGameClass->GetPathName() : FString();
+
+	PackageFileUEVersion = GPackageFileUEVersion;
+	SavedEngineVersion = FEngineVersion::Current();
+	CustomVersions = FCurrentCustomVersions::GetAll();
+	BlobHashes.Reset();
+	EncryptionTag = FSHAHash();
+}
+
+void FGameSaveHeader::SerializeSummary(FArchive& Ar)
+{
+	Ar << Magic;
+
+	if (Magic != MAGIC)
+	{
+		Ar.SetError();
+		return;
+	}
+
+	Ar << FormatVersion;
+
+	if ((FormatVersion < FGameSaveFormatVersion::Initial) || (FormatVersion > FGameSaveFormatVersion::LatestVersion))
+	{
+		Ar.SetError();
+		return;
+	}
+
+	Ar << PayloadSize;
+	Ar << DataVersion;
+	Ar << SchemaHash;
+
+	if (FormatVersion >= FGameSaveFormatVersion::PayloadHash)
+	{
+		Ar << PayloadHash;
+	}
+
+	if (FormatVersion >= FGameSaveFormatVersion::Encryption)
+	{
+		auto CipherValue{ static_cast<uint8>(Cipher) };
+		Ar << CipherValue;
+		Cipher = static_cast<EGameSaveCipher>(CipherValue);
+
+		Ar << EncryptionNonce;
+	}
+
+	auto FlagsValue{ static_cast<uint32>(Flags) };
+	Ar << FlagsValue;
+	Flags = static_cast<EGameSaveFormatFlags>(FlagsValue);
+
+	Ar << ClassPath;
+}
+
+void FGameSaveHeader::Serialize(FArchive& Ar)
+{
+	SerializeSummary(Ar);
+
+	if (Ar.IsError())
+	{
+		return;
+	}
+
+	Ar << PackageFileUEVersion.FileVersionUE4;
+	Ar << PackageFileUEVersion.FileVersionUE5;
+	Ar << SavedEngineVersion;
+
+	CustomVersions.Serialize(Ar, ECustomVersionSerializationFormat::Optimized);
+
+	if (FormatVersion >= FGameSaveFormatVersion::Blobs)
+	{
+		Ar << BlobHashes;
+	}
+
+	if (HasEncryptionTag())
+	{
+		Ar << EncryptionTag;
+	}
+}
+
+uint64 FGameSaveHeader::HashPayload(const uint8* PayloadData, int64 PayloadSize)
+{
+	return CityHash64(reinterpret_cast<const char*>(PayloadData), static_cast<uint32>(PayloadSize));
+}
+
+bool FGameSaveHeader::HasValidMagic(const TArray<uint8>& InData)
+{
+	if (InData.Num() < sizeof(uint32))
+	{
+		return false;
+	}
+
+	uint32 DataMagic{ 0 };
+	FMemory::Memcpy(&DataMagic, InData.GetData(), sizeof(uint32));
+
+	return INTEL_ORDER32(DataMagic) == MAGIC;
+}
+
+bool FGameSaveHeader::CanLoadAs(const UClass* BaseClass, const UClass* SaveGameClass, const FString& SlotName, TFunctionRef<bool(const UObject* SavedCDO)> CanLoadDataVersion) const
+{
+	// Check the saved class and data version before deserializing the payload, classes can only be loaded on the game thread
+
+	const FSoftClassPath SavedClassPath{ ClassPath };
+	const auto* SavedClass{ IsInGameThread() ? SavedClassPath.TryLoadClass<UObject>() : SavedClassPath.ResolveClass() };
+	const auto* SavedCDO{ (SavedClass && SavedClass->IsChildOf(BaseClass)) ? SavedClass->GetDefaultObject() : nullptr };
+
+	const TCHAR* Reason{ nullptr };
+
+	if (!SavedCDO)
+	{
+		Reason = TEXT("unknown class");
+	}
+	else if (SaveGameClass && !SavedClass->IsChildOf(SaveGameClass))
+	{
+		Reason = TEXT("class mismatch");
+	}
+	else if (!CanLoadDataVersion(SavedCDO))
+	{
+		Reason = TEXT("unsupported data version");
+	}
+	else if (PayloadSize <= 0)
+	{
+		Reason = TEXT("empty payload");
+	}
+
+	if (Reason)
+	{
+		UE_LOG(LogGameCore_Save, Warning, TEXT("FGameSaveHeader::CanLoadAs: Rejected save of class(%s) data version(%d) in slot(%s) for class(%s): %s"),
+			*ClassPath, DataVersion, *SlotName, *GetNameSafe(SaveGameClass ? SaveGameClass : BaseClass), Reason);
+		return false;
+	}
+
+	return true;
+}
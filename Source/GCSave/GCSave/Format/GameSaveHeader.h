@@ -0,0 +1,221 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "IO/IoHash.h"
+#include "Misc/EngineVersion.h"
+#include "Misc/SecureHash.h"
+#include "Serialization/CustomVersion.h"
+#include "Templates/Function.h"
+#include "Templates/SubclassOf.h"
+#include "UObject/ObjectVersion.h"
+
+class UClass;
+
+
+/**
+ * Flags describing how the payload of a save file was written
+ */
+enum class EGameSaveFormatFlags : uint32
+{
+	None			= 0,
+
+	// Properties were written with unversioned property serialization and can only be read by a matching schema
+	Unversioned		= 1 << 0,
+
+	// Arrays of FGameSaveColumnarElement are not in the serialized object but written as columns after it
+	Columnar		= 1 << 1,
+
+	// The payload is the content of a FGameSaveBlob in its side slot, not a serialized object
+	Blob			= 1 << 2,
+};
+ENUM_CLASS_FLAGS(EGameSaveFormatFlags);
+
+
+/**
+ * Ciphers used to encrypt the payload of a save file
+ */
+enum class EGameSaveCipher : uint8
+{
+	None			= 0,
+
+	// AES-256 in counter mode, the payload is encrypted in independent chunks
+	AES256_CTR		= 1,
+};
+
+
+/**
+ * Versions of the save file format written by this plugin
+ */
+struct FGameSaveFormatVersion
+{
+	enum Type : int32
+	{
+		Initial = 1,
+
+		// Added the hash of the payload
+		PayloadHash,
+
+		// Added the cipher and nonce of encrypted payloads
+		Encryption,
+
+		// Added columnar arrays after the serialized object
+		Columnar,
+
+		// Added the hashes of the blobs referenced by the payload
+		Blobs,
+
+		// Added the authentication tag of encrypted payloads, the payload hash of encrypted payloads became the hash of the ciphertext
+		EncryptionTag,
+
+		// -----<new versions can be added above this line>-------------------------------------------------
+		VersionPlusOne,
+		LatestVersion = VersionPlusOne - 1
+	};
+};
+
+
+/**
+ * Header written at the start of every save file created by this plugin
+ *
+ * Tips:
+ *	Fixed size fields come first so that the header can be probed without reading the whole file
+ */
+struct GCSAVE_API FGameSaveHeader
+{
+public:
+	FGameSaveHeader() {}
+
+	//
+	// Tag used to identify the save files written by this plugin ("GCSV")
+	//
+	static const uint32 MAGIC;
+
+public:
+	uint32 Magic{ 0 };
+
+	int32 FormatVersion{ 0 };
+
+	//
+	// Size of the serialized object that follows the header
+	//
+	int64 PayloadSize{ 0 };
+
+	//
+	// Game-specific version of the saved data (the value of GetLatestDataVersion when saved)
+	//
+	int32 DataVersion{ 0 };
+
+	//
+	// Hash of the property layout of the saved class when it was saved
+	//
+	uint32 SchemaHash{ 0 };
+
+	//
+	// CityHash64 of the payload as it is stored, used to detect damaged data and to skip writing data identical to what is already in the slot
+	//
+	// Tips:
+	//	The hash of an encrypted payload is the hash of its ciphertext, so it tells nothing about the plain data.
+	//	Data written before FGameSaveFormatVersion::EncryptionTag holds the hash of the decrypted payload instead.
+	//
+	uint64 PayloadHash{ 0 };
+
+	//
+	// Cipher the payload is encrypted with
+	//
+	EGameSaveCipher Cipher{ EGameSaveCipher::None };
+
+	//
+	// Random value that makes the key stream unique to each write
+	//
+	uint64 EncryptionNonce{ 0 };
+
+	EGameSaveFormatFlags Flags{ EGameSaveFormatFlags::None };
+
+	//
+	// Path of the saved class
+	//
+	FString ClassPath;
+
+	FPackageFileVersion PackageFileUEVersion;
+	FEngineVersion SavedEngineVersion;
+	FCustomVersionContainer CustomVersions;
+
+	//
+	// Hashes of the FGameSaveBlob payloads referenced by the payload, stored in side slots of the same user
+	//
+	TArray<FIoHash> BlobHashes;
+
+	//
+	// HMAC-SHA1 of the whole encrypted data with this field zeroed, written last so that it directly precedes the payload
+	//
+	FSHAHash EncryptionTag;
+
+public:
+	/**
+	 * Fills the header for data that is about to be written with the current engine versions
+	 */
+	void Initialize(const UClass* SaveGameClass, int32 InDataVersion, EGameSaveFormatFlags InFlags);
+
+	/**
+	 * Reads or writes the header
+	 *
+	 * Note:
+	 *	The archive is set to the error state if the data is not a header of this plugin or its version is not supported
+	 */
+	void Serialize(FArchive& Ar);
+
+	/**
+	 * Reads or writes only the fields up to ClassPath, which come first in the header
+	 *
+	 * Tips:
+	 *	Used to probe a slot from the first bytes of its data, the engine versions are left unchanged
+	 */
+	void SerializeSummary(FArchive& Ar);
+
+	/**
+	 * Maximum size of the fields read by SerializeSummary for class paths of usual length
+	 */
+	static constexpr int64 SUMMARY_PROBE_SIZE{ 1024 };
+
+	/**
+	 * Computes the hash of the payload that follows the header
+	 */
+	static uint64 HashPayload(const uint8* PayloadData, int64 PayloadSize);
+
+	/**
+	 * Returns true if the data starts with the tag of this plugin
+	 */
+	static bool HasValidMagic(const TArray<uint8>& InData);
+
+	/**
+	 * Returns true if the saved data can be deserialized as SaveGameClass, passed to the pipeline as the header filter of loads
+	 *
+	 * Tips:
+	 *	Saves of another class, an unsupported data version or no payload are logged and rejected before they are deserialized.
+	 *	Called on a worker thread for batched loads, where only classes that are already loaded are resolved.
+	 */
+	template<typename SaveGameType>
+	bool CanLoadAs(TSubclassOf<SaveGameType> SaveGameClass, const FString& SlotName) const
+	{
+		return CanLoadAs(SaveGameType::StaticClass(), SaveGameClass.Get(), SlotName,
+			[this](const UObject* SavedCDO)
+			{
+				return CastChecked<SaveGameType>(SavedCDO)->CanLoadDataVersion(DataVersion);
+			});
+	}
+
+	/**
+	 * Returns true if the saved data is of a class derived from BaseClass and SaveGameClass and CanLoadDataVersion accepts the CDO of the saved class
+	 */
+	bool CanLoadAs(const UClass* BaseClass, const UClass* SaveGameClass, const FString& SlotName, TFunctionRef<bool(const UObject* SavedCDO)> CanLoadDataVersion) const;
+
+	bool IsUnversioned() const { return EnumHasAnyFlags(Flags, EGameSaveFormatFlags::Unversioned); }
+
+	bool IsEncrypted() const { return Cipher != EGameSaveCipher::None; }
+
+	bool HasEncryptionTag() const { return FormatVersion >= FGameSaveFormatVersion::EncryptionTag; }
+
+	bool HasColumnarArrays() const { return EnumHasAnyFlags(Flags, EGameSaveFormatFlags::Columnar); }
+
+};
@@ -0,0 +1,82 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "GameSaveMigration.h"
+
+#include "Format/GameSaveHeader.h"
+#include "GCSaveLogs.h"
+
+#include "GameFramework/SaveGame.h"
+#include "Misc/ScopeRWLock.h"
+
+
+FGameSaveMigrationRegistry& FGameSaveMigrationRegistry::Get()
+{
+	static FGameSaveMigrationRegistry Registry;
+	return Registry;
+}
+
+
+void FGameSaveMigrationRegistry::RegisterStep(TSubclassOf<USaveGame> SaveGameClass, int32 FromVersion, FGameSaveMigrationStep Step)
+{
+	if (!ensure(SaveGameClass && Step))
+	{
+		return;
+	}
+
+	FWriteScopeLock WriteLock(StepsLock);
+
+	Steps.FindOrAdd(SaveGameClass->GetPathName()).Emplace(FromVersion, MoveTemp(Step));
+}
+
+void FGameSaveMigrationRegistry::UnregisterSteps(TSubclassOf<USaveGame> SaveGameClass)
+{
+	if (SaveGameClass)
+	{
+		FWriteScopeLock WriteLock(StepsLock);
+
+		Steps.Remove(SaveGameClass->GetPathName());
+	}
+}
+
+bool FGameSaveMigrationRegistry::HasStep(const FString& ClassPath, int32 FromVersion) const
+{
+	FReadScopeLock ReadLock(StepsLock);
+
+	const auto* ClassSteps{ Steps.Find(ClassPath) };
+	return ClassSteps && ClassSteps->Contains(FromVersion);
+}
+
+bool FGameSaveMigrationRegistry::Migrate(FGameSaveHeader& Header, TArray<uint8>& Payload) const
+{
+	while (true)
+	{
+		// Copy the step so that the lock is not held while it runs
+
+		FGameSaveMigrationStep Step;
+		{
+			FReadScopeLock ReadLock(StepsLock);
+
+			const auto* ClassSteps{ Steps.Find(Header.ClassPath) };
+			const auto* FoundStep{ ClassSteps ? ClassSteps->Find(Header.DataVersion) : nullptr };
+
+			if (!FoundStep)
+			{
+				return true;
+			}
+
+			Step = *FoundStep;
+		}
+
+		FGameSaveMigrationContext Context(Header, Payload);
+
+		if (!Step(Context))
+		{
+			UE_LOG(LogGameCore_Save, Error, TEXT("FGameSaveMigrationRegistry::Migrate: Failed to migrate class(%s) from version(%d)"), *Header.ClassPath, Header.DataVersion);
+			return false;
+		}
+
+		UE_LOG(LogGameCore_Save, Log, TEXT("Migrated class(%s) from version(%d) to version(%d)"), *Header.ClassPath, Header.DataVersion, Header.DataVersion + 1);
+
+		Header.DataVersion++;
+	}
+}
@@ -0,0 +1,96 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "HAL/CriticalSection.h"
+#include "Templates/Function.h"
+#include "Templates/SubclassOf.h"
+
+class USaveGame;
+struct FGameSaveHeader;
+
+
+/**
+ * Data passed to a migration step
+ */
+struct FGameSaveMigrationContext
+{
+public:
+	FGameSaveMigrationContext(FGameSaveHeader& InHeader, TArray<uint8>& InPayload)
+		: Header(InHeader), Payload(InPayload)
+	{}
+
+	//
+	// Header of the data being migrated.
+	//
+	// Tips:
+	//	DataVersion is advanced by the registry after each successful step.
+	//	Steps that change the property layout of unversioned data must update SchemaHash.
+	//
+	FGameSaveHeader& Header;
+
+	//
+	// Serialized object that follows the header, steps rewrite it in place
+	//
+	// Note:
+	//	If the header has the Columnar flag, the columnar arrays follow the object and must be kept
+	//
+	TArray<uint8>& Payload;
+
+};
+
+
+/**
+ * Migration step that upgrades serialized data from version N to N + 1.
+ *
+ * Note:
+ *	Called on worker threads, so it must not touch UObjects other than reading class data
+ */
+using FGameSaveMigrationStep = TFunction<bool(FGameSaveMigrationContext&)>;
+
+
+/**
+ * Registry of per-class migration steps that run on serialized save data before the object is constructed
+ *
+ * Tips:
+ *	Steps are chained, so a save written with version 1 is upgraded by the steps 1->2, 2->3 ... until no step is found for its version.
+ *	Fixups that need the constructed object can still be done in HandlePostLoad.
+ */
+class GCSAVE_API FGameSaveMigrationRegistry
+{
+public:
+	static FGameSaveMigrationRegistry& Get();
+
+protected:
+	//
+	// Registered steps by class path, then by source version
+	//
+	TMap<FString, TMap<int32, FGameSaveMigrationStep>> Steps;
+
+	mutable FRWLock StepsLock;
+
+public:
+	/**
+	 * Registers a step that upgrades the data of the class from FromVersion to FromVersion + 1
+	 */
+	void RegisterStep(TSubclassOf<USaveGame> SaveGameClass, int32 FromVersion, FGameSaveMigrationStep Step);
+
+	/**
+	 * Removes all steps registered to the class
+	 */
+	void UnregisterSteps(TSubclassOf<USaveGame> SaveGameClass);
+
+	/**
+	 * Returns true if a step is registered to upgrade the data of the class path from the version
+	 */
+	bool HasStep(const FString& ClassPath, int32 FromVersion) const;
+
+	/**
+	 * Runs the chain of steps for the class and version written in the header
+	 *
+	 * Note:
+	 *	Thread-safe, return false if a step failed
+	 */
+	bool Migrate(FGameSaveHeader& Header, TArray<uint8>& Payload) const;
+
+};
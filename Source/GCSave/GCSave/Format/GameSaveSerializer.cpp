@@ -0,0 +1,590 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "GameSaveSerializer.h"
+
+#include "Format/GameSaveBlob.h"
+#include "Format/GameSaveColumnar.h"
+#include "Format/GameSaveHeader.h"
+#include "Format/GameSaveMigration.h"
+#include "GCSaveLogs.h"
+
+#include "GameFramework/SaveGame.h"
+#include "Kismet/GameplayStatics.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/ObjectAndNameAsStringProxyArchive.h"
+#include "Serialization/StructuredArchive.h"
+#include "UObject/UObjectHash.h"
+#include "UObject/UnrealType.h"
+
+
+namespace GameSaveSerializer
+{
+	//
+	// Name of the property that holds the data version in UGlobalSave and UPlayerSave
+	//
+	static const FName NAME_SavedDataVersion{ TEXT("SavedDataVersion") };
+
+	static void ClearAsyncFlags(UObject* Object)
+	{
+		Object->ClearInternalFlags(EInternalObjectFlags::Async);
+
+		ForEachObjectWithOuter(Object,
+			[](UObject* Subobject)
+			{
+				Subobject->ClearInternalFlags(EInternalObjectFlags::Async);
+			}
+		);
+	}
+
+	/**
+	 * Proxy archive for deserialization that records references to objects that could not be found or loaded
+	 */
+	class FLoadProxyArchive : public FObjectAndNameAsStringProxyArchive
+	{
+	public:
+		FLoadProxyArchive(FArchive& InInnerArchive, bool bInLoadIfFindFails)
+			: FObjectAndNameAsStringProxyArchive(InInnerArchive, bInLoadIfFindFails)
+		{
+		}
+
+		//
+		// Whether a reference to an object that could not be found or loaded has been read
+		//
+		bool bHasUnresolvedReferences{ false };
+
+		using FObjectAndNameAsStringProxyArchive::operator<<;
+
+		virtual FArchive& operator<<(UObject*& Obj) override
+		{
+			FString LoadedString;
+			InnerArchive << LoadedString;
+
+			Obj = nullptr;
+
+			if (!LoadedString.IsEmpty())
+			{
+				Obj = FindObject<UObject>(nullptr, *LoadedString, false);
+
+				if (!Obj && bLoadIfFindFails)
+				{
+					Obj = LoadObject<UObject>(nullptr, *LoadedString);
+				}
+
+				bHasUnresolvedReferences |= (Obj == nullptr);
+			}
+
+			return *this;
+		}
+
+		virtual FArchive& operator<<(FObjectPtr& Obj) override
+		{
+			UObject* Object{ nullptr };
+			*this << Object;
+
+			Obj = Object;
+			return *this;
+		}
+
+	};
+
+
+	static uint32 HashProperty(const FProperty* Property, uint32 Crc, TSet<const UStruct*>& VisitedStructs);
+
+	static uint32 HashStruct(const UStruct* Struct, uint32 Crc, TSet<const UStruct*>& VisitedStructs)
+	{
+		// Structs that reference themselves through a container are only hashed once
+
+		bool bAlreadyVisited{ false };
+		VisitedStructs.Add(Struct, &bAlreadyVisited);
+
+		Crc = FCrc::StrCrc32(*Struct->GetPathName(), Crc);
+
+		if (!bAlreadyVisited)
+		{
+			for (TFieldIterator<FProperty> It(Struct, EFieldIteratorFlags::IncludeSuper); It; ++It)
+			{
+				Crc = HashProperty(*It, Crc, VisitedStructs);
+			}
+		}
+
+		return Crc;
+	}
+
+	static uint32 HashProperty(const FProperty* Property, uint32 Crc, TSet<const UStruct*>& VisitedStructs)
+	{
+		Crc = FCrc::StrCrc32(*Property->GetName(), Crc);
+		Crc = FCrc::StrCrc32(*Property->GetCPPType(), Crc);
+		Crc = FCrc::MemCrc32(&Property->ArrayDim, sizeof(Property->ArrayDim), Crc);
+
+		if (const auto* StructProperty{ CastField<FStructProperty>(Property) })
+		{
+			Crc = HashStruct(StructProperty->Struct, Crc, VisitedStructs);
+		}
+		else if (const auto* ArrayProperty{ CastField<FArrayProperty>(Property) })
+		{
+			Crc = HashProperty(ArrayProperty->Inner, Crc, VisitedStructs);
+		}
+		else if (const auto* SetProperty{ CastField<FSetProperty>(Property) })
+		{
+			Crc = HashProperty(SetProperty->ElementProp, Crc, VisitedStructs);
+		}
+		else if (const auto* MapProperty{ CastField<FMapProperty>(Property) })
+		{
+			Crc = HashProperty(MapProperty->KeyProp, Crc, VisitedStructs);
+			Crc = HashProperty(MapProperty->ValueProp, Crc, VisitedStructs);
+		}
+
+		return Crc;
+	}
+
+	/**
+	 * Returns the number of distinct non-empty blobs in the properties of the object, used to reserve the blob table of the header
+	 *
+	 * Tips:
+	 *	Blobs of subobjects or written by custom serializers are not counted.
+	 */
+	static int32 CountBlobs(const UObject* Object)
+	{
+		TSet<FIoHash> Hashes;
+
+		for (TPropertyValueIterator<const FStructProperty> It(Object->GetClass(), Object); It; ++It)
+		{
+			if (It.Key()->Struct == FGameSaveBlob::StaticStruct())
+			{
+				const auto* Blob{ static_cast<const FGameSaveBlob*>(It.Value()) };
+
+				if (!Blob->IsEmpty() && !It.Key()->HasAnyPropertyFlags(CPF_Transient))
+				{
+					Hashes.Add(Blob->GetHash());
+				}
+
+				It.SkipRecursiveProperty();
+			}
+		}
+
+		return Hashes.Num();
+	}
+}
+
+
+bool FGameSaveSerializer::SaveToMemory(USaveGame* SaveObject, int32 DataVersion, bool bUnversioned, TArray<uint8>& OutData)
+{
+	if (!SaveObject)
+	{
+		return false;
+	}
+
+	// Unversioned data is read by the layout of the class, so its arrays are always kept in the object
+
+	TArray<const FArrayProperty*> ColumnarProperties;
+
+	if (!bUnversioned)
+	{
+		FGameSaveColumnar::GetColumnarProperties(SaveObject->GetClass(), ColumnarProperties);
+	}
+
+	auto Flags{ bUnversioned ? EGameSaveFormatFlags::Unversioned : EGameSaveFormatFlags::None };
+
+	if (ColumnarProperties.Num() > 0)
+	{
+		Flags |= EGameSaveFormatFlags::Columnar;
+	}
+
+	FGameSaveHeader Header;
+	Header.Initialize(SaveObject->GetClass(), DataVersion, Flags);
+	Header.SchemaHash = GetSchemaHash(SaveObject->GetClass());
+
+	// Reserve the header with a blob table for the blobs of the object, the payload is written directly after it
+
+	const auto NumReservedBlobs{ GameSaveSerializer::CountBlobs(SaveObject) };
+	Header.BlobHashes.SetNumZeroed(NumReservedBlobs);
+
+	OutData.Reset();
+
+	FMemoryWriter Writer(OutData, true);
+	Header.Serialize(Writer);
+
+	const auto PayloadOffset{ Writer.Tell() };
+
+	FGameSaveBlobCollector BlobCollector;
+
+	FGameSaveObjectArchive Ar(Writer, false);
+	Ar.SetUseUnversionedPropertySerialization(bUnversioned);
+
+	for (const auto* Property : ColumnarProperties)
+	{
+		Ar.SkippedProperties.Add(Property);
+	}
+
+	SaveObject->Serialize(Ar);
+
+	if (ColumnarProperties.Num() > 0)
+	{
+		FGameSaveColumnar::WriteArrays(Writer, SaveObject, ColumnarProperties);
+	}
+
+	if (Writer.IsError() || Ar.IsError())
+	{
+		return false;
+	}
+
+	// Rewrite the header now that the payload and the blobs it references are known
+
+	Header.PayloadSize = Writer.Tell() - PayloadOffset;
+	Header.PayloadHash = FGameSaveHeader::HashPayload(OutData.GetData() + PayloadOffset, Header.PayloadSize);
+	Header.BlobHashes = BlobCollector.Blobs.Hashes;
+
+	if (Header.BlobHashes.Num() == NumReservedBlobs)
+	{
+		Writer.Seek(0);
+		Header.Serialize(Writer);
+
+		return !Writer.IsError();
+	}
+
+	// The blob table has another size than reserved, only when blobs were not counted up front, so the payload is moved
+
+	TArray<uint8> HeaderData;
+
+	FMemoryWriter HeaderWriter(HeaderData, true);
+	Header.Serialize(HeaderWriter);
+
+	const auto OldHeaderSize{ static_cast<int32>(PayloadOffset) };
+	const auto SizeDelta{ HeaderData.Num() - OldHeaderSize };
+
+	if (SizeDelta > 0)
+	{
+		OutData.InsertUninitialized(OldHeaderSize, SizeDelta);
+	}
+	else
+	{
+		OutData.RemoveAt(OldHeaderSize + SizeDelta, -SizeDelta);
+	}
+
+	FMemory::Memcpy(OutData.GetData(), HeaderData.GetData(), HeaderData.Num());
+
+	return !HeaderWriter.IsError();
+}
+
+USaveGame* FGameSaveSerializer::LoadFromMemory(const TArray<uint8>& InData)
+{
+	// Files written before this format existed are loaded through the engine's tagged path
+
+	if (!IsGameSaveData(InData))
+	{
+		return UGameplayStatics::LoadGameFromMemory(InData);
+	}
+
+	FGameSaveHeader Header;
+	int64 PayloadOffset{ 0 };
+
+	if (!ReadHeader(InData, Header, &PayloadOffset))
+	{
+		UE_LOG(LogGameCore_Save, Error, TEXT("FGameSaveSerializer::LoadFromMemory: Unsupported save header"));
+		return nullptr;
+	}
+
+	auto* SaveGameClass{ FSoftClassPath(Header.ClassPath).TryLoadClass<USaveGame>() };
+	if (!SaveGameClass)
+	{
+		UE_LOG(LogGameCore_Save, Error, TEXT("FGameSaveSerializer::LoadFromMemory: Unknown save game class(%s)"), *Header.ClassPath);
+		return nullptr;
+	}
+
+	return DeserializeObject(InData, Header, PayloadOffset, SaveGameClass, false);
+}
+
+USaveGame* FGameSaveSerializer::LoadFromMemory_AnyThread(const TArray<uint8>& InData, bool* bOutNeedsGameThread)
+{
+	if (bOutNeedsGameThread)
+	{
+		*bOutNeedsGameThread = false;
+	}
+
+	FGameSaveHeader Header;
+	int64 PayloadOffset{ 0 };
+
+	if (!ReadHeader(InData, Header, &PayloadOffset))
+	{
+		return nullptr;
+	}
+
+	// Classes can only be loaded on the game thread
+
+	auto* SaveGameClass{ FSoftClassPath(Header.ClassPath).ResolveClass() };
+	if (!SaveGameClass || !SaveGameClass->IsChildOf<USaveGame>())
+	{
+		if (bOutNeedsGameThread)
+		{
+			*bOutNeedsGameThread = true;
+		}
+
+		return nullptr;
+	}
+
+	return DeserializeObject(InData, Header, PayloadOffset, SaveGameClass, !IsInGameThread(), bOutNeedsGameThread);
+}
+
+bool FGameSaveSerializer::CanLoadOnAnyThread(const TArray<uint8>& InData)
+{
+	FGameSaveHeader Header;
+
+	if (!ReadHeader(InData, Header))
+	{
+		return false;
+	}
+
+	const auto* SaveGameClass{ FSoftClassPath(Header.ClassPath).ResolveClass() };
+	return SaveGameClass && SaveGameClass->IsChildOf<USaveGame>();
+}
+
+void FGameSaveSerializer::FinishAsyncLoad(USaveGame* SaveObject)
+{
+	check(IsInGameThread());
+
+	if (SaveObject)
+	{
+		GameSaveSerializer::ClearAsyncFlags(SaveObject);
+	}
+}
+
+bool FGameSaveSerializer::MigrateData(TArray<uint8>& InOutData)
+{
+	if (!IsGameSaveData(InOutData))
+	{
+		return true;
+	}
+
+	FGameSaveHeader Header;
+	int64 PayloadOffset{ 0 };
+
+	if (!ReadHeader(InOutData, Header, &PayloadOffset))
+	{
+		UE_LOG(LogGameCore_Save, Error, TEXT("FGameSaveSerializer::MigrateData: Unsupported save header"));
+		return false;
+	}
+
+	if (Header.IsEncrypted())
+	{
+		UE_LOG(LogGameCore_Save, Error, TEXT("FGameSaveSerializer::MigrateData: Save of class(%s) must be decrypted before it is migrated"), *Header.ClassPath);
+		return false;
+	}
+
+	auto& Registry{ FGameSaveMigrationRegistry::Get() };
+
+	if (!Registry.HasStep(Header.ClassPath, Header.DataVersion))
+	{
+		return true;
+	}
+
+	TArray<uint8> Payload(InOutData.GetData() + PayloadOffset, InOutData.Num() - PayloadOffset);
+
+	if (!Registry.Migrate(Header, Payload))
+	{
+		return false;
+	}
+
+	// Rebuild the data with the migrated header and payload
+
+	Header.PayloadSize = Payload.Num();
+	Header.PayloadHash = FGameSaveHeader::HashPayload(Payload.GetData(), Payload.Num());
+
+	InOutData.Reset();
+
+	FMemoryWriter Writer(InOutData, true);
+	Header.Serialize(Writer);
+	Writer.Serialize(Payload.GetData(), Payload.Num());
+
+	return !Writer.IsError();
+}
+
+bool FGameSaveSerializer::IsGameSaveData(const TArray<uint8>& InData)
+{
+	return FGameSaveHeader::HasValidMagic(InData);
+}
+
+bool FGameSaveSerializer::ReadHeader(const TArray<uint8>& InData, FGameSaveHeader& OutHeader, int64* OutPayloadOffset)
+{
+	if (!IsGameSaveData(InData))
+	{
+		return false;
+	}
+
+	FMemoryReader Reader(InData, true);
+	OutHeader.Serialize(Reader);
+
+	if (Reader.IsError())
+	{
+		return false;
+	}
+
+	if (OutPayloadOffset)
+	{
+		*OutPayloadOffset = Reader.Tell();
+	}
+
+	return true;
+}
+
+bool FGameSaveSerializer::ReadHeaderSummary(const TArray<uint8>& InData, FGameSaveHeader& OutHeader)
+{
+	if (!IsGameSaveData(InData))
+	{
+		return false;
+	}
+
+	FMemoryReader Reader(InData, true);
+	OutHeader.SerializeSummary(Reader);
+
+	return !Reader.IsError();
+}
+
+uint32 FGameSaveSerializer::GetSchemaHash(const UClass* Class)
+{
+	if (!Class)
+	{
+		return 0;
+	}
+
+	TSet<const UStruct*> VisitedStructs;
+	return GameSaveSerializer::HashStruct(Class, 0, VisitedStructs);
+}
+
+void FGameSaveSerializer::GetPropertyHashes(const USaveGame* SaveObject, TMap<FName, uint32>& OutHashes)
+{
+	OutHashes.Reset();
+
+	if (!SaveObject)
+	{
+		return;
+	}
+
+	TArray<uint8> Bytes;
+
+	for (TFieldIterator<FProperty> It(SaveObject->GetClass()); It; ++It)
+	{
+		const auto* Property{ *It };
+
+		if (!IsSavedProperty(Property))
+		{
+			continue;
+		}
+
+		SerializeProperty(SaveObject, Property, Bytes);
+
+		OutHashes.Add(Property->GetFName(), FCrc::MemCrc32(Bytes.GetData(), Bytes.Num()));
+	}
+}
+
+bool FGameSaveSerializer::IsSavedProperty(const FProperty* Property)
+{
+	return Property && !Property->HasAnyPropertyFlags(CPF_Transient | CPF_Deprecated);
+}
+
+void FGameSaveSerializer::SerializeProperty(const USaveGame* SaveObject, const FProperty* Property, TArray<uint8>& OutBytes)
+{
+	OutBytes.Reset();
+
+	FMemoryWriter Writer(OutBytes);
+	FObjectAndNameAsStringProxyArchive Ar(Writer, false);
+
+	for (int32 ArrayIndex{ 0 }; ArrayIndex < Property->ArrayDim; ++ArrayIndex)
+	{
+		auto* ValuePtr{ const_cast<void*>(Property->ContainerPtrToValuePtr<void>(SaveObject, ArrayIndex)) };
+		Property->SerializeItem(FStructuredArchiveFromArchive(Ar).GetSlot(), ValuePtr);
+	}
+}
+
+bool FGameSaveSerializer::DeserializeProperty(USaveGame* SaveObject, const FProperty* Property, const TArray<uint8>& InBytes)
+{
+	FMemoryReader Reader(InBytes);
+	FObjectAndNameAsStringProxyArchive Ar(Reader, true);
+
+	for (int32 ArrayIndex{ 0 }; ArrayIndex < Property->ArrayDim; ++ArrayIndex)
+	{
+		auto* ValuePtr{ Property->ContainerPtrToValuePtr<void>(SaveObject, ArrayIndex) };
+		Property->SerializeItem(FStructuredArchiveFromArchive(Ar).GetSlot(), ValuePtr);
+	}
+
+	return !Ar.IsError();
+}
+
+
+USaveGame* FGameSaveSerializer::DeserializeObject(const TArray<uint8>& InData, const FGameSaveHeader& Header, int64 PayloadOffset, UClass* SaveGameClass, bool bAsync, bool* bOutNeedsGameThread)
+{
+	if (Header.IsEncrypted())
+	{
+		UE_LOG(LogGameCore_Save, Error, TEXT("FGameSaveSerializer::DeserializeObject: Save of class(%s) must be decrypted before it is loaded"), *Header.ClassPath);
+		return nullptr;
+	}
+
+	// Unversioned data has no property tags, so it can only be read by the exact layout it was written with
+
+	if (Header.IsUnversioned() && (Header.SchemaHash != GetSchemaHash(SaveGameClass)))
+	{
+		UE_LOG(LogGameCore_Save, Error, TEXT("FGameSaveSerializer::DeserializeObject: Schema of class(%s) has changed since the unversioned save was written"), *Header.ClassPath);
+		return nullptr;
+	}
+
+	FMemoryReader Reader(InData, true);
+	Reader.Seek(PayloadOffset);
+	Reader.SetUEVer(Header.PackageFileUEVersion);
+	Reader.SetEngineVer(Header.SavedEngineVersion);
+	Reader.SetCustomVersions(Header.CustomVersions);
+
+	// Objects created off the game thread are hidden from garbage collection until FinishAsyncLoad
+
+	FStaticConstructObjectParameters Params(SaveGameClass);
+	Params.Outer = GetTransientPackage();
+	Params.InternalSetFlags = bAsync ? EInternalObjectFlags::Async : EInternalObjectFlags::None;
+
+	auto* SaveObject{ CastChecked<USaveGame>(StaticConstructObject_Internal(Params)) };
+
+	// Referenced objects that are not loaded yet can only be loaded on the game thread
+
+	GameSaveSerializer::FLoadProxyArchive Ar(Reader, !bAsync);
+	Ar.SetUseUnversionedPropertySerialization(Header.IsUnversioned());
+	SaveObject->Serialize(Ar);
+
+	if (bAsync && Ar.bHasUnresolvedReferences)
+	{
+		UE_LOG(LogGameCore_Save, Verbose, TEXT("FGameSaveSerializer::DeserializeObject: Save of class(%s) references objects that are not loaded, it is deserialized on the game thread"), *Header.ClassPath);
+
+		if (bOutNeedsGameThread)
+		{
+			*bOutNeedsGameThread = true;
+		}
+
+		// Let garbage collection destroy the incomplete object
+
+		GameSaveSerializer::ClearAsyncFlags(SaveObject);
+		return nullptr;
+	}
+
+	// Columnar arrays follow the object
+
+	if (!Ar.IsError() && Header.HasColumnarArrays() && !FGameSaveColumnar::ReadArrays(Reader, SaveObject))
+	{
+		Reader.SetError();
+	}
+
+	if (Ar.IsError() || Reader.IsError())
+	{
+		UE_LOG(LogGameCore_Save, Error, TEXT("FGameSaveSerializer::DeserializeObject: Failed to deserialize save game object of class(%s)"), *Header.ClassPath);
+
+		// Let garbage collection destroy the failed object
+
+		GameSaveSerializer::ClearAsyncFlags(SaveObject);
+		return nullptr;
+	}
+
+	// Data migrated by MigrateData still contains the version it was originally written with
+
+	if (auto* VersionProperty{ FindFProperty<FIntProperty>(SaveGameClass, GameSaveSerializer::NAME_SavedDataVersion) })
+	{
+		VersionProperty->SetPropertyValue_InContainer(SaveObject, Header.DataVersion);
+	}
+
+	return SaveObject;
+}
@@ -0,0 +1,134 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+class USaveGame;
+class UClass;
+class FProperty;
+struct FGameSaveHeader;
+
+
+/**
+ * Reads and writes save game objects in the save file format of this plugin
+ *
+ * Tips:
+ *	Data that does not start with FGameSaveHeader is treated as a file written by UGameplayStatics and loaded through the engine's tagged path.
+ *	Reading and writing slots is done by FGameSavePipeline.
+ */
+class GCSAVE_API FGameSaveSerializer
+{
+public:
+	//////////////////////////////////////////////////////////////////
+	// Memory
+public:
+	/**
+	 * Serializes the save game object with a header
+	 *
+	 * Tips:
+	 *	If bUnversioned is true, properties are written with the unversioned property serialization and the schema hash of the class is stored in the header.
+	 *	FGameSaveBlob properties are written as references, their payloads are added to the FGameSaveBlobCollector in scope.
+	 */
+	static bool SaveToMemory(USaveGame* SaveObject, int32 DataVersion, bool bUnversioned, TArray<uint8>& OutData);
+
+	/**
+	 * Creates a save game object from serialized data
+	 *
+	 * Note:
+	 *	Return nullptr if the data is invalid, still encrypted, or if unversioned data no longer matches the schema of its class
+	 */
+	static USaveGame* LoadFromMemory(const TArray<uint8>& InData);
+
+	/**
+	 * Creates a save game object from serialized data on any thread
+	 *
+	 * Tips:
+	 *	The object is created with the Async internal flag so that garbage collection ignores it, FinishAsyncLoad must be called on the game thread before it is used.
+	 *	The caller should hold a FGCScopeGuard while it runs.
+	 *
+	 * Note:
+	 *	Return nullptr if the data can only be loaded on the game thread, because its class (see CanLoadOnAnyThread) or an object it references is not loaded yet.
+	 *	bOutNeedsGameThread is set to true in that case, so that the data can be loaded again with LoadFromMemory.
+	 */
+	static USaveGame* LoadFromMemory_AnyThread(const TArray<uint8>& InData, bool* bOutNeedsGameThread = nullptr);
+
+	/**
+	 * Returns true if the data was written by SaveToMemory and its class is already loaded
+	 */
+	static bool CanLoadOnAnyThread(const TArray<uint8>& InData);
+
+	/**
+	 * Clears the Async internal flag of an object created by LoadFromMemory_AnyThread and its subobjects
+	 */
+	static void FinishAsyncLoad(USaveGame* SaveObject);
+
+	/**
+	 * Upgrades the serialized data with the steps registered in FGameSaveMigrationRegistry and rewrites its header
+	 *
+	 * Tips:
+	 *	Thread-safe, the async load runs this on a worker thread so that only deserialization is left for the game thread.
+	 *	Data without migration steps, or written by UGameplayStatics, is left untouched.
+	 *
+	 * Note:
+	 *	Return false if the data is invalid, still encrypted, or a migration step failed
+	 */
+	static bool MigrateData(TArray<uint8>& InOutData);
+
+	/**
+	 * Returns true if the data was written by SaveToMemory
+	 */
+	static bool IsGameSaveData(const TArray<uint8>& InData);
+
+	/**
+	 * Reads the header at the start of the data
+	 *
+	 * Note:
+	 *	Return false if the data was not written by SaveToMemory or its format is not supported
+	 */
+	static bool ReadHeader(const TArray<uint8>& InData, FGameSaveHeader& OutHeader, int64* OutPayloadOffset = nullptr);
+
+	/**
+	 * Reads only the summary of the header, the data may be just the first bytes of a save
+	 *
+	 * Note:
+	 *	Return false if the data was not written by SaveToMemory or is too short for the summary
+	 */
+	static bool ReadHeaderSummary(const TArray<uint8>& InData, FGameSaveHeader& OutHeader);
+
+	/**
+	 * Returns the hash of the serialized property layout of the class
+	 *
+	 * Tips:
+	 *	Any change to the name, type or order of a property, including nested structs and containers, changes the hash
+	 */
+	static uint32 GetSchemaHash(const UClass* Class);
+
+	/**
+	 * Returns the hash of the serialized value of each non-transient property of the object
+	 */
+	static void GetPropertyHashes(const USaveGame* SaveObject, TMap<FName, uint32>& OutHashes);
+
+	/**
+	 * Returns true if the property is written to saves
+	 */
+	static bool IsSavedProperty(const FProperty* Property);
+
+	/**
+	 * Serializes the value of the property of the object, including all elements of a static array
+	 */
+	static void SerializeProperty(const USaveGame* SaveObject, const FProperty* Property, TArray<uint8>& OutBytes);
+
+	/**
+	 * Overwrites the value of the property of the object with data written by SerializeProperty
+	 */
+	static bool DeserializeProperty(USaveGame* SaveObject, const FProperty* Property, const TArray<uint8>& InBytes);
+
+protected:
+	/**
+	 * Creates the object of the class and deserializes the payload into it
+	 *
+	 * Tips:
+	 *	Async deserialization fails and sets bOutNeedsGameThread if the payload references an object that is not loaded, instead of leaving the reference empty
+	 */
+	static USaveGame* DeserializeObject(const TArray<uint8>& InData, const FGameSaveHeader& Header, int64 PayloadOffset, UClass* SaveGameClass, bool bAsync, bool* bOutNeedsGameThread = nullptr);
+
+};
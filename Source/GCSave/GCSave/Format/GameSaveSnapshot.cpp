@@ -0,0 +1,124 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "GameSaveSnapshot.h"
+
+#include "Format/GameSaveSerializer.h"
+
+#include "GameFramework/SaveGame.h"
+#include "HAL/PlatformTime.h"
+#include "UObject/UnrealType.h"
+
+
+FGameSaveSnapshot::~FGameSaveSnapshot()
+{
+	if (Data)
+	{
+		for (const auto& Copied : Properties)
+		{
+			Copied.Property->DestroyValue_InContainer(Data);
+		}
+
+		FMemory::Free(Data);
+	}
+}
+
+FGameSaveSnapshotRef FGameSaveSnapshot::Capture(const USaveGame* SaveObject, const FString& InSlotName)
+{
+	check(IsInGameThread());
+	check(SaveObject);
+
+	const auto* Class{ SaveObject->GetClass() };
+
+	auto Snapshot{ MakeShared<FGameSaveSnapshot, ESPMode::ThreadSafe>() };
+	Snapshot->SlotName = InSlotName;
+	Snapshot->ClassPath = Class->GetPathName();
+	Snapshot->CaptureTime = FPlatformTime::Seconds();
+
+	// The values keep their offsets in the object, the memory of unsaved properties is left unused
+
+	Snapshot->Data = static_cast<uint8*>(FMemory::MallocZeroed(Class->GetPropertiesSize(), Class->GetMinAlignment()));
+
+	for (TFieldIterator<FProperty> It(Class); It; ++It)
+	{
+		const auto* Property{ *It };
+
+		if (!FGameSaveSerializer::IsSavedProperty(Property))
+		{
+			continue;
+		}
+
+		Property->InitializeValue_InContainer(Snapshot->Data);
+		Property->CopyCompleteValue_InContainer(Snapshot->Data, SaveObject);
+
+		auto& Copied{ Snapshot->Properties.AddDefaulted_GetRef() };
+		Copied.Name = Property->GetFName();
+		Copied.Property = Property;
+		Copied.Offset = Property->GetOffset_ForInternal();
+		Copied.ElementSize = Property->ElementSize;
+	}
+
+	return Snapshot;
+}
+
+const void* FGameSaveSnapshot::FindValuePtr(FName PropertyName) const
+{
+	const auto* Property{ Properties.FindByPredicate([PropertyName](const FCopiedProperty& Copied) { return Copied.Name == PropertyName; }) };
+
+	return Property ? Data + Property->Offset : nullptr;
+}
+
+
+FGameSaveSnapshotChannel::~FGameSaveSnapshotChannel()
+{
+	Current.store(nullptr);
+}
+
+FGameSaveSnapshotPtr FGameSaveSnapshotChannel::Get() const
+{
+	// The snapshot cannot be released while this reader is counted, so it is safe to take a reference to it
+
+	NumReaders.fetch_add(1);
+
+	const auto* Snapshot{ Current.load() };
+	FGameSaveSnapshotPtr Result{ Snapshot ? Snapshot->AsShared() : FGameSaveSnapshotPtr() };
+
+	NumReaders.fetch_sub(1);
+
+	return Result;
+}
+
+void FGameSaveSnapshotChannel::Publish(FGameSaveSnapshotRef Snapshot)
+{
+	check(IsInGameThread());
+
+	Snapshot->Sequence = LatestSequence.load() + 1;
+
+	OwnedSnapshots.Add(Snapshot);
+	Current.store(&Snapshot.Get());
+	LatestSequence.store(Snapshot->Sequence, std::memory_order_release);
+
+	ReleaseReplacedSnapshots();
+}
+
+void FGameSaveSnapshotChannel::Reset()
+{
+	check(IsInGameThread());
+
+	Current.store(nullptr);
+
+	ReleaseReplacedSnapshots();
+}
+
+void FGameSaveSnapshotChannel::ReleaseReplacedSnapshots()
+{
+	// Readers that start after this check see the new snapshot, so the replaced ones can go once no reader is counted
+
+	if (NumReaders.load() != 0)
+	{
+		return;
+	}
+
+	const auto* Latest{ Current.load() };
+
+	OwnedSnapshots.RemoveAll([Latest](const FGameSaveSnapshotPtr& Snapshot) { return Snapshot.Get() != Latest; });
+}
@@ -0,0 +1,178 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Templates/SharedPointer.h"
+
+#include <atomic>
+
+class USaveGame;
+class FProperty;
+class FGameSaveSnapshot;
+
+using FGameSaveSnapshotRef = TSharedRef<FGameSaveSnapshot, ESPMode::ThreadSafe>;
+using FGameSaveSnapshotPtr = TSharedPtr<const FGameSaveSnapshot, ESPMode::ThreadSafe>;
+
+
+/**
+ * Immutable copy of the saved properties of a save game object that can be read from any thread
+ *
+ * Tips:
+ *	The values are copied into memory owned by the snapshot with the same layout as the object, so reading them never touches the object.
+ *	Read values with FindValue and the C++ type of the property, e.g. FindValue<TArray<FName>>(GET_MEMBER_NAME_CHECKED(UMySave, Unlocks)).
+ *
+ * Note:
+ *	Object references in the values are copied as they are and must not be dereferenced off the game thread.
+ *	The class of the save must stay loaded while snapshots of it exist, which is always the case for classes of loaded saves.
+ */
+class GCSAVE_API FGameSaveSnapshot : public TSharedFromThis<FGameSaveSnapshot, ESPMode::ThreadSafe>
+{
+public:
+	FGameSaveSnapshot() {}
+	~FGameSaveSnapshot();
+
+	FGameSaveSnapshot(const FGameSaveSnapshot&) = delete;
+	FGameSaveSnapshot& operator=(const FGameSaveSnapshot&) = delete;
+
+	/**
+	 * Copies the saved properties of the object, must be called on the game thread
+	 */
+	static FGameSaveSnapshotRef Capture(const USaveGame* SaveObject, const FString& InSlotName);
+
+protected:
+	struct FCopiedProperty
+	{
+	public:
+		FName Name;
+
+		const FProperty* Property{ nullptr };
+
+		int32 Offset{ 0 };
+
+		int32 ElementSize{ 0 };
+	};
+
+	FString SlotName;
+
+	FString ClassPath;
+
+	double CaptureTime{ 0.0 };
+
+	//
+	// Number of the publish in its channel, 0 if it has not been published
+	//
+	uint64 Sequence{ 0 };
+
+	TArray<FCopiedProperty> Properties;
+
+	//
+	// Memory with the layout of the object, only the copied properties are initialized
+	//
+	uint8* Data{ nullptr };
+
+	friend class FGameSaveSnapshotChannel;
+
+public:
+	const FString& GetSlotName() const { return SlotName; }
+
+	const FString& GetClassPath() const { return ClassPath; }
+
+	double GetCaptureTime() const { return CaptureTime; }
+
+	uint64 GetSequence() const { return Sequence; }
+
+	/**
+	 * Returns the copied value of the property, or nullptr if the property is not saved
+	 */
+	const void* FindValuePtr(FName PropertyName) const;
+
+	/**
+	 * Returns the copied value of the property as its C++ type
+	 *
+	 * Note:
+	 *	Return nullptr if the property is not saved or its size does not match the type
+	 */
+	template<typename T>
+	const T* FindValue(FName PropertyName) const
+	{
+		const auto* Property{ Properties.FindByPredicate([PropertyName](const FCopiedProperty& Copied) { return Copied.Name == PropertyName; }) };
+
+		return (Property && (Property->ElementSize == sizeof(T))) ? reinterpret_cast<const T*>(Data + Property->Offset) : nullptr;
+	}
+
+	/**
+	 * Returns a copy of the value of the property, or DefaultValue if it is not found
+	 */
+	template<typename T>
+	T GetValue(FName PropertyName, const T& DefaultValue = T()) const
+	{
+		const auto* Value{ FindValue<T>(PropertyName) };
+
+		return Value ? *Value : DefaultValue;
+	}
+
+};
+
+
+/**
+ * Holds the latest snapshot of a slot, readers on any thread get it without locks
+ *
+ * Tips:
+ *	Get the channel once on the game thread and keep it, then call Get from any thread whenever the data is needed.
+ *	A snapshot stays valid for as long as it is referenced, even after a newer one has been published.
+ *	Compare GetLatestSequence with the sequence of a held snapshot to know whether it is outdated without getting a new one.
+ */
+class GCSAVE_API FGameSaveSnapshotChannel
+{
+public:
+	FGameSaveSnapshotChannel() {}
+	~FGameSaveSnapshotChannel();
+
+protected:
+	//
+	// Latest snapshot, kept alive by OwnedSnapshots
+	//
+	std::atomic<const FGameSaveSnapshot*> Current{ nullptr };
+
+	//
+	// Number of readers between reading Current and taking a reference to it
+	//
+	mutable std::atomic<int32> NumReaders{ 0 };
+
+	std::atomic<uint64> LatestSequence{ 0 };
+
+	//
+	// Latest snapshot and replaced snapshots that readers may still be taking, only accessed on the game thread
+	//
+	TArray<FGameSaveSnapshotPtr> OwnedSnapshots;
+
+public:
+	/**
+	 * Returns the latest snapshot, or nullptr if none has been published, can be called from any thread
+	 */
+	FGameSaveSnapshotPtr Get() const;
+
+	/**
+	 * Returns the sequence of the latest snapshot, 0 if none has been published, can be called from any thread
+	 */
+	uint64 GetLatestSequence() const { return LatestSequence.load(std::memory_order_acquire); }
+
+	/**
+	 * Replaces the latest snapshot, must be called on the game thread
+	 */
+	void Publish(FGameSaveSnapshotRef Snapshot);
+
+	/**
+	 * Removes the latest snapshot so that readers get nullptr, must be called on the game thread
+	 */
+	void Reset();
+
+protected:
+	/**
+	 * Releases the replaced snapshots once no reader can be about to take one of them
+	 */
+	void ReleaseReplacedSnapshots();
+
+};
+
+using FGameSaveSnapshotChannelRef = TSharedRef<FGameSaveSnapshotChannel, ESPMode::ThreadSafe>;
@@ -4,6 +4,8 @@
 
 #include "Engine/DeveloperSettings.h"
 
+#include "GameSaveTypes.h"
+
 #include "GameSaveDeveloperSettings.generated.h"
 
 
@@ -32,5 +34,215 @@ public:
 	UPROPERTY(Config, EditAnywhere, Category = "Save Game", meta = (ForceInlineRow, MetaClass = "/Script/GCSave.PlayerSave"))
 	TMap<FSoftClassPath, FString> PlayerSaveToAutoLoad;
 
+
+	///////////////////////////////////////////////
+	// Loading
+public:
+	//
+	// Time in milliseconds each save subsystem may spend per frame on the post-load of async loaded saves, 0 disables the budget
+	//
+	// Tips:
+	//	Post-loads run on the next tick of the core ticker after the save has finished loading, at least one per tick.
+	//	With 0, every queued post-load runs in that tick. The delegate of a load is called once its post-load has finished.
+	//
+	UPROPERTY(Config, EditAnywhere, Category = "Loading", meta = (ClampMin = 0, Units = "ms"))
+	float PostLoadBudgetMs{ 4.0f };
+
+
+	///////////////////////////////////////////////
+	// Completions
+public:
+	//
+	// Maximum number of async save and load completions each save subsystem dispatches per frame, 0 for no limit
+	//
+	// Tips:
+	//	A completion runs the post-save or deserialization of the operation and calls its delegate
+	//
+	UPROPERTY(Config, EditAnywhere, Category = "Completions", meta = (ClampMin = 0))
+	int32 MaxCompletionsPerFrame{ 16 };
+
+	//
+	// Time in milliseconds each save subsystem may spend per frame dispatching async save and load completions, 0 for no limit
+	//
+	// Tips:
+	//	At least one completion is dispatched per frame
+	//
+	UPROPERTY(Config, EditAnywhere, Category = "Completions", meta = (ClampMin = 0, Units = "ms"))
+	float CompletionBudgetMs{ 2.0f };
+
+
+	///////////////////////////////////////////////
+	// Slot Ring
+public:
+	//
+	// Number of writes each slot ring keeps unless it is configured with ConfigureSlotRing of the save subsystems
+	//
+	UPROPERTY(Config, EditAnywhere, Category = "Slot Ring", meta = (ClampMin = 1))
+	int32 SlotRingSize{ 3 };
+
+
+	///////////////////////////////////////////////
+	// Checkpoint
+public:
+	//
+	// Maximum number of in-memory checkpoints each slot keeps, the oldest are dropped first, 0 for no limit
+	//
+	UPROPERTY(Config, EditAnywhere, Category = "Checkpoint", meta = (ClampMin = 0))
+	int32 MaxCheckpointsPerSlot{ 8 };
+
+
+	///////////////////////////////////////////////
+	// Storage
+public:
+	//
+	// Where the save subsystems store their saves
+	//
+	// Tips:
+	//	Can be overridden with "-GameSaveStorage=<Type>" on the command line
+	//
+	UPROPERTY(Config, EditAnywhere, Category = "Storage")
+	EGameSaveStorageType StorageType{ EGameSaveStorageType::PlatformFile };
+
+	//
+	// Maximum total size in bytes of the data kept by PrefetchSlots of each save subsystem, the oldest prefetches are evicted first
+	//
+	UPROPERTY(Config, EditAnywhere, Category = "Storage", meta = (ClampMin = 0, Units = "Bytes"))
+	int64 PrefetchCacheSize{ 32 * 1024 * 1024 };
+
+
+	///////////////////////////////////////////////
+	// Throttling
+public:
+	//
+	// Disk bandwidth in bytes per second that writes of background priority may use together, 0 for no limit
+	//
+	// Tips:
+	//	Writes of critical priority and all reads are never throttled
+	//
+	UPROPERTY(Config, EditAnywhere, Category = "Throttling", meta = (ClampMin = 0, Units = "Bytes"))
+	int64 BackgroundWriteBytesPerSecond{ 0 };
+
+	//
+	// Size in bytes of the chunks throttled writes are split into, the writer waits for budget before each chunk
+	//
+	UPROPERTY(Config, EditAnywhere, Category = "Throttling", meta = (ClampMin = 4096, Units = "Bytes"))
+	int32 BackgroundWriteChunkSize{ 64 * 1024 };
+
+	//
+	// Whether writes of background priority wait while the engine is loading many packages
+	//
+	UPROPERTY(Config, EditAnywhere, Category = "Throttling")
+	bool bPauseBackgroundWritesWhileStreaming{ false };
+
+	//
+	// Number of packages being loaded asynchronously from which background writes wait
+	//
+	UPROPERTY(Config, EditAnywhere, Category = "Throttling", meta = (ClampMin = 1, EditCondition = "bPauseBackgroundWritesWhileStreaming"))
+	int32 StreamingPackagesToPauseWrites{ 8 };
+
+	//
+	// Maximum time in seconds each chunk of a background write waits for streaming, so that saves are never held back forever
+	//
+	UPROPERTY(Config, EditAnywhere, Category = "Throttling", meta = (ClampMin = 0, Units = "s", EditCondition = "bPauseBackgroundWritesWhileStreaming"))
+	float MaxStreamingPauseSeconds{ 10.0f };
+
+
+	///////////////////////////////////////////////
+	// Server Player Saves
+public:
+	//
+	// Whether UServerPlayerSaveSubsystem is also created on listen servers and standalone games, it is always created on dedicated servers
+	//
+	UPROPERTY(Config, EditAnywhere, Category = "Server Player Saves")
+	bool bServerPlayerSavesOutsideDedicatedServer{ false };
+
+	//
+	// Directory in the SaveGames directory of the project where the saves of connected players are stored
+	//
+	UPROPERTY(Config, EditAnywhere, Category = "Server Player Saves")
+	FString ServerPlayerSaveDirectory{ TEXT("ServerPlayers") };
+
+	//
+	// Number of subdirectories the player directories are spread over, so that no directory holds too many entries
+	//
+	UPROPERTY(Config, EditAnywhere, Category = "Server Player Saves", meta = (ClampMin = 1, ClampMax = 4096))
+	int32 ServerPlayerSaveShards{ 256 };
+
+	//
+	// Maximum number of reads and writes of player saves that run at the same time
+	//
+	UPROPERTY(Config, EditAnywhere, Category = "Server Player Saves", meta = (ClampMin = 1))
+	int32 ServerPlayerSaveIOWorkers{ 4 };
+
+	//
+	// Interval in seconds at which changed player saves are written back, 0 disables the periodic write-back
+	//
+	UPROPERTY(Config, EditAnywhere, Category = "Server Player Saves", meta = (ClampMin = 0, Units = "s"))
+	float ServerPlayerSaveWriteBackInterval{ 30.0f };
+
+	//
+	// Maximum number of player saves serialized for the write-back per frame
+	//
+	UPROPERTY(Config, EditAnywhere, Category = "Server Player Saves", meta = (ClampMin = 1))
+	int32 ServerPlayerSaveWriteBackBatchSize{ 16 };
+
+
+	///////////////////////////////////////////////
+	// Encryption
+public:
+	//
+	// Whether the payload of saves is encrypted on a worker thread before it is written
+	//
+	// Tips:
+	//	The key is provided by the game with FGameSaveEncryption::SetKeyProvider, writes fail while no key is available.
+	//	Encrypted saves are decrypted on load regardless of this setting.
+	//
+	UPROPERTY(Config, EditAnywhere, Category = "Encryption")
+	bool bEncryptSaves{ false };
+
+
+	///////////////////////////////////////////////
+	// Memory
+public:
+	//
+	// Interval in seconds at which the save subsystems measure the memory of their saves for the GameSave stat group and the memory budgets, 0 disables it
+	//
+	// Tips:
+	//	The memory can always be logged with the "GameSave.Memory" console command
+	//
+	UPROPERTY(Config, EditAnywhere, Category = "Memory", meta = (ClampMin = 0, Units = "s"))
+	float MemoryAccountingInterval{ 5.0f };
+
+
+	///////////////////////////////////////////////
+	// Budgets
+public:
+	//
+	// Maximum serialized size in bytes of saves of each class, the closest parent class is used if a class is not listed
+	//
+	UPROPERTY(Config, EditAnywhere, Category = "Budget", meta = (ForceInlineRow, MetaClass = "/Script/Engine.SaveGame", ClampMin = 0, Units = "Bytes"))
+	TMap<FSoftClassPath, int64> SaveSizeBudgets;
+
+	//
+	// Whether saves that exceed the size budget of their class fail instead of only logging a warning
+	//
+	UPROPERTY(Config, EditAnywhere, Category = "Budget")
+	bool bRejectSavesOverSizeBudget{ false };
+
+	//
+	// Maximum memory in bytes of each loaded save of a class, including its containers, the closest parent class is used if a class is not listed
+	//
+	UPROPERTY(Config, EditAnywhere, Category = "Budget", meta = (ForceInlineRow, MetaClass = "/Script/Engine.SaveGame", ClampMin = 0, Units = "Bytes"))
+	TMap<FSoftClassPath, int64> SaveMemoryBudgets;
+
+	//
+	// Maximum memory in bytes of the loaded saves, in-flight buffers, prefetch caches and checkpoints of all save subsystems, 0 for no budget
+	//
+	// Tips:
+	//	Exceeding a memory budget only logs a warning, it is checked every MemoryAccountingInterval
+	//
+	UPROPERTY(Config, EditAnywhere, Category = "Budget", meta = (ClampMin = 0, Units = "Bytes"))
+	int64 TotalSaveMemoryBudget{ 0 };
+
 };
 
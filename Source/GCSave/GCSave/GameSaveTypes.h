@@ -0,0 +1,53 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "GameSaveTypes.generated.h"
+
+
+/**
+ * How a save detects that it has changed since the last successful save
+ */
+UENUM(BlueprintType)
+enum class EGameSaveDirtyTracking : uint8
+{
+	// Always written when a save is requested
+	None,
+
+	// Written only after MarkDirty has been called
+	Explicit,
+
+	// Written only if the serialized value of a property differs from the last successful save or load
+	Snapshot,
+};
+
+
+/**
+ * Where serialized save data is stored
+ */
+UENUM(BlueprintType)
+enum class EGameSaveStorageType : uint8
+{
+	// Saved by the save game system of the platform, the same as UGameplayStatics
+	PlatformFile,
+
+	// Kept in memory only and lost when the subsystem is destroyed, used for tests and benchmarks
+	Memory,
+
+	// All slots are packed into one container file, for games with many small slots
+	Packed,
+};
+
+
+/**
+ * How urgently an async write must reach the storage
+ */
+UENUM(BlueprintType)
+enum class EGameSaveIOPriority : uint8
+{
+	// Written right away, for saves the player is waiting for
+	Critical,
+
+	// Written within the bandwidth budget of background writes and paused during heavy streaming, for autosaves and write-backs
+	Background,
+};
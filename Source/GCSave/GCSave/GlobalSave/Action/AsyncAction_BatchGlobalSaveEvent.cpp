@@ -0,0 +1,131 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "AsyncAction_BatchGlobalSaveEvent.h"
+
+#include "GlobalSave/GlobalSaveSubsystem.h"
+#include "Pipeline/GameSavePipeline.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(AsyncAction_BatchGlobalSaveEvent)
+
+
+UAsyncAction_BatchGlobalSaveEvent* UAsyncAction_BatchGlobalSaveEvent::AsyncLoadGlobalSaves(UGlobalSaveSubsystem* Subsystem, const TArray<FGlobalSaveBatchEntry>& Entries, bool bForceLoad)
+{
+	auto* Action{ NewObject<UAsyncAction_BatchGlobalSaveEvent>() };
+	Action->Operation = EGlobalSaveOperation::Load;
+	Action->InEntries = Entries;
+	Action->bInForceLoad = bForceLoad;
+	Action->InSubsystem = Subsystem;
+
+	if (Subsystem)
+	{
+		Action->RegisterWithGameInstance(Subsystem->GetGameInstance());
+	}
+
+	return Action;
+}
+
+UAsyncAction_BatchGlobalSaveEvent* UAsyncAction_BatchGlobalSaveEvent::AsyncSaveGlobalSaves(UGlobalSaveSubsystem* Subsystem, const TArray<FGlobalSaveBatchEntry>& Entries)
+{
+	auto* Action{ NewObject<UAsyncAction_BatchGlobalSaveEvent>() };
+	Action->Operation = EGlobalSaveOperation::Save;
+	Action->InEntries = Entries;
+	Action->InSubsystem = Subsystem;
+
+	if (Subsystem)
+	{
+		Action->RegisterWithGameInstance(Subsystem->GetGameInstance());
+	}
+
+	return Action;
+}
+
+
+void UAsyncAction_BatchGlobalSaveEvent::Activate()
+{
+	Results.SetNum(InEntries.Num());
+	IssuedSerials.SetNumZeroed(InEntries.Num());
+
+	if (!InSubsystem.IsValid())
+	{
+		HandleCompleted();
+		return;
+	}
+
+	// Slots that complete during the loop are counted, but the completion waits until every slot is issued
+
+	bIssuing = true;
+
+	for (int32 Index{ 0 }; Index < InEntries.Num(); ++Index)
+	{
+		const auto& Entry{ InEntries[Index] };
+		const auto SlotName{ InSubsystem->ResolveSlotName(Entry.GlobalSaveClass, Entry.SlotName) };
+
+		Results[Index].SlotName = SlotName;
+		IssuedSerials[Index] = InSubsystem->GetPipeline()->GetTransferSerial(SlotName, UGlobalSaveSubsystem::SLOT_GlobalSave);
+
+		auto bActivationSuccess{ false };
+		auto Delegate{ FGlobalSaveEventDelegate::CreateUObject(this, &ThisClass::HandleSlotEvent, Index) };
+
+		if (Operation == EGlobalSaveOperation::Load)
+		{
+			bActivationSuccess = InSubsystem->AsyncLoadGlobalSave(Entry.GlobalSaveClass, Entry.SlotName, bInForceLoad, Delegate);
+		}
+		else if (Operation == EGlobalSaveOperation::Save)
+		{
+			bActivationSuccess = InSubsystem->AsyncSaveGameToSlot(Entry.GlobalSaveClass, Entry.SlotName, Delegate);
+		}
+
+		if (!bActivationSuccess)
+		{
+			HandleSlotEvent(nullptr, false, Index);
+		}
+	}
+
+	bIssuing = false;
+
+	if (NumCompleted >= InEntries.Num())
+	{
+		HandleCompleted();
+	}
+}
+
+
+void UAsyncAction_BatchGlobalSaveEvent::HandleSlotEvent(UGlobalSave* GlobalSaveObject, bool bSuccess, int32 EntryIndex)
+{
+	auto& Result{ Results[EntryIndex] };
+	Result.GlobalSave = GlobalSaveObject;
+	Result.bSuccess = bSuccess;
+
+	// Only count the data if the slot was actually read or written by this operation
+
+	if (InSubsystem.IsValid())
+	{
+		int64 Bytes{ 0 };
+		const auto Serial{ InSubsystem->GetPipeline()->GetTransferSerial(Result.SlotName, UGlobalSaveSubsystem::SLOT_GlobalSave, &Bytes) };
+
+		Result.Bytes = (Serial != IssuedSerials[EntryIndex]) ? Bytes : 0;
+		TransferredBytes += Result.Bytes;
+	}
+
+	NumCompleted++;
+
+	Progress.Broadcast(NumCompleted, InEntries.Num(), TransferredBytes);
+
+	if (!bIssuing && (NumCompleted >= InEntries.Num()))
+	{
+		HandleCompleted();
+	}
+}
+
+void UAsyncAction_BatchGlobalSaveEvent::HandleCompleted()
+{
+	auto bAllSucceeded{ InSubsystem.IsValid() };
+
+	for (const auto& Result : Results)
+	{
+		bAllSucceeded &= Result.bSuccess;
+	}
+
+	Completed.Broadcast(Results, bAllSucceeded);
+	SetReadyToDestroy();
+}
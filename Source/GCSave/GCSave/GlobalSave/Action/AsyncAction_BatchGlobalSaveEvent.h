@@ -0,0 +1,133 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Kismet/BlueprintAsyncActionBase.h"
+
+#include "GlobalSave/GlobalSaveSubsystem.h"
+
+#include "AsyncAction_BatchGlobalSaveEvent.generated.h"
+
+
+/**
+ * Result of one entry of a batch
+ */
+USTRUCT(BlueprintType)
+struct FGlobalSaveBatchResult
+{
+	GENERATED_BODY()
+public:
+	FGlobalSaveBatchResult() {}
+
+	UPROPERTY(BlueprintReadOnly, Category = "Global Save")
+	TObjectPtr<UGlobalSave> GlobalSave{ nullptr };
+
+	UPROPERTY(BlueprintReadOnly, Category = "Global Save")
+	FString SlotName;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Global Save")
+	bool bSuccess{ false };
+
+	//
+	// Size of the data read or written, 0 if nothing was transferred (e.g. already loaded or unchanged)
+	//
+	UPROPERTY(BlueprintReadOnly, Category = "Global Save")
+	int64 Bytes{ 0 };
+
+};
+
+
+/**
+ * Delegate to signal the progress of a global save batch
+ */
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FGlobalSaveBatchProgressDelegate, int32, CompletedSlots, int32, TotalSlots, int64, TransferredBytes);
+
+/**
+ * Delegate to signal the completion of a global save batch
+ */
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FGlobalSaveBatchCompletedDelegate, const TArray<FGlobalSaveBatchResult>&, Results, bool, bAllSucceeded);
+
+
+/**
+ * Async action for handle async load or save of multiple global saves
+ *
+ * Tips:
+ *	All loads or saves are issued together and the results are in the order of the entries
+ */
+UCLASS()
+class GCSAVE_API UAsyncAction_BatchGlobalSaveEvent : public UBlueprintAsyncActionBase
+{
+	GENERATED_BODY()
+public:
+	UAsyncAction_BatchGlobalSaveEvent() {}
+
+public:
+	//
+	// Delegate called each time a slot completes
+	//
+	UPROPERTY(BlueprintAssignable)
+	FGlobalSaveBatchProgressDelegate Progress;
+
+	//
+	// Delegate called when all slots complete
+	//
+	UPROPERTY(BlueprintAssignable)
+	FGlobalSaveBatchCompletedDelegate Completed;
+
+protected:
+	enum class EGlobalSaveOperation : uint8 { Save, Load };
+
+	//
+	// Which operation is being run
+	//
+	EGlobalSaveOperation Operation{ EGlobalSaveOperation::Save };
+
+protected:
+	UPROPERTY(Transient)
+	TWeakObjectPtr<UGlobalSaveSubsystem> InSubsystem{ nullptr };
+
+	UPROPERTY(Transient)
+	TArray<FGlobalSaveBatchEntry> InEntries;
+
+	UPROPERTY(Transient)
+	bool bInForceLoad{ false };
+
+	UPROPERTY(Transient)
+	TArray<FGlobalSaveBatchResult> Results;
+
+	//
+	// Transfer serial of each slot when its operation was issued
+	//
+	TArray<uint32> IssuedSerials;
+
+	int32 NumCompleted{ 0 };
+
+	int64 TransferredBytes{ 0 };
+
+	//
+	// Whether the operations are still being issued, completion is deferred until all are issued
+	//
+	bool bIssuing{ false };
+
+public:
+	/**
+	 * Load global saves asynchronously.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Global Save", meta = (AdvancedDisplay = "bForceLoad", BlueprintInternalUseOnly = "true"))
+	static UAsyncAction_BatchGlobalSaveEvent* AsyncLoadGlobalSaves(UGlobalSaveSubsystem* Subsystem, const TArray<FGlobalSaveBatchEntry>& Entries, bool bForceLoad = false);
+
+	/**
+	 * Save global saves asynchronously.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Global Save", meta = (BlueprintInternalUseOnly = "true", DisplayName = "Wait Async Save Global Saves"))
+	static UAsyncAction_BatchGlobalSaveEvent* AsyncSaveGlobalSaves(UGlobalSaveSubsystem* Subsystem, const TArray<FGlobalSaveBatchEntry>& Entries);
+
+
+public:
+	virtual void Activate() override;
+
+protected:
+	virtual void HandleSlotEvent(UGlobalSave* GlobalSaveObject, bool bSuccess, int32 EntryIndex);
+	virtual void HandleCompleted();
+
+};
@@ -2,6 +2,7 @@
 
 #include "GlobalSave.h"
 
+#include "Format/GameSaveSerializer.h"
 #include "GCSaveLogs.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(GlobalSave)
@@ -14,6 +15,8 @@ void UGlobalSave::InitializeSaveGame(UGameInstance* GameInstance, FString InSlot
 
 	LoadedDataVersion = SavedDataVersion;
 	HandlePostLoad();
+
+	ClearDirty();
 }
 
 void UGlobalSave::ResetToDefault()
@@ -22,6 +25,8 @@ void UGlobalSave::ResetToDefault()
 	LoadedDataVersion = SavedDataVersion;
 
 	OnResetToDefault();
+
+	MarkDirty();
 }
 
 void UGlobalSave::HandlePostLoad()
@@ -35,9 +40,32 @@ void UGlobalSave::HandlePreSave()
 
 	// Set the save data version and increment the requested count
 
+	SavingPreviousDataVersion = SavedDataVersion;
 	SavedDataVersion = GetLatestDataVersion();
 	CurrentSaveRequest++;
 
+	// Keep the changes being saved so that they can be restored if the save fails
+
+	SavingDirtyProperties = MoveTemp(DirtyProperties);
+	DirtyProperties.Reset();
+
+	// The hashes of the dirty check that let this save through are still valid if nothing has been marked since
+
+	if (GetDirtyTrackingMode() == EGameSaveDirtyTracking::Snapshot)
+	{
+		if (CheckedSnapshotFrame == GFrameCounter)
+		{
+			SavingPropertySnapshot = MoveTemp(CheckedPropertySnapshot);
+		}
+		else
+		{
+			FGameSaveSerializer::GetPropertyHashes(this, SavingPropertySnapshot);
+		}
+	}
+
+	CheckedPropertySnapshot.Reset();
+	CheckedSnapshotFrame = MAX_uint64;
+
 	UE_LOG(LogGameCore_GlobalSave, Log, TEXT("Starting to save game(%s) request(%d) to slot(%s) "), *GetName(), CurrentSaveRequest, *GetSaveSlotName());
 }
 
@@ -48,6 +76,8 @@ void UGlobalSave::HandlePostSave(bool bSuccess)
 		ensure(CurrentSaveRequest > LastSuccessfulSaveRequest);
 		LastSuccessfulSaveRequest = CurrentSaveRequest;
 
+		PropertySnapshot = MoveTemp(SavingPropertySnapshot);
+
 		UE_LOG(LogGameCore_GlobalSave, Log, TEXT("Successfully saved game(%s) request(%d) to slot(%s)"), *GetName(), LastSuccessfulSaveRequest, *GetSaveSlotName());
 	}
 	else
@@ -55,8 +85,127 @@ void UGlobalSave::HandlePostSave(bool bSuccess)
 		ensure(CurrentSaveRequest > LastErrorSaveRequest);
 		LastErrorSaveRequest = CurrentSaveRequest;
 
+		DirtyProperties.Append(SavingDirtyProperties);
+		SavedDataVersion = SavingPreviousDataVersion;
+
 		UE_LOG(LogGameCore_GlobalSave, Error, TEXT("Failed to save game(%s) request(%d) to slot(%s)"), *GetName(), LastErrorSaveRequest, *GetSaveSlotName());
 	}
 
+	SavingDirtyProperties.Reset();
+	SavingPropertySnapshot.Reset();
+
 	OnPostSave(bSuccess);
 }
+
+void UGlobalSave::HandlePreCopySave(const FString& CopySlotName)
+{
+	OnPreSave();
+
+	UE_LOG(LogGameCore_GlobalSave, Log, TEXT("Starting to save a copy of game(%s) to slot(%s)"), *GetName(), *CopySlotName);
+}
+
+void UGlobalSave::HandlePostCopySave(const FString& CopySlotName, bool bSuccess)
+{
+	if (bSuccess)
+	{
+		UE_LOG(LogGameCore_GlobalSave, Log, TEXT("Successfully saved a copy of game(%s) to slot(%s)"), *GetName(), *CopySlotName);
+	}
+	else
+	{
+		UE_LOG(LogGameCore_GlobalSave, Error, TEXT("Failed to save a copy of game(%s) to slot(%s)"), *GetName(), *CopySlotName);
+	}
+
+	OnPostSave(bSuccess);
+}
+
+void UGlobalSave::HandlePostRestoreCheckpoint(FName CheckpointName)
+{
+	UE_LOG(LogGameCore_GlobalSave, Log, TEXT("Restored game(%s) to checkpoint(%s)"), *GetName(), *CheckpointName.ToString());
+
+	LoadedDataVersion = SavedDataVersion;
+	HandlePostLoad();
+}
+
+
+void UGlobalSave::MarkDirty(FName PropertyName)
+{
+	DirtyProperties.Add(PropertyName);
+
+	CheckedSnapshotFrame = MAX_uint64;
+}
+
+bool UGlobalSave::IsDirty() const
+{
+	const auto Mode{ GetDirtyTrackingMode() };
+
+	if (Mode == EGameSaveDirtyTracking::None)
+	{
+		return true;
+	}
+
+	// Saves that have never been written are always dirty
+
+	if (!WasLoaded() && (LastSuccessfulSaveRequest == 0))
+	{
+		return true;
+	}
+
+	// Saves loaded from an older data version are written again to upgrade the slot
+
+	if (GetSavedDataVersion() != GetLatestDataVersion())
+	{
+		return true;
+	}
+
+	if (!DirtyProperties.IsEmpty())
+	{
+		return true;
+	}
+
+	if (Mode == EGameSaveDirtyTracking::Snapshot)
+	{
+		FGameSaveSerializer::GetPropertyHashes(this, CheckedPropertySnapshot);
+		CheckedSnapshotFrame = GFrameCounter;
+
+		return !CheckedPropertySnapshot.OrderIndependentCompareEqual(PropertySnapshot);
+	}
+
+	return false;
+}
+
+TArray<FName> UGlobalSave::GetDirtyProperties() const
+{
+	auto Result{ DirtyProperties.Array() };
+
+	if (GetDirtyTrackingMode() == EGameSaveDirtyTracking::Snapshot)
+	{
+		TMap<FName, uint32> CurrentHashes;
+		FGameSaveSerializer::GetPropertyHashes(this, CurrentHashes);
+
+		for (const auto& KVP : CurrentHashes)
+		{
+			const auto* SnapshotHash{ PropertySnapshot.Find(KVP.Key) };
+
+			if (!SnapshotHash || (*SnapshotHash != KVP.Value))
+			{
+				Result.AddUnique(KVP.Key);
+			}
+		}
+	}
+
+	return Result;
+}
+
+void UGlobalSave::ClearDirty()
+{
+	DirtyProperties.Reset();
+
+	if (GetDirtyTrackingMode() == EGameSaveDirtyTracking::Snapshot)
+	{
+		FGameSaveSerializer::GetPropertyHashes(this, PropertySnapshot);
+	}
+	else
+	{
+		PropertySnapshot.Reset();
+	}
+}
@@ -4,6 +4,8 @@
 
 #include "GameFramework/SaveGame.h"
 
+#include "GameSaveTypes.h"
+
 #include "GlobalSave.generated.h"
 
 class UGameInstance;
@@ -127,6 +129,27 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Save Game|Info")
 	virtual int32 GetLatestDataVersion() const { return 0; }
 
+	/**
+	 * Returns true if saved data of the data version can be loaded into this class
+	 *
+	 * Tips:
+	 *	Checked against the header of a slot before it is read, so that unsupported saves are replaced without being deserialized.
+	 *	By default saves newer than GetLatestDataVersion are rejected, override this function to change the supported range.
+	 */
+	virtual bool CanLoadDataVersion(int32 InDataVersion) const { return (InDataVersion >= GetInvalidDataVersion()) && (InDataVersion <= GetLatestDataVersion()); }
+
+	/**
+	 * Returns true if this is saved with the unversioned property serialization
+	 *
+	 * Tips:
+	 *	Unversioned saves are smaller and faster to load, but can only be loaded while the property layout of the class is unchanged.
+	 *	Override this function in your derived class or Blueprint only for saves whose layout is stable between patches.
+	 *	Saves written before enabling this are still loaded as before.
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintNativeEvent, Category = "Save Game|Info")
+	bool UseUnversionedSerialization() const;
+	virtual bool UseUnversionedSerialization_Implementation() const { return false; }
+
 	/** 
 	 * Returns true if this was loaded from an existing save 
 	 */
@@ -152,6 +175,82 @@ public:
 	virtual bool WasLastSaveSuccessful() const { return (WasSaveRequested() && LastSuccessfulSaveRequest > LastErrorSaveRequest); }
 
 
+	/////////////////////////////////////////////////////////////////////////////////////
+	// Dirty Tracking
+protected:
+	//
+	// Names of the properties changed since the last successful save, NAME_None means the whole object
+	//
+	UPROPERTY(Transient)
+	TSet<FName> DirtyProperties;
+
+	//
+	// Dirty properties at the time the save in progress was requested, restored if it fails
+	//
+	UPROPERTY(Transient)
+	TSet<FName> SavingDirtyProperties;
+
+	//
+	// Data version before the save in progress was requested, restored if it fails
+	//
+	int32 SavingPreviousDataVersion{ 0 };
+
+	//
+	// Hash of each property at the last successful save or load, used by EGameSaveDirtyTracking::Snapshot
+	//
+	TMap<FName, uint32> PropertySnapshot;
+
+	//
+	// Hash of each property at the time the save in progress was requested
+	//
+	TMap<FName, uint32> SavingPropertySnapshot;
+
+	//
+	// Hash of each property computed by the last IsDirty, reused by HandlePreSave in the same frame unless MarkDirty is called in between
+	//
+	mutable TMap<FName, uint32> CheckedPropertySnapshot;
+
+	mutable uint64 CheckedSnapshotFrame{ MAX_uint64 };
+
+public:
+	/**
+	 * Returns how this detects changes since the last successful save
+	 *
+	 * Tips:
+	 *	By default every save request is written.
+	 *	Override this function in your derived class or Blueprint to skip save requests while nothing has changed.
+	 *	In Snapshot mode, properties changed in OnPreSave or an override of HandlePreSave must be marked with MarkDirty,
+	 *	since the property hashes computed by the dirty check of the save are reused for the snapshot.
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintNativeEvent, Category = "Save Game|Dirty")
+	EGameSaveDirtyTracking GetDirtyTrackingMode() const;
+	virtual EGameSaveDirtyTracking GetDirtyTrackingMode_Implementation() const { return EGameSaveDirtyTracking::None; }
+
+	/**
+	 * Marks the property as changed since the last successful save
+	 *
+	 * Tips:
+	 *	Use GET_MEMBER_NAME_CHECKED for the property name in C++, or NAME_None if the property is unknown
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Save Game|Dirty")
+	virtual void MarkDirty(FName PropertyName = NAME_None);
+
+	/**
+	 * Returns true if this has changed since the last successful save, has never been saved or was saved with an older data version
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Save Game|Dirty")
+	virtual bool IsDirty() const;
+
+	/**
+	 * Returns the names of the properties changed since the last successful save
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Save Game|Dirty")
+	virtual TArray<FName> GetDirtyProperties() const;
+
+protected:
+	void ClearDirty();
+
+
 	/////////////////////////////////////////////////////////////////////////////////////
 	// Initialization
 public:
@@ -168,6 +267,10 @@ public:
 
 	/** 
 	 * Called after loading, this is not called for newly created saves 
+	 *
+	 * Tips:
+	 *	Fixups that only depend on the saved data can be registered to FGameSaveMigrationRegistry instead,
+	 *	which runs them on a worker thread before the object is created.
 	 */
 	virtual void HandlePostLoad();
 
@@ -181,6 +284,27 @@ public:
 	 */
 	virtual void HandlePostSave(bool bSuccess);
 
+	/**
+	 * Called before a copy of this is saved to another slot, such as a slot of a ring
+	 *
+	 * Tips:
+	 *	Unlike HandlePreSave, the data version and the dirty state are left unchanged, because the slot of this save is not written
+	 */
+	virtual void HandlePreCopySave(const FString& CopySlotName);
+
+	/**
+	 * Called after saving a copy to another slot finishes with success/failure result
+	 */
+	virtual void HandlePostCopySave(const FString& CopySlotName, bool bSuccess);
+
+	/**
+	 * Called after the data has been restored to an in-memory checkpoint
+	 *
+	 * Tips:
+	 *	The restored data is handled like loaded data, so HandlePostLoad runs again to rebuild state derived from it
+	 */
+	virtual void HandlePostRestoreCheckpoint(FName CheckpointName);
+
 protected:
 	UFUNCTION(BlueprintImplementableEvent, Category = "Save Game")
 	void OnResetToDefault();
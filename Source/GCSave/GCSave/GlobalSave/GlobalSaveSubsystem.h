@@ -4,10 +4,20 @@
 
 #include "Subsystems/GameInstanceSubsystem.h"
 
+#include "Containers/Ticker.h"
+
+#include "Format/GameSaveBlob.h"
+#include "Format/GameSaveSnapshot.h"
+#include "Profiling/GameSaveMemoryProfiler.h"
+#include "GameSaveTypes.h"
+
 #include "GlobalSaveSubsystem.generated.h"
 
 class USaveGame;
 class UGlobalSave;
+class FGameSavePipeline;
+class FGameSaveCheckpoint;
+class FGameSaveSlotRing;
 
 
 /**
@@ -15,6 +25,59 @@ class UGlobalSave;
  */
 DECLARE_DELEGATE_TwoParams(FGlobalSaveEventDelegate, UGlobalSave*, bool);
 
+/**
+ * Delegate notifies that all saves of a batched load have been loaded
+ */
+DECLARE_DELEGATE_OneParam(FGlobalSaveBatchEventDelegate, const TArray<UGlobalSave*>&);
+
+/**
+ * Function called once the post-load of a save has finished
+ */
+using FGlobalSavePostLoadFunc = TFunction<void(UGlobalSave*)>;
+
+
+/**
+ * Global save to load or save in a batch
+ */
+USTRUCT(BlueprintType)
+struct FGlobalSaveBatchEntry
+{
+	GENERATED_BODY()
+public:
+	FGlobalSaveBatchEntry() {}
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Global Save")
+	TSubclassOf<UGlobalSave> GlobalSaveClass{ nullptr };
+
+	//
+	// Slot name used if the class does not have its own
+	//
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Global Save")
+	FString SlotName;
+
+};
+
+
+/**
+ * Save waiting for its post-load in the queue of UGlobalSaveSubsystem
+ */
+USTRUCT()
+struct FGlobalSavePostLoadEntry
+{
+	GENERATED_BODY()
+public:
+	FGlobalSavePostLoadEntry() {}
+
+	UPROPERTY()
+	TObjectPtr<UGlobalSave> SaveObject{ nullptr };
+
+	UPROPERTY()
+	FString SlotName;
+
+	FGlobalSavePostLoadFunc OnPostLoaded;
+
+};
+
 
 /**
  * Subsystems that manage GlobalSave
@@ -32,11 +95,24 @@ public:
 	// Initialization
 public:
 	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
 
 protected:
 	void LoadInitialGlobalSaves();
 
 
+	//////////////////////////////////////////////////////////////////
+	// Pipeline
+protected:
+	//
+	// Pipeline through which all reads and writes of this subsystem go
+	//
+	TSharedPtr<FGameSavePipeline> Pipeline;
+
+public:
+	FGameSavePipeline* GetPipeline() const { return Pipeline.Get(); }
+
+
 	//////////////////////////////////////////////////////////////////
 	// Load Get Create
 protected:
@@ -47,6 +123,11 @@ protected:
 	TMap<FString, TObjectPtr<UGlobalSave>> ActiveSaves;
 
 public:
+	/**
+	 * Returns all loaded saved game objects by slot name
+	 */
+	const TMap<FString, TObjectPtr<UGlobalSave>>& GetActiveSaves() const { return ActiveSaves; }
+
 	/**
 	 * Get loaded saved game object from slot name
 	 * 
@@ -107,6 +188,18 @@ public:
 		, bool bForceLoad = false
 		, FGlobalSaveEventDelegate Delegate = FGlobalSaveEventDelegate());
 
+	/**
+	 * Load multiple save games asynchronously, the slots are read and deserialized in parallel on worker threads
+	 *
+	 * Tips:
+	 *	The delegate is called once after every save has been initialized, with one save per entry of SavesToLoad in its order.
+	 *	Entries that resolve to the same slot share one load and receive the same save, loaded with the class of the first of them.
+	 */
+	bool AsyncLoadGlobalSaves(
+		const TArray<FGlobalSaveBatchEntry>& SavesToLoad
+		, bool bForceLoad = false
+		, FGlobalSaveBatchEventDelegate Delegate = FGlobalSaveBatchEventDelegate());
+
 	/**
 	 * Saves the specified loaded save game object
 	 *
@@ -121,18 +214,23 @@ public:
 	/**
 	 * Save loaded save game object specified asynchronously
 	 *
+	 * Tips:
+	 *	Saves of background priority, such as autosaves, are written within the bandwidth budget of FGameSaveThrottle
+	 *
 	 * Note:
 	 *	Cannot save if the specified save game has not yet been loaded
 	 */
-	UFUNCTION(BlueprintCallable, Category = "Global Save", meta = (DisplayName = "Async Save Global Save"))
+	UFUNCTION(BlueprintCallable, Category = "Global Save", meta = (DisplayName = "Async Save Global Save", AdvancedDisplay = "Priority"))
 	bool AsyncSaveGameToSlot(
 		TSubclassOf<UGlobalSave> GlobalSaveClass
-		, const FString& SlotName);
+		, const FString& SlotName
+		, EGameSaveIOPriority Priority = EGameSaveIOPriority::Critical);
 
 	bool AsyncSaveGameToSlot(
 		TSubclassOf<UGlobalSave> GlobalSaveClass
 		, const FString& SlotName
-		, FGlobalSaveEventDelegate Delegate);
+		, FGlobalSaveEventDelegate Delegate
+		, EGameSaveIOPriority Priority = EGameSaveIOPriority::Critical);
 
 	/**
 	 * Create new save games.
@@ -146,6 +244,28 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Global Save")
 	bool ReleaseSave(TSubclassOf<UGlobalSave> GlobalSaveClass, const FString& SlotName);
 
+	/**
+	 * Deletes the saved data in the slot, the loaded save game object is released
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Global Save")
+	bool DeleteSave(TSubclassOf<UGlobalSave> GlobalSaveClass, const FString& SlotName);
+
+	/**
+	 * Returns the names of all slots that have saved data
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Global Save")
+	TArray<FString> GetSavedSlotNames() const;
+
+	/**
+	 * Reads the slots in the background so that a later load of them only deserializes the data
+	 *
+	 * Tips:
+	 *	The data is kept until the slot is loaded, written or the cache exceeds PrefetchCacheSize in UGameSaveDeveloperSettings.
+	 *	Slots that are already loaded are skipped.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Global Save")
+	void PrefetchSlots(const TArray<FString>& SlotNames);
+
 
 protected:
 	void AsyncLoadGlobalSaveInternal(
@@ -158,17 +278,315 @@ protected:
 		UGlobalSave* SaveObject
 		, const FString& SlotName
 		, int32 Slot
-		, FGlobalSaveEventDelegate Delegate);
+		, FGlobalSaveEventDelegate Delegate
+		, EGameSaveIOPriority Priority);
 
 protected:
 	void HandleGlobalSaveLoaded(const FString& Slotname, UGlobalSave* SaveObject);
 
-	UGlobalSave* ProcessLoadedSave(USaveGame* BaseSave, const FString& SlotName, TSubclassOf<UGlobalSave> SaveGameClass);
+	/**
+	 * Validates the loaded object and initializes it, or creates a new save if it is invalid
+	 *
+	 * Tips:
+	 *	If OnPostLoaded is set, the initialization of a loaded save is queued and runs under the per-frame budget,
+	 *	and OnPostLoaded is called once it has finished. Otherwise it runs immediately.
+	 */
+	UGlobalSave* ProcessLoadedSave(USaveGame* BaseSave, const FString& SlotName, TSubclassOf<UGlobalSave> SaveGameClass, FGlobalSavePostLoadFunc OnPostLoaded = nullptr);
 	UGlobalSave* CreateNewSaveObject(TSubclassOf<UGlobalSave> GlobalSaveClass, const FString& Slotname);
 
+public:
+	/**
+	 * Returns the slot name of the class if it has one, otherwise SlotName
+	 */
 	FString ResolveSlotName(TSubclassOf<UGlobalSave> GlobalSaveClass, const FString& SlotName) const;
 
 
+	//////////////////////////////////////////////////////////////////
+	// Post Load Queue
+protected:
+	//
+	// Loaded saves waiting for their post-load, oldest first
+	//
+	UPROPERTY(Transient)
+	TArray<FGlobalSavePostLoadEntry> PostLoadQueue;
+
+	FTSTicker::FDelegateHandle PostLoadTickerHandle;
+
+protected:
+	/**
+	 * Queues the post-load of the save
+	 *
+	 * Tips:
+	 *	If a save of the slot is already queued, it is replaced by this save and keeps its place in the queue.
+	 *	The callbacks of both loads are called with this save.
+	 */
+	void QueuePostLoad(UGlobalSave* SaveObject, const FString& SlotName, FGlobalSavePostLoadFunc OnPostLoaded);
+
+	FGlobalSavePostLoadEntry* FindQueuedPostLoad(const FString& SlotName);
+
+	/**
+	 * Calls OnPostLoaded after the callbacks of the queued save of the slot once its post-load has finished
+	 *
+	 * Note:
+	 *	Return false if no save of the slot is queued
+	 */
+	bool ChainPostLoad(const FString& SlotName, FGlobalSavePostLoadFunc OnPostLoaded);
+
+	/**
+	 * Drops the queued save of the slot because a newer save has been loaded, its callbacks are called with the newer save
+	 */
+	void SupersedePostLoad(const FString& SlotName, UGlobalSave* SaveObject);
+
+	/**
+	 * Runs the post-load of the queued save of the slot immediately
+	 *
+	 * Note:
+	 *	Return nullptr if no save of the slot is queued
+	 */
+	UGlobalSave* FlushPostLoad(const FString& SlotName);
+
+	/**
+	 * Runs queued post-loads until PostLoadBudgetMs in UGameSaveDeveloperSettings is spent, at least one per frame
+	 */
+	bool TickPostLoadQueue(float DeltaTime);
+
+	void RunPostLoad(const FGlobalSavePostLoadEntry& Entry);
+
+public:
+	/**
+	 * Returns whether there are loaded saves waiting for their post-load
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Global Save|Pending Load")
+	bool HasQueuedPostLoad() const { return PostLoadQueue.Num() > 0; }
+
+
+	//////////////////////////////////////////////////////////////////
+	// Checkpoint
+protected:
+	//
+	// In-memory checkpoints of each slot, oldest first
+	//
+	TMap<FString, TArray<TSharedRef<const FGameSaveCheckpoint>>> Checkpoints;
+
+public:
+	/**
+	 * Captures the current data of the loaded save as an in-memory checkpoint
+	 *
+	 * Tips:
+	 *	Properties that have not changed since the latest checkpoint of the slot share its memory.
+	 *	Capturing with the name of an existing checkpoint of the slot replaces it.
+	 *	The oldest checkpoints of the slot are dropped once there are more than MaxCheckpointsPerSlot in UGameSaveDeveloperSettings.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Global Save|Checkpoint")
+	bool CaptureCheckpoint(TSubclassOf<UGlobalSave> GlobalSaveClass, const FString& SlotName, FName CheckpointName);
+
+	/**
+	 * Restores the loaded save to the checkpoint in place, nothing is read from disk
+	 *
+	 * Tips:
+	 *	If CheckpointName is None, the latest checkpoint of the slot is restored.
+	 *	Restored properties are marked dirty so that the next save writes them.
+	 *	HandlePostRestoreCheckpoint of the save is called once the data has been restored.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Global Save|Checkpoint", meta = (AdvancedDisplay = "CheckpointName"))
+	bool RestoreCheckpoint(TSubclassOf<UGlobalSave> GlobalSaveClass, const FString& SlotName, FName CheckpointName = NAME_None);
+
+	/**
+	 * Discards the checkpoint of the slot, or all checkpoints of the slot if CheckpointName is None
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Global Save|Checkpoint", meta = (AdvancedDisplay = "CheckpointName"))
+	void DiscardCheckpoint(TSubclassOf<UGlobalSave> GlobalSaveClass, const FString& SlotName, FName CheckpointName = NAME_None);
+
+	/**
+	 * Returns the names of the checkpoints of the slot, oldest first
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Global Save|Checkpoint")
+	TArray<FName> GetCheckpointNames(TSubclassOf<UGlobalSave> GlobalSaveClass, const FString& SlotName) const;
+
+	/**
+	 * Returns the memory used by the checkpoints of all slots, shared data is counted once
+	 */
+	int64 GetCheckpointMemorySize() const;
+
+
+	//////////////////////////////////////////////////////////////////
+	// Snapshot
+protected:
+	//
+	// Channels of the slots whose snapshots have been requested
+	//
+	TMap<FString, FGameSaveSnapshotChannelRef> SnapshotChannels;
+
+public:
+	/**
+	 * Returns the channel that holds the latest snapshot of the slot, it is created on first use
+	 *
+	 * Tips:
+	 *	Snapshots are only published for slots that have a channel, after each load and each successful save.
+	 *	If the save is already loaded, a snapshot of it is published when the channel is created.
+	 *	The channel can be kept and read from any thread, see FGameSaveSnapshotChannel.
+	 */
+	FGameSaveSnapshotChannelRef GetSnapshotChannel(TSubclassOf<UGlobalSave> GlobalSaveClass, const FString& SlotName);
+
+protected:
+	/**
+	 * Captures a snapshot of the save if the slot has a channel, otherwise returns nullptr
+	 */
+	TSharedPtr<FGameSaveSnapshot, ESPMode::ThreadSafe> CaptureSnapshot(const FString& SlotName, const UGlobalSave* SaveObject) const;
+
+	void PublishSnapshot(const FString& SlotName, const TSharedPtr<FGameSaveSnapshot, ESPMode::ThreadSafe>& Snapshot);
+
+
+	//////////////////////////////////////////////////////////////////
+	// Blob
+public:
+	/**
+	 * Loads the payload of the blob from its side slot if it is not loaded yet
+	 *
+	 * Tips:
+	 *	The payloads of FGameSaveBlob properties are not loaded with the global save, see FGameSaveBlob
+	 */
+	bool SyncLoadBlob(FGameSaveBlob& Blob);
+
+	/**
+	 * Loads the payload of the blob on a worker thread if it is not loaded yet
+	 *
+	 * Tips:
+	 *	The blob itself is not modified since it may be gone before the load completes, pass the payload to FGameSaveBlob::SetLoadedData to keep it
+	 */
+	void AsyncLoadBlob(const FGameSaveBlob& Blob, FGameSaveBlobLoadedDelegate Delegate);
+
+
+	//////////////////////////////////////////////////////////////////
+	// Trace
+public:
+	/**
+	 * Starts recording the reads, writes and deletes of this subsystem, a recording in progress is discarded
+	 *
+	 * Tips:
+	 *	The trace holds the time, slot, class, operation, size, priority and outcome of each operation but no save data.
+	 *	Replay it headless with "-run=GameSaveTraceReplay -Trace=<file>" to benchmark changes against the recorded traffic.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Global Save|Trace")
+	void StartTraceRecording();
+
+	/**
+	 * Stops recording and writes the trace to the file, relative paths are relative to the Saved/GameSaveTraces directory of the project
+	 *
+	 * Note:
+	 *	Return false if no trace is being recorded or the file could not be written.
+	 *	Operations that have not completed yet are not in the trace.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Global Save|Trace")
+	bool StopTraceRecording(const FString& Filename);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Global Save|Trace")
+	bool IsRecordingTrace() const;
+
+
+	//////////////////////////////////////////////////////////////////
+	// Slot Ring
+protected:
+	//
+	// Rings of rotating slots by ring name
+	//
+	TMap<FString, TSharedRef<FGameSaveSlotRing>> SlotRings;
+
+public:
+	/**
+	 * Sets the number of writes the ring keeps
+	 *
+	 * Tips:
+	 *	Rings that are not configured keep SlotRingSize in UGameSaveDeveloperSettings
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Global Save|Slot Ring")
+	void ConfigureSlotRing(const FString& RingName, int32 NumSlots);
+
+	/**
+	 * Writes the loaded save asynchronously to the next slot of the ring
+	 *
+	 * Tips:
+	 *	The write never waits for old slots to be deleted, writes beyond the size of the ring are pruned in the background.
+	 *	Unlike AsyncSaveGameToSlot, a new slot is written even if the save has not changed.
+	 *	Rings are usually written by autosaves, which can pass background priority to be written within the bandwidth budget of FGameSaveThrottle.
+	 *	The dirty state of the save is not changed, so a later AsyncSaveGameToSlot still writes its changes to its own slot.
+	 *	The first write to a ring is deferred until its index has been read on a worker thread.
+	 *
+	 * Note:
+	 *	Cannot save if the specified save game has not yet been loaded
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Global Save|Slot Ring", meta = (DisplayName = "Async Save Global Save To Slot Ring", AdvancedDisplay = "Priority"))
+	bool AsyncSaveToSlotRing(
+		TSubclassOf<UGlobalSave> GlobalSaveClass
+		, const FString& SlotName
+		, const FString& RingName
+		, EGameSaveIOPriority Priority = EGameSaveIOPriority::Critical);
+
+	bool AsyncSaveToSlotRing(
+		TSubclassOf<UGlobalSave> GlobalSaveClass
+		, const FString& SlotName
+		, const FString& RingName
+		, FGlobalSaveEventDelegate Delegate
+		, EGameSaveIOPriority Priority = EGameSaveIOPriority::Critical);
+
+	/**
+	 * Loads the latest successful write of the ring asynchronously
+	 *
+	 * Tips:
+	 *	The save is loaded into the slot of the write, which is returned by GetLatestSlotInRing.
+	 *	The latest write is resolved and checked on a worker thread, the delegate is called with nullptr if the ring has no valid slot.
+	 *
+	 * Note:
+	 *	Return false if the ring name is not valid
+	 */
+	bool AsyncLoadLatestFromSlotRing(
+		TSubclassOf<UGlobalSave> GlobalSaveClass
+		, const FString& RingName
+		, bool bForceLoad = false
+		, FGlobalSaveEventDelegate Delegate = FGlobalSaveEventDelegate());
+
+	/**
+	 * Returns the slot of the latest successful write of the ring whose data is complete
+	 *
+	 * Tips:
+	 *	Blocks until the index of the ring is read and reads the candidate slots, prefer AsyncLoadLatestFromSlotRing on the game thread
+	 *
+	 * Note:
+	 *	Return an empty string if the ring has no successful write
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Global Save|Slot Ring")
+	FString GetLatestSlotInRing(const FString& RingName);
+
+protected:
+	/**
+	 * Returns the ring, starting to read its index on a worker thread if it has not been used yet
+	 */
+	TSharedRef<FGameSaveSlotRing> FindOrCreateSlotRing(const FString& RingName);
+
+
+	//////////////////////////////////////////////////////////////////
+	// Memory
+protected:
+	//
+	// Latest memory report of this subsystem, counted in the GameSave stat group
+	//
+	FGameSaveMemoryReport MemoryReport;
+
+	FTSTicker::FDelegateHandle MemoryTickerHandle;
+
+public:
+	/**
+	 * Measures the memory used by the loaded saves, in-flight buffers, prefetch cache and checkpoints of this subsystem
+	 */
+	FGameSaveMemoryReport GetMemoryReport() const;
+
+protected:
+	/**
+	 * Updates the memory report every MemoryAccountingInterval in UGameSaveDeveloperSettings
+	 */
+	bool TickMemoryAccounting(float DeltaTime);
+
+
 	//////////////////////////////////////////////////////////////////
 	// Pending Load List
 protected:
@@ -182,6 +600,7 @@ protected:
 	void AddPendingLoad(const FString& Slotname, const TSubclassOf<UGlobalSave>& Class);
 	void RemovePendingLoad(const FString& Slotname);
 
+public:
 	/**
 	 * Returns whether or not the saved game with the specified slot name is currently loading.
 	 */
@@ -207,6 +626,7 @@ protected:
 	void AddPendingSave(const FString& Slotname);
 	void RemovePendingSave(const FString& Slotname);
 
+public:
 	/**
 	 * Returns whether or not the saved game with the specified slot name is currently saving.
 	 */
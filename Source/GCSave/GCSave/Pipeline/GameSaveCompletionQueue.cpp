@@ -0,0 +1,223 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "GameSaveCompletionQueue.h"
+
+#include "GameSaveDeveloperSettings.h"
+
+#include "HAL/PlatformTime.h"
+
+
+FGameSaveCompletionQueue::~FGameSaveCompletionQueue()
+{
+	if (TickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+		TickerHandle.Reset();
+	}
+}
+
+
+uint64 FGameSaveCompletionQueue::Reserve(const FString& SlotKey)
+{
+	check(IsInGameThread());
+
+	AddPending();
+
+	return SlotOrders.FindOrAdd(SlotKey).NextTicket++;
+}
+
+TArray<uint64> FGameSaveCompletionQueue::Reserve(const TArray<FString>& SlotKeys)
+{
+	check(IsInGameThread());
+
+	// The completion is dispatched once for all of the slot keys
+
+	AddPending();
+
+	TArray<uint64> Tickets;
+	Tickets.Reserve(SlotKeys.Num());
+
+	for (const auto& SlotKey : SlotKeys)
+	{
+		Tickets.Add(SlotOrders.FindOrAdd(SlotKey).NextTicket++);
+	}
+
+	return Tickets;
+}
+
+void FGameSaveCompletionQueue::Push(const FString& SlotKey, uint64 Ticket, TUniqueFunction<void()> Callback)
+{
+	Incoming.Enqueue(FCompletion{ SlotKey, Ticket, MoveTemp(Callback) });
+}
+
+void FGameSaveCompletionQueue::Push(const TArray<FString>& SlotKeys, const TArray<uint64>& Tickets, TUniqueFunction<void()> Callback)
+{
+	check(SlotKeys.Num() == Tickets.Num());
+
+	auto Group{ MakeShared<FGroupCompletion>() };
+	Group->SlotKeys = SlotKeys;
+	Group->Callback = MoveTemp(Callback);
+
+	for (int32 Index{ 0 }; Index < SlotKeys.Num(); ++Index)
+	{
+		Incoming.Enqueue(FCompletion{ SlotKeys[Index], Tickets[Index], nullptr, Group });
+	}
+}
+
+
+bool FGameSaveCompletionQueue::Tick(float DeltaTime)
+{
+	CollectIncoming();
+
+	const auto* DevSetting{ GetDefault<UGameSaveDeveloperSettings>() };
+	const auto MaxCount{ DevSetting->MaxCompletionsPerFrame };
+	const auto BudgetSeconds{ DevSetting->CompletionBudgetMs / 1000.0 };
+	const auto StartTime{ FPlatformTime::Seconds() };
+
+	// At least one completion is dispatched each frame so that the queue always progresses
+
+	int32 NumDispatched{ 0 };
+
+	while (Ready.Num() > 0)
+	{
+		auto Callback{ MoveTemp(Ready[0]) };
+		Ready.RemoveAt(0);
+
+		NumPending--;
+		NumDispatched++;
+
+		Callback();
+
+		if ((MaxCount > 0) && (NumDispatched >= MaxCount))
+		{
+			break;
+		}
+
+		if ((BudgetSeconds > 0.0) && (FPlatformTime::Seconds() - StartTime >= BudgetSeconds))
+		{
+			break;
+		}
+	}
+
+	if (NumPending > 0)
+	{
+		return true;
+	}
+
+	TickerHandle.Reset();
+	return false;
+}
+
+int32 FGameSaveCompletionQueue::DispatchAll()
+{
+	check(IsInGameThread());
+
+	int32 NumDispatched{ 0 };
+
+	// Completions pushed by the callbacks themselves are dispatched too
+
+	for (CollectIncoming(); Ready.Num() > 0; CollectIncoming())
+	{
+		auto Callback{ MoveTemp(Ready[0]) };
+		Ready.RemoveAt(0);
+
+		NumPending--;
+		NumDispatched++;
+
+		Callback();
+	}
+
+	return NumDispatched;
+}
+
+void FGameSaveCompletionQueue::CollectIncoming()
+{
+	FCompletion Completion;
+
+	while (Incoming.Dequeue(Completion))
+	{
+		auto* Order{ SlotOrders.Find(Completion.SlotKey) };
+
+		if (!ensureMsgf(Order, TEXT("Completion of slot key(%s) was not reserved"), *Completion.SlotKey))
+		{
+			continue;
+		}
+
+		if (Completion.Ticket != Order->NextReady)
+		{
+			Order->Held.Add(Completion.Ticket, MoveTemp(Completion));
+			continue;
+		}
+
+		ReleaseHead(MoveTemp(Completion));
+	}
+}
+
+void FGameSaveCompletionQueue::AddPending()
+{
+	NumPending++;
+
+	// The ticker runs while operations are pending and stops once all of them have been dispatched
+
+	if (!TickerHandle.IsValid())
+	{
+		TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda(
+			[WeakThis = AsWeak()](float DeltaTime)
+			{
+				const auto This{ WeakThis.Pin() };
+
+				return This.IsValid() ? This->Tick(DeltaTime) : false;
+			}
+		));
+	}
+}
+
+void FGameSaveCompletionQueue::ReleaseHead(FCompletion&& Completion)
+{
+	if (!Completion.Group.IsValid())
+	{
+		Ready.Add(MoveTemp(Completion.Callback));
+		Advance(Completion.SlotKey);
+		return;
+	}
+
+	// The slot key stays at this ticket, so later completions of it wait for the group
+
+	const auto Group{ MoveTemp(Completion.Group) };
+
+	if (++Group->NumAtHead < Group->SlotKeys.Num())
+	{
+		return;
+	}
+
+	Ready.Add(MoveTemp(Group->Callback));
+
+	for (const auto& SlotKey : Group->SlotKeys)
+	{
+		Advance(SlotKey);
+	}
+}
+
+void FGameSaveCompletionQueue::Advance(const FString& SlotKey)
+{
+	auto* Order{ SlotOrders.Find(SlotKey) };
+	Order->NextReady++;
+
+	// Completions of later tickets that arrived earlier follow in order
+
+	if (auto* HeldCompletion{ Order->Held.Find(Order->NextReady) })
+	{
+		auto Completion{ MoveTemp(*HeldCompletion) };
+		Order->Held.Remove(Order->NextReady);
+
+		ReleaseHead(MoveTemp(Completion));
+		return;
+	}
+
+	// The order of the slot key starts over once nothing of it is in flight
+
+	if (Order->NextReady == Order->NextTicket)
+	{
+		SlotOrders.Remove(SlotKey);
+	}
+}
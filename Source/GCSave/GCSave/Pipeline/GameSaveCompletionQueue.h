@@ -0,0 +1,153 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Containers/Queue.h"
+#include "Containers/Ticker.h"
+#include "Templates/Function.h"
+
+
+/**
+ * Collects the completions of async reads and writes from any thread and dispatches them on the game thread under a per-frame cap
+ *
+ * Tips:
+ *	Completions of the same slot key are dispatched in the order their operations were reserved, even if the IO finishes out of order.
+ *	A completion reserved for several slot keys is dispatched once, after the earlier completions of all of them.
+ *	The cap is set with MaxCompletionsPerFrame and CompletionBudgetMs in UGameSaveDeveloperSettings, at least one completion is dispatched per frame.
+ */
+class GCSAVE_API FGameSaveCompletionQueue : public TSharedFromThis<FGameSaveCompletionQueue>
+{
+public:
+	FGameSaveCompletionQueue() {}
+	~FGameSaveCompletionQueue();
+
+protected:
+	//
+	// Completion reserved for several slot keys, which holds each of them until it has reached the head of all of them
+	//
+	struct FGroupCompletion
+	{
+		TArray<FString> SlotKeys;
+
+		//
+		// Number of slot keys whose head is this completion
+		//
+		int32 NumAtHead{ 0 };
+
+		TUniqueFunction<void()> Callback;
+	};
+
+	struct FCompletion
+	{
+		FString SlotKey;
+
+		uint64 Ticket{ 0 };
+
+		TUniqueFunction<void()> Callback;
+
+		//
+		// Group the completion is a part of, the callback of the group is used instead
+		//
+		TSharedPtr<FGroupCompletion> Group;
+	};
+
+	//
+	// Dispatch order of the completions of one slot key
+	//
+	struct FSlotOrder
+	{
+		//
+		// Ticket given to the next reserved operation
+		//
+		uint64 NextTicket{ 0 };
+
+		//
+		// Ticket of the next completion that can be moved to the ready list
+		//
+		uint64 NextReady{ 0 };
+
+		//
+		// Completions that arrived before the completions of earlier tickets
+		//
+		TMap<uint64, FCompletion> Held;
+	};
+
+	//
+	// Completions pushed by any thread that have not been collected by the game thread yet
+	//
+	TQueue<FCompletion, EQueueMode::Mpsc> Incoming;
+
+	//
+	// Following members are only accessed on the game thread
+	//
+
+	TMap<FString, FSlotOrder> SlotOrders;
+
+	//
+	// Completions that can be dispatched, in dispatch order
+	//
+	TArray<TUniqueFunction<void()>> Ready;
+
+	//
+	// Number of reserved operations whose completion has not been dispatched yet
+	//
+	int32 NumPending{ 0 };
+
+	FTSTicker::FDelegateHandle TickerHandle;
+
+public:
+	/**
+	 * Reserves the place of an operation in the dispatch order of the slot key, must be called on the game thread when the operation is issued
+	 */
+	uint64 Reserve(const FString& SlotKey);
+
+	/**
+	 * Reserves the place of an operation in the dispatch order of each of the slot keys, which must be unique
+	 */
+	TArray<uint64> Reserve(const TArray<FString>& SlotKeys);
+
+	/**
+	 * Queues the completion of a reserved operation, can be called from any thread
+	 */
+	void Push(const FString& SlotKey, uint64 Ticket, TUniqueFunction<void()> Callback);
+
+	/**
+	 * Queues the completion of an operation reserved for several slot keys, can be called from any thread
+	 */
+	void Push(const TArray<FString>& SlotKeys, const TArray<uint64>& Tickets, TUniqueFunction<void()> Callback);
+
+	/**
+	 * Returns the number of reserved operations whose completion has not been dispatched yet
+	 */
+	int32 GetNumPending() const { return NumPending; }
+
+	/**
+	 * Dispatches every completion that has arrived, ignoring the per-frame cap, and returns how many were dispatched
+	 *
+	 * Tips:
+	 *	Used on shutdown after the IO has finished, so that the post-save of every finished write has run.
+	 *	Completions whose operations are still running are not waited for.
+	 */
+	int32 DispatchAll();
+
+protected:
+	bool Tick(float DeltaTime);
+
+	/**
+	 * Moves the pushed completions to the ready list, or holds them until the completions of earlier tickets arrive
+	 */
+	void CollectIncoming();
+
+	void AddPending();
+
+	/**
+	 * Makes the completion ready, or holds its slot key until its group has reached the head of all of its slot keys
+	 */
+	void ReleaseHead(FCompletion&& Completion);
+
+	/**
+	 * Moves the slot key to its next ticket and releases the completion of it if it has already arrived
+	 */
+	void Advance(const FString& SlotKey);
+
+};
@@ -0,0 +1,132 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "GameSaveIOQueue.h"
+
+#include "Pipeline/GameSaveThrottle.h"
+
+#include "Async/Async.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/ScopeLock.h"
+
+
+FGameSaveIOQueue::FGameSaveIOQueue(int32 InMaxConcurrentTasks)
+	: MaxConcurrentTasks(FMath::Max(InMaxConcurrentTasks, 1))
+{
+}
+
+
+void FGameSaveIOQueue::Enqueue(TUniqueFunction<void()> Task, EGameSaveIOPriority Priority)
+{
+	{
+		FScopeLock Lock(&QueueCS);
+
+		auto& Lane{ GetLane(Priority) };
+
+		if (!CanStart(Priority))
+		{
+			Lane.PendingTasks.Enqueue(MoveTemp(Task));
+			Lane.NumPendingTasks++;
+
+			return;
+		}
+
+		Lane.NumRunningTasks++;
+	}
+
+	Launch(MoveTemp(Task), Priority);
+}
+
+int32 FGameSaveIOQueue::GetNumTasks() const
+{
+	FScopeLock Lock(&QueueCS);
+
+	return CriticalLane.NumPendingTasks + CriticalLane.NumRunningTasks + BackgroundLane.NumPendingTasks + BackgroundLane.NumRunningTasks;
+}
+
+bool FGameSaveIOQueue::WaitUntilIdle(double TimeoutSeconds) const
+{
+	const auto EndTime{ FPlatformTime::Seconds() + TimeoutSeconds };
+
+	while (GetNumTasks() > 0)
+	{
+		if (FPlatformTime::Seconds() > EndTime)
+		{
+			return false;
+		}
+
+		FPlatformProcess::Sleep(0.001f);
+	}
+
+	return true;
+}
+
+
+bool FGameSaveIOQueue::CanStart(EGameSaveIOPriority Priority) const
+{
+	// Background tasks never take the workers critical tasks are waiting for
+
+	if (Priority == EGameSaveIOPriority::Critical)
+	{
+		return CriticalLane.NumRunningTasks < MaxConcurrentTasks;
+	}
+
+	return (CriticalLane.NumRunningTasks + BackgroundLane.NumRunningTasks) < MaxConcurrentTasks;
+}
+
+void FGameSaveIOQueue::Launch(TUniqueFunction<void()> Task, EGameSaveIOPriority Priority)
+{
+	TUniqueFunction<void()> RunTask
+	{
+		[This = AsShared(), Task = MoveTemp(Task), Priority]()
+		{
+			Task();
+
+			This->HandleTaskFinished(Priority);
+		}
+	};
+
+	// Throttled writes wait for their budget on the pacing thread instead of a worker
+
+	auto& Throttle{ FGameSaveThrottle::Get() };
+
+	if ((Priority == EGameSaveIOPriority::Background) && Throttle.IsEnabled())
+	{
+		Throttle.Launch(MoveTemp(RunTask));
+	}
+	else
+	{
+		AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, MoveTemp(RunTask));
+	}
+}
+
+void FGameSaveIOQueue::HandleTaskFinished(EGameSaveIOPriority Priority)
+{
+	TArray<TTuple<EGameSaveIOPriority, TUniqueFunction<void()>>> NextTasks;
+	{
+		FScopeLock Lock(&QueueCS);
+
+		GetLane(Priority).NumRunningTasks--;
+
+		// The free workers are handed to the oldest waiting tasks, critical ones first
+
+		for (const auto LanePriority : { EGameSaveIOPriority::Critical, EGameSaveIOPriority::Background })
+		{
+			auto& Lane{ GetLane(LanePriority) };
+			TUniqueFunction<void()> NextTask;
+
+			while (CanStart(LanePriority) && Lane.PendingTasks.Dequeue(NextTask))
+			{
+				Lane.NumPendingTasks--;
+				Lane.NumRunningTasks++;
+
+				NextTasks.Emplace(LanePriority, MoveTemp(NextTask));
+			}
+		}
+	}
+
+	for (auto& NextTask : NextTasks)
+	{
+		Launch(MoveTemp(NextTask.Get<1>()), NextTask.Get<0>());
+	}
+}
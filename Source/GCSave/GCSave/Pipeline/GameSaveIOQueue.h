@@ -0,0 +1,75 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Containers/Queue.h"
+#include "HAL/CriticalSection.h"
+#include "Templates/Function.h"
+
+#include "GameSaveTypes.h"
+
+
+/**
+ * Runs IO tasks on background threads with a limited number running at the same time
+ *
+ * Tips:
+ *	Tasks beyond the limit wait in first-in first-out order and start as running tasks finish.
+ *	Several pipelines can share one queue so that their IO together never uses more than the limit.
+ *	Critical and background tasks have a lane each, critical tasks are limited only by other critical tasks and background tasks only start while the queue has a free worker.
+ *	Background tasks run on the pacing thread of FGameSaveThrottle while it is enabled, so that their waits never hold a worker of the task graph.
+ */
+class GCSAVE_API FGameSaveIOQueue : public TSharedFromThis<FGameSaveIOQueue>
+{
+public:
+	explicit FGameSaveIOQueue(int32 InMaxConcurrentTasks);
+
+protected:
+	int32 MaxConcurrentTasks{ 1 };
+
+	mutable FCriticalSection QueueCS;
+
+	struct FLane
+	{
+		TQueue<TUniqueFunction<void()>> PendingTasks;
+
+		int32 NumPendingTasks{ 0 };
+
+		int32 NumRunningTasks{ 0 };
+	};
+
+	FLane CriticalLane;
+
+	FLane BackgroundLane;
+
+public:
+	/**
+	 * Runs the task on a background thread once a worker of its lane is free
+	 */
+	void Enqueue(TUniqueFunction<void()> Task, EGameSaveIOPriority Priority = EGameSaveIOPriority::Critical);
+
+	/**
+	 * Returns the number of tasks that are waiting or running
+	 */
+	int32 GetNumTasks() const;
+
+	/**
+	 * Blocks until every task has finished or the timeout in seconds has passed
+	 *
+	 * Note:
+	 *	Return false if tasks are still running after the timeout
+	 */
+	bool WaitUntilIdle(double TimeoutSeconds) const;
+
+protected:
+	FLane& GetLane(EGameSaveIOPriority Priority) { return (Priority == EGameSaveIOPriority::Critical) ? CriticalLane : BackgroundLane; }
+
+	/**
+	 * Returns true if a task of the priority may start now, the lock must be held
+	 */
+	bool CanStart(EGameSaveIOPriority Priority) const;
+
+	void Launch(TUniqueFunction<void()> Task, EGameSaveIOPriority Priority);
+
+	void HandleTaskFinished(EGameSaveIOPriority Priority);
+
+};
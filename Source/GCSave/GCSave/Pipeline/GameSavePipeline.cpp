@@ -0,0 +1,1268 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "GameSavePipeline.h"
+
+#include "Format/GameSaveEncryption.h"
+#include "Format/GameSaveHeader.h"
+#include "Format/GameSaveSerializer.h"
+#include "Pipeline/GameSaveCompletionQueue.h"
+#include "Pipeline/GameSaveIOQueue.h"
+#include "Pipeline/GameSaveThrottle.h"
+#include "Profiling/GameSaveSizeProfiler.h"
+#include "Storage/GameSaveStorage.h"
+#include "GameSaveDeveloperSettings.h"
+#include "GCSaveLogs.h"
+
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "GameFramework/SaveGame.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/ScopeLock.h"
+#include "Serialization/MemoryWriter.h"
+#include "UObject/GarbageCollection.h"
+
+#include <atomic>
+
+
+namespace GameSavePipeline
+{
+	//
+	// Prefix of the side slots that hold the payloads of blobs
+	//
+	static const TCHAR* BLOB_SLOT_PREFIX{ TEXT("GameSaveBlob_") };
+
+	//
+	// Bytes read from the start of a slot to read its whole header, enough for the engine versions and many blob hashes
+	//
+	static constexpr int64 HEADER_PROBE_SIZE{ 16 * 1024 };
+
+	//
+	// Identifier given to the next pipeline
+	//
+	static std::atomic<uint32> NextPipelineId{ 0 };
+
+
+	static FGameSaveTraceEvent BeginTraceEvent(const FGameSaveTraceRecorderPtr& Recorder, EGameSaveTraceOp Op, const FString& SlotName, int32 UserIndex, const USaveGame* SaveObject = nullptr, EGameSaveIOPriority Priority = EGameSaveIOPriority::Critical)
+	{
+		if (!Recorder.IsValid())
+		{
+			return FGameSaveTraceEvent();
+		}
+
+		auto Event{ Recorder->BeginEvent(Op, SlotName, UserIndex, Priority) };
+
+		if (SaveObject)
+		{
+			Event.ClassPath = SaveObject->GetClass()->GetPathName();
+		}
+
+		return Event;
+	}
+
+	static void EndTraceEvent(const FGameSaveTraceRecorderPtr& Recorder, FGameSaveTraceEvent& Event, EGameSaveTraceOutcome Outcome, int64 Size, const USaveGame* LoadedObject = nullptr)
+	{
+		if (!Recorder.IsValid())
+		{
+			return;
+		}
+
+		if (LoadedObject)
+		{
+			Event.ClassPath = LoadedObject->GetClass()->GetPathName();
+		}
+
+		Recorder->EndEvent(MoveTemp(Event), Outcome, Size);
+	}
+
+	static EGameSaveTraceOutcome ToTraceOutcome(bool bSuccess)
+	{
+		return bSuccess ? EGameSaveTraceOutcome::Succeeded : EGameSaveTraceOutcome::Failed;
+	}
+
+	static bool PassesHeaderFilter(const FGameSaveHeaderFilter& HeaderFilter, const FString& SlotName, const TArray<uint8>& Data)
+	{
+		// Data without a header of this plugin can only be checked by deserializing it
+
+		FGameSaveHeader Header;
+
+		if (!HeaderFilter || !FGameSaveSerializer::ReadHeaderSummary(Data, Header))
+		{
+			return true;
+		}
+
+		return HeaderFilter(SlotName, Header);
+	}
+}
+
+
+FGameSavePipeline::FGameSavePipeline(TSharedRef<IGameSaveStorage> InStorage)
+	: Storage(InStorage)
+	, CompletionQueue(MakeShared<FGameSaveCompletionQueue>())
+	, PipelineId(GameSavePipeline::NextPipelineId++)
+{
+}
+
+TSharedRef<FGameSavePipeline> FGameSavePipeline::Create()
+{
+	auto NewStorage{ IGameSaveStorage::Create(IGameSaveStorage::GetDefaultStorageType()) };
+
+	UE_LOG(LogGameCore_Save, Log, TEXT("Created save pipeline with storage(%s)"), *NewStorage->GetStorageName());
+
+	return MakeShared<FGameSavePipeline>(NewStorage);
+}
+
+
+void FGameSavePipeline::SetIOQueue(TSharedPtr<FGameSaveIOQueue> InIOQueue)
+{
+	IOQueue = InIOQueue;
+}
+
+void FGameSavePipeline::SetCompletionQueue(TSharedRef<FGameSaveCompletionQueue> InCompletionQueue)
+{
+	CompletionQueue = InCompletionQueue;
+}
+
+void FGameSavePipeline::LaunchIOTask(TUniqueFunction<void()> Task, EGameSaveIOPriority Priority) const
+{
+	if (IOQueue.IsValid())
+	{
+		IOQueue->Enqueue(MoveTemp(Task), Priority);
+	}
+	else if ((Priority == EGameSaveIOPriority::Background) && FGameSaveThrottle::Get().IsEnabled())
+	{
+		FGameSaveThrottle::Get().Launch(MoveTemp(Task));
+	}
+	else
+	{
+		AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, MoveTemp(Task));
+	}
+}
+
+bool FGameSavePipeline::WriteSlotWithPriority(const FString& SlotName, int32 UserIndex, const TArray<uint8>& InData, EGameSaveIOPriority Priority)
+{
+	auto& Throttle{ FGameSaveThrottle::Get() };
+
+	if ((Priority == EGameSaveIOPriority::Critical) || !Throttle.IsEnabled())
+	{
+		return Storage->WriteSlot(SlotName, UserIndex, InData);
+	}
+
+	return Storage->WriteSlotChunked(SlotName, UserIndex, InData, Throttle.GetChunkSize(),
+		[&Throttle](int64 ChunkBytes)
+		{
+			Throttle.WaitForChunk(ChunkBytes);
+		}
+	);
+}
+
+
+bool FGameSavePipeline::DoesSaveGameExist(const FString& SlotName, int32 UserIndex) const
+{
+	// Prefetched slots are known to exist without accessing the storage
+
+	return IsSlotPrefetched(SlotName, UserIndex) || Storage->DoesSlotExist(SlotName, UserIndex);
+}
+
+EGameSaveProbeResult FGameSavePipeline::ProbeSlot(const FString& SlotName, int32 UserIndex, FGameSaveHeader& OutHeader) const
+{
+	TArray<uint8> Data;
+
+	// Completed prefetches already hold the whole slot
+
+	{
+		FScopeLock Lock(&PrefetchCS);
+
+		if (const auto* Entry{ PrefetchedSlots.Find(MakeSlotKey(SlotName, UserIndex)) }; Entry && (*Entry)->bCounted)
+		{
+			return FGameSaveSerializer::ReadHeaderSummary((*Entry)->Data, OutHeader) ? EGameSaveProbeResult::Valid : EGameSaveProbeResult::Unknown;
+		}
+	}
+
+	if (!Storage->ReadSlotPrefix(SlotName, UserIndex, FGameSaveHeader::SUMMARY_PROBE_SIZE, Data))
+	{
+		return EGameSaveProbeResult::Missing;
+	}
+
+	if (FGameSaveSerializer::ReadHeaderSummary(Data, OutHeader))
+	{
+		return EGameSaveProbeResult::Valid;
+	}
+
+	// Class paths longer than the probe need more of the slot
+
+	if ((Data.Num() >= FGameSaveHeader::SUMMARY_PROBE_SIZE) && FGameSaveHeader::HasValidMagic(Data)
+		&& Storage->ReadSlot(SlotName, UserIndex, Data) && FGameSaveSerializer::ReadHeaderSummary(Data, OutHeader))
+	{
+		return EGameSaveProbeResult::Valid;
+	}
+
+	return EGameSaveProbeResult::Unknown;
+}
+
+bool FGameSavePipeline::VerifySlot(const FString& SlotName, int32 UserIndex) const
+{
+	TArray<uint8> Data;
+
+	if (!Storage->ReadSlot(SlotName, UserIndex, Data) || Data.IsEmpty())
+	{
+		return false;
+	}
+
+	FGameSaveHeader Header;
+	int64 PayloadOffset{ 0 };
+
+	if (!FGameSaveSerializer::ReadHeader(Data, Header, &PayloadOffset))
+	{
+		return !FGameSaveHeader::HasValidMagic(Data);
+	}
+
+	// A write interrupted by a crash or a power loss leaves a truncated payload
+
+	if ((Header.PayloadSize <= 0) || (PayloadOffset + Header.PayloadSize > Data.Num()))
+	{
+		return false;
+	}
+
+	// Encrypted data written before tags existed only has the hash of the decrypted payload
+
+	if (Header.IsEncrypted() && !Header.HasEncryptionTag())
+	{
+		return FGameSaveEncryption::DecryptData(Data);
+	}
+
+	return (Header.PayloadHash == 0) || (FGameSaveHeader::HashPayload(Data.GetData() + PayloadOffset, Header.PayloadSize) == Header.PayloadHash);
+}
+
+bool FGameSavePipeline::DeleteGameInSlot(const FString& SlotName, int32 UserIndex)
+{
+	auto TraceEvent{ GameSavePipeline::BeginTraceEvent(TraceRecorder, EGameSaveTraceOp::Delete, SlotName, UserIndex) };
+
+	ForgetWrittenHash(SlotName, UserIndex);
+	DiscardPrefetchedSlot(SlotName, UserIndex);
+
+	const auto bSuccess{ Storage->DeleteSlot(SlotName, UserIndex) };
+
+	GameSavePipeline::EndTraceEvent(TraceRecorder, TraceEvent, GameSavePipeline::ToTraceOutcome(bSuccess), 0);
+
+	if (!bSuccess)
+	{
+		return false;
+	}
+
+	// The deleted save may have been the last one referencing some blobs
+
+	LaunchBlobCollection(UserIndex);
+
+	return true;
+}
+
+bool FGameSavePipeline::GetSaveGameNames(int32 UserIndex, TArray<FString>& OutSlotNames) const
+{
+	if (!Storage->GetSlotNames(UserIndex, OutSlotNames))
+	{
+		return false;
+	}
+
+	OutSlotNames.RemoveAll([](const FString& SlotName) { return IsBlobSlotName(SlotName); });
+
+	return true;
+}
+
+bool FGameSavePipeline::SaveGameToSlot(USaveGame* SaveObject, int32 DataVersion, bool bUnversioned, const FString& SlotName, int32 UserIndex)
+{
+	TArray<uint8> Data;
+	uint64 PayloadHash{ 0 };
+	FGameSaveBlobSet Blobs;
+
+	auto TraceEvent{ GameSavePipeline::BeginTraceEvent(TraceRecorder, EGameSaveTraceOp::SyncSave, SlotName, UserIndex, SaveObject) };
+
+	DiscardPrefetchedSlot(SlotName, UserIndex);
+
+	if (!SerializeForWrite(SaveObject, DataVersion, bUnversioned, SlotName, Data, PayloadHash, Blobs))
+	{
+		GameSavePipeline::EndTraceEvent(TraceRecorder, TraceEvent, EGameSaveTraceOutcome::Failed, 0);
+		return false;
+	}
+
+	// Skip the write if the slot already holds the same data, which also references the same blobs
+
+	if (IsAlreadyWritten(SlotName, UserIndex, PayloadHash))
+	{
+		UE_LOG(LogGameCore_Save, Verbose, TEXT("Skipped writing unchanged data to slot(%s)"), *SlotName);
+
+		GameSavePipeline::EndTraceEvent(TraceRecorder, TraceEvent, EGameSaveTraceOutcome::Unchanged, Data.Num());
+		return true;
+	}
+
+	const int64 DataBytes{ Data.Num() };
+
+	bool bWroteBlobs{ false };
+
+	const auto bSuccess{ BeginBlobWrites(Blobs, UserIndex, EGameSaveIOPriority::Critical, bWroteBlobs) && EncryptForWrite(Data) && Storage->WriteSlot(SlotName, UserIndex, Data) };
+
+	EndBlobWrites(Blobs, UserIndex);
+
+	SetWrittenHash(SlotName, UserIndex, bSuccess ? PayloadHash : 0);
+	RecordTransfer(SlotName, UserIndex, bSuccess ? Data.Num() : 0);
+
+	GameSavePipeline::EndTraceEvent(TraceRecorder, TraceEvent, GameSavePipeline::ToTraceOutcome(bSuccess), DataBytes);
+
+	// A new blob usually replaces one that is no longer referenced
+
+	if (bSuccess && bWroteBlobs)
+	{
+		LaunchBlobCollection(UserIndex);
+	}
+
+	return bSuccess;
+}
+
+USaveGame* FGameSavePipeline::LoadGameFromSlot(const FString& SlotName, int32 UserIndex, const FGameSaveHeaderFilter& HeaderFilter)
+{
+	TArray<uint8> Data;
+	uint64 ReadHash{ 0 };
+
+	auto TraceEvent{ GameSavePipeline::BeginTraceEvent(TraceRecorder, EGameSaveTraceOp::SyncLoad, SlotName, UserIndex) };
+
+	// Prefetched data only needs to be deserialized
+
+	USaveGame* LoadedSave{ nullptr };
+
+	if (TakePrefetchedData(SlotName, UserIndex, Data, ReadHash) || ReadForLoad(SlotName, UserIndex, Data, ReadHash))
+	{
+		SetWrittenHash(SlotName, UserIndex, ReadHash);
+		RecordTransfer(SlotName, UserIndex, Data.Num());
+
+		if (GameSavePipeline::PassesHeaderFilter(HeaderFilter, SlotName, Data))
+		{
+			LoadedSave = FGameSaveSerializer::LoadFromMemory(Data);
+		}
+	}
+
+	GameSavePipeline::EndTraceEvent(TraceRecorder, TraceEvent, GameSavePipeline::ToTraceOutcome(LoadedSave != nullptr), Data.Num(), LoadedSave);
+
+	return LoadedSave;
+}
+
+void FGameSavePipeline::AsyncSaveGameToSlot(USaveGame* SaveObject, int32 DataVersion, bool bUnversioned, const FString& SlotName, int32 UserIndex, FAsyncSaveGameToSlotDelegate SavedDelegate, EGameSaveIOPriority Priority)
+{
+	TArray<uint8> Data;
+	uint64 PayloadHash{ 0 };
+	FGameSaveBlobSet Blobs;
+
+	DiscardPrefetchedSlot(SlotName, UserIndex);
+
+	// The event ends when the delegate is called, so it includes the time spent in the completion queue
+
+	const auto Recorder{ TraceRecorder };
+	auto TraceEvent{ GameSavePipeline::BeginTraceEvent(Recorder, EGameSaveTraceOp::AsyncSave, SlotName, UserIndex, SaveObject, Priority) };
+
+	// Operations that finish immediately also go through the queue so that they keep their order in the slot
+
+	const auto SlotKey{ MakeSlotKey(SlotName, UserIndex) };
+	const auto CompletionKey{ MakeCompletionKey(SlotName, UserIndex) };
+	const auto Ticket{ CompletionQueue->Reserve(CompletionKey) };
+
+	// Serialization happens on the game thread, only the encryption and write are done in the background
+
+	if (!SerializeForWrite(SaveObject, DataVersion, bUnversioned, SlotName, Data, PayloadHash, Blobs))
+	{
+		CompletionQueue->Push(CompletionKey, Ticket,
+			[SlotName, UserIndex, SavedDelegate, Recorder, TraceEvent = MoveTemp(TraceEvent)]() mutable
+			{
+				GameSavePipeline::EndTraceEvent(Recorder, TraceEvent, EGameSaveTraceOutcome::Failed, 0);
+
+				SavedDelegate.ExecuteIfBound(SlotName, UserIndex, false);
+			}
+		);
+		return;
+	}
+
+	// Skip the write if the slot already holds the same data
+
+	if (IsAlreadyWritten(SlotName, UserIndex, PayloadHash))
+	{
+		UE_LOG(LogGameCore_Save, Verbose, TEXT("Skipped writing unchanged data to slot(%s)"), *SlotName);
+
+		CompletionQueue->Push(CompletionKey, Ticket,
+			[SlotName, UserIndex, SavedDelegate, Recorder, TraceEvent = MoveTemp(TraceEvent), DataBytes = static_cast<int64>(Data.Num())]() mutable
+			{
+				GameSavePipeline::EndTraceEvent(Recorder, TraceEvent, EGameSaveTraceOutcome::Unchanged, DataBytes);
+
+				SavedDelegate.ExecuteIfBound(SlotName, UserIndex, true);
+			}
+		);
+		return;
+	}
+
+	// The slot content is unknown until the write completes
+
+	SetWrittenHash(SlotName, UserIndex, 0);
+
+	const int64 DataBytes{ Data.Num() };
+	AddInFlightBytes(DataBytes);
+	AddPendingWrite(SlotKey);
+
+	if (Priority == EGameSaveIOPriority::Background)
+	{
+		FGameSaveThrottle::Get().BeginBackgroundWrite();
+	}
+
+	LaunchIOTask(
+		[This = AsShared(), Completions = CompletionQueue, SlotName, UserIndex, SlotKey, CompletionKey, Ticket, PayloadHash, SavedDelegate, Priority, DataBytes, Recorder, TraceEvent = MoveTemp(TraceEvent), Data = MoveTemp(Data), Blobs = MoveTemp(Blobs)]() mutable
+		{
+			// Encryption and the writes of new blobs run on the worker thread together with the write
+
+			bool bWroteBlobs{ false };
+
+			const auto bSuccess{ This->BeginBlobWrites(Blobs, UserIndex, Priority, bWroteBlobs) && This->EncryptForWrite(Data) && This->WriteSlotWithPriority(SlotName, UserIndex, Data, Priority) };
+
+			This->EndBlobWrites(Blobs, UserIndex);
+
+			if (Priority == EGameSaveIOPriority::Background)
+			{
+				FGameSaveThrottle::Get().EndBackgroundWrite();
+			}
+
+			This->SetWrittenHash(SlotName, UserIndex, bSuccess ? PayloadHash : 0);
+			This->RecordTransfer(SlotName, UserIndex, bSuccess ? Data.Num() : 0);
+
+			if (bSuccess && bWroteBlobs)
+			{
+				This->DeleteUnreferencedBlobs(UserIndex);
+			}
+
+			Data.Empty();
+			This->AddInFlightBytes(-DataBytes);
+			This->RemovePendingWrite(SlotKey);
+
+			Completions->Push(CompletionKey, Ticket,
+				[SlotName, UserIndex, SavedDelegate, bSuccess, DataBytes, Recorder, TraceEvent = MoveTemp(TraceEvent)]() mutable
+				{
+					GameSavePipeline::EndTraceEvent(Recorder, TraceEvent, GameSavePipeline::ToTraceOutcome(bSuccess), DataBytes);
+
+					SavedDelegate.ExecuteIfBound(SlotName, UserIndex, bSuccess);
+				}
+			);
+		},
+		Priority
+	);
+}
+
+void FGameSavePipeline::AsyncLoadGameFromSlot(const FString& SlotName, int32 UserIndex, FAsyncLoadGameFromSlotDelegate LoadedDelegate, FGameSaveHeaderFilter HeaderFilter)
+{
+	const auto Recorder{ TraceRecorder };
+	auto TraceEvent{ GameSavePipeline::BeginTraceEvent(Recorder, EGameSaveTraceOp::AsyncLoad, SlotName, UserIndex) };
+
+	const auto CompletionKey{ MakeCompletionKey(SlotName, UserIndex) };
+	const auto Ticket{ CompletionQueue->Reserve(CompletionKey) };
+
+	LaunchIOTask(
+		[This = AsShared(), Completions = CompletionQueue, SlotName, UserIndex, CompletionKey, Ticket, LoadedDelegate, HeaderFilter = MoveTemp(HeaderFilter), Recorder, TraceEvent = MoveTemp(TraceEvent)]() mutable
+		{
+			TArray<uint8> Data;
+			uint64 ReadHash{ 0 };
+
+			// Version migration runs on the worker thread together with the read
+
+			const auto bSuccess{ This->TakePrefetchedData(SlotName, UserIndex, Data, ReadHash) || This->ReadForLoad(SlotName, UserIndex, Data, ReadHash) };
+
+			if (bSuccess)
+			{
+				This->SetWrittenHash(SlotName, UserIndex, ReadHash);
+				This->RecordTransfer(SlotName, UserIndex, Data.Num());
+			}
+
+			// The data is held until it is deserialized on the game thread
+
+			const int64 DataBytes{ Data.Num() };
+			This->AddInFlightBytes(DataBytes);
+
+			Completions->Push(CompletionKey, Ticket,
+				[This, SlotName, UserIndex, LoadedDelegate, bSuccess, DataBytes, HeaderFilter = MoveTemp(HeaderFilter), Recorder, TraceEvent = MoveTemp(TraceEvent), Data = MoveTemp(Data)]() mutable
+				{
+					// The header is checked from the data already read, the slot is not accessed again
+
+					const auto bAccepted{ bSuccess && GameSavePipeline::PassesHeaderFilter(HeaderFilter, SlotName, Data) };
+
+					auto* LoadedSave{ bAccepted ? FGameSaveSerializer::LoadFromMemory(Data) : nullptr };
+
+					Data.Empty();
+					This->AddInFlightBytes(-DataBytes);
+
+					GameSavePipeline::EndTraceEvent(Recorder, TraceEvent, GameSavePipeline::ToTraceOutcome(LoadedSave != nullptr), DataBytes, LoadedSave);
+
+					LoadedDelegate.ExecuteIfBound(SlotName, UserIndex, LoadedSave);
+				}
+			);
+		}
+	);
+}
+
+
+void FGameSavePipeline::AsyncLoadGamesFromSlots(const TArray<FString>& SlotNames, int32 UserIndex, FAsyncLoadGamesFromSlotsDelegate LoadedDelegate, FGameSaveHeaderFilter HeaderFilter)
+{
+	// The batch takes a place in the order of each of its slots, and is dispatched after the earlier operations of all of them
+
+	TArray<FString> CompletionKeys;
+
+	for (const auto& SlotName : SlotNames)
+	{
+		CompletionKeys.AddUnique(MakeCompletionKey(SlotName, UserIndex));
+	}
+
+	if (CompletionKeys.IsEmpty())
+	{
+		CompletionKeys.Add(MakeCompletionKey(FString(), UserIndex));
+	}
+
+	const auto Tickets{ CompletionQueue->Reserve(CompletionKeys) };
+
+	// Each slot of the batch is traced as an async load issued with the batch
+
+	const auto Recorder{ TraceRecorder };
+	TArray<FGameSaveTraceEvent> TraceEvents;
+
+	if (Recorder.IsValid())
+	{
+		for (const auto& SlotName : SlotNames)
+		{
+			TraceEvents.Add(GameSavePipeline::BeginTraceEvent(Recorder, EGameSaveTraceOp::AsyncLoad, SlotName, UserIndex));
+		}
+	}
+
+	LaunchIOTask(
+		[This = AsShared(), Completions = CompletionQueue, SlotNames, UserIndex, CompletionKeys, Tickets, LoadedDelegate, HeaderFilter = MoveTemp(HeaderFilter), Recorder, TraceEvents = MoveTemp(TraceEvents)]() mutable
+		{
+			TArray<FGameSaveLoadedSlot> Results;
+			Results.SetNum(SlotNames.Num());
+
+			TArray<int64> DataSizes;
+			DataSizes.SetNumZeroed(SlotNames.Num());
+
+			// Data that could not be deserialized on a worker thread is kept for the game thread
+
+			TArray<TArray<uint8>> PendingData;
+			PendingData.SetNum(SlotNames.Num());
+
+			ParallelFor(SlotNames.Num(),
+				[&This, &SlotNames, &Results, &PendingData, &DataSizes, &HeaderFilter, UserIndex](int32 Index)
+				{
+					const auto& SlotName{ SlotNames[Index] };
+					auto& Data{ PendingData[Index] };
+					uint64 ReadHash{ 0 };
+
+					Results[Index].SlotName = SlotName;
+
+					const auto bSuccess
+					{
+						This->TakePrefetchedData(SlotName, UserIndex, Data, ReadHash) ||
+						(This->Storage->DoesSlotExist(SlotName, UserIndex) && This->ReadForLoad(SlotName, UserIndex, Data, ReadHash))
+					};
+
+					if (!bSuccess)
+					{
+						Data.Empty();
+						return;
+					}
+
+					This->SetWrittenHash(SlotName, UserIndex, ReadHash);
+					This->RecordTransfer(SlotName, UserIndex, Data.Num());
+
+					DataSizes[Index] = Data.Num();
+
+					// Garbage collection is only blocked while objects are created, not during the IO, decryption and migration
+
+					FGCScopeGuard GCGuard;
+
+					// The header of data that can be deserialized here is checked here, the rest on the game thread
+
+					if (FGameSaveSerializer::CanLoadOnAnyThread(Data))
+					{
+						if (!GameSavePipeline::PassesHeaderFilter(HeaderFilter, SlotName, Data))
+						{
+							Data.Empty();
+							return;
+						}
+
+						// Data that references objects which are not loaded yet is also kept for the game thread
+
+						auto bNeedsGameThread{ false };
+						Results[Index].SaveObject = FGameSaveSerializer::LoadFromMemory_AnyThread(Data, &bNeedsGameThread);
+
+						if (!bNeedsGameThread)
+						{
+							Data.Empty();
+						}
+					}
+				}
+			);
+
+			// Data left for the game thread is held until it is deserialized there
+
+			int64 PendingBytes{ 0 };
+
+			for (const auto& Data : PendingData)
+			{
+				PendingBytes += Data.Num();
+			}
+
+			This->AddInFlightBytes(PendingBytes);
+
+			Completions->Push(CompletionKeys, Tickets,
+				[This, UserIndex, LoadedDelegate, PendingBytes, HeaderFilter = MoveTemp(HeaderFilter), Recorder, TraceEvents = MoveTemp(TraceEvents), DataSizes = MoveTemp(DataSizes), Results = MoveTemp(Results), PendingData = MoveTemp(PendingData)]() mutable
+				{
+					for (int32 Index{ 0 }; Index < Results.Num(); ++Index)
+					{
+						if (Results[Index].SaveObject)
+						{
+							FGameSaveSerializer::FinishAsyncLoad(Results[Index].SaveObject);
+						}
+						else if ((PendingData[Index].Num() > 0) && GameSavePipeline::PassesHeaderFilter(HeaderFilter, Results[Index].SlotName, PendingData[Index]))
+						{
+							Results[Index].SaveObject = FGameSaveSerializer::LoadFromMemory(PendingData[Index]);
+						}
+					}
+
+					PendingData.Empty();
+					This->AddInFlightBytes(-PendingBytes);
+
+					for (int32 Index{ 0 }; Index < TraceEvents.Num(); ++Index)
+					{
+						const auto* LoadedSave{ Results[Index].SaveObject };
+
+						GameSavePipeline::EndTraceEvent(Recorder, TraceEvents[Index], GameSavePipeline::ToTraceOutcome(LoadedSave != nullptr), DataSizes[Index], LoadedSave);
+					}
+
+					LoadedDelegate.ExecuteIfBound(UserIndex, Results);
+				}
+			);
+		}
+	);
+}
+
+
+bool FGameSavePipeline::HasPendingWrites(const FString& SlotName, int32 UserIndex) const
+{
+	FScopeLock Lock(&PendingWritesCS);
+
+	return PendingWrites.Contains(MakeSlotKey(SlotName, UserIndex));
+}
+
+bool FGameSavePipeline::WaitForPendingWrites(const FString& SlotName, int32 UserIndex, double TimeoutSeconds) const
+{
+	const auto EndTime{ FPlatformTime::Seconds() + TimeoutSeconds };
+
+	// Each finished write wakes the waiter, which goes back to sleep if writes of its slot are still pending
+
+	while (HasPendingWrites(SlotName, UserIndex))
+	{
+		const auto RemainingSeconds{ EndTime - FPlatformTime::Seconds() };
+
+		if (RemainingSeconds <= 0.0)
+		{
+			return false;
+		}
+
+		WriteFinishedEvent->Wait(FTimespan::FromSeconds(RemainingSeconds));
+	}
+
+	return true;
+}
+
+void FGameSavePipeline::AddPendingWrite(const FString& SlotKey)
+{
+	FScopeLock Lock(&PendingWritesCS);
+
+	PendingWrites.FindOrAdd(SlotKey)++;
+}
+
+void FGameSavePipeline::RemovePendingWrite(const FString& SlotKey)
+{
+	{
+		FScopeLock Lock(&PendingWritesCS);
+
+		auto* Count{ PendingWrites.Find(SlotKey) };
+
+		if (Count && (--(*Count) <= 0))
+		{
+			PendingWrites.Remove(SlotKey);
+		}
+	}
+
+	WriteFinishedEvent->Trigger();
+}
+
+
+void FGameSavePipeline::ForgetWrittenHash(const FString& SlotName, int32 UserIndex)
+{
+	SetWrittenHash(SlotName, UserIndex, 0);
+}
+
+void FGameSavePipeline::SetWrittenHash(const FString& SlotName, int32 UserIndex, uint64 PayloadHash)
+{
+	FScopeLock Lock(&WrittenHashesCS);
+
+	if (PayloadHash != 0)
+	{
+		WrittenHashes.Add(MakeSlotKey(SlotName, UserIndex), PayloadHash);
+	}
+	else
+	{
+		WrittenHashes.Remove(MakeSlotKey(SlotName, UserIndex));
+	}
+}
+
+bool FGameSavePipeline::IsAlreadyWritten(const FString& SlotName, int32 UserIndex, uint64 PayloadHash) const
+{
+	{
+		FScopeLock Lock(&WrittenHashesCS);
+
+		if ((PayloadHash == 0) || (WrittenHashes.FindRef(MakeSlotKey(SlotName, UserIndex)) != PayloadHash))
+		{
+			return false;
+		}
+	}
+
+	return Storage->DoesSlotExist(SlotName, UserIndex);
+}
+
+bool FGameSavePipeline::SerializeForWrite(USaveGame* SaveObject, int32 DataVersion, bool bUnversioned, const FString& SlotName, TArray<uint8>& OutData, uint64& OutPayloadHash, FGameSaveBlobSet& OutBlobs) const
+{
+	{
+		FGameSaveBlobCollector BlobCollector;
+
+		if (!FGameSaveSerializer::SaveToMemory(SaveObject, DataVersion, bUnversioned, OutData))
+		{
+			return false;
+		}
+
+		OutBlobs = MoveTemp(BlobCollector.Blobs);
+	}
+
+	if (!FGameSaveSizeProfiler::CheckSizeBudget(SaveObject->GetClass(), OutData.Num(), SlotName))
+	{
+		return false;
+	}
+
+	FGameSaveHeader Header;
+	OutPayloadHash = FGameSaveSerializer::ReadHeader(OutData, Header) ? Header.PayloadHash : 0;
+
+	return true;
+}
+
+bool FGameSavePipeline::EncryptForWrite(TArray<uint8>& InOutData) const
+{
+	return !FGameSaveEncryption::ShouldEncrypt() || FGameSaveEncryption::EncryptData(InOutData);
+}
+
+bool FGameSavePipeline::ReadForLoad(const FString& SlotName, int32 UserIndex, TArray<uint8>& OutData, uint64& OutReadHash) const
+{
+	if (!Storage->ReadSlot(SlotName, UserIndex, OutData) || !FGameSaveEncryption::DecryptData(OutData))
+	{
+		return false;
+	}
+
+	// Remember what is in the slot before migration changes the data
+
+	FGameSaveHeader Header;
+	OutReadHash = FGameSaveSerializer::ReadHeader(OutData, Header) ? Header.PayloadHash : 0;
+
+	return FGameSaveSerializer::MigrateData(OutData);
+}
+
+FString FGameSavePipeline::MakeSlotKey(const FString& SlotName, int32 UserIndex)
+{
+	return FString::Printf(TEXT("%d/%s"), UserIndex, *SlotName);
+}
+
+FString FGameSavePipeline::MakeCompletionKey(const FString& SlotName, int32 UserIndex) const
+{
+	return FString::Printf(TEXT("%u:%d/%s"), PipelineId, UserIndex, *SlotName);
+}
+
+
+TMap<FString, int32> FGameSavePipeline::ProtectedBlobs;
+uint64 FGameSavePipeline::BlobWriteSerial{ 0 };
+FCriticalSection FGameSavePipeline::BlobsCS;
+
+FString FGameSavePipeline::MakeBlobSlotName(const FIoHash& Hash)
+{
+	return FString::Printf(TEXT("%s%s"), GameSavePipeline::BLOB_SLOT_PREFIX, *LexToString(Hash));
+}
+
+bool FGameSavePipeline::IsBlobSlotName(const FString& SlotName)
+{
+	return SlotName.StartsWith(GameSavePipeline::BLOB_SLOT_PREFIX, ESearchCase::CaseSensitive);
+}
+
+bool FGameSavePipeline::LoadBlob(const FIoHash& Hash, int32 UserIndex, FGameSaveBlobDataPtr& OutData)
+{
+	const auto BlobSlotName{ MakeBlobSlotName(Hash) };
+
+	TArray<uint8> Data;
+
+	if (!Storage->ReadSlot(BlobSlotName, UserIndex, Data))
+	{
+		UE_LOG(LogGameCore_Save, Error, TEXT("Failed to read blob slot(%s)"), *BlobSlotName);
+		return false;
+	}
+
+	RecordTransfer(BlobSlotName, UserIndex, Data.Num());
+
+	if (!DecodeBlob(Hash, Data))
+	{
+		UE_LOG(LogGameCore_Save, Error, TEXT("Content of blob slot(%s) does not match its hash"), *BlobSlotName);
+		return false;
+	}
+
+	OutData = MakeShared<const TArray<uint8>, ESPMode::ThreadSafe>(MoveTemp(Data));
+	return true;
+}
+
+void FGameSavePipeline::AsyncLoadBlob(const FIoHash& Hash, int32 UserIndex, FGameSaveBlobLoadedDelegate LoadedDelegate)
+{
+	const auto CompletionKey{ MakeCompletionKey(MakeBlobSlotName(Hash), UserIndex) };
+	const auto Ticket{ CompletionQueue->Reserve(CompletionKey) };
+
+	LaunchIOTask(
+		[This = AsShared(), Completions = CompletionQueue, Hash, UserIndex, CompletionKey, Ticket, LoadedDelegate]()
+		{
+			FGameSaveBlobDataPtr Data;
+
+			const auto bSuccess{ This->LoadBlob(Hash, UserIndex, Data) };
+
+			Completions->Push(CompletionKey, Ticket,
+				[LoadedDelegate, bSuccess, Data]()
+				{
+					LoadedDelegate.ExecuteIfBound(bSuccess, Data);
+				}
+			);
+		}
+	);
+}
+
+void FGameSavePipeline::DeleteUnreferencedBlobs(int32 UserIndex)
+{
+	TArray<FString> SlotNames;
+
+	if (!Storage->GetSlotNames(UserIndex, SlotNames))
+	{
+		return;
+	}
+
+	TArray<FString> BlobSlotNames;
+
+	for (const auto& SlotName : SlotNames)
+	{
+		if (IsBlobSlotName(SlotName))
+		{
+			BlobSlotNames.Add(SlotName);
+		}
+	}
+
+	if (BlobSlotNames.IsEmpty())
+	{
+		return;
+	}
+
+	uint64 StartSerial{ 0 };
+
+	{
+		FScopeLock Lock(&BlobsCS);
+		StartSerial = BlobWriteSerial;
+	}
+
+	// Collect the references from the headers of all saves of the user
+
+	TSet<FString> ReferencedSlotNames;
+
+	for (const auto& SlotName : SlotNames)
+	{
+		if (IsBlobSlotName(SlotName))
+		{
+			continue;
+		}
+
+		FGameSaveHeader Header;
+		const auto Result{ ReadSlotHeader(SlotName, UserIndex, Header) };
+
+		if (Result == EGameSaveProbeResult::Missing)
+		{
+			// A save that cannot be read may still reference any of the blobs
+
+			return;
+		}
+
+		if (Result == EGameSaveProbeResult::Valid)
+		{
+			for (const auto& Hash : Header.BlobHashes)
+			{
+				ReferencedSlotNames.Add(MakeBlobSlotName(Hash));
+			}
+		}
+	}
+
+	// Writes that finished during the scan may reference blobs whose saves were already read
+
+	FScopeLock Lock(&BlobsCS);
+
+	if (BlobWriteSerial != StartSerial)
+	{
+		return;
+	}
+
+	for (const auto& BlobSlotName : BlobSlotNames)
+	{
+		if (ReferencedSlotNames.Contains(BlobSlotName) || ProtectedBlobs.Contains(MakeSlotKey(BlobSlotName, UserIndex)))
+		{
+			continue;
+		}
+
+		if (Storage->DeleteSlot(BlobSlotName, UserIndex))
+		{
+			UE_LOG(LogGameCore_Save, Verbose, TEXT("Deleted unreferenced blob slot(%s)"), *BlobSlotName);
+		}
+	}
+}
+
+EGameSaveProbeResult FGameSavePipeline::ReadSlotHeader(const FString& SlotName, int32 UserIndex, FGameSaveHeader& OutHeader) const
+{
+	TArray<uint8> Data;
+
+	if (!Storage->ReadSlotPrefix(SlotName, UserIndex, GameSavePipeline::HEADER_PROBE_SIZE, Data))
+	{
+		return EGameSaveProbeResult::Missing;
+	}
+
+	if (FGameSaveSerializer::ReadHeader(Data, OutHeader))
+	{
+		return EGameSaveProbeResult::Valid;
+	}
+
+	// Headers that reference many blobs are longer than the probe
+
+	if ((Data.Num() >= GameSavePipeline::HEADER_PROBE_SIZE) && FGameSaveHeader::HasValidMagic(Data))
+	{
+		if (!Storage->ReadSlot(SlotName, UserIndex, Data))
+		{
+			return EGameSaveProbeResult::Missing;
+		}
+
+		if (FGameSaveSerializer::ReadHeader(Data, OutHeader))
+		{
+			return EGameSaveProbeResult::Valid;
+		}
+	}
+
+	return EGameSaveProbeResult::Unknown;
+}
+
+bool FGameSavePipeline::EncodeBlob(const TArray<uint8>& Payload, TArray<uint8>& OutData) const
+{
+	FGameSaveHeader Header;
+	Header.Initialize(nullptr, 0, EGameSaveFormatFlags::Blob);
+	Header.PayloadSize = Payload.Num();
+	Header.PayloadHash = FGameSaveHeader::HashPayload(Payload.GetData(), Payload.Num());
+
+	OutData.Reset();
+
+	FMemoryWriter Writer(OutData, true);
+	Header.Serialize(Writer);
+	Writer.Serialize(const_cast<uint8*>(Payload.GetData()), Payload.Num());
+
+	return !Writer.IsError() && EncryptForWrite(OutData);
+}
+
+bool FGameSavePipeline::DecodeBlob(const FIoHash& Hash, TArray<uint8>& InOutData)
+{
+	FGameSaveHeader Header;
+	int64 PayloadOffset{ 0 };
+
+	// Blobs written before they had a header hold the bare payload
+
+	if (FGameSaveSerializer::ReadHeader(InOutData, Header, &PayloadOffset) && EnumHasAnyFlags(Header.Flags, EGameSaveFormatFlags::Blob))
+	{
+		if (!FGameSaveEncryption::DecryptData(InOutData))
+		{
+			return false;
+		}
+
+		InOutData.RemoveAt(0, static_cast<int32>(PayloadOffset));
+	}
+
+	return FIoHash::HashBuffer(InOutData.GetData(), InOutData.Num()) == Hash;
+}
+
+bool FGameSavePipeline::BeginBlobWrites(const FGameSaveBlobSet& Blobs, int32 UserIndex, EGameSaveIOPriority Priority, bool& bOutWroteBlobs)
+{
+	bOutWroteBlobs = false;
+
+	if (Blobs.Hashes.IsEmpty())
+	{
+		return true;
+	}
+
+	{
+		FScopeLock Lock(&BlobsCS);
+
+		for (const auto& Hash : Blobs.Hashes)
+		{
+			ProtectedBlobs.FindOrAdd(MakeSlotKey(MakeBlobSlotName(Hash), UserIndex))++;
+		}
+	}
+
+	// Side slots are addressed by their content, so one that exists never needs to be written again
+
+	for (const auto& Hash : Blobs.Hashes)
+	{
+		const auto BlobSlotName{ MakeBlobSlotName(Hash) };
+
+		if (Storage->DoesSlotExist(BlobSlotName, UserIndex))
+		{
+			continue;
+		}
+
+		// The payload of an unloaded blob only lives in its side slot, so the save would reference data that is gone
+
+		const auto Payload{ Blobs.Payloads.FindRef(Hash) };
+
+		if (!Payload.IsValid())
+		{
+			UE_LOG(LogGameCore_Save, Error, TEXT("Blob slot(%s) is referenced but neither stored nor loaded, the save is not written"), *BlobSlotName);
+			return false;
+		}
+
+		TArray<uint8> Data;
+
+		if (!EncodeBlob(*Payload, Data) || !WriteSlotWithPriority(BlobSlotName, UserIndex, Data, Priority))
+		{
+			UE_LOG(LogGameCore_Save, Error, TEXT("Failed to write blob slot(%s)"), *BlobSlotName);
+			return false;
+		}
+
+		RecordTransfer(BlobSlotName, UserIndex, Data.Num());
+
+		bOutWroteBlobs = true;
+	}
+
+	return true;
+}
+
+void FGameSavePipeline::EndBlobWrites(const FGameSaveBlobSet& Blobs, int32 UserIndex)
+{
+	if (Blobs.Hashes.IsEmpty())
+	{
+		return;
+	}
+
+	FScopeLock Lock(&BlobsCS);
+
+	for (const auto& Hash : Blobs.Hashes)
+	{
+		const auto BlobSlotKey{ MakeSlotKey(MakeBlobSlotName(Hash), UserIndex) };
+		auto& Count{ ProtectedBlobs.FindChecked(BlobSlotKey) };
+
+		if (--Count <= 0)
+		{
+			ProtectedBlobs.Remove(BlobSlotKey);
+		}
+	}
+
+	BlobWriteSerial++;
+}
+
+void FGameSavePipeline::LaunchBlobCollection(int32 UserIndex)
+{
+	// Collection is never urgent, so it does not take the workers of critical IO
+
+	LaunchIOTask(
+		[This = AsShared(), UserIndex]()
+		{
+			This->DeleteUnreferencedBlobs(UserIndex);
+		},
+		EGameSaveIOPriority::Background
+	);
+}
+
+
+uint32 FGameSavePipeline::GetTransferSerial(const FString& SlotName, int32 UserIndex, int64* OutBytes) const
+{
+	FScopeLock Lock(&TransfersCS);
+
+	const auto* Record{ Transfers.Find(MakeSlotKey(SlotName, UserIndex)) };
+
+	if (OutBytes)
+	{
+		*OutBytes = Record ? Record->Bytes : 0;
+	}
+
+	return Record ? Record->Serial : 0;
+}
+
+void FGameSavePipeline::RecordTransfer(const FString& SlotName, int32 UserIndex, int64 Bytes)
+{
+	FScopeLock Lock(&TransfersCS);
+
+	auto& Record{ Transfers.FindOrAdd(MakeSlotKey(SlotName, UserIndex)) };
+	Record.Bytes = Bytes;
+	Record.Serial++;
+}
+
+
+int64 FGameSavePipeline::GetCachedBytes() const
+{
+	FScopeLock Lock(&PrefetchCS);
+
+	return PrefetchedBytes;
+}
+
+
+void FGameSavePipeline::PrefetchSlots(const TArray<FString>& SlotNames, int32 UserIndex)
+{
+	for (const auto& SlotName : SlotNames)
+	{
+		const auto SlotKey{ MakeSlotKey(SlotName, UserIndex) };
+		FPrefetchedSlotRef Entry{ MakeShared<FPrefetchedSlot, ESPMode::ThreadSafe>() };
+
+		// Skip slots that are already prefetched or being prefetched
+
+		{
+			FScopeLock Lock(&PrefetchCS);
+
+			if (SlotName.IsEmpty() || PrefetchedSlots.Contains(SlotKey))
+			{
+				continue;
+			}
+
+			PrefetchedSlots.Add(SlotKey, Entry);
+		}
+
+		Entry->Completion = Async(EAsyncExecution::ThreadPool,
+			[This = AsShared(), SlotName, UserIndex, SlotKey, Entry]()
+			{
+				const auto bSuccess{ This->Storage->DoesSlotExist(SlotName, UserIndex) && This->ReadForLoad(SlotName, UserIndex, Entry->Data, Entry->ReadHash) };
+
+				FScopeLock Lock(&This->PrefetchCS);
+
+				// The entry may have been taken or discarded while reading
+
+				if (const auto* Current{ This->PrefetchedSlots.Find(SlotKey) }; Current && (*Current == Entry))
+				{
+					if (bSuccess)
+					{
+						This->CommitPrefetchedSlot(SlotKey, Entry);
+					}
+					else
+					{
+						This->PrefetchedSlots.Remove(SlotKey);
+					}
+				}
+
+				return bSuccess;
+			}
+		);
+	}
+}
+
+void FGameSavePipeline::DiscardPrefetchedSlot(const FString& SlotName, int32 UserIndex)
+{
+	FScopeLock Lock(&PrefetchCS);
+
+	RemovePrefetchedSlot(MakeSlotKey(SlotName, UserIndex));
+}
+
+void FGameSavePipeline::DiscardAllPrefetchedSlots()
+{
+	FScopeLock Lock(&PrefetchCS);
+
+	PrefetchedSlots.Reset();
+	PrefetchOrder.Reset();
+	PrefetchedBytes = 0;
+}
+
+bool FGameSavePipeline::IsSlotPrefetched(const FString& SlotName, int32 UserIndex) const
+{
+	FScopeLock Lock(&PrefetchCS);
+
+	return PrefetchedSlots.Contains(MakeSlotKey(SlotName, UserIndex));
+}
+
+bool FGameSavePipeline::TakePrefetchedData(const FString& SlotName, int32 UserIndex, TArray<uint8>& OutData, uint64& OutReadHash)
+{
+	TSharedPtr<FPrefetchedSlot, ESPMode::ThreadSafe> Entry;
+	{
+		FScopeLock Lock(&PrefetchCS);
+
+		const auto SlotKey{ MakeSlotKey(SlotName, UserIndex) };
+
+		Entry = PrefetchedSlots.FindRef(SlotKey);
+
+		if (!Entry)
+		{
+			return false;
+		}
+
+		RemovePrefetchedSlot(SlotKey);
+	}
+
+	// Wait outside the lock, the read needs it to complete
+
+	if (!Entry->Completion.IsValid() || !Entry->Completion.Get())
+	{
+		return false;
+	}
+
+	OutData = MoveTemp(Entry->Data);
+	OutReadHash = Entry->ReadHash;
+
+	UE_LOG(LogGameCore_Save, Verbose, TEXT("Used prefetched data of slot(%s)"), *SlotName);
+
+	return true;
+}
+
+void FGameSavePipeline::CommitPrefetchedSlot(const FString& SlotKey, const FPrefetchedSlotRef& Entry)
+{
+	const auto CacheSize{ GetDefault<UGameSaveDeveloperSettings>()->PrefetchCacheSize };
+
+	Entry->bCounted = true;
+	PrefetchedBytes += Entry->Data.Num();
+	PrefetchOrder.Add(SlotKey);
+
+	// Evict the oldest prefetches, including this one if it does not fit on its own
+
+	while ((PrefetchedBytes > CacheSize) && (PrefetchOrder.Num() > 0))
+	{
+		const auto OldestKey{ PrefetchOrder[0] };
+
+		UE_LOG(LogGameCore_Save, Verbose, TEXT("Evicted prefetched slot(%s) over the cache size"), *OldestKey);
+
+		RemovePrefetchedSlot(OldestKey);
+	}
+}
+
+void FGameSavePipeline::RemovePrefetchedSlot(const FString& SlotKey)
+{
+	FPrefetchedSlotRef* Entry{ PrefetchedSlots.Find(SlotKey) };
+
+	if (!Entry)
+	{
+		return;
+	}
+
+	if ((*Entry)->bCounted)
+	{
+		PrefetchedBytes -= (*Entry)->Data.Num();
+		PrefetchOrder.Remove(SlotKey);
+	}
+
+	PrefetchedSlots.Remove(SlotKey);
+}
+
+
+void FGameSavePipeline::SetTraceRecorder(FGameSaveTraceRecorderPtr InTraceRecorder)
+{
+	check(IsInGameThread());
+
+	TraceRecorder = InTraceRecorder;
+}
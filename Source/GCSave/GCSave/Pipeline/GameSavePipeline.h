@@ -0,0 +1,539 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Format/GameSaveBlob.h"
+#include "Profiling/GameSaveTrace.h"
+#include "GameSaveTypes.h"
+
+#include "Kismet/GameplayStatics.h"
+
+#include "Async/Future.h"
+#include "HAL/CriticalSection.h"
+#include "HAL/Event.h"
+
+#include <atomic>
+
+class IGameSaveStorage;
+class FGameSaveIOQueue;
+class FGameSaveCompletionQueue;
+class USaveGame;
+struct FGameSaveHeader;
+
+
+/**
+ * Result of FGameSavePipeline::ProbeSlot
+ */
+enum class EGameSaveProbeResult : uint8
+{
+	// The slot does not exist
+	Missing,
+
+	// The slot exists but has no header of this plugin, e.g. it was written by UGameplayStatics
+	Unknown,
+
+	// The summary of the header has been read
+	Valid,
+};
+
+
+/**
+ * Result of one slot of a batched load
+ */
+struct FGameSaveLoadedSlot
+{
+public:
+	FGameSaveLoadedSlot() {}
+
+	FString SlotName;
+
+	//
+	// Loaded object, or nullptr if the slot does not exist or could not be loaded
+	//
+	USaveGame* SaveObject{ nullptr };
+
+};
+
+
+/**
+ * Delegate notifies that all slots of a batched load have been loaded, results are in the order of the requested slots
+ */
+DECLARE_DELEGATE_TwoParams(FAsyncLoadGamesFromSlotsDelegate, int32, const TArray<FGameSaveLoadedSlot>&);
+
+
+/**
+ * Decides from the header of a slot whether its data is deserialized, slots it rejects are loaded as nullptr
+ *
+ * Tips:
+ *	Called on the game thread, or on a worker thread for the slots of a batched load whose class is already loaded.
+ *	Data without a header of this plugin is deserialized without calling it.
+ */
+using FGameSaveHeaderFilter = TFunction<bool(const FString&, const FGameSaveHeader&)>;
+
+
+/**
+ * Reads and writes save game objects to the slots of a storage
+ *
+ * Tips:
+ *	Each save subsystem owns one pipeline, and every IO of the subsystem goes through its storage.
+ *	Async operations keep the pipeline alive until they complete and call their delegates on the game thread through its completion queue.
+ */
+class GCSAVE_API FGameSavePipeline : public TSharedFromThis<FGameSavePipeline>
+{
+public:
+	explicit FGameSavePipeline(TSharedRef<IGameSaveStorage> InStorage);
+
+	/**
+	 * Creates a pipeline with the storage set in UGameSaveDeveloperSettings
+	 */
+	static TSharedRef<FGameSavePipeline> Create();
+
+protected:
+	TSharedRef<IGameSaveStorage> Storage;
+
+	//
+	// Queue that runs the reads and writes of async operations, or nullptr to use the task graph without a limit
+	//
+	TSharedPtr<FGameSaveIOQueue> IOQueue;
+
+	//
+	// Queue that dispatches the delegates of async operations on the game thread
+	//
+	TSharedRef<FGameSaveCompletionQueue> CompletionQueue;
+
+	//
+	// Identifier of the pipeline, which keeps the slot keys of pipelines that share a completion queue apart
+	//
+	uint32 PipelineId{ 0 };
+
+public:
+	IGameSaveStorage& GetStorage() const { return *Storage; }
+
+	FGameSaveCompletionQueue& GetCompletionQueue() const { return *CompletionQueue; }
+
+	/**
+	 * Sets the queue that runs the reads and writes of async operations
+	 *
+	 * Tips:
+	 *	Pipelines that share a queue never run more reads and writes at the same time than its limit
+	 */
+	void SetIOQueue(TSharedPtr<FGameSaveIOQueue> InIOQueue);
+
+	/**
+	 * Sets the queue that dispatches the delegates of async operations
+	 *
+	 * Tips:
+	 *	Pipelines that share a queue share its per-frame cap, operations already issued complete through the previous queue
+	 */
+	void SetCompletionQueue(TSharedRef<FGameSaveCompletionQueue> InCompletionQueue);
+
+protected:
+	/**
+	 * Runs the task through the IO queue, or on the task graph or the pacing thread of FGameSaveThrottle without one
+	 */
+	void LaunchIOTask(TUniqueFunction<void()> Task, EGameSaveIOPriority Priority = EGameSaveIOPriority::Critical) const;
+
+	/**
+	 * Writes the slot, in throttled chunks if the priority is background and throttling is enabled, can be called from any thread
+	 */
+	bool WriteSlotWithPriority(const FString& SlotName, int32 UserIndex, const TArray<uint8>& InData, EGameSaveIOPriority Priority);
+
+
+	//////////////////////////////////////////////////////////////////
+	// Slot
+public:
+	bool DoesSaveGameExist(const FString& SlotName, int32 UserIndex) const;
+
+	/**
+	 * Reads the summary of the header of the slot (class path, data version, payload size) from its first bytes
+	 *
+	 * Tips:
+	 *	Prefetched slots are probed from the cache without accessing the storage.
+	 *	Storages that cannot read a prefix of a slot read the whole slot, so loads pass a FGameSaveHeaderFilter instead of probing first.
+	 */
+	EGameSaveProbeResult ProbeSlot(const FString& SlotName, int32 UserIndex, FGameSaveHeader& OutHeader) const;
+
+	/**
+	 * Returns true if the slot exists and its payload is complete and matches its hash, can be called from any thread
+	 *
+	 * Note:
+	 *	Reads the whole slot, data not written by this plugin is only checked for being non-empty.
+	 *	Encrypted payloads are checked against the hash of their ciphertext without the key.
+	 */
+	bool VerifySlot(const FString& SlotName, int32 UserIndex) const;
+
+	bool DeleteGameInSlot(const FString& SlotName, int32 UserIndex);
+
+	/**
+	 * Returns the names of all slots of the user in the storage, except the side slots of blobs
+	 */
+	bool GetSaveGameNames(int32 UserIndex, TArray<FString>& OutSlotNames) const;
+
+	bool SaveGameToSlot(USaveGame* SaveObject, int32 DataVersion, bool bUnversioned, const FString& SlotName, int32 UserIndex);
+
+	USaveGame* LoadGameFromSlot(const FString& SlotName, int32 UserIndex, const FGameSaveHeaderFilter& HeaderFilter = nullptr);
+
+	/**
+	 * Serializes the object on the game thread, then encrypts and writes it on a worker thread
+	 *
+	 * Tips:
+	 *	The delegate is always called through the completion queue, after the delegates of earlier async operations of the slot.
+	 *	Writes of background priority go through FGameSaveThrottle.
+	 */
+	void AsyncSaveGameToSlot(USaveGame* SaveObject, int32 DataVersion, bool bUnversioned, const FString& SlotName, int32 UserIndex, FAsyncSaveGameToSlotDelegate SavedDelegate, EGameSaveIOPriority Priority = EGameSaveIOPriority::Critical);
+
+	void AsyncLoadGameFromSlot(const FString& SlotName, int32 UserIndex, FAsyncLoadGameFromSlotDelegate LoadedDelegate, FGameSaveHeaderFilter HeaderFilter = nullptr);
+
+	/**
+	 * Reads and deserializes the slots in parallel on worker threads and calls the delegate once on the game thread
+	 *
+	 * Tips:
+	 *	Objects whose class or referenced assets are not loaded yet are deserialized on the game thread before the delegate is called.
+	 *	The delegate is called after the delegates of earlier async operations of all of the slots.
+	 */
+	void AsyncLoadGamesFromSlots(const TArray<FString>& SlotNames, int32 UserIndex, FAsyncLoadGamesFromSlotsDelegate LoadedDelegate, FGameSaveHeaderFilter HeaderFilter = nullptr);
+
+
+	//////////////////////////////////////////////////////////////////
+	// Pending Writes
+protected:
+	//
+	// Number of async writes issued to each slot that have not been written yet, by slot key
+	//
+	TMap<FString, int32> PendingWrites;
+
+	mutable FCriticalSection PendingWritesCS;
+
+	//
+	// Triggered whenever an async write has been written
+	//
+	FEventRef WriteFinishedEvent{ EEventMode::AutoReset };
+
+public:
+	/**
+	 * Returns true if async writes of the slot have not been written yet
+	 */
+	bool HasPendingWrites(const FString& SlotName, int32 UserIndex) const;
+
+	/**
+	 * Blocks until the async writes of the slot issued so far have been written, other slots are not waited for
+	 *
+	 * Tips:
+	 *	Only waits for the write on the worker thread, not for the delegate, so it can be called on the game thread
+	 *
+	 * Note:
+	 *	Return false if writes are still pending after the timeout
+	 */
+	bool WaitForPendingWrites(const FString& SlotName, int32 UserIndex, double TimeoutSeconds) const;
+
+protected:
+	void AddPendingWrite(const FString& SlotKey);
+
+	void RemovePendingWrite(const FString& SlotKey);
+
+
+	//////////////////////////////////////////////////////////////////
+	// Written Hashes
+protected:
+	//
+	// Payload hash of the data last written to or read from each slot
+	//
+	TMap<FString, uint64> WrittenHashes;
+
+	mutable FCriticalSection WrittenHashesCS;
+
+public:
+	/**
+	 * Forgets the payload hash of the last data written to or read from the slot
+	 *
+	 * Tips:
+	 *	Writes are skipped while the payload hash of new data matches this, call it if the slot is modified outside of this pipeline
+	 */
+	void ForgetWrittenHash(const FString& SlotName, int32 UserIndex);
+
+protected:
+	void SetWrittenHash(const FString& SlotName, int32 UserIndex, uint64 PayloadHash);
+
+	/**
+	 * Returns true if the data is identical to the data last written to the slot and the slot still exists
+	 */
+	bool IsAlreadyWritten(const FString& SlotName, int32 UserIndex, uint64 PayloadHash) const;
+
+	/**
+	 * Serializes the object for a write on the game thread
+	 */
+	bool SerializeForWrite(USaveGame* SaveObject, int32 DataVersion, bool bUnversioned, const FString& SlotName, TArray<uint8>& OutData, uint64& OutPayloadHash, FGameSaveBlobSet& OutBlobs) const;
+
+	/**
+	 * Encrypts the serialized data if encryption is enabled, can be called from any thread
+	 */
+	bool EncryptForWrite(TArray<uint8>& InOutData) const;
+
+	/**
+	 * Reads the slot, decrypts and migrates its data, can be called from any thread
+	 *
+	 * Tips:
+	 *	OutReadHash is the payload hash of the data in the slot before migration
+	 */
+	bool ReadForLoad(const FString& SlotName, int32 UserIndex, TArray<uint8>& OutData, uint64& OutReadHash) const;
+
+	static FString MakeSlotKey(const FString& SlotName, int32 UserIndex);
+
+public:
+	/**
+	 * Returns the key that orders the completions of the slot in the completion queue
+	 *
+	 * Tips:
+	 *	Includes the identifier of the pipeline, since server player pipelines share a completion queue and all use user index 0
+	 */
+	FString MakeCompletionKey(const FString& SlotName, int32 UserIndex) const;
+
+
+	//////////////////////////////////////////////////////////////////
+	// Blobs
+protected:
+	//
+	// Number of writes in progress that reference each blob by slot key, these blobs are never deleted as unreferenced
+	//
+	// Tips:
+	//	Shared by all pipelines since the pipelines of different subsystems can write to the slots of the same user
+	//
+	static TMap<FString, int32> ProtectedBlobs;
+
+	//
+	// Incremented whenever a write that references blobs finishes
+	//
+	static uint64 BlobWriteSerial;
+
+	static FCriticalSection BlobsCS;
+
+public:
+	/**
+	 * Returns the name of the side slot that holds the payload of a blob
+	 */
+	static FString MakeBlobSlotName(const FIoHash& Hash);
+
+	static bool IsBlobSlotName(const FString& SlotName);
+
+	/**
+	 * Reads the payload of a blob from its side slot, can be called from any thread
+	 *
+	 * Note:
+	 *	Return false if the side slot does not exist or its content does not match the hash
+	 */
+	bool LoadBlob(const FIoHash& Hash, int32 UserIndex, FGameSaveBlobDataPtr& OutData);
+
+	/**
+	 * Reads the payload of a blob on a worker thread
+	 *
+	 * Tips:
+	 *	The delegate is called through the completion queue, after the delegates of earlier loads of the same blob
+	 */
+	void AsyncLoadBlob(const FIoHash& Hash, int32 UserIndex, FGameSaveBlobLoadedDelegate LoadedDelegate);
+
+	/**
+	 * Deletes the side slots of blobs that no save of the user references anymore, can be called from any thread
+	 *
+	 * Tips:
+	 *	Runs on a worker thread after writes that added a blob and after deletes, the headers of all slots of the user are read.
+	 *	Only the first bytes of each slot are read, unless its header is longer or the storage cannot read a prefix of a slot.
+	 *	Nothing is deleted if a write that references blobs finishes while the headers are read, the next collection catches up.
+	 */
+	void DeleteUnreferencedBlobs(int32 UserIndex);
+
+protected:
+	/**
+	 * Reads the whole header of the slot, including the referenced blobs, from the first bytes of the slot
+	 */
+	EGameSaveProbeResult ReadSlotHeader(const FString& SlotName, int32 UserIndex, FGameSaveHeader& OutHeader) const;
+
+	/**
+	 * Wraps the payload of a blob in a header and encrypts it with the key of the saves if encryption is enabled
+	 */
+	bool EncodeBlob(const TArray<uint8>& Payload, TArray<uint8>& OutData) const;
+
+	/**
+	 * Restores the payload of a blob from the data of its side slot
+	 *
+	 * Note:
+	 *	Return false if the data cannot be decrypted or the payload does not match the hash
+	 */
+	static bool DecodeBlob(const FIoHash& Hash, TArray<uint8>& InOutData);
+
+	/**
+	 * Protects the blobs from deletion and writes the ones whose side slot does not exist yet, can be called from any thread
+	 *
+	 * Note:
+	 *	EndBlobWrites must be called once the slot that references the blobs has been written, even if this failed.
+	 *	Return false if a blob whose payload was unloaded no longer has its side slot, since the save would reference missing data.
+	 */
+	bool BeginBlobWrites(const FGameSaveBlobSet& Blobs, int32 UserIndex, EGameSaveIOPriority Priority, bool& bOutWroteBlobs);
+
+	void EndBlobWrites(const FGameSaveBlobSet& Blobs, int32 UserIndex);
+
+	void LaunchBlobCollection(int32 UserIndex);
+
+
+	//////////////////////////////////////////////////////////////////
+	// Transfers
+protected:
+	//
+	// Size of the last read or write of a slot
+	//
+	struct FTransferRecord
+	{
+		int64 Bytes{ 0 };
+
+		//
+		// Incremented by every read or write of the slot
+		//
+		uint32 Serial{ 0 };
+	};
+
+	TMap<FString, FTransferRecord> Transfers;
+
+	mutable FCriticalSection TransfersCS;
+
+public:
+	/**
+	 * Returns the number of reads and writes of the slot so far, and the size of the last one
+	 *
+	 * Tips:
+	 *	Compare the serial before and after an operation to know whether it transferred any data
+	 */
+	uint32 GetTransferSerial(const FString& SlotName, int32 UserIndex, int64* OutBytes = nullptr) const;
+
+protected:
+	void RecordTransfer(const FString& SlotName, int32 UserIndex, int64 Bytes);
+
+
+	//////////////////////////////////////////////////////////////////
+	// Memory
+protected:
+	//
+	// Size of the serialized data held by async operations that have not completed yet
+	//
+	std::atomic<int64> InFlightBytes{ 0 };
+
+public:
+	/**
+	 * Returns the size of the serialized data currently held by async reads and writes
+	 */
+	int64 GetInFlightBytes() const { return InFlightBytes.load(std::memory_order_relaxed); }
+
+	/**
+	 * Returns the size of the data kept by the prefetch cache
+	 */
+	int64 GetCachedBytes() const;
+
+protected:
+	void AddInFlightBytes(int64 Bytes) { InFlightBytes.fetch_add(Bytes, std::memory_order_relaxed); }
+
+
+	//////////////////////////////////////////////////////////////////
+	// Prefetch
+protected:
+	//
+	// Data of a slot read ahead of its load
+	//
+	struct FPrefetchedSlot
+	{
+		//
+		// Completes with whether the read succeeded, Data and ReadHash are only valid after that
+		//
+		TFuture<bool> Completion;
+
+		TArray<uint8> Data;
+
+		uint64 ReadHash{ 0 };
+
+		//
+		// Whether the size of the data is counted in PrefetchedBytes
+		//
+		bool bCounted{ false };
+	};
+
+	using FPrefetchedSlotRef = TSharedRef<FPrefetchedSlot, ESPMode::ThreadSafe>;
+
+	//
+	// Prefetched slots by slot key, including reads that are still in progress
+	//
+	TMap<FString, FPrefetchedSlotRef> PrefetchedSlots;
+
+	//
+	// Slot keys of the completed prefetches, oldest first
+	//
+	TArray<FString> PrefetchOrder;
+
+	//
+	// Total size of the completed prefetches, bounded by PrefetchCacheSize in UGameSaveDeveloperSettings
+	//
+	int64 PrefetchedBytes{ 0 };
+
+	mutable FCriticalSection PrefetchCS;
+
+public:
+	/**
+	 * Reads, decrypts and migrates the slots on worker threads and keeps their data until they are loaded
+	 *
+	 * Tips:
+	 *	A later load of a prefetched slot only deserializes the data, waiting for the read if it is still in progress.
+	 *	Writes and deletes of a slot discard its prefetched data.
+	 */
+	void PrefetchSlots(const TArray<FString>& SlotNames, int32 UserIndex);
+
+	/**
+	 * Discards the prefetched data of the slot
+	 */
+	void DiscardPrefetchedSlot(const FString& SlotName, int32 UserIndex);
+
+	/**
+	 * Discards the prefetched data of all slots
+	 */
+	void DiscardAllPrefetchedSlots();
+
+	/**
+	 * Returns true if the slot has been prefetched or is being prefetched
+	 */
+	bool IsSlotPrefetched(const FString& SlotName, int32 UserIndex) const;
+
+protected:
+	/**
+	 * Removes the prefetched data of the slot from the cache, waiting for the read if it is still in progress
+	 *
+	 * Note:
+	 *	Return false if the slot was not prefetched or the read failed
+	 */
+	bool TakePrefetchedData(const FString& SlotName, int32 UserIndex, TArray<uint8>& OutData, uint64& OutReadHash);
+
+	/**
+	 * Counts the completed prefetch and evicts the oldest ones over the budget, the lock must be held
+	 */
+	void CommitPrefetchedSlot(const FString& SlotKey, const FPrefetchedSlotRef& Entry);
+
+	/**
+	 * Removes the entry from the cache, the lock must be held
+	 */
+	void RemovePrefetchedSlot(const FString& SlotKey);
+
+
+	//////////////////////////////////////////////////////////////////
+	// Trace
+protected:
+	//
+	// Recorder the operations of the pipeline are added to, or nullptr if no trace is being recorded
+	//
+	FGameSaveTraceRecorderPtr TraceRecorder;
+
+public:
+	/**
+	 * Sets the recorder operations issued from now on are added to, nullptr stops recording, must be called on the game thread
+	 *
+	 * Tips:
+	 *	Operations issued before keep the previous recorder until they complete
+	 */
+	void SetTraceRecorder(FGameSaveTraceRecorderPtr InTraceRecorder);
+
+	const FGameSaveTraceRecorderPtr& GetTraceRecorder() const { return TraceRecorder; }
+
+};
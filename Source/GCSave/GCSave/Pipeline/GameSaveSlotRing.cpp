@@ -0,0 +1,434 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "GameSaveSlotRing.h"
+
+#include "Pipeline/GameSaveCompletionQueue.h"
+#include "Pipeline/GameSavePipeline.h"
+#include "Storage/GameSaveStorage.h"
+#include "GCSaveLogs.h"
+
+#include "Algo/BinarySearch.h"
+#include "Async/Async.h"
+#include "Misc/ScopeLock.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+
+namespace GameSaveSlotRing
+{
+	static constexpr uint32 INDEX_MAGIC{ 0x49524347 };
+	static constexpr int32 INDEX_VERSION{ 1 };
+
+	static const TCHAR* INDEX_SUFFIX{ TEXT("Index") };
+}
+
+
+FGameSaveSlotRing::FGameSaveSlotRing(TSharedRef<FGameSavePipeline> InPipeline, const FString& InRingName, int32 InUserIndex, int32 InNumSlots)
+	: Pipeline(InPipeline)
+	, RingName(InRingName)
+	, UserIndex(InUserIndex)
+	, NumSlots(FMath::Max(InNumSlots, 1))
+{
+}
+
+TSharedRef<FGameSaveSlotRing> FGameSaveSlotRing::Create(TSharedRef<FGameSavePipeline> InPipeline, const FString& InRingName, int32 InUserIndex, int32 InNumSlots)
+{
+	auto NewRing{ MakeShared<FGameSaveSlotRing>(InPipeline, InRingName, InUserIndex, InNumSlots) };
+
+	// Listing and checking the slots can take long on some storages, so it never runs on the game thread
+
+	Async(EAsyncExecution::ThreadPool, [NewRing]() { NewRing->ReadIndex(); });
+
+	return NewRing;
+}
+
+
+int32 FGameSaveSlotRing::GetNumSlots() const
+{
+	FScopeLock Lock(&RingCS);
+
+	return NumSlots;
+}
+
+void FGameSaveSlotRing::SetNumSlots(int32 InNumSlots)
+{
+	{
+		FScopeLock Lock(&RingCS);
+
+		NumSlots = FMath::Max(InNumSlots, 1);
+
+		PruneEntries();
+
+		if (SequencesToDelete.IsEmpty())
+		{
+			return;
+		}
+	}
+
+	ScheduleWriteBack();
+}
+
+FString FGameSaveSlotRing::GetSlotName(uint32 Sequence) const
+{
+	return FString::Printf(TEXT("%s_%u"), *RingName, Sequence);
+}
+
+FString FGameSaveSlotRing::GetIndexSlotName() const
+{
+	return FString::Printf(TEXT("%s_%s"), *RingName, GameSaveSlotRing::INDEX_SUFFIX);
+}
+
+void FGameSaveSlotRing::CallWhenIndexRead(TUniqueFunction<void()> Callback)
+{
+	auto& Completions{ Pipeline->GetCompletionQueue() };
+	const auto Ticket{ Completions.Reserve(GetCompletionKey()) };
+
+	{
+		FScopeLock Lock(&IndexReadCallbacksCS);
+
+		if (!bIndexRead.load())
+		{
+			IndexReadCallbacks.Emplace(Ticket, MoveTemp(Callback));
+			return;
+		}
+	}
+
+	Completions.Push(GetCompletionKey(), Ticket, MoveTemp(Callback));
+}
+
+FString FGameSaveSlotRing::BeginWrite()
+{
+	WaitForIndex();
+
+	FScopeLock Lock(&RingCS);
+
+	const auto Sequence{ NextSequence++ };
+	WritingSequences.Add(Sequence);
+
+	return GetSlotName(Sequence);
+}
+
+void FGameSaveSlotRing::EndWrite(const FString& SlotName, bool bSuccess)
+{
+	uint32 Sequence{ 0 };
+
+	if (!ParseSequence(SlotName, Sequence))
+	{
+		UE_LOG(LogGameCore_Save, Error, TEXT("FGameSaveSlotRing::EndWrite: Slot(%s) is not a slot of ring(%s)"), *SlotName, *RingName);
+		return;
+	}
+
+	{
+		FScopeLock Lock(&RingCS);
+
+		WritingSequences.Remove(Sequence);
+
+		if (bSuccess)
+		{
+			// Writes can finish out of order, keep the entries sorted by sequence
+
+			const auto InsertIndex{ Algo::LowerBoundBy(Entries, Sequence, &FGameSaveRingEntry::Sequence) };
+			Entries.Insert(FGameSaveRingEntry(Sequence, FDateTime::UtcNow()), InsertIndex);
+
+			PruneEntries();
+		}
+		else
+		{
+			// A failed write may have left partial data behind
+
+			SequencesToDelete.Add(Sequence);
+		}
+	}
+
+	ScheduleWriteBack();
+}
+
+bool FGameSaveSlotRing::GetLatestValidSlot(FString& OutSlotName) const
+{
+	WaitForIndex();
+
+	TArray<uint32> Candidates;
+	{
+		FScopeLock Lock(&RingCS);
+
+		for (int32 Index{ Entries.Num() - 1 }; Index >= 0; --Index)
+		{
+			Candidates.Add(Entries[Index].Sequence);
+		}
+	}
+
+	// Slots may have been deleted or damaged outside of the ring since they were written
+
+	for (const auto& Sequence : Candidates)
+	{
+		const auto SlotName{ GetSlotName(Sequence) };
+
+		if (Pipeline->VerifySlot(SlotName, UserIndex))
+		{
+			OutSlotName = SlotName;
+			return true;
+		}
+
+		UE_LOG(LogGameCore_Save, Warning, TEXT("FGameSaveSlotRing::GetLatestValidSlot: Skipped missing or incomplete slot(%s) of ring(%s)"), *SlotName, *RingName);
+	}
+
+	return false;
+}
+
+void FGameSaveSlotRing::AsyncGetLatestValidSlot(TUniqueFunction<void(const FString&)> Callback)
+{
+	const auto Completions{ Pipeline->GetCompletionQueue().AsShared() };
+	const auto Ticket{ Completions->Reserve(GetCompletionKey()) };
+
+	Async(EAsyncExecution::ThreadPool,
+		[This = AsShared(), Completions, Ticket, Callback = MoveTemp(Callback)]() mutable
+		{
+			FString SlotName;
+			This->GetLatestValidSlot(SlotName);
+
+			Completions->Push(This->GetCompletionKey(), Ticket,
+				[SlotName, Callback = MoveTemp(Callback)]()
+				{
+					Callback(SlotName);
+				}
+			);
+		}
+	);
+}
+
+TArray<FGameSaveRingEntry> FGameSaveSlotRing::GetEntries() const
+{
+	WaitForIndex();
+
+	FScopeLock Lock(&RingCS);
+
+	TArray<FGameSaveRingEntry> Result;
+	Result.Reserve(Entries.Num());
+
+	for (int32 Index{ Entries.Num() - 1 }; Index >= 0; --Index)
+	{
+		Result.Add(Entries[Index]);
+	}
+
+	return Result;
+}
+
+
+void FGameSaveSlotRing::ReadIndex()
+{
+	// Read the successful writes recorded in the index
+
+	TArray<FGameSaveRingEntry> IndexedEntries;
+	TArray<uint8> Data;
+
+	if (Pipeline->GetStorage().ReadSlot(GetIndexSlotName(), UserIndex, Data))
+	{
+		FMemoryReader Reader(Data);
+
+		uint32 Magic{ 0 };
+		int32 Version{ 0 };
+		int32 NumEntries{ 0 };
+		Reader << Magic << Version << NumEntries;
+
+		if ((Magic == GameSaveSlotRing::INDEX_MAGIC) && (Version <= GameSaveSlotRing::INDEX_VERSION) && (NumEntries >= 0) && !Reader.IsError())
+		{
+			for (int32 Index{ 0 }; (Index < NumEntries) && !Reader.IsError(); ++Index)
+			{
+				FGameSaveRingEntry Entry;
+				Reader << Entry.Sequence << Entry.Timestamp;
+
+				IndexedEntries.Add(Entry);
+			}
+		}
+
+		if (Reader.IsError() || (Magic != GameSaveSlotRing::INDEX_MAGIC))
+		{
+			UE_LOG(LogGameCore_Save, Warning, TEXT("FGameSaveSlotRing::ReadIndex: Index of ring(%s) is broken, it is rebuilt from the slot names"), *RingName);
+			IndexedEntries.Reset();
+		}
+	}
+
+	IndexedEntries.Sort([](const FGameSaveRingEntry& A, const FGameSaveRingEntry& B) { return A.Sequence < B.Sequence; });
+
+	// Slots newer than the index were written before the index could be updated, but only complete ones are adopted.
+	// Incomplete newer slots and older unknown slots are leftovers of an interrupted write or prune.
+
+	const auto LatestIndexed{ IndexedEntries.IsEmpty() ? 0u : IndexedEntries.Last().Sequence };
+	auto bIndexChanged{ false };
+	uint32 MaxSequence{ 0 };
+	TArray<uint32> LeftoverSequences;
+
+	TArray<FString> SlotNames;
+	Pipeline->GetSaveGameNames(UserIndex, SlotNames);
+
+	for (const auto& SlotName : SlotNames)
+	{
+		uint32 Sequence{ 0 };
+
+		if (!ParseSequence(SlotName, Sequence))
+		{
+			continue;
+		}
+
+		MaxSequence = FMath::Max(MaxSequence, Sequence);
+
+		if ((Sequence > LatestIndexed) && Pipeline->VerifySlot(SlotName, UserIndex))
+		{
+			const auto InsertIndex{ Algo::LowerBoundBy(IndexedEntries, Sequence, &FGameSaveRingEntry::Sequence) };
+			IndexedEntries.Insert(FGameSaveRingEntry(Sequence, FDateTime::UtcNow()), InsertIndex);
+
+			bIndexChanged = true;
+		}
+		else if (!IndexedEntries.ContainsByPredicate([Sequence](const FGameSaveRingEntry& Entry) { return Entry.Sequence == Sequence; }))
+		{
+			UE_LOG(LogGameCore_Save, Verbose, TEXT("FGameSaveSlotRing::ReadIndex: Deleting leftover slot(%s) of ring(%s)"), *SlotName, *RingName);
+
+			LeftoverSequences.Add(Sequence);
+		}
+	}
+
+	for (const auto& Entry : IndexedEntries)
+	{
+		MaxSequence = FMath::Max(MaxSequence, Entry.Sequence);
+	}
+
+	{
+		FScopeLock Lock(&RingCS);
+
+		Entries = MoveTemp(IndexedEntries);
+		NextSequence = FMath::Max(NextSequence, MaxSequence + 1);
+		SequencesToDelete.Append(LeftoverSequences);
+
+		PruneEntries();
+
+		bIndexChanged |= !SequencesToDelete.IsEmpty();
+	}
+
+	if (bIndexChanged)
+	{
+		ScheduleWriteBack();
+	}
+
+	// Release the writes and queries that waited for the index
+
+	TArray<TPair<uint64, TUniqueFunction<void()>>> Callbacks;
+	{
+		FScopeLock Lock(&IndexReadCallbacksCS);
+
+		bIndexRead.store(true);
+		Callbacks = MoveTemp(IndexReadCallbacks);
+	}
+
+	IndexReadEvent->Trigger();
+
+	auto& Completions{ Pipeline->GetCompletionQueue() };
+
+	for (auto& Callback : Callbacks)
+	{
+		Completions.Push(GetCompletionKey(), Callback.Key, MoveTemp(Callback.Value));
+	}
+}
+
+void FGameSaveSlotRing::WaitForIndex() const
+{
+	if (!bIndexRead.load())
+	{
+		IndexReadEvent->Wait();
+	}
+}
+
+FString FGameSaveSlotRing::GetCompletionKey() const
+{
+	return Pipeline->MakeCompletionKey(GetIndexSlotName(), UserIndex);
+}
+
+void FGameSaveSlotRing::ScheduleWriteBack()
+{
+	Async(EAsyncExecution::ThreadPool, [This = AsShared()]() { This->WriteBack(); });
+}
+
+void FGameSaveSlotRing::WriteBack()
+{
+	FScopeLock WriteBackLock(&WriteBackCS);
+
+	TArray<uint8> Data;
+	TArray<uint32> Deletes;
+	{
+		FScopeLock Lock(&RingCS);
+
+		FMemoryWriter Writer(Data);
+
+		auto Magic{ GameSaveSlotRing::INDEX_MAGIC };
+		auto Version{ GameSaveSlotRing::INDEX_VERSION };
+		auto NumEntries{ Entries.Num() };
+		Writer << Magic << Version << NumEntries;
+
+		for (auto Entry : Entries)
+		{
+			Writer << Entry.Sequence << Entry.Timestamp;
+		}
+
+		Deletes = MoveTemp(SequencesToDelete);
+		SequencesToDelete.Reset();
+	}
+
+	// The index is written first so that it never refers to a deleted slot
+
+	if (!Pipeline->GetStorage().WriteSlot(GetIndexSlotName(), UserIndex, Data))
+	{
+		UE_LOG(LogGameCore_Save, Error, TEXT("FGameSaveSlotRing::WriteBack: Failed to write index of ring(%s)"), *RingName);
+
+		FScopeLock Lock(&RingCS);
+		SequencesToDelete.Append(Deletes);
+
+		return;
+	}
+
+	for (const auto& Sequence : Deletes)
+	{
+		const auto SlotName{ GetSlotName(Sequence) };
+
+		if (Pipeline->DoesSaveGameExist(SlotName, UserIndex) && !Pipeline->DeleteGameInSlot(SlotName, UserIndex))
+		{
+			UE_LOG(LogGameCore_Save, Warning, TEXT("FGameSaveSlotRing::WriteBack: Failed to delete slot(%s) of ring(%s)"), *SlotName, *RingName);
+		}
+	}
+}
+
+void FGameSaveSlotRing::PruneEntries()
+{
+	const auto NumToRemove{ Entries.Num() - NumSlots };
+
+	if (NumToRemove <= 0)
+	{
+		return;
+	}
+
+	for (int32 Index{ 0 }; Index < NumToRemove; ++Index)
+	{
+		SequencesToDelete.Add(Entries[Index].Sequence);
+	}
+
+	Entries.RemoveAt(0, NumToRemove);
+}
+
+bool FGameSaveSlotRing::ParseSequence(const FString& SlotName, uint32& OutSequence) const
+{
+	const auto Prefix{ RingName + TEXT("_") };
+
+	if (!SlotName.StartsWith(Prefix, ESearchCase::CaseSensitive))
+	{
+		return false;
+	}
+
+	const auto Number{ SlotName.RightChop(Prefix.Len()) };
+
+	if (Number.IsEmpty() || !Number.IsNumeric() || Number.Contains(TEXT(".")) || Number.Contains(TEXT("-")))
+	{
+		return false;
+	}
+
+	OutSequence = static_cast<uint32>(FCString::Strtoui64(*Number, nullptr, 10));
+
+	return OutSequence > 0;
+}
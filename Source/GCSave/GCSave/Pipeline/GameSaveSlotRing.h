@@ -0,0 +1,202 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "HAL/CriticalSection.h"
+#include "HAL/Event.h"
+#include "Misc/DateTime.h"
+#include "Templates/Function.h"
+
+#include <atomic>
+
+class FGameSavePipeline;
+
+
+/**
+ * Slot of a ring that has been written successfully
+ */
+struct FGameSaveRingEntry
+{
+public:
+	FGameSaveRingEntry() {}
+
+	FGameSaveRingEntry(uint32 InSequence, const FDateTime& InTimestamp)
+		: Sequence(InSequence), Timestamp(InTimestamp)
+	{}
+
+	//
+	// Number of the write, newer writes have larger numbers
+	//
+	uint32 Sequence{ 0 };
+
+	//
+	// UTC time at which the write finished
+	//
+	FDateTime Timestamp;
+
+};
+
+
+/**
+ * Rotating set of slots for quick saves and autosaves
+ *
+ * Tips:
+ *	Each write goes to a new slot named "<RingName>_<Sequence>", so it never waits for an old slot to be deleted.
+ *	The successful writes are recorded in a small index slot "<RingName>_Index". Once more than NumSlots writes have succeeded,
+ *	the oldest ones are removed from the index and their slots are deleted on a worker thread.
+ *	The index is read on a worker thread when the ring is created. Slots newer than the index are only adopted if their data is complete.
+ *	The latest valid slot is resolved from the index, and its data is checked before it is returned.
+ */
+class GCSAVE_API FGameSaveSlotRing : public TSharedFromThis<FGameSaveSlotRing>
+{
+public:
+	FGameSaveSlotRing(TSharedRef<FGameSavePipeline> InPipeline, const FString& InRingName, int32 InUserIndex, int32 InNumSlots);
+
+	/**
+	 * Creates the ring and starts reading its index from the storage of the pipeline on a worker thread
+	 */
+	static TSharedRef<FGameSaveSlotRing> Create(TSharedRef<FGameSavePipeline> InPipeline, const FString& InRingName, int32 InUserIndex, int32 InNumSlots);
+
+protected:
+	TSharedRef<FGameSavePipeline> Pipeline;
+
+	FString RingName;
+
+	int32 UserIndex{ 0 };
+
+	//
+	// Number of successful writes that are kept
+	//
+	int32 NumSlots{ 1 };
+
+	mutable FCriticalSection RingCS;
+
+	//
+	// Successful writes, oldest first
+	//
+	TArray<FGameSaveRingEntry> Entries;
+
+	//
+	// Writes that have been started but not finished
+	//
+	TSet<uint32> WritingSequences;
+
+	//
+	// Slots to delete with the next write-back
+	//
+	TArray<uint32> SequencesToDelete;
+
+	uint32 NextSequence{ 1 };
+
+	//
+	// Keeps write-backs in order so that the index on disk is always the latest one
+	//
+	FCriticalSection WriteBackCS;
+
+	//
+	// Triggered once the index has been read
+	//
+	FEventRef IndexReadEvent{ EEventMode::ManualReset };
+
+	std::atomic<bool> bIndexRead{ false };
+
+	//
+	// Functions waiting for the index, with their tickets in the completion queue of the pipeline
+	//
+	TArray<TPair<uint64, TUniqueFunction<void()>>> IndexReadCallbacks;
+
+	FCriticalSection IndexReadCallbacksCS;
+
+public:
+	const FString& GetRingName() const { return RingName; }
+
+	int32 GetNumSlots() const;
+
+	/**
+	 * Changes the number of writes that are kept, excess writes are pruned in the background
+	 */
+	void SetNumSlots(int32 InNumSlots);
+
+	/**
+	 * Returns the slot name of the write
+	 */
+	FString GetSlotName(uint32 Sequence) const;
+
+	FString GetIndexSlotName() const;
+
+	bool IsIndexRead() const { return bIndexRead.load(); }
+
+	/**
+	 * Calls the function through the completion queue of the pipeline once the index has been read, must be called on the game thread
+	 */
+	void CallWhenIndexRead(TUniqueFunction<void()> Callback);
+
+	/**
+	 * Returns the slot to write to next and marks it as being written
+	 *
+	 * Note:
+	 *	Blocks until the index has been read, use CallWhenIndexRead to avoid it
+	 */
+	FString BeginWrite();
+
+	/**
+	 * Records the result of the write started with BeginWrite and prunes old writes in the background
+	 */
+	void EndWrite(const FString& SlotName, bool bSuccess);
+
+	/**
+	 * Finds the slot of the latest successful write whose data is still complete, can be called from any thread
+	 *
+	 * Tips:
+	 *	The slots are read to check them against their headers, newest first until one is valid.
+	 *
+	 * Note:
+	 *	Blocks until the index has been read.
+	 *	Return false if the ring has no valid write
+	 */
+	bool GetLatestValidSlot(FString& OutSlotName) const;
+
+	/**
+	 * Finds the slot of the latest valid write on a worker thread, must be called on the game thread
+	 *
+	 * Tips:
+	 *	The function is called through the completion queue of the pipeline, with an empty slot name if the ring has no valid write
+	 */
+	void AsyncGetLatestValidSlot(TUniqueFunction<void(const FString&)> Callback);
+
+	/**
+	 * Returns the successful writes, newest first
+	 *
+	 * Note:
+	 *	Blocks until the index has been read
+	 */
+	TArray<FGameSaveRingEntry> GetEntries() const;
+
+protected:
+	/**
+	 * Reads the index and checks the slots newer than it without holding RingCS, so that the ring can be configured meanwhile
+	 */
+	void ReadIndex();
+
+	void WaitForIndex() const;
+
+	/**
+	 * Returns the key of the ring in the completion queue of the pipeline
+	 */
+	FString GetCompletionKey() const;
+
+	/**
+	 * Writes the index and deletes the pruned slots on a worker thread
+	 */
+	void ScheduleWriteBack();
+
+	void WriteBack();
+
+	/**
+	 * Moves the writes beyond NumSlots to SequencesToDelete, RingCS must be locked
+	 */
+	void PruneEntries();
+
+	bool ParseSequence(const FString& SlotName, uint32& OutSequence) const;
+
+};
@@ -0,0 +1,158 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "GameSaveThrottle.h"
+
+#include "GameSaveDeveloperSettings.h"
+
+#include "Async/Async.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/QueuedThreadPool.h"
+#include "Misc/ScopeLock.h"
+#include "UObject/UObjectGlobals.h"
+
+
+namespace GameSaveThrottle
+{
+	//
+	// Longest time a waiting chunk sleeps before it checks the budget and streaming again
+	//
+	static constexpr double MAX_SLEEP_SECONDS{ 0.05 };
+
+	static constexpr uint32 PACING_THREAD_STACK_SIZE{ 128 * 1024 };
+}
+
+
+FGameSaveThrottle& FGameSaveThrottle::Get()
+{
+	static FGameSaveThrottle Instance;
+	return Instance;
+}
+
+
+bool FGameSaveThrottle::IsEnabled() const
+{
+	const auto* DevSetting{ GetDefault<UGameSaveDeveloperSettings>() };
+
+	return (DevSetting->BackgroundWriteBytesPerSecond > 0) || DevSetting->bPauseBackgroundWritesWhileStreaming;
+}
+
+int64 FGameSaveThrottle::GetChunkSize() const
+{
+	return FMath::Max(GetDefault<UGameSaveDeveloperSettings>()->BackgroundWriteChunkSize, 4096);
+}
+
+void FGameSaveThrottle::BeginBackgroundWrite()
+{
+	check(IsInGameThread());
+
+	NumBackgroundWrites.fetch_add(1);
+
+	// Streaming is sampled while background writes are in flight and stops once all of them have finished
+
+	if (!TickerHandle.IsValid())
+	{
+		TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FGameSaveThrottle::Tick));
+
+		Tick(0.0f);
+	}
+}
+
+void FGameSaveThrottle::EndBackgroundWrite()
+{
+	NumBackgroundWrites.fetch_sub(1);
+}
+
+void FGameSaveThrottle::Launch(TUniqueFunction<void()> Task)
+{
+	FScopeLock Lock(&PacingThreadCS);
+
+	if (!PacingThread)
+	{
+		PacingThread = FQueuedThreadPool::Allocate();
+		verify(PacingThread->Create(1, GameSaveThrottle::PACING_THREAD_STACK_SIZE, TPri_BelowNormal, TEXT("GameSavePacingThread")));
+	}
+
+	AsyncPool(*PacingThread, MoveTemp(Task));
+}
+
+void FGameSaveThrottle::Shutdown()
+{
+	FScopeLock Lock(&PacingThreadCS);
+
+	if (PacingThread)
+	{
+		PacingThread->Destroy();
+
+		delete PacingThread;
+		PacingThread = nullptr;
+	}
+}
+
+void FGameSaveThrottle::WaitForChunk(int64 Bytes)
+{
+	const auto* DevSetting{ GetDefault<UGameSaveDeveloperSettings>() };
+	const auto BytesPerSecond{ static_cast<double>(DevSetting->BackgroundWriteBytesPerSecond) };
+	const auto bPauseWhileStreaming{ DevSetting->bPauseBackgroundWritesWhileStreaming };
+	const auto StartTime{ FPlatformTime::Seconds() };
+	const auto PauseEndTime{ StartTime + DevSetting->MaxStreamingPauseSeconds };
+
+	while (true)
+	{
+		const auto Now{ FPlatformTime::Seconds() };
+		double WaitSeconds{ 0.0 };
+
+		// Streaming goes first until the chunk has waited for it too long
+
+		if (bPauseWhileStreaming && IsStreamingHeavy() && (Now < PauseEndTime))
+		{
+			WaitSeconds = GameSaveThrottle::MAX_SLEEP_SECONDS;
+		}
+		else if (BytesPerSecond > 0.0)
+		{
+			FScopeLock Lock(&BudgetCS);
+
+			// The budget builds up to one chunk at most, so idle time never turns into a burst
+
+			AvailableBytes = FMath::Min(AvailableBytes + (Now - LastRefillTime) * BytesPerSecond, static_cast<double>(GetChunkSize()));
+			LastRefillTime = Now;
+
+			if (AvailableBytes >= 0.0)
+			{
+				AvailableBytes -= Bytes;
+			}
+			else
+			{
+				WaitSeconds = -AvailableBytes / BytesPerSecond;
+			}
+		}
+
+		if (WaitSeconds <= 0.0)
+		{
+			break;
+		}
+
+		FPlatformProcess::Sleep(static_cast<float>(FMath::Min(WaitSeconds, GameSaveThrottle::MAX_SLEEP_SECONDS)));
+	}
+
+	ThrottledBytes.fetch_add(Bytes, std::memory_order_relaxed);
+	WaitMicroseconds.fetch_add(static_cast<int64>((FPlatformTime::Seconds() - StartTime) * 1000000.0), std::memory_order_relaxed);
+}
+
+
+bool FGameSaveThrottle::Tick(float DeltaTime)
+{
+	const auto* DevSetting{ GetDefault<UGameSaveDeveloperSettings>() };
+
+	if (NumBackgroundWrites.load() <= 0)
+	{
+		bStreamingHeavy.store(false);
+
+		TickerHandle.Reset();
+		return false;
+	}
+
+	bStreamingHeavy.store(DevSetting->bPauseBackgroundWritesWhileStreaming && (GetNumAsyncPackages() >= DevSetting->StreamingPackagesToPauseWrites));
+
+	return true;
+}
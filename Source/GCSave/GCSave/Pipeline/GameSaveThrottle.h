@@ -0,0 +1,114 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Containers/Ticker.h"
+#include "HAL/CriticalSection.h"
+#include "Templates/Function.h"
+
+#include <atomic>
+
+class FQueuedThreadPool;
+
+
+/**
+ * Limits the disk bandwidth used by the background priority writes of all save pipelines
+ *
+ * Tips:
+ *	Throttled writes are split into chunks of BackgroundWriteChunkSize and each chunk waits until the budget of BackgroundWriteBytesPerSecond allows it.
+ *	With bPauseBackgroundWritesWhileStreaming, chunks also wait while the engine loads StreamingPackagesToPauseWrites packages or more, for at most MaxStreamingPauseSeconds.
+ *	Throttled writes run one at a time on a pacing thread of their own, so that their waits never hold a worker of the task graph or a critical worker of an FGameSaveIOQueue.
+ *	Critical writes and all reads never go through the throttle.
+ */
+class GCSAVE_API FGameSaveThrottle
+{
+public:
+	FGameSaveThrottle() {}
+
+	static FGameSaveThrottle& Get();
+
+protected:
+	//
+	// Budget in bytes left for the next chunks, negative while a chunk larger than the budget is paid off
+	//
+	double AvailableBytes{ 0.0 };
+
+	double LastRefillTime{ 0.0 };
+
+	mutable FCriticalSection BudgetCS;
+
+	//
+	// Whether the engine is loading enough packages to pause background writes, sampled on the game thread
+	//
+	std::atomic<bool> bStreamingHeavy{ false };
+
+	//
+	// Number of background writes issued and not finished yet, streaming is only sampled while there are any
+	//
+	std::atomic<int32> NumBackgroundWrites{ 0 };
+
+	std::atomic<int64> ThrottledBytes{ 0 };
+
+	std::atomic<int64> WaitMicroseconds{ 0 };
+
+	FTSTicker::FDelegateHandle TickerHandle;
+
+	//
+	// Pool of a single thread that runs the throttled writes, created on the first of them
+	//
+	FQueuedThreadPool* PacingThread{ nullptr };
+
+	FCriticalSection PacingThreadCS;
+
+public:
+	/**
+	 * Returns true if the settings limit or pause background writes
+	 */
+	bool IsEnabled() const;
+
+	/**
+	 * Returns the size of the chunks throttled writes are split into
+	 */
+	int64 GetChunkSize() const;
+
+	/**
+	 * Registers a background write before it is issued, must be called on the game thread
+	 */
+	void BeginBackgroundWrite();
+
+	/**
+	 * Unregisters a background write once it has finished, can be called from any thread
+	 */
+	void EndBackgroundWrite();
+
+	/**
+	 * Runs the task of a throttled write on the pacing thread after the tasks launched before it, can be called from any thread
+	 */
+	void Launch(TUniqueFunction<void()> Task);
+
+	/**
+	 * Stops the pacing thread, tasks that have not started yet are dropped
+	 */
+	void Shutdown();
+
+	/**
+	 * Blocks until a chunk of the size may be written, must be called on the pacing thread
+	 */
+	void WaitForChunk(int64 Bytes);
+
+	bool IsStreamingHeavy() const { return bStreamingHeavy.load(std::memory_order_relaxed); }
+
+	/**
+	 * Returns the total size of the chunks that went through the throttle
+	 */
+	int64 GetThrottledBytes() const { return ThrottledBytes.load(std::memory_order_relaxed); }
+
+	/**
+	 * Returns the total time chunks waited for budget or streaming
+	 */
+	double GetWaitSeconds() const { return WaitMicroseconds.load(std::memory_order_relaxed) / 1000000.0; }
+
+protected:
+	bool Tick(float DeltaTime);
+
+};
@@ -0,0 +1,125 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "AsyncAction_BatchPlayerSaveEvent.h"
+
+#include "PlayerSave/PlayerSaveSubsystem.h"
+#include "Pipeline/GameSavePipeline.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(AsyncAction_BatchPlayerSaveEvent)
+
+
+UAsyncAction_BatchPlayerSaveEvent* UAsyncAction_BatchPlayerSaveEvent::AsyncLoadPlayerSaves(UPlayerSaveSubsystem* Subsystem, const TArray<FPlayerSaveBatchEntry>& Entries, bool bForceLoad)
+{
+	auto* Action{ NewObject<UAsyncAction_BatchPlayerSaveEvent>() };
+	Action->Operation = EPlayerSaveOperation::Load;
+	Action->InEntries = Entries;
+	Action->bInForceLoad = bForceLoad;
+	Action->InSubsystem = Subsystem;
+
+	Action->RegisterWithGameInstance(Subsystem);
+
+	return Action;
+}
+
+UAsyncAction_BatchPlayerSaveEvent* UAsyncAction_BatchPlayerSaveEvent::AsyncSavePlayerSaves(UPlayerSaveSubsystem* Subsystem, const TArray<FPlayerSaveBatchEntry>& Entries)
+{
+	auto* Action{ NewObject<UAsyncAction_BatchPlayerSaveEvent>() };
+	Action->Operation = EPlayerSaveOperation::Save;
+	Action->InEntries = Entries;
+	Action->InSubsystem = Subsystem;
+
+	Action->RegisterWithGameInstance(Subsystem);
+
+	return Action;
+}
+
+
+void UAsyncAction_BatchPlayerSaveEvent::Activate()
+{
+	Results.SetNum(InEntries.Num());
+	IssuedSerials.SetNumZeroed(InEntries.Num());
+
+	if (!InSubsystem.IsValid())
+	{
+		HandleCompleted();
+		return;
+	}
+
+	// Slots that complete during the loop are counted, but the completion waits until every slot is issued
+
+	bIssuing = true;
+
+	for (int32 Index{ 0 }; Index < InEntries.Num(); ++Index)
+	{
+		const auto& Entry{ InEntries[Index] };
+		const auto SlotName{ InSubsystem->ResolveSlotName(Entry.PlayerSaveClass, Entry.SlotName) };
+
+		Results[Index].SlotName = SlotName;
+		IssuedSerials[Index] = InSubsystem->GetPipeline()->GetTransferSerial(SlotName, InSubsystem->GetLocalPlayer()->GetPlatformUserIndex());
+
+		auto bActivationSuccess{ false };
+		auto Delegate{ FPlayerSaveEventDelegate::CreateUObject(this, &ThisClass::HandleSlotEvent, Index) };
+
+		if (Operation == EPlayerSaveOperation::Load)
+		{
+			bActivationSuccess = InSubsystem->AsyncLoadPlayerSave(Entry.PlayerSaveClass, Entry.SlotName, bInForceLoad, Delegate);
+		}
+		else if (Operation == EPlayerSaveOperation::Save)
+		{
+			bActivationSuccess = InSubsystem->AsyncSaveGameToSlot(Entry.PlayerSaveClass, Entry.SlotName, Delegate);
+		}
+
+		if (!bActivationSuccess)
+		{
+			HandleSlotEvent(nullptr, false, Index);
+		}
+	}
+
+	bIssuing = false;
+
+	if (NumCompleted >= InEntries.Num())
+	{
+		HandleCompleted();
+	}
+}
+
+
+void UAsyncAction_BatchPlayerSaveEvent::HandleSlotEvent(UPlayerSave* PlayerSaveObject, bool bSuccess, int32 EntryIndex)
+{
+	auto& Result{ Results[EntryIndex] };
+	Result.PlayerSave = PlayerSaveObject;
+	Result.bSuccess = bSuccess;
+
+	// Only count the data if the slot was actually read or written by this operation
+
+	if (InSubsystem.IsValid())
+	{
+		int64 Bytes{ 0 };
+		const auto Serial{ InSubsystem->GetPipeline()->GetTransferSerial(Result.SlotName, InSubsystem->GetLocalPlayer()->GetPlatformUserIndex(), &Bytes) };
+
+		Result.Bytes = (Serial != IssuedSerials[EntryIndex]) ? Bytes : 0;
+		TransferredBytes += Result.Bytes;
+	}
+
+	NumCompleted++;
+
+	Progress.Broadcast(NumCompleted, InEntries.Num(), TransferredBytes);
+
+	if (!bIssuing && (NumCompleted >= InEntries.Num()))
+	{
+		HandleCompleted();
+	}
+}
+
+void UAsyncAction_BatchPlayerSaveEvent::HandleCompleted()
+{
+	auto bAllSucceeded{ InSubsystem.IsValid() };
+
+	for (const auto& Result : Results)
+	{
+		bAllSucceeded &= Result.bSuccess;
+	}
+
+	Completed.Broadcast(Results, bAllSucceeded);
+	SetReadyToDestroy();
+}
@@ -0,0 +1,133 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Kismet/BlueprintAsyncActionBase.h"
+
+#include "PlayerSave/PlayerSaveSubsystem.h"
+
+#include "AsyncAction_BatchPlayerSaveEvent.generated.h"
+
+
+/**
+ * Result of one entry of a batch
+ */
+USTRUCT(BlueprintType)
+struct FPlayerSaveBatchResult
+{
+	GENERATED_BODY()
+public:
+	FPlayerSaveBatchResult() {}
+
+	UPROPERTY(BlueprintReadOnly, Category = "Player Save")
+	TObjectPtr<UPlayerSave> PlayerSave{ nullptr };
+
+	UPROPERTY(BlueprintReadOnly, Category = "Player Save")
+	FString SlotName;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Player Save")
+	bool bSuccess{ false };
+
+	//
+	// Size of the data read or written, 0 if nothing was transferred (e.g. already loaded or unchanged)
+	//
+	UPROPERTY(BlueprintReadOnly, Category = "Player Save")
+	int64 Bytes{ 0 };
+
+};
+
+
+/**
+ * Delegate to signal the progress of a player save batch
+ */
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FPlayerSaveBatchProgressDelegate, int32, CompletedSlots, int32, TotalSlots, int64, TransferredBytes);
+
+/**
+ * Delegate to signal the completion of a player save batch
+ */
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FPlayerSaveBatchCompletedDelegate, const TArray<FPlayerSaveBatchResult>&, Results, bool, bAllSucceeded);
+
+
+/**
+ * Async action for handle async load or save of multiple player saves
+ *
+ * Tips:
+ *	All loads or saves are issued together and the results are in the order of the entries
+ */
+UCLASS()
+class GCSAVE_API UAsyncAction_BatchPlayerSaveEvent : public UBlueprintAsyncActionBase
+{
+	GENERATED_BODY()
+public:
+	UAsyncAction_BatchPlayerSaveEvent() {}
+
+public:
+	//
+	// Delegate called each time a slot completes
+	//
+	UPROPERTY(BlueprintAssignable)
+	FPlayerSaveBatchProgressDelegate Progress;
+
+	//
+	// Delegate called when all slots complete
+	//
+	UPROPERTY(BlueprintAssignable)
+	FPlayerSaveBatchCompletedDelegate Completed;
+
+protected:
+	enum class EPlayerSaveOperation : uint8 { Save, Load };
+
+	//
+	// Which operation is being run
+	//
+	EPlayerSaveOperation Operation{ EPlayerSaveOperation::Save };
+
+protected:
+	UPROPERTY(Transient)
+	TWeakObjectPtr<UPlayerSaveSubsystem> InSubsystem{ nullptr };
+
+	UPROPERTY(Transient)
+	TArray<FPlayerSaveBatchEntry> InEntries;
+
+	UPROPERTY(Transient)
+	bool bInForceLoad{ false };
+
+	UPROPERTY(Transient)
+	TArray<FPlayerSaveBatchResult> Results;
+
+	//
+	// Transfer serial of each slot when its operation was issued
+	//
+	TArray<uint32> IssuedSerials;
+
+	int32 NumCompleted{ 0 };
+
+	int64 TransferredBytes{ 0 };
+
+	//
+	// Whether the operations are still being issued, completion is deferred until all are issued
+	//
+	bool bIssuing{ false };
+
+public:
+	/**
+	 * Load player saves asynchronously.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Player Save", meta = (AdvancedDisplay = "bForceLoad", BlueprintInternalUseOnly = "true"))
+	static UAsyncAction_BatchPlayerSaveEvent* AsyncLoadPlayerSaves(UPlayerSaveSubsystem* Subsystem, const TArray<FPlayerSaveBatchEntry>& Entries, bool bForceLoad = false);
+
+	/**
+	 * Save player saves asynchronously.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Player Save", meta = (BlueprintInternalUseOnly = "true", DisplayName = "Wait Async Save Player Saves"))
+	static UAsyncAction_BatchPlayerSaveEvent* AsyncSavePlayerSaves(UPlayerSaveSubsystem* Subsystem, const TArray<FPlayerSaveBatchEntry>& Entries);
+
+
+public:
+	virtual void Activate() override;
+
+protected:
+	virtual void HandleSlotEvent(UPlayerSave* PlayerSaveObject, bool bSuccess, int32 EntryIndex);
+	virtual void HandleCompleted();
+
+};
@@ -2,6 +2,7 @@
 
 #include "PlayerSave.h"
 
+#include "Format/GameSaveSerializer.h"
 #include "GCSaveLogs.h"
 
 #include "Engine/LocalPlayer.h"
@@ -27,6 +28,8 @@ void UPlayerSave::InitializeSaveGame(const ULocalPlayer* LocalPlayer, FString In
 
 	LoadedDataVersion = SavedDataVersion;
 	HandlePostLoad();
+
+	ClearDirty();
 }
 
 void UPlayerSave::ResetToDefault()
@@ -35,6 +38,8 @@ void UPlayerSave::ResetToDefault()
 	LoadedDataVersion = SavedDataVersion;
 
 	OnResetToDefault();
+
+	MarkDirty();
 }
 
 void UPlayerSave::HandlePostLoad()
@@ -48,9 +53,32 @@ void UPlayerSave::HandlePreSave()
 
 	// Set the save data version and increment the requested count
 
+	SavingPreviousDataVersion = SavedDataVersion;
 	SavedDataVersion = GetLatestDataVersion();
 	CurrentSaveRequest++;
 
+	// Keep the changes being saved so that they can be restored if the save fails
+
+	SavingDirtyProperties = MoveTemp(DirtyProperties);
+	DirtyProperties.Reset();
+
+	// The hashes of the dirty check that let this save through are still valid if nothing has been marked since
+
+	if (GetDirtyTrackingMode() == EGameSaveDirtyTracking::Snapshot)
+	{
+		if (CheckedSnapshotFrame == GFrameCounter)
+		{
+			SavingPropertySnapshot = MoveTemp(CheckedPropertySnapshot);
+		}
+		else
+		{
+			FGameSaveSerializer::GetPropertyHashes(this, SavingPropertySnapshot);
+		}
+	}
+
+	CheckedPropertySnapshot.Reset();
+	CheckedSnapshotFrame = MAX_uint64;
+
 	UE_LOG(LogGameCore_PlayerSave, Log, TEXT("Starting to save game(%s) request(%d) to slot(%s) for user(%d)"), *GetName(), CurrentSaveRequest, *GetSaveSlotName(), GetPlatformUserIndex());
 }
 
@@ -61,6 +89,8 @@ void UPlayerSave::HandlePostSave(bool bSuccess)
 		ensure(CurrentSaveRequest > LastSuccessfulSaveRequest);
 		LastSuccessfulSaveRequest = CurrentSaveRequest;
 
+		PropertySnapshot = MoveTemp(SavingPropertySnapshot);
+
 		UE_LOG(LogGameCore_PlayerSave, Log, TEXT("Successfully saved game(%s) request(%d) to slot(%s) for user(%d)"), *GetName(), LastSuccessfulSaveRequest, *GetSaveSlotName(), GetPlatformUserIndex());
 	}
 	else
@@ -68,8 +98,127 @@ void UPlayerSave::HandlePostSave(bool bSuccess)
 		ensure(CurrentSaveRequest > LastErrorSaveRequest);
 		LastErrorSaveRequest = CurrentSaveRequest;
 
+		DirtyProperties.Append(SavingDirtyProperties);
+		SavedDataVersion = SavingPreviousDataVersion;
+
 		UE_LOG(LogGameCore_PlayerSave, Error, TEXT("Failed to save game(%s) request(%d) to slot(%s) for user(%d)"), *GetName(), LastErrorSaveRequest, *GetSaveSlotName(), GetPlatformUserIndex());
 	}
 
+	SavingDirtyProperties.Reset();
+	SavingPropertySnapshot.Reset();
+
 	OnPostSave(bSuccess);
 }
+
+void UPlayerSave::HandlePreCopySave(const FString& CopySlotName)
+{
+	OnPreSave();
+
+	UE_LOG(LogGameCore_PlayerSave, Log, TEXT("Starting to save a copy of game(%s) to slot(%s) for user(%d)"), *GetName(), *CopySlotName, GetPlatformUserIndex());
+}
+
+void UPlayerSave::HandlePostCopySave(const FString& CopySlotName, bool bSuccess)
+{
+	if (bSuccess)
+	{
+		UE_LOG(LogGameCore_PlayerSave, Log, TEXT("Successfully saved a copy of game(%s) to slot(%s) for user(%d)"), *GetName(), *CopySlotName, GetPlatformUserIndex());
+	}
+	else
+	{
+		UE_LOG(LogGameCore_PlayerSave, Error, TEXT("Failed to save a copy of game(%s) to slot(%s) for user(%d)"), *GetName(), *CopySlotName, GetPlatformUserIndex());
+	}
+
+	OnPostSave(bSuccess);
+}
+
+void UPlayerSave::HandlePostRestoreCheckpoint(FName CheckpointName)
+{
+	UE_LOG(LogGameCore_PlayerSave, Log, TEXT("Restored game(%s) to checkpoint(%s) for user(%d)"), *GetName(), *CheckpointName.ToString(), GetPlatformUserIndex());
+
+	LoadedDataVersion = SavedDataVersion;
+	HandlePostLoad();
+}
+
+
+void UPlayerSave::MarkDirty(FName PropertyName)
+{
+	DirtyProperties.Add(PropertyName);
+
+	CheckedSnapshotFrame = MAX_uint64;
+}
+
+bool UPlayerSave::IsDirty() const
+{
+	const auto Mode{ GetDirtyTrackingMode() };
+
+	if (Mode == EGameSaveDirtyTracking::None)
+	{
+		return true;
+	}
+
+	// Saves that have never been written are always dirty
+
+	if (!WasLoaded() && (LastSuccessfulSaveRequest == 0))
+	{
+		return true;
+	}
+
+	// Saves loaded from an older data version are written again to upgrade the slot
+
+	if (GetSavedDataVersion() != GetLatestDataVersion())
+	{
+		return true;
+	}
+
+	if (!DirtyProperties.IsEmpty())
+	{
+		return true;
+	}
+
+	if (Mode == EGameSaveDirtyTracking::Snapshot)
+	{
+		FGameSaveSerializer::GetPropertyHashes(this, CheckedPropertySnapshot);
+		CheckedSnapshotFrame = GFrameCounter;
+
+		return !CheckedPropertySnapshot.OrderIndependentCompareEqual(PropertySnapshot);
+	}
+
+	return false;
+}
+
+TArray<FName> UPlayerSave::GetDirtyProperties() const
+{
+	auto Result{ DirtyProperties.Array() };
+
+	if (GetDirtyTrackingMode() == EGameSaveDirtyTracking::Snapshot)
+	{
+		TMap<FName, uint32> CurrentHashes;
+		FGameSaveSerializer::GetPropertyHashes(this, CurrentHashes);
+
+		for (const auto& KVP : CurrentHashes)
+		{
+			const auto* SnapshotHash{ PropertySnapshot.Find(KVP.Key) };
+
+			if (!SnapshotHash || (*SnapshotHash != KVP.Value))
+			{
+				Result.AddUnique(KVP.Key);
+			}
+		}
+	}
+
+	return Result;
+}
+
+void UPlayerSave::ClearDirty()
+{
+	DirtyProperties.Reset();
+
+	if (GetDirtyTrackingMode() == EGameSaveDirtyTracking::Snapshot)
+	{
+		FGameSaveSerializer::GetPropertyHashes(this, PropertySnapshot);
+	}
+	else
+	{
+		PropertySnapshot.Reset();
+	}
+}
@@ -3,10 +3,16 @@
 #include "PlayerSaveSubsystem.h"
 
 #include "PlayerSave/PlayerSave.h"
+#include "Format/GameSaveCheckpoint.h"
+#include "Format/GameSaveHeader.h"
+#include "Pipeline/GameSavePipeline.h"
+#include "Pipeline/GameSaveSlotRing.h"
+#include "Profiling/GameSaveTrace.h"
 #include "GameSaveDeveloperSettings.h"
 #include "GCSaveLogs.h"
 
 #include "Kismet/GameplayStatics.h"
+#include "HAL/PlatformTime.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(PlayerSaveSubsystem)
 
@@ -15,31 +21,69 @@ void UPlayerSaveSubsystem::Initialize(FSubsystemCollectionBase& Collection)
 {
 	Super::Initialize(Collection);
 
+	Pipeline = FGameSavePipeline::Create();
+
+	const auto MemoryAccountingInterval{ GetDefault<UGameSaveDeveloperSettings>()->MemoryAccountingInterval };
+
+	if (MemoryAccountingInterval > 0.0f)
+	{
+		MemoryTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::TickMemoryAccounting), MemoryAccountingInterval);
+	}
+
 	LoadInitialPlayerSaves();
 }
 
+void UPlayerSaveSubsystem::Deinitialize()
+{
+	if (PostLoadTickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(PostLoadTickerHandle);
+		PostLoadTickerHandle.Reset();
+	}
+
+	if (MemoryTickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(MemoryTickerHandle);
+		MemoryTickerHandle.Reset();
+	}
+
+	// Remove the memory of this subsystem from the stats
+
+	FGameSaveMemoryProfiler::ReplaceReport(MemoryReport, FGameSaveMemoryReport());
+
+	// Readers that keep a channel see that the saves are gone
+
+	for (const auto& KVP : SnapshotChannels)
+	{
+		KVP.Value->Reset();
+	}
+
+	PostLoadQueue.Reset();
+	Checkpoints.Reset();
+	SlotRings.Reset();
+	SnapshotChannels.Reset();
+
+	Super::Deinitialize();
+}
+
 void UPlayerSaveSubsystem::LoadInitialPlayerSaves()
 {
 	auto* DevSetting{ GetDefault<UGameSaveDeveloperSettings>() };
 
-	UE_LOG(LogGameCore_PlayerSave, Log, TEXT("UPlayerSaveSubsystem::LoadInitialPlayerSaves: Start auto loading global saves"));
+	UE_LOG(LogGameCore_PlayerSave, Log, TEXT("UPlayerSaveSubsystem::LoadInitialPlayerSaves: Start auto loading player saves"));
+
+	TArray<FPlayerSaveBatchEntry> SavesToLoad;
 
 	for (const auto& KVP : DevSetting->PlayerSaveToAutoLoad)
 	{
-		auto* PlayerSaveClass{ KVP.Key.TryLoadClass<UPlayerSave>() };
-		const auto SlotName{ KVP.Value };
-
-		// SKip if no valid slot name
+		auto& Entry{ SavesToLoad.AddDefaulted_GetRef() };
+		Entry.PlayerSaveClass = KVP.Key.TryLoadClass<UPlayerSave>();
+		Entry.SlotName = KVP.Value;
+	}
 
-		const auto SlotNameToUse{ ResolveSlotName(PlayerSaveClass, SlotName) };
-		if (SlotNameToUse.IsEmpty())
-		{
-			UE_LOG(LogGameCore_PlayerSave, Error, TEXT("UPlayerSaveSubsystem::LoadInitialPlayerSaves: No valid slot name"));
-			continue;
-		}
+	// Auto loaded saves are read and deserialized together
 
-		AsyncLoadPlayerSaveInternal(PlayerSaveClass, SlotNameToUse, GetLocalPlayer()->GetPlatformUserIndex(), FPlayerSaveEventDelegate());
-	}
+	AsyncLoadPlayerSaves(SavesToLoad, false, FPlayerSaveBatchEventDelegate());
 }
 
 
@@ -61,6 +105,13 @@ UPlayerSave* UPlayerSaveSubsystem::GetPlayerSave(TSubclassOf<UPlayerSave> Player
 		return FoundSave;
 	}
 
+	// If the post-load is queued, finish it now.
+
+	if (auto* QueuedSave{ FlushPostLoad(SlotNameToUse) })
+	{
+		return QueuedSave;
+	}
+
 	if (bShouldLoadIfNotLoaded)
 	{
 		return SyncLoadPlayerSave(PlayerSaveClass, SlotName, true);
@@ -88,16 +139,28 @@ UPlayerSave* UPlayerSaveSubsystem::SyncLoadPlayerSave(TSubclassOf<UPlayerSave> P
 		{
 			return FoundSave;
 		}
+
+		// If the post-load is queued, finish it now.
+
+		if (auto* QueuedSave{ FlushPostLoad(SlotNameToUse) })
+		{
+			return QueuedSave;
+		}
 	}
 
-	// If loading is allowed, try to load.
+	// Try to load, saves rejected by their header are not deserialized
 
-	if (UGameplayStatics::DoesSaveGameExist(SlotNameToUse, GetLocalPlayer()->GetPlatformUserIndex()))
+	const auto HeaderFilter
 	{
-		if (auto* LoadedSave{ UGameplayStatics::LoadGameFromSlot(SlotNameToUse, GetLocalPlayer()->GetPlatformUserIndex()) })
+		[PlayerSaveClass](const FString& SlotName, const FGameSaveHeader& Header)
 		{
-			return ProcessLoadedSave(LoadedSave, SlotNameToUse, PlayerSaveClass);
+			return Header.CanLoadAs<UPlayerSave>(PlayerSaveClass, SlotName);
 		}
+	};
+
+	if (auto* LoadedSave{ Pipeline->LoadGameFromSlot(SlotNameToUse, GetLocalPlayer()->GetPlatformUserIndex(), HeaderFilter) })
+	{
+		return ProcessLoadedSave(LoadedSave, SlotNameToUse, PlayerSaveClass);
 	}
 
 	// Create new
@@ -125,12 +188,165 @@ bool UPlayerSaveSubsystem::AsyncLoadPlayerSave(TSubclassOf<UPlayerSave> PlayerSa
 			Delegate.ExecuteIfBound(FoundSave, true);
 			return true;
 		}
+
+		// If the post-load is queued, report it once it has finished.
+
+		if (ChainPostLoad(SlotNameToUse, [Delegate](UPlayerSave* LoadedSave) { Delegate.ExecuteIfBound(LoadedSave, IsValid(LoadedSave)); }))
+		{
+			return true;
+		}
 	}
 
 	AsyncLoadPlayerSaveInternal(PlayerSaveClass, SlotNameToUse, GetLocalPlayer()->GetPlatformUserIndex(), Delegate);
 	return true;
 }
 
+bool UPlayerSaveSubsystem::AsyncLoadPlayerSaves(const TArray<FPlayerSaveBatchEntry>& SavesToLoad, bool bForceLoad, FPlayerSaveBatchEventDelegate Delegate)
+{
+	TArray<UPlayerSave*> LoadedSaves;
+	TArray<FString> SlotNamesToLoad;
+	TArray<TSubclassOf<UPlayerSave>> ClassesToLoad;
+	TArray<TArray<int32>> ResultIndices;
+	TArray<FString> QueuedSlotNames;
+	TArray<TArray<int32>> QueuedResultIndices;
+
+	for (const auto& Entry : SavesToLoad)
+	{
+		const auto ResultIndex{ LoadedSaves.Add(nullptr) };
+
+		// Skip if no valid slot name
+
+		const auto SlotNameToUse{ ResolveSlotName(Entry.PlayerSaveClass, Entry.SlotName) };
+		if (SlotNameToUse.IsEmpty())
+		{
+			UE_LOG(LogGameCore_PlayerSave, Error, TEXT("UPlayerSaveSubsystem::AsyncLoadPlayerSaves: No valid slot name"));
+			continue;
+		}
+
+		if (!bForceLoad)
+		{
+			// If already loaded, use it.
+
+			if (auto FoundSave{ ActiveSaves.FindRef(SlotNameToUse) })
+			{
+				LoadedSaves[ResultIndex] = FoundSave;
+				continue;
+			}
+
+			// If the post-load is queued, wait for it.
+
+			if (FindQueuedPostLoad(SlotNameToUse))
+			{
+				const auto QueuedIndex{ QueuedSlotNames.AddUnique(SlotNameToUse) };
+				QueuedResultIndices.SetNum(QueuedSlotNames.Num());
+				QueuedResultIndices[QueuedIndex].Add(ResultIndex);
+				continue;
+			}
+		}
+
+		// Entries that resolve to the same slot share one load
+
+		const auto SlotIndex{ SlotNamesToLoad.Find(SlotNameToUse) };
+
+		if (SlotIndex != INDEX_NONE)
+		{
+			ResultIndices[SlotIndex].Add(ResultIndex);
+			continue;
+		}
+
+		AddPendingLoad(SlotNameToUse);
+
+		SlotNamesToLoad.Add(SlotNameToUse);
+		ClassesToLoad.Add(Entry.PlayerSaveClass);
+		ResultIndices.Add({ ResultIndex });
+	}
+
+	if (SlotNamesToLoad.IsEmpty() && QueuedSlotNames.IsEmpty())
+	{
+		Delegate.ExecuteIfBound(LoadedSaves);
+		return true;
+	}
+
+	// The delegate is called once the post-load of every save has finished
+
+	auto Saves{ MakeShared<TArray<UPlayerSave*>>(MoveTemp(LoadedSaves)) };
+	auto NumRemaining{ MakeShared<int32>(SlotNamesToLoad.Num() + QueuedSlotNames.Num()) };
+
+	const auto MakePostLoadFunc
+	{
+		[Delegate, Saves, NumRemaining](const TArray<int32>& EntryIndices) -> FPlayerSavePostLoadFunc
+		{
+			return [Delegate, Saves, NumRemaining, EntryIndices](UPlayerSave* LoadedSave)
+				{
+					for (const auto EntryIndex : EntryIndices)
+					{
+						(*Saves)[EntryIndex] = LoadedSave;
+					}
+
+					if (--(*NumRemaining) == 0)
+					{
+						Delegate.ExecuteIfBound(*Saves);
+					}
+				};
+		}
+	};
+
+	// Saves whose post-load is already queued are reported once it has finished
+
+	for (int32 Index{ 0 }; Index < QueuedSlotNames.Num(); ++Index)
+	{
+		ChainPostLoad(QueuedSlotNames[Index], MakePostLoadFunc(QueuedResultIndices[Index]));
+	}
+
+	if (SlotNamesToLoad.IsEmpty())
+	{
+		return true;
+	}
+
+	auto Lambda
+	{
+		FAsyncLoadGamesFromSlotsDelegate::CreateWeakLambda(this,
+			[this, MakePostLoadFunc, ResultIndices, ClassesToLoad](const int32 UserIndex, const TArray<FGameSaveLoadedSlot>& Results)
+			{
+				for (int32 Index{ 0 }; Index < Results.Num(); ++Index)
+				{
+					const auto& Result{ Results[Index] };
+					const auto SlotName{ Result.SlotName };
+
+					this->ProcessLoadedSave(Result.SaveObject, SlotName, ClassesToLoad[Index],
+						[this, SlotName, OnPostLoaded = MakePostLoadFunc(ResultIndices[Index])](UPlayerSave* LoadedSave)
+						{
+							this->RemovePendingLoad(SlotName);
+
+							OnPostLoaded(LoadedSave);
+						}
+					);
+				}
+			}
+		)
+	};
+
+	// The filter may run on worker threads, so it keeps its own copy of the classes
+
+	TMap<FString, TSubclassOf<UPlayerSave>> ClassesBySlot;
+
+	for (int32 Index{ 0 }; Index < SlotNamesToLoad.Num(); ++Index)
+	{
+		ClassesBySlot.Add(SlotNamesToLoad[Index], ClassesToLoad[Index]);
+	}
+
+	auto HeaderFilter
+	{
+		[ClassesBySlot = MoveTemp(ClassesBySlot)](const FString& SlotName, const FGameSaveHeader& Header)
+		{
+			return Header.CanLoadAs<UPlayerSave>(ClassesBySlot.FindRef(SlotName), SlotName);
+		}
+	};
+
+	Pipeline->AsyncLoadGamesFromSlots(SlotNamesToLoad, GetLocalPlayer()->GetPlatformUserIndex(), Lambda, MoveTemp(HeaderFilter));
+	return true;
+}
+
 bool UPlayerSaveSubsystem::SyncSaveGameToSlot(TSubclassOf<UPlayerSave> PlayerSaveClass, const FString& SlotName)
 {
 	// Suspend if no valid slot name
@@ -146,24 +362,43 @@ bool UPlayerSaveSubsystem::SyncSaveGameToSlot(TSubclassOf<UPlayerSave> PlayerSav
 
 	if (auto FoundSave{ ActiveSaves.FindRef(SlotNameToUse) })
 	{
+		// Skip if nothing has changed since the last successful save
+
+		if (!FoundSave->IsDirty())
+		{
+			UE_LOG(LogGameCore_PlayerSave, Verbose, TEXT("Skipped saving clean game(%s) to slot(%s)"), *FoundSave->GetName(), *SlotNameToUse);
+			return true;
+		}
+
 		FoundSave->HandlePreSave();
 
-		const auto bSuccess{ UGameplayStatics::SaveGameToSlot(FoundSave, SlotNameToUse, GetLocalPlayer()->GetPlatformUserIndex()) };
+		const auto Snapshot{ CaptureSnapshot(SlotNameToUse, FoundSave) };
+
+		const auto bSuccess
+		{
+			Pipeline->SaveGameToSlot(
+				FoundSave, FoundSave->GetSavedDataVersion(), FoundSave->UseUnversionedSerialization(), SlotNameToUse, GetLocalPlayer()->GetPlatformUserIndex())
+		};
 
 		FoundSave->HandlePostSave(bSuccess);
 
+		if (bSuccess)
+		{
+			PublishSnapshot(SlotNameToUse, Snapshot);
+		}
+
 		return bSuccess;
 	}
 
 	return false;
 }
 
-bool UPlayerSaveSubsystem::AsyncSaveGameToSlot(TSubclassOf<UPlayerSave> PlayerSaveClass, const FString& SlotName)
+bool UPlayerSaveSubsystem::AsyncSaveGameToSlot(TSubclassOf<UPlayerSave> PlayerSaveClass, const FString& SlotName, EGameSaveIOPriority Priority)
 {
-	return AsyncSaveGameToSlot(PlayerSaveClass, SlotName, FPlayerSaveEventDelegate());
+	return AsyncSaveGameToSlot(PlayerSaveClass, SlotName, FPlayerSaveEventDelegate(), Priority);
 }
 
-bool UPlayerSaveSubsystem::AsyncSaveGameToSlot(TSubclassOf<UPlayerSave> PlayerSaveClass, const FString& SlotName, FPlayerSaveEventDelegate Delegate)
+bool UPlayerSaveSubsystem::AsyncSaveGameToSlot(TSubclassOf<UPlayerSave> PlayerSaveClass, const FString& SlotName, FPlayerSaveEventDelegate Delegate, EGameSaveIOPriority Priority)
 {
 	// Suspend if no valid slot name
 
@@ -178,7 +413,7 @@ bool UPlayerSaveSubsystem::AsyncSaveGameToSlot(TSubclassOf<UPlayerSave> PlayerSa
 
 	if (auto FoundSave{ ActiveSaves.FindRef(SlotNameToUse) })
 	{
-		AsyncSaveGameToSlotInternal(FoundSave, SlotNameToUse, GetLocalPlayer()->GetPlatformUserIndex(), Delegate);
+		AsyncSaveGameToSlotInternal(FoundSave, SlotNameToUse, GetLocalPlayer()->GetPlatformUserIndex(), Delegate, Priority);
 
 		return true;
 	}
@@ -214,52 +449,125 @@ bool UPlayerSaveSubsystem::ReleaseSave(TSubclassOf<UPlayerSave> PlayerSaveClass,
 	}
 
 	ActiveSaves.Remove(SlotNameToUse);
+	Checkpoints.Remove(SlotNameToUse);
 
 	return true;
 }
 
+bool UPlayerSaveSubsystem::DeleteSave(TSubclassOf<UPlayerSave> PlayerSaveClass, const FString& SlotName)
+{
+	// Suspend if no valid slot name
+
+	const auto SlotNameToUse{ ResolveSlotName(PlayerSaveClass, SlotName) };
+	if (SlotNameToUse.IsEmpty())
+	{
+		UE_LOG(LogGameCore_PlayerSave, Error, TEXT("UPlayerSaveSubsystem::DeleteSave: No valid slot name"));
+		return false;
+	}
+
+	ActiveSaves.Remove(SlotNameToUse);
+	Checkpoints.Remove(SlotNameToUse);
+
+	if (const auto* Channel{ SnapshotChannels.Find(SlotNameToUse) })
+	{
+		(*Channel)->Reset();
+	}
+
+	return Pipeline->DeleteGameInSlot(SlotNameToUse, GetLocalPlayer()->GetPlatformUserIndex());
+}
+
+TArray<FString> UPlayerSaveSubsystem::GetSavedSlotNames() const
+{
+	TArray<FString> SlotNames;
+	Pipeline->GetSaveGameNames(GetLocalPlayer()->GetPlatformUserIndex(), SlotNames);
+
+	return SlotNames;
+}
+
+void UPlayerSaveSubsystem::PrefetchSlots(const TArray<FString>& SlotNames)
+{
+	TArray<FString> SlotNamesToPrefetch;
+
+	for (const auto& SlotName : SlotNames)
+	{
+		if (!SlotName.IsEmpty() && !ActiveSaves.Contains(SlotName))
+		{
+			SlotNamesToPrefetch.Add(SlotName);
+		}
+	}
+
+	Pipeline->PrefetchSlots(SlotNamesToPrefetch, GetLocalPlayer()->GetPlatformUserIndex());
+}
+
 
 void UPlayerSaveSubsystem::AsyncLoadPlayerSaveInternal(TSubclassOf<UPlayerSave> PlayerSaveClass, const FString& SlotName, int32 Slot, FPlayerSaveEventDelegate Delegate)
 {
-	if (UGameplayStatics::DoesSaveGameExist(SlotName, Slot))
+	AddPendingLoad(SlotName);
+
+	auto Lambda
 	{
-		AddPendingLoad(SlotName);
+		FAsyncLoadGameFromSlotDelegate::CreateWeakLambda(this,
+			[this, PlayerSaveClass, Delegate](const FString& SlotName, const int32 Slot, USaveGame* BaseSave)
+			{
+				// The save is reported once its post-load has finished
 
-		auto Lambda
-		{
-			FAsyncLoadGameFromSlotDelegate::CreateWeakLambda(this,
-				[this, PlayerSaveClass, Delegate](const FString& SlotName, const int32 Slot, USaveGame* BaseSave)
-				{
-					auto* LoadedSave{ this->ProcessLoadedSave(BaseSave, SlotName, PlayerSaveClass) };
+				this->ProcessLoadedSave(BaseSave, SlotName, PlayerSaveClass,
+					[this, Delegate, SlotName](UPlayerSave* LoadedSave)
+					{
+						this->RemovePendingLoad(SlotName);
 
-					this->RemovePendingLoad(SlotName);
+						Delegate.ExecuteIfBound(LoadedSave, IsValid(LoadedSave));
+					}
+				);
+			}
+		)
+	};
 
-					Delegate.ExecuteIfBound(LoadedSave, IsValid(LoadedSave));
-				}
-			)
-		};
+	// Saves rejected by their header are not deserialized and replaced by a new save
 
-		UGameplayStatics::AsyncLoadGameFromSlot(SlotName, Slot, Lambda);
-	}
-	else
+	auto HeaderFilter
 	{
-		Delegate.ExecuteIfBound(CreateNewSaveObject(PlayerSaveClass, SlotName), true);
-	}
+		[PlayerSaveClass](const FString& SlotName, const FGameSaveHeader& Header)
+		{
+			return Header.CanLoadAs<UPlayerSave>(PlayerSaveClass, SlotName);
+		}
+	};
+
+	Pipeline->AsyncLoadGameFromSlot(SlotName, Slot, Lambda, MoveTemp(HeaderFilter));
 }
 
-void UPlayerSaveSubsystem::AsyncSaveGameToSlotInternal(UPlayerSave* SaveObject, const FString& SlotName, int32 Slot, FPlayerSaveEventDelegate Delegate)
+void UPlayerSaveSubsystem::AsyncSaveGameToSlotInternal(UPlayerSave* SaveObject, const FString& SlotName, int32 Slot, FPlayerSaveEventDelegate Delegate, EGameSaveIOPriority Priority)
 {
+	// Complete immediately if nothing has changed since the last successful save
+
+	if (!SaveObject->IsDirty())
+	{
+		UE_LOG(LogGameCore_PlayerSave, Verbose, TEXT("Skipped saving clean game(%s) to slot(%s)"), *SaveObject->GetName(), *SlotName);
+
+		Delegate.ExecuteIfBound(SaveObject, true);
+		return;
+	}
+
 	AddPendingSave(SlotName);
 
 	SaveObject->HandlePreSave();
 
+	// The snapshot is taken now because the data is serialized now, but only published once it has been written
+
+	const auto Snapshot{ CaptureSnapshot(SlotName, SaveObject) };
+
 	auto SavedDelegate
 	{
 		FAsyncSaveGameToSlotDelegate::CreateWeakLambda(this,
-			[this, SaveObject, Delegate](const FString& SlotName, const int32 UserIndex, bool bSuccess)
+			[this, SaveObject, Delegate, Snapshot](const FString& SlotName, const int32 UserIndex, bool bSuccess)
 			{
 				SaveObject->HandlePostSave(bSuccess);
 
+				if (bSuccess)
+				{
+					this->PublishSnapshot(SlotName, Snapshot);
+				}
+
 				Delegate.ExecuteIfBound(SaveObject, bSuccess);
 
 				this->RemovePendingSave(SlotName);
@@ -267,7 +575,8 @@ void UPlayerSaveSubsystem::AsyncSaveGameToSlotInternal(UPlayerSave* SaveObject,
 		)
 	};
 
-	UGameplayStatics::AsyncSaveGameToSlot(SaveObject, SlotName, Slot, SavedDelegate);
+	Pipeline->AsyncSaveGameToSlot(
+		SaveObject, SaveObject->GetSavedDataVersion(), SaveObject->UseUnversionedSerialization(), SlotName, Slot, SavedDelegate, Priority);
 }
 
 
@@ -276,9 +585,15 @@ void UPlayerSaveSubsystem::HandlePlayerSaveLoaded(const FString& Slotname, UPlay
 	SaveObject->InitializeSaveGame(GetLocalPlayer(), Slotname);
 
 	ActiveSaves.Emplace(Slotname, SaveObject);
+
+	// A queued post-load of the slot is older than this save and must not replace it later
+
+	SupersedePostLoad(Slotname, SaveObject);
+
+	PublishSnapshot(Slotname, CaptureSnapshot(Slotname, SaveObject));
 }
 
-UPlayerSave* UPlayerSaveSubsystem::ProcessLoadedSave(USaveGame* BaseSave, const FString& SlotName, TSubclassOf<UPlayerSave> SaveGameClass)
+UPlayerSave* UPlayerSaveSubsystem::ProcessLoadedSave(USaveGame* BaseSave, const FString& SlotName, TSubclassOf<UPlayerSave> SaveGameClass, FPlayerSavePostLoadFunc OnPostLoaded)
 {
 	auto* LoadedSave{ Cast<UPlayerSave>(BaseSave) };
 
@@ -291,6 +606,15 @@ UPlayerSave* UPlayerSaveSubsystem::ProcessLoadedSave(USaveGame* BaseSave, const
 	if (!LoadedSave)
 	{
 		LoadedSave = CreateNewSaveObject(SaveGameClass, SlotName);
+
+		if (OnPostLoaded)
+		{
+			OnPostLoaded(LoadedSave);
+		}
+	}
+	else if (OnPostLoaded)
+	{
+		QueuePostLoad(LoadedSave, SlotName, MoveTemp(OnPostLoaded));
 	}
 	else
 	{
@@ -330,6 +654,621 @@ FString UPlayerSaveSubsystem::ResolveSlotName(TSubclassOf<UPlayerSave> PlayerSav
 }
 
 
+void UPlayerSaveSubsystem::QueuePostLoad(UPlayerSave* SaveObject, const FString& SlotName, FPlayerSavePostLoadFunc OnPostLoaded)
+{
+	// A newer load of the slot replaces the queued save, whose callbacks receive the newer save instead
+
+	if (auto* QueuedEntry{ FindQueuedPostLoad(SlotName) })
+	{
+		QueuedEntry->SaveObject = SaveObject;
+		ChainPostLoad(SlotName, MoveTemp(OnPostLoaded));
+		return;
+	}
+
+	auto& Entry{ PostLoadQueue.AddDefaulted_GetRef() };
+	Entry.SaveObject = SaveObject;
+	Entry.SlotName = SlotName;
+	Entry.OnPostLoaded = MoveTemp(OnPostLoaded);
+
+	if (!PostLoadTickerHandle.IsValid())
+	{
+		PostLoadTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::TickPostLoadQueue));
+	}
+}
+
+FPlayerSavePostLoadEntry* UPlayerSaveSubsystem::FindQueuedPostLoad(const FString& SlotName)
+{
+	return PostLoadQueue.FindByPredicate([&SlotName](const FPlayerSavePostLoadEntry& Entry) { return Entry.SlotName == SlotName; });
+}
+
+bool UPlayerSaveSubsystem::ChainPostLoad(const FString& SlotName, FPlayerSavePostLoadFunc OnPostLoaded)
+{
+	auto* QueuedEntry{ FindQueuedPostLoad(SlotName) };
+
+	if (!QueuedEntry)
+	{
+		return false;
+	}
+
+	if (OnPostLoaded)
+	{
+		QueuedEntry->OnPostLoaded =
+			[Previous = MoveTemp(QueuedEntry->OnPostLoaded), Next = MoveTemp(OnPostLoaded)](UPlayerSave* LoadedSave)
+			{
+				if (Previous)
+				{
+					Previous(LoadedSave);
+				}
+
+				Next(LoadedSave);
+			};
+	}
+
+	return true;
+}
+
+void UPlayerSaveSubsystem::SupersedePostLoad(const FString& SlotName, UPlayerSave* SaveObject)
+{
+	const auto Index{ PostLoadQueue.IndexOfByPredicate([&SlotName](const FPlayerSavePostLoadEntry& Entry) { return Entry.SlotName == SlotName; }) };
+
+	if (Index == INDEX_NONE)
+	{
+		return;
+	}
+
+	const auto Entry{ PostLoadQueue[Index] };
+	PostLoadQueue.RemoveAt(Index);
+
+	UE_LOG(LogGameCore_PlayerSave, Verbose, TEXT("UPlayerSaveSubsystem::SupersedePostLoad: Dropped queued save(%s) of slot(%s) for save(%s)"),
+		*GetNameSafe(Entry.SaveObject), *SlotName, *GetNameSafe(SaveObject));
+
+	if (Entry.OnPostLoaded)
+	{
+		Entry.OnPostLoaded(SaveObject);
+	}
+}
+
+UPlayerSave* UPlayerSaveSubsystem::FlushPostLoad(const FString& SlotName)
+{
+	const auto Index{ PostLoadQueue.IndexOfByPredicate([&SlotName](const FPlayerSavePostLoadEntry& Entry) { return Entry.SlotName == SlotName; }) };
+
+	if (Index == INDEX_NONE)
+	{
+		return nullptr;
+	}
+
+	const auto Entry{ PostLoadQueue[Index] };
+	PostLoadQueue.RemoveAt(Index);
+
+	RunPostLoad(Entry);
+
+	return Entry.SaveObject;
+}
+
+bool UPlayerSaveSubsystem::TickPostLoadQueue(float DeltaTime)
+{
+	const auto BudgetSeconds{ GetDefault<UGameSaveDeveloperSettings>()->PostLoadBudgetMs / 1000.0 };
+	const auto StartTime{ FPlatformTime::Seconds() };
+
+	// At least one save is processed each frame so that the queue always progresses
+
+	while (PostLoadQueue.Num() > 0)
+	{
+		const auto Entry{ PostLoadQueue[0] };
+		PostLoadQueue.RemoveAt(0);
+
+		RunPostLoad(Entry);
+
+		if ((BudgetSeconds > 0.0) && (FPlatformTime::Seconds() - StartTime >= BudgetSeconds))
+		{
+			break;
+		}
+	}
+
+	if (PostLoadQueue.Num() > 0)
+	{
+		return true;
+	}
+
+	PostLoadTickerHandle.Reset();
+	return false;
+}
+
+void UPlayerSaveSubsystem::RunPostLoad(const FPlayerSavePostLoadEntry& Entry)
+{
+	if (!Entry.SaveObject)
+	{
+		return;
+	}
+
+	HandlePlayerSaveLoaded(Entry.SlotName, Entry.SaveObject);
+
+	if (Entry.OnPostLoaded)
+	{
+		Entry.OnPostLoaded(Entry.SaveObject);
+	}
+}
+
+
+bool UPlayerSaveSubsystem::CaptureCheckpoint(TSubclassOf<UPlayerSave> PlayerSaveClass, const FString& SlotName, FName CheckpointName)
+{
+	// Suspend if no valid slot name
+
+	const auto SlotNameToUse{ ResolveSlotName(PlayerSaveClass, SlotName) };
+	if (SlotNameToUse.IsEmpty())
+	{
+		UE_LOG(LogGameCore_PlayerSave, Error, TEXT("UPlayerSaveSubsystem::CaptureCheckpoint: No valid slot name"));
+		return false;
+	}
+
+	// Suspend if the save is not loaded
+
+	UPlayerSave* SaveObject{ ActiveSaves.FindRef(SlotNameToUse) };
+	if (!SaveObject)
+	{
+		SaveObject = FlushPostLoad(SlotNameToUse);
+	}
+
+	if (!SaveObject)
+	{
+		UE_LOG(LogGameCore_PlayerSave, Warning, TEXT("UPlayerSaveSubsystem::CaptureCheckpoint: Save in slot(%s) is not loaded"), *SlotNameToUse);
+		return false;
+	}
+
+	// Capture against the latest checkpoint so that unchanged data is shared
+
+	auto& SlotCheckpoints{ Checkpoints.FindOrAdd(SlotNameToUse) };
+	const auto* Previous{ SlotCheckpoints.IsEmpty() ? nullptr : &SlotCheckpoints.Last().Get() };
+
+	auto Checkpoint{ FGameSaveCheckpoint::Capture(SaveObject, CheckpointName, Previous) };
+
+	SlotCheckpoints.RemoveAll([CheckpointName](const TSharedRef<const FGameSaveCheckpoint>& Existing) { return Existing->GetName() == CheckpointName; });
+	SlotCheckpoints.Add(Checkpoint);
+
+	// Drop the oldest checkpoints over the limit, data they share with newer checkpoints is kept
+
+	const auto MaxCheckpoints{ GetDefault<UGameSaveDeveloperSettings>()->MaxCheckpointsPerSlot };
+
+	if ((MaxCheckpoints > 0) && (SlotCheckpoints.Num() > MaxCheckpoints))
+	{
+		const auto NumToDrop{ SlotCheckpoints.Num() - MaxCheckpoints };
+
+		UE_LOG(LogGameCore_PlayerSave, Verbose, TEXT("UPlayerSaveSubsystem::CaptureCheckpoint: Dropped %d oldest checkpoints of slot(%s) over the limit of %d"), NumToDrop, *SlotNameToUse, MaxCheckpoints);
+
+		SlotCheckpoints.RemoveAt(0, NumToDrop);
+	}
+
+	UE_LOG(LogGameCore_PlayerSave, Verbose, TEXT("UPlayerSaveSubsystem::CaptureCheckpoint: Captured checkpoint(%s) of slot(%s) with %lld new bytes of %lld"),
+		*CheckpointName.ToString(), *SlotNameToUse, Checkpoint->GetUniqueBytes(), Checkpoint->GetTotalBytes());
+
+	return true;
+}
+
+bool UPlayerSaveSubsystem::RestoreCheckpoint(TSubclassOf<UPlayerSave> PlayerSaveClass, const FString& SlotName, FName CheckpointName)
+{
+	// Suspend if no valid slot name
+
+	const auto SlotNameToUse{ ResolveSlotName(PlayerSaveClass, SlotName) };
+	if (SlotNameToUse.IsEmpty())
+	{
+		UE_LOG(LogGameCore_PlayerSave, Error, TEXT("UPlayerSaveSubsystem::RestoreCheckpoint: No valid slot name"));
+		return false;
+	}
+
+	// Suspend if no checkpoint found
+
+	const auto* SlotCheckpoints{ Checkpoints.Find(SlotNameToUse) };
+	const TSharedRef<const FGameSaveCheckpoint>* Checkpoint{ nullptr };
+
+	if (SlotCheckpoints && !SlotCheckpoints->IsEmpty())
+	{
+		Checkpoint = CheckpointName.IsNone() ? &SlotCheckpoints->Last()
+			: SlotCheckpoints->FindByPredicate([CheckpointName](const TSharedRef<const FGameSaveCheckpoint>& Existing) { return Existing->GetName() == CheckpointName; });
+	}
+
+	if (!Checkpoint)
+	{
+		UE_LOG(LogGameCore_PlayerSave, Warning, TEXT("UPlayerSaveSubsystem::RestoreCheckpoint: No checkpoint(%s) of slot(%s)"), *CheckpointName.ToString(), *SlotNameToUse);
+		return false;
+	}
+
+	// Suspend if the save is not loaded
+
+	UPlayerSave* SaveObject{ ActiveSaves.FindRef(SlotNameToUse) };
+	if (!SaveObject)
+	{
+		SaveObject = FlushPostLoad(SlotNameToUse);
+	}
+
+	if (!SaveObject)
+	{
+		UE_LOG(LogGameCore_PlayerSave, Warning, TEXT("UPlayerSaveSubsystem::RestoreCheckpoint: Save in slot(%s) is not loaded"), *SlotNameToUse);
+		return false;
+	}
+
+	// Restore in place and mark the restored properties for the next save
+
+	TArray<FName> ChangedProperties;
+	const auto bSuccess{ (*Checkpoint)->Restore(SaveObject, &ChangedProperties) };
+
+	for (const auto& PropertyName : ChangedProperties)
+	{
+		SaveObject->MarkDirty(PropertyName);
+	}
+
+	if (bSuccess)
+	{
+		SaveObject->HandlePostRestoreCheckpoint((*Checkpoint)->GetName());
+	}
+
+	return bSuccess;
+}
+
+void UPlayerSaveSubsystem::DiscardCheckpoint(TSubclassOf<UPlayerSave> PlayerSaveClass, const FString& SlotName, FName CheckpointName)
+{
+	const auto SlotNameToUse{ ResolveSlotName(PlayerSaveClass, SlotName) };
+
+	if (CheckpointName.IsNone())
+	{
+		Checkpoints.Remove(SlotNameToUse);
+	}
+	else if (auto* SlotCheckpoints{ Checkpoints.Find(SlotNameToUse) })
+	{
+		SlotCheckpoints->RemoveAll([CheckpointName](const TSharedRef<const FGameSaveCheckpoint>& Existing) { return Existing->GetName() == CheckpointName; });
+	}
+}
+
+TArray<FName> UPlayerSaveSubsystem::GetCheckpointNames(TSubclassOf<UPlayerSave> PlayerSaveClass, const FString& SlotName) const
+{
+	TArray<FName> Names;
+
+	if (const auto* SlotCheckpoints{ Checkpoints.Find(ResolveSlotName(PlayerSaveClass, SlotName)) })
+	{
+		for (const auto& Checkpoint : *SlotCheckpoints)
+		{
+			Names.Add(Checkpoint->GetName());
+		}
+	}
+
+	return Names;
+}
+
+int64 UPlayerSaveSubsystem::GetCheckpointMemorySize() const
+{
+	TSet<const void*> CountedBuffers;
+	int64 Total{ 0 };
+
+	for (const auto& KVP : Checkpoints)
+	{
+		for (const auto& Checkpoint : KVP.Value)
+		{
+			Total += Checkpoint->AccumulateBytes(CountedBuffers);
+		}
+	}
+
+	return Total;
+}
+
+
+FGameSaveSnapshotChannelRef UPlayerSaveSubsystem::GetSnapshotChannel(TSubclassOf<UPlayerSave> PlayerSaveClass, const FString& SlotName)
+{
+	// Suspend if no valid slot name
+
+	const auto SlotNameToUse{ ResolveSlotName(PlayerSaveClass, SlotName) };
+	if (SlotNameToUse.IsEmpty())
+	{
+		UE_LOG(LogGameCore_PlayerSave, Error, TEXT("UPlayerSaveSubsystem::GetSnapshotChannel: No valid slot name"));
+		return MakeShared<FGameSaveSnapshotChannel, ESPMode::ThreadSafe>();
+	}
+
+	if (const auto* FoundChannel{ SnapshotChannels.Find(SlotNameToUse) })
+	{
+		return *FoundChannel;
+	}
+
+	auto Channel{ SnapshotChannels.Add(SlotNameToUse, MakeShared<FGameSaveSnapshotChannel, ESPMode::ThreadSafe>()) };
+
+	// Publish the loaded data right away so that readers do not wait for the next save
+
+	if (const auto* FoundSave{ ActiveSaves.FindRef(SlotNameToUse).Get() })
+	{
+		Channel->Publish(FGameSaveSnapshot::Capture(FoundSave, SlotNameToUse));
+	}
+
+	return Channel;
+}
+
+TSharedPtr<FGameSaveSnapshot, ESPMode::ThreadSafe> UPlayerSaveSubsystem::CaptureSnapshot(const FString& SlotName, const UPlayerSave* SaveObject) const
+{
+	if (SaveObject && SnapshotChannels.Contains(SlotName))
+	{
+		return FGameSaveSnapshot::Capture(SaveObject, SlotName);
+	}
+
+	return nullptr;
+}
+
+void UPlayerSaveSubsystem::PublishSnapshot(const FString& SlotName, const TSharedPtr<FGameSaveSnapshot, ESPMode::ThreadSafe>& Snapshot)
+{
+	const auto* Channel{ SnapshotChannels.Find(SlotName) };
+
+	if (Channel && Snapshot.IsValid())
+	{
+		(*Channel)->Publish(Snapshot.ToSharedRef());
+	}
+}
+
+
+bool UPlayerSaveSubsystem::SyncLoadBlob(FGameSaveBlob& Blob)
+{
+	if (Blob.IsLoaded())
+	{
+		return true;
+	}
+
+	FGameSaveBlobDataPtr Data;
+
+	return Pipeline->LoadBlob(Blob.GetHash(), GetLocalPlayer()->GetPlatformUserIndex(), Data) && Blob.SetLoadedData(Data);
+}
+
+void UPlayerSaveSubsystem::AsyncLoadBlob(const FGameSaveBlob& Blob, FGameSaveBlobLoadedDelegate Delegate)
+{
+	if (Blob.IsLoaded())
+	{
+		Delegate.ExecuteIfBound(true, Blob.GetData());
+		return;
+	}
+
+	Pipeline->AsyncLoadBlob(Blob.GetHash(), GetLocalPlayer()->GetPlatformUserIndex(), Delegate);
+}
+
+
+void UPlayerSaveSubsystem::StartTraceRecording()
+{
+	Pipeline->SetTraceRecorder(MakeShared<FGameSaveTraceRecorder, ESPMode::ThreadSafe>());
+
+	UE_LOG(LogGameCore_PlayerSave, Log, TEXT("Started recording a trace of the player save traffic"));
+}
+
+bool UPlayerSaveSubsystem::StopTraceRecording(const FString& Filename)
+{
+	const auto Recorder{ Pipeline->GetTraceRecorder() };
+
+	if (!Recorder.IsValid())
+	{
+		UE_LOG(LogGameCore_PlayerSave, Warning, TEXT("UPlayerSaveSubsystem::StopTraceRecording: No trace is being recorded"));
+		return false;
+	}
+
+	Pipeline->SetTraceRecorder(nullptr);
+
+	const auto Trace{ Recorder->GetTrace() };
+
+	if (!Trace.SaveToFile(Filename))
+	{
+		UE_LOG(LogGameCore_PlayerSave, Error, TEXT("UPlayerSaveSubsystem::StopTraceRecording: Failed to write trace file(%s)"), *FGameSaveTrace::ResolveFilename(Filename));
+		return false;
+	}
+
+	UE_LOG(LogGameCore_PlayerSave, Log, TEXT("Wrote trace of %d operations to file(%s)"), Trace.Events.Num(), *FGameSaveTrace::ResolveFilename(Filename));
+
+	return true;
+}
+
+bool UPlayerSaveSubsystem::IsRecordingTrace() const
+{
+	return Pipeline->GetTraceRecorder().IsValid();
+}
+
+
+void UPlayerSaveSubsystem::ConfigureSlotRing(const FString& RingName, int32 NumSlots)
+{
+	if (RingName.IsEmpty())
+	{
+		UE_LOG(LogGameCore_PlayerSave, Error, TEXT("UPlayerSaveSubsystem::ConfigureSlotRing: No valid ring name"));
+		return;
+	}
+
+	FindOrCreateSlotRing(RingName)->SetNumSlots(NumSlots);
+}
+
+bool UPlayerSaveSubsystem::AsyncSaveToSlotRing(TSubclassOf<UPlayerSave> PlayerSaveClass, const FString& SlotName, const FString& RingName, EGameSaveIOPriority Priority)
+{
+	return AsyncSaveToSlotRing(PlayerSaveClass, SlotName, RingName, FPlayerSaveEventDelegate(), Priority);
+}
+
+bool UPlayerSaveSubsystem::AsyncSaveToSlotRing(TSubclassOf<UPlayerSave> PlayerSaveClass, const FString& SlotName, const FString& RingName, FPlayerSaveEventDelegate Delegate, EGameSaveIOPriority Priority)
+{
+	// Suspend if no valid slot name
+
+	const auto SlotNameToUse{ ResolveSlotName(PlayerSaveClass, SlotName) };
+	if (SlotNameToUse.IsEmpty() || RingName.IsEmpty())
+	{
+		UE_LOG(LogGameCore_PlayerSave, Error, TEXT("UPlayerSaveSubsystem::AsyncSaveToSlotRing: No valid slot name or ring name"));
+		return false;
+	}
+
+	// Suspend if the save is not loaded
+
+	UPlayerSave* SaveObject{ ActiveSaves.FindRef(SlotNameToUse) };
+	if (!SaveObject)
+	{
+		return false;
+	}
+
+	// Wait for the index of the ring on a worker thread instead of blocking the game thread in BeginWrite
+
+	auto Ring{ FindOrCreateSlotRing(RingName) };
+
+	if (!Ring->IsIndexRead())
+	{
+		Ring->CallWhenIndexRead(
+			[WeakThis = TWeakObjectPtr<ThisClass>(this), PlayerSaveClass, SlotName, RingName, Delegate, Priority]()
+			{
+				if (auto* This{ WeakThis.Get() })
+				{
+					This->AsyncSaveToSlotRing(PlayerSaveClass, SlotName, RingName, Delegate, Priority);
+				}
+			}
+		);
+
+		return true;
+	}
+
+	// Write to the next slot, the ring records the result and prunes old slots in the background
+
+	const auto RingSlotName{ Ring->BeginWrite() };
+
+	AddPendingSave(RingSlotName);
+
+	// The copy does not change the dirty state of the save, so the slot of the save is still written when it changes
+
+	SaveObject->HandlePreCopySave(RingSlotName);
+
+	const auto Snapshot{ CaptureSnapshot(SlotNameToUse, SaveObject) };
+
+	auto SavedDelegate
+	{
+		FAsyncSaveGameToSlotDelegate::CreateWeakLambda(this,
+			[this, SaveObject, Delegate, Ring, Snapshot, SlotNameToUse](const FString& SlotName, const int32 UserIndex, bool bSuccess)
+			{
+				Ring->EndWrite(SlotName, bSuccess);
+
+				SaveObject->HandlePostCopySave(SlotName, bSuccess);
+
+				if (bSuccess)
+				{
+					this->PublishSnapshot(SlotNameToUse, Snapshot);
+				}
+
+				Delegate.ExecuteIfBound(SaveObject, bSuccess);
+
+				this->RemovePendingSave(SlotName);
+			}
+		)
+	};
+
+	Pipeline->AsyncSaveGameToSlot(
+		SaveObject, SaveObject->GetLatestDataVersion(), SaveObject->UseUnversionedSerialization(), RingSlotName, GetLocalPlayer()->GetPlatformUserIndex(), SavedDelegate, Priority);
+
+	return true;
+}
+
+bool UPlayerSaveSubsystem::AsyncLoadLatestFromSlotRing(TSubclassOf<UPlayerSave> PlayerSaveClass, const FString& RingName, bool bForceLoad, FPlayerSaveEventDelegate Delegate)
+{
+	// Suspend if no valid ring name
+
+	if (RingName.IsEmpty())
+	{
+		UE_LOG(LogGameCore_PlayerSave, Error, TEXT("UPlayerSaveSubsystem::AsyncLoadLatestFromSlotRing: No valid ring name"));
+		return false;
+	}
+
+	// The index is read and the slots are checked on a worker thread
+
+	FindOrCreateSlotRing(RingName)->AsyncGetLatestValidSlot(
+		[WeakThis = TWeakObjectPtr<ThisClass>(this), PlayerSaveClass, RingName, bForceLoad, Delegate](const FString& RingSlotName)
+		{
+			auto* This{ WeakThis.Get() };
+			if (!This)
+			{
+				return;
+			}
+
+			if (RingSlotName.IsEmpty())
+			{
+				UE_LOG(LogGameCore_PlayerSave, Warning, TEXT("UPlayerSaveSubsystem::AsyncLoadLatestFromSlotRing: Ring(%s) has no valid slot"), *RingName);
+
+				Delegate.ExecuteIfBound(nullptr, false);
+				return;
+			}
+
+			if (!bForceLoad)
+			{
+				// If already loaded, return it.
+
+				if (auto FoundSave{ This->ActiveSaves.FindRef(RingSlotName) })
+				{
+					Delegate.ExecuteIfBound(FoundSave, true);
+					return;
+				}
+
+				// If the post-load is queued, report it once it has finished.
+
+				if (This->ChainPostLoad(RingSlotName, [Delegate](UPlayerSave* LoadedSave) { Delegate.ExecuteIfBound(LoadedSave, IsValid(LoadedSave)); }))
+				{
+					return;
+				}
+			}
+
+			This->AsyncLoadPlayerSaveInternal(PlayerSaveClass, RingSlotName, This->GetLocalPlayer()->GetPlatformUserIndex(), Delegate);
+		}
+	);
+
+	return true;
+}
+
+FString UPlayerSaveSubsystem::GetLatestSlotInRing(const FString& RingName)
+{
+	FString RingSlotName;
+
+	if (!RingName.IsEmpty())
+	{
+		FindOrCreateSlotRing(RingName)->GetLatestValidSlot(RingSlotName);
+	}
+
+	return RingSlotName;
+}
+
+TSharedRef<FGameSaveSlotRing> UPlayerSaveSubsystem::FindOrCreateSlotRing(const FString& RingName)
+{
+	if (const auto* FoundRing{ SlotRings.Find(RingName) })
+	{
+		return *FoundRing;
+	}
+
+	const auto NumSlots{ GetDefault<UGameSaveDeveloperSettings>()->SlotRingSize };
+
+	return SlotRings.Add(RingName, FGameSaveSlotRing::Create(Pipeline.ToSharedRef(), RingName, GetLocalPlayer()->GetPlatformUserIndex(), NumSlots));
+}
+
+
+FGameSaveMemoryReport UPlayerSaveSubsystem::GetMemoryReport() const
+{
+	FGameSaveMemoryReport Report;
+	Report.Name = FString::Printf(TEXT("PlayerSave(%d)"), GetLocalPlayer()->GetPlatformUserIndex());
+
+	for (const auto& KVP : ActiveSaves)
+	{
+		Report.AddSave(KVP.Key, KVP.Value);
+	}
+
+	// Saves waiting for their post-load are not active yet but already resident
+
+	for (const auto& Entry : PostLoadQueue)
+	{
+		Report.AddSave(Entry.SlotName, Entry.SaveObject);
+	}
+
+	if (Pipeline.IsValid())
+	{
+		Report.InFlightBytes = Pipeline->GetInFlightBytes();
+		Report.CachedBytes = Pipeline->GetCachedBytes();
+	}
+
+	Report.CheckpointBytes = GetCheckpointMemorySize();
+
+	return Report;
+}
+
+bool UPlayerSaveSubsystem::TickMemoryAccounting(float DeltaTime)
+{
+	FGameSaveMemoryProfiler::ReplaceReport(MemoryReport, GetMemoryReport());
+
+	return true;
+}
+
+
 void UPlayerSaveSubsystem::AddPendingLoad(const FString& Slotname)
 {
 	UE_LOG(LogGameCore_PlayerSave, Log, TEXT("Start loading slot(%s)"), *Slotname);
@@ -0,0 +1,224 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "GameSaveMemoryProfiler.h"
+
+#include "GlobalSave/GlobalSaveSubsystem.h"
+#include "PlayerSave/PlayerSaveSubsystem.h"
+#include "GameSaveDeveloperSettings.h"
+#include "GCSaveLogs.h"
+
+#include "Engine/GameInstance.h"
+#include "Engine/LocalPlayer.h"
+#include "Engine/World.h"
+#include "GameFramework/SaveGame.h"
+#include "HAL/IConsoleManager.h"
+#include "Serialization/ArchiveCountMem.h"
+#include "Stats/Stats.h"
+
+
+DECLARE_STATS_GROUP(TEXT("GameSave"), STATGROUP_GameSave, STATCAT_Advanced);
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Loaded Saves"), STAT_GameSave_NumActiveSaves, STATGROUP_GameSave);
+DECLARE_MEMORY_STAT(TEXT("Loaded Saves Memory"), STAT_GameSave_ActiveSaveMemory, STATGROUP_GameSave);
+DECLARE_MEMORY_STAT(TEXT("In-Flight Buffers"), STAT_GameSave_InFlightMemory, STATGROUP_GameSave);
+DECLARE_MEMORY_STAT(TEXT("Prefetch Cache"), STAT_GameSave_CachedMemory, STATGROUP_GameSave);
+DECLARE_MEMORY_STAT(TEXT("Checkpoints"), STAT_GameSave_CheckpointMemory, STATGROUP_GameSave);
+
+
+namespace GameSaveMemoryProfiler
+{
+	/**
+	 * Sum of the latest reports of all save subsystems, only accessed on the game thread
+	 */
+	struct FTotals
+	{
+	public:
+		int32 NumActiveSaves{ 0 };
+		int64 ActiveSaveBytes{ 0 };
+		int64 InFlightBytes{ 0 };
+		int64 CachedBytes{ 0 };
+		int64 CheckpointBytes{ 0 };
+
+	public:
+		int64 GetTotalBytes() const { return ActiveSaveBytes + InFlightBytes + CachedBytes + CheckpointBytes; }
+	};
+
+	static FTotals Totals;
+
+
+#if !UE_BUILD_SHIPPING
+	static void HandleMemoryCommand(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		const auto* GameInstance{ World ? World->GetGameInstance() : nullptr };
+		if (!GameInstance)
+		{
+			Ar.Log(TEXT("GameSave.Memory: No game instance"));
+			return;
+		}
+
+		int64 TotalBytes{ 0 };
+
+		if (const auto* GlobalSaveSubsystem{ GameInstance->GetSubsystem<UGlobalSaveSubsystem>() })
+		{
+			const auto Report{ GlobalSaveSubsystem->GetMemoryReport() };
+			Report.Log(Ar);
+
+			TotalBytes += Report.GetTotalBytes();
+		}
+
+		for (const auto* LocalPlayer : GameInstance->GetLocalPlayers())
+		{
+			if (const auto* PlayerSaveSubsystem{ LocalPlayer ? LocalPlayer->GetSubsystem<UPlayerSaveSubsystem>() : nullptr })
+			{
+				const auto Report{ PlayerSaveSubsystem->GetMemoryReport() };
+				Report.Log(Ar);
+
+				TotalBytes += Report.GetTotalBytes();
+			}
+		}
+
+		const auto TotalBudget{ GetDefault<UGameSaveDeveloperSettings>()->TotalSaveMemoryBudget };
+
+		Ar.Logf(TEXT("Total(%lld bytes) Budget(%lld bytes)"), TotalBytes, TotalBudget);
+	}
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice MemoryCommand(
+		TEXT("GameSave.Memory"),
+		TEXT("Logs the memory used by the loaded saves, in-flight buffers, prefetch caches and checkpoints of the save subsystems"),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&HandleMemoryCommand));
+#endif
+}
+
+
+void FGameSaveMemoryReport::AddSave(const FString& SlotName, USaveGame* SaveObject)
+{
+	if (SaveObject)
+	{
+		auto& Entry{ Entries.AddDefaulted_GetRef() };
+		Entry.SlotName = SlotName;
+		Entry.ClassPath = SaveObject->GetClass()->GetPathName();
+		Entry.Bytes = FGameSaveMemoryProfiler::MeasureObject(SaveObject);
+		Entry.Budget = FGameSaveMemoryProfiler::GetMemoryBudget(SaveObject->GetClass());
+	}
+}
+
+int64 FGameSaveMemoryReport::GetActiveSaveBytes() const
+{
+	int64 Bytes{ 0 };
+
+	for (const auto& Entry : Entries)
+	{
+		Bytes += Entry.Bytes;
+	}
+
+	return Bytes;
+}
+
+int64 FGameSaveMemoryReport::GetTotalBytes() const
+{
+	return GetActiveSaveBytes() + InFlightBytes + CachedBytes + CheckpointBytes;
+}
+
+void FGameSaveMemoryReport::Log(FOutputDevice& Ar) const
+{
+	Ar.Logf(TEXT("Memory(%s) Total(%lld bytes) Saves(%lld bytes) InFlight(%lld bytes) Cached(%lld bytes) Checkpoints(%lld bytes)"),
+		*Name, GetTotalBytes(), GetActiveSaveBytes(), InFlightBytes, CachedBytes, CheckpointBytes);
+
+	for (const auto& Entry : Entries)
+	{
+		const auto Budget{ Entry.Budget > 0 ? FString::Printf(TEXT(" / %lld bytes%s"), Entry.Budget, Entry.IsOverBudget() ? TEXT(" OVER BUDGET") : TEXT("")) : FString() };
+
+		Ar.Logf(TEXT("  %s (%s): %lld bytes%s"), *Entry.SlotName, *Entry.ClassPath, Entry.Bytes, *Budget);
+	}
+}
+
+
+int64 FGameSaveMemoryProfiler::MeasureObject(USaveGame* SaveObject)
+{
+	if (!SaveObject)
+	{
+		return 0;
+	}
+
+	// The counter only sees the allocations of the properties, not the object itself
+
+	FArchiveCountMem Counter(SaveObject);
+
+	return SaveObject->GetClass()->GetStructureSize() + static_cast<int64>(Counter.GetMax());
+}
+
+void FGameSaveMemoryProfiler::ReplaceReport(FGameSaveMemoryReport& InOutReport, FGameSaveMemoryReport NewReport)
+{
+	check(IsInGameThread());
+
+	auto& Totals{ GameSaveMemoryProfiler::Totals };
+	const auto PreviousTotalBytes{ Totals.GetTotalBytes() };
+
+	// Only the difference to the previous report is applied, so the totals stay the sum of all subsystems
+
+	Totals.NumActiveSaves += NewReport.Entries.Num() - InOutReport.Entries.Num();
+	Totals.ActiveSaveBytes += NewReport.GetActiveSaveBytes() - InOutReport.GetActiveSaveBytes();
+	Totals.InFlightBytes += NewReport.InFlightBytes - InOutReport.InFlightBytes;
+	Totals.CachedBytes += NewReport.CachedBytes - InOutReport.CachedBytes;
+	Totals.CheckpointBytes += NewReport.CheckpointBytes - InOutReport.CheckpointBytes;
+
+	SET_DWORD_STAT(STAT_GameSave_NumActiveSaves, Totals.NumActiveSaves);
+	SET_MEMORY_STAT(STAT_GameSave_ActiveSaveMemory, Totals.ActiveSaveBytes);
+	SET_MEMORY_STAT(STAT_GameSave_InFlightMemory, Totals.InFlightBytes);
+	SET_MEMORY_STAT(STAT_GameSave_CachedMemory, Totals.CachedBytes);
+	SET_MEMORY_STAT(STAT_GameSave_CheckpointMemory, Totals.CheckpointBytes);
+
+	// Warn about saves that went over the budget of their class since the previous report
+
+	for (const auto& Entry : NewReport.Entries)
+	{
+		if (!Entry.IsOverBudget())
+		{
+			continue;
+		}
+
+		const auto* PreviousEntry{ InOutReport.Entries.FindByPredicate([&Entry](const FGameSaveMemoryEntry& Other) { return Other.SlotName == Entry.SlotName; }) };
+
+		if (!PreviousEntry || !PreviousEntry->IsOverBudget())
+		{
+			UE_LOG(LogGameCore_Save, Warning, TEXT("Save of class(%s) in slot(%s) uses %lld bytes of memory, over its budget of %lld bytes"),
+				*Entry.ClassPath, *Entry.SlotName, Entry.Bytes, Entry.Budget);
+		}
+	}
+
+	const auto TotalBudget{ GetDefault<UGameSaveDeveloperSettings>()->TotalSaveMemoryBudget };
+	const auto TotalBytes{ Totals.GetTotalBytes() };
+
+	if ((TotalBudget > 0) && (TotalBytes > TotalBudget) && (PreviousTotalBytes <= TotalBudget))
+	{
+		UE_LOG(LogGameCore_Save, Warning, TEXT("Saves use %lld bytes of memory, over the total budget of %lld bytes"), TotalBytes, TotalBudget);
+	}
+
+	InOutReport = MoveTemp(NewReport);
+}
+
+
+int64 FGameSaveMemoryProfiler::GetMemoryBudget(const UClass* SaveGameClass)
+{
+	const auto* DevSetting{ GetDefault<UGameSaveDeveloperSettings>() };
+
+	if (DevSetting->SaveMemoryBudgets.IsEmpty())
+	{
+		return 0;
+	}
+
+	for (auto* Class{ SaveGameClass }; Class; Class = Class->GetSuperClass())
+	{
+		if (const auto* Budget{ DevSetting->SaveMemoryBudgets.Find(FSoftClassPath(Class)) })
+		{
+			return *Budget;
+		}
+	}
+
+	return 0;
+}
+
+int64 FGameSaveMemoryProfiler::GetTrackedTotalBytes()
+{
+	return GameSaveMemoryProfiler::Totals.GetTotalBytes();
+}
@@ -0,0 +1,120 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+class USaveGame;
+class UClass;
+class FOutputDevice;
+
+
+/**
+ * Resident memory of one loaded save game object
+ */
+struct FGameSaveMemoryEntry
+{
+public:
+	FGameSaveMemoryEntry() {}
+
+	FString SlotName;
+
+	FString ClassPath;
+
+	//
+	// Size of the object and the memory allocated by its containers
+	//
+	int64 Bytes{ 0 };
+
+	//
+	// Memory budget of the class set in UGameSaveDeveloperSettings, or 0 if there is no budget
+	//
+	int64 Budget{ 0 };
+
+public:
+	bool IsOverBudget() const { return (Budget > 0) && (Bytes > Budget); }
+
+};
+
+
+/**
+ * Breakdown of the memory used by the saves of a save subsystem
+ */
+struct GCSAVE_API FGameSaveMemoryReport
+{
+public:
+	FGameSaveMemoryReport() {}
+
+	FString Name;
+
+	//
+	// Loaded saves, including the ones waiting for their post-load
+	//
+	TArray<FGameSaveMemoryEntry> Entries;
+
+	//
+	// Serialized data held by async reads and writes that have not completed yet
+	//
+	int64 InFlightBytes{ 0 };
+
+	//
+	// Data kept by the prefetch cache
+	//
+	int64 CachedBytes{ 0 };
+
+	//
+	// Data kept by in-memory checkpoints, shared data counted once
+	//
+	int64 CheckpointBytes{ 0 };
+
+public:
+	/**
+	 * Measures the save game object and adds it to the entries
+	 */
+	void AddSave(const FString& SlotName, USaveGame* SaveObject);
+
+	int64 GetActiveSaveBytes() const;
+
+	int64 GetTotalBytes() const;
+
+	void Log(FOutputDevice& Ar) const;
+
+};
+
+
+/**
+ * Measures the memory used by loaded saves and tracks it against the memory budgets
+ *
+ * Tips:
+ *	The reports of all save subsystems are summed in the GameSave stat group ("stat GameSave")
+ */
+class GCSAVE_API FGameSaveMemoryProfiler
+{
+public:
+	/**
+	 * Returns the size of the object and the memory allocated by its containers
+	 */
+	static int64 MeasureObject(USaveGame* SaveObject);
+
+	/**
+	 * Replaces the report of a save subsystem and updates the stats and budget warnings with the difference
+	 *
+	 * Tips:
+	 *	Pass an empty report when the subsystem is deinitialized to remove it from the totals.
+	 *	Budget warnings are only logged when a save or the total goes over its budget, not while it stays over.
+	 */
+	static void ReplaceReport(FGameSaveMemoryReport& InOutReport, FGameSaveMemoryReport NewReport);
+
+
+	//////////////////////////////////////////////////////////////////
+	// Budget
+public:
+	/**
+	 * Returns the memory budget of the class or its closest parent set in UGameSaveDeveloperSettings, or 0 if there is no budget
+	 */
+	static int64 GetMemoryBudget(const UClass* SaveGameClass);
+
+	/**
+	 * Returns the memory used by the saves of all save subsystems as of their latest reports
+	 */
+	static int64 GetTrackedTotalBytes();
+
+};
@@ -0,0 +1,334 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "GameSaveSizeProfiler.h"
+
+#include "GlobalSave/GlobalSave.h"
+#include "GlobalSave/GlobalSaveSubsystem.h"
+#include "PlayerSave/PlayerSave.h"
+#include "PlayerSave/PlayerSaveSubsystem.h"
+#include "Format/GameSaveEncryption.h"
+#include "Format/GameSaveSerializer.h"
+#include "GameSaveDeveloperSettings.h"
+#include "GCSaveLogs.h"
+
+#include "Engine/GameInstance.h"
+#include "Engine/LocalPlayer.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Serialization/ObjectAndNameAsStringProxyArchive.h"
+#include "Serialization/StructuredArchive.h"
+#include "UObject/UnrealType.h"
+
+
+namespace GameSaveSizeProfiler
+{
+	/**
+	 * Archive that only counts the bytes written to it
+	 */
+	class FCountingArchive : public FArchive
+	{
+	public:
+		FCountingArchive()
+		{
+			SetIsSaving(true);
+			SetIsPersistent(true);
+		}
+
+		int64 Count{ 0 };
+
+	public:
+		virtual void Serialize(void* V, int64 Length) override { Count += Length; }
+		virtual FString GetArchiveName() const override { return TEXT("GameSaveSizeProfiler::FCountingArchive"); }
+	};
+
+	static int64 MeasureValue(const FProperty* Property, void* ValuePtr)
+	{
+		FCountingArchive Counter;
+		FObjectAndNameAsStringProxyArchive Ar(Counter, false);
+
+		Property->SerializeItem(FStructuredArchiveFromArchive(Ar).GetSlot(), ValuePtr);
+
+		return Counter.Count;
+	}
+
+	static bool HasChildren(const FProperty* Property)
+	{
+		return Property->IsA<FStructProperty>() || Property->IsA<FArrayProperty>() || Property->IsA<FSetProperty>() || Property->IsA<FMapProperty>();
+	}
+
+	/**
+	 * Collects entries, values of the same path in different container elements are accumulated into one entry
+	 */
+	struct FCollector
+	{
+	public:
+		FCollector(TArray<FGameSaveSizeEntry>& InEntries, int32 InMaxDepth)
+			: Entries(InEntries), MaxDepth(InMaxDepth)
+		{}
+
+		TArray<FGameSaveSizeEntry>& Entries;
+		TMap<FString, int32> EntryIndices;
+		int32 MaxDepth{ 0 };
+
+	public:
+		int32 AddEntry(const FString& Path, const FProperty* Property, int32 Depth, int64 Bytes)
+		{
+			auto& Index{ EntryIndices.FindOrAdd(Path, INDEX_NONE) };
+
+			if (Index == INDEX_NONE)
+			{
+				Index = Entries.AddDefaulted();
+				Entries[Index].Path = Path;
+				Entries[Index].TypeName = Property->GetCPPType();
+				Entries[Index].Depth = Depth;
+			}
+
+			Entries[Index].Bytes += Bytes;
+
+			return Index;
+		}
+
+		void AddElements(int32 Index, int32 NumElements)
+		{
+			Entries[Index].NumElements = FMath::Max(Entries[Index].NumElements, 0) + NumElements;
+		}
+
+		void CollectStruct(const UStruct* Struct, void* Container, const FString& Prefix, int32 Depth)
+		{
+			for (TFieldIterator<FProperty> It(Struct); It; ++It)
+			{
+				const auto* Property{ *It };
+
+				// Skip properties that are never serialized
+
+				if (Property->HasAnyPropertyFlags(CPF_Transient | CPF_Deprecated))
+				{
+					continue;
+				}
+
+				const auto Path{ Prefix.IsEmpty() ? Property->GetName() : Prefix + TEXT(".") + Property->GetName() };
+
+				for (int32 ArrayIndex{ 0 }; ArrayIndex < Property->ArrayDim; ++ArrayIndex)
+				{
+					CollectValue(Property, Property->ContainerPtrToValuePtr<void>(Container, ArrayIndex), Path, Depth);
+				}
+			}
+		}
+
+		void CollectValue(const FProperty* Property, void* ValuePtr, const FString& Path, int32 Depth)
+		{
+			const auto Index{ AddEntry(Path, Property, Depth, MeasureValue(Property, ValuePtr)) };
+			const auto bCollectChildren{ Depth < MaxDepth };
+
+			if (const auto* StructProperty{ CastField<FStructProperty>(Property) })
+			{
+				if (bCollectChildren)
+				{
+					CollectStruct(StructProperty->Struct, ValuePtr, Path, Depth + 1);
+				}
+			}
+			else if (const auto* ArrayProperty{ CastField<FArrayProperty>(Property) })
+			{
+				FScriptArrayHelper Helper(ArrayProperty, ValuePtr);
+				AddElements(Index, Helper.Num());
+
+				// Elements of simple types are already covered by the size of the array
+
+				if (bCollectChildren && HasChildren(ArrayProperty->Inner))
+				{
+					for (int32 ElementIndex{ 0 }; ElementIndex < Helper.Num(); ++ElementIndex)
+					{
+						CollectValue(ArrayProperty->Inner, Helper.GetRawPtr(ElementIndex), Path + TEXT("[]"), Depth + 1);
+					}
+				}
+			}
+			else if (const auto* SetProperty{ CastField<FSetProperty>(Property) })
+			{
+				FScriptSetHelper Helper(SetProperty, ValuePtr);
+				AddElements(Index, Helper.Num());
+
+				if (bCollectChildren && HasChildren(SetProperty->ElementProp))
+				{
+					for (int32 ElementIndex{ 0 }; ElementIndex < Helper.GetMaxIndex(); ++ElementIndex)
+					{
+						if (Helper.IsValidIndex(ElementIndex))
+						{
+							CollectValue(SetProperty->ElementProp, Helper.GetElementPtr(ElementIndex), Path + TEXT("[]"), Depth + 1);
+						}
+					}
+				}
+			}
+			else if (const auto* MapProperty{ CastField<FMapProperty>(Property) })
+			{
+				FScriptMapHelper Helper(MapProperty, ValuePtr);
+				AddElements(Index, Helper.Num());
+
+				if (bCollectChildren)
+				{
+					for (int32 ElementIndex{ 0 }; ElementIndex < Helper.GetMaxIndex(); ++ElementIndex)
+					{
+						if (Helper.IsValidIndex(ElementIndex))
+						{
+							CollectValue(MapProperty->KeyProp, Helper.GetKeyPtr(ElementIndex), Path + TEXT(".Key"), Depth + 1);
+							CollectValue(MapProperty->ValueProp, Helper.GetValuePtr(ElementIndex), Path + TEXT(".Value"), Depth + 1);
+						}
+					}
+				}
+			}
+		}
+	};
+
+
+#if !UE_BUILD_SHIPPING
+	static void HandleProfileSizeCommand(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		const auto* GameInstance{ World ? World->GetGameInstance() : nullptr };
+		if (!GameInstance)
+		{
+			Ar.Log(TEXT("GameSave.ProfileSize: No game instance"));
+			return;
+		}
+
+		const auto SlotFilter{ Args.IsValidIndex(0) ? Args[0] : FString() };
+		const auto MaxDepth{ Args.IsValidIndex(1) ? FCString::Atoi(*Args[1]) : 2 };
+
+		auto ShouldProfile{ [&SlotFilter](const FString& SlotName) { return SlotFilter.IsEmpty() || (SlotFilter == TEXT("*")) || (SlotFilter == SlotName); } };
+
+		if (const auto* GlobalSaveSubsystem{ GameInstance->GetSubsystem<UGlobalSaveSubsystem>() })
+		{
+			for (const auto& KVP : GlobalSaveSubsystem->GetActiveSaves())
+			{
+				if (KVP.Value && ShouldProfile(KVP.Key))
+				{
+					FGameSaveSizeProfiler::ProfileObject(KVP.Value, MaxDepth).Log(Ar);
+				}
+			}
+		}
+
+		for (const auto* LocalPlayer : GameInstance->GetLocalPlayers())
+		{
+			if (const auto* PlayerSaveSubsystem{ LocalPlayer ? LocalPlayer->GetSubsystem<UPlayerSaveSubsystem>() : nullptr })
+			{
+				for (const auto& KVP : PlayerSaveSubsystem->GetActiveSaves())
+				{
+					if (KVP.Value && ShouldProfile(KVP.Key))
+					{
+						FGameSaveSizeProfiler::ProfileObject(KVP.Value, MaxDepth).Log(Ar);
+					}
+				}
+			}
+		}
+	}
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice ProfileSizeCommand(
+		TEXT("GameSave.ProfileSize"),
+		TEXT("Logs the serialized size of each property of the active saves. Usage: GameSave.ProfileSize [SlotName|*] [Depth]"),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&HandleProfileSizeCommand));
+#endif
+}
+
+
+int64 FGameSaveSizeReport::GetPropertyBytes() const
+{
+	int64 Bytes{ 0 };
+
+	for (const auto& Entry : Entries)
+	{
+		Bytes += (Entry.Depth == 0) ? Entry.Bytes : 0;
+	}
+
+	return Bytes;
+}
+
+void FGameSaveSizeReport::Log(FOutputDevice& Ar) const
+{
+	const auto PropertyBytes{ GetPropertyBytes() };
+
+	Ar.Logf(TEXT("Save(%s) Class(%s) Total(%lld bytes) Properties(%lld bytes) Overhead(%lld bytes)"), *Name, *ClassPath, TotalBytes, PropertyBytes, TotalBytes - PropertyBytes);
+
+	for (const auto& Entry : Entries)
+	{
+		const auto Percent{ TotalBytes > 0 ? (100.0 * Entry.Bytes) / TotalBytes : 0.0 };
+		const auto Elements{ Entry.NumElements != INDEX_NONE ? FString::Printf(TEXT(" x%d"), Entry.NumElements) : FString() };
+
+		Ar.Logf(TEXT("  %s%s (%s)%s: %lld bytes (%.1f%%)"), *FString::ChrN(Entry.Depth * 2, TEXT(' ')), *Entry.Path, *Entry.TypeName, *Elements, Entry.Bytes, Percent);
+	}
+}
+
+
+FGameSaveSizeReport FGameSaveSizeProfiler::ProfileObject(USaveGame* SaveObject, int32 MaxDepth)
+{
+	FGameSaveSizeReport Report;
+
+	if (SaveObject)
+	{
+		Report.Name = SaveObject->GetName();
+		Report.ClassPath = SaveObject->GetClass()->GetPathName();
+
+		GameSaveSizeProfiler::FCountingArchive Counter;
+		FObjectAndNameAsStringProxyArchive Ar(Counter, false);
+		SaveObject->Serialize(Ar);
+
+		Report.TotalBytes = Counter.Count;
+
+		GameSaveSizeProfiler::FCollector Collector(Report.Entries, MaxDepth);
+		Collector.CollectStruct(SaveObject->GetClass(), SaveObject, FString(), 0);
+	}
+
+	return Report;
+}
+
+bool FGameSaveSizeProfiler::ProfileData(const TArray<uint8>& InData, FGameSaveSizeReport& OutReport, int32 MaxDepth)
+{
+	auto Data{ InData };
+
+	if (!FGameSaveEncryption::DecryptData(Data) || !FGameSaveSerializer::MigrateData(Data))
+	{
+		return false;
+	}
+
+	if (auto* SaveObject{ FGameSaveSerializer::LoadFromMemory(Data) })
+	{
+		OutReport = ProfileObject(SaveObject, MaxDepth);
+		OutReport.TotalBytes = InData.Num();
+
+		return true;
+	}
+
+	return false;
+}
+
+
+int64 FGameSaveSizeProfiler::GetSizeBudget(const UClass* SaveGameClass)
+{
+	const auto* DevSetting{ GetDefault<UGameSaveDeveloperSettings>() };
+
+	if (DevSetting->SaveSizeBudgets.IsEmpty())
+	{
+		return 0;
+	}
+
+	for (auto* Class{ SaveGameClass }; Class; Class = Class->GetSuperClass())
+	{
+		if (const auto* Budget{ DevSetting->SaveSizeBudgets.Find(FSoftClassPath(Class)) })
+		{
+			return *Budget;
+		}
+	}
+
+	return 0;
+}
+
+bool FGameSaveSizeProfiler::CheckSizeBudget(const UClass* SaveGameClass, int64 Size, const FString& SlotName)
+{
+	const auto Budget{ GetSizeBudget(SaveGameClass) };
+
+	if ((Budget > 0) && (Size > Budget))
+	{
+		UE_LOG(LogGameCore_Save, Warning, TEXT("Save of class(%s) to slot(%s) is %lld bytes, over its budget of %lld bytes"), *GetNameSafe(SaveGameClass), *SlotName, Size, Budget);
+
+		return !GetDefault<UGameSaveDeveloperSettings>()->bRejectSavesOverSizeBudget;
+	}
+
+	return true;
+}
@@ -0,0 +1,107 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+class USaveGame;
+class UClass;
+class UStruct;
+class FOutputDevice;
+
+
+/**
+ * Serialized size of a property, or of a field accumulated over all elements of a container
+ */
+struct FGameSaveSizeEntry
+{
+public:
+	FGameSaveSizeEntry() {}
+
+	//
+	// Path of the property from the save object (e.g. "Inventory.Items[].Count")
+	//
+	FString Path;
+
+	FString TypeName;
+
+	int64 Bytes{ 0 };
+
+	//
+	// Number of elements if this is a container, otherwise INDEX_NONE
+	//
+	int32 NumElements{ INDEX_NONE };
+
+	int32 Depth{ 0 };
+
+};
+
+
+/**
+ * Breakdown of the serialized size of a save game object
+ */
+struct GCSAVE_API FGameSaveSizeReport
+{
+public:
+	FGameSaveSizeReport() {}
+
+	FString Name;
+
+	FString ClassPath;
+
+	//
+	// Size of the whole serialized data, including the header if profiled from data
+	//
+	int64 TotalBytes{ 0 };
+
+	//
+	// Entries in declaration order, children follow their parent
+	//
+	TArray<FGameSaveSizeEntry> Entries;
+
+public:
+	/**
+	 * Returns the sum of the sizes of the top level properties
+	 *
+	 * Tips:
+	 *	The difference to TotalBytes is the overhead of property tags, the header and the object itself
+	 */
+	int64 GetPropertyBytes() const;
+
+	void Log(FOutputDevice& Ar) const;
+
+};
+
+
+/**
+ * Measures the serialized size of each property of save game objects
+ */
+class GCSAVE_API FGameSaveSizeProfiler
+{
+public:
+	/**
+	 * Measures the properties of the loaded object down to MaxDepth levels of nested structs and containers
+	 */
+	static FGameSaveSizeReport ProfileObject(USaveGame* SaveObject, int32 MaxDepth = 2);
+
+	/**
+	 * Loads the object from the serialized data and measures its properties
+	 */
+	static bool ProfileData(const TArray<uint8>& InData, FGameSaveSizeReport& OutReport, int32 MaxDepth = 2);
+
+
+	//////////////////////////////////////////////////////////////////
+	// Budget
+public:
+	/**
+	 * Returns the size budget of the class or its closest parent set in UGameSaveDeveloperSettings, or 0 if there is no budget
+	 */
+	static int64 GetSizeBudget(const UClass* SaveGameClass);
+
+	/**
+	 * Warns if the size exceeds the budget of the class
+	 *
+	 * Note:
+	 *	Return false if it exceeds the budget and saves over the budget should be rejected
+	 */
+	static bool CheckSizeBudget(const UClass* SaveGameClass, int64 Size, const FString& SlotName);
+
+};
@@ -0,0 +1,725 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "GameSaveSoakTest.h"
+
+#include "GlobalSave/GlobalSave.h"
+#include "GlobalSave/GlobalSaveSubsystem.h"
+#include "PlayerSave/PlayerSave.h"
+#include "PlayerSave/PlayerSaveSubsystem.h"
+#include "Format/GameSaveSerializer.h"
+#include "Profiling/GameSaveSoakTestSave.h"
+#include "GCSaveLogs.h"
+
+#include "Engine/GameInstance.h"
+#include "Engine/LocalPlayer.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+
+
+namespace GameSaveSoakTest
+{
+	//
+	// Maximum number of errors kept in a result, the rest are only counted in the log
+	//
+	static constexpr int32 MAX_ERRORS{ 100 };
+
+	static const TCHAR* SLOT_PREFIX{ TEXT("SoakTest") };
+
+	static const TCHAR* GetOperationName(int32 Operation)
+	{
+		static const TCHAR* Names[]{ TEXT("SyncLoad"), TEXT("AsyncLoad"), TEXT("ForceReload"), TEXT("SyncSave"), TEXT("AsyncSave"), TEXT("Release"), TEXT("Mutate") };
+
+		return Names[Operation];
+	}
+
+
+	/**
+	 * Soak test target of UGlobalSaveSubsystem
+	 */
+	class FGlobalSaveTarget : public IGameSaveSoakTestTarget
+	{
+	public:
+		explicit FGlobalSaveTarget(UGlobalSaveSubsystem* InSubsystem) : Subsystem(InSubsystem) {}
+
+	protected:
+		TWeakObjectPtr<UGlobalSaveSubsystem> Subsystem;
+
+	public:
+		virtual bool IsValid() const override { return Subsystem.IsValid(); }
+
+		virtual TArray<TSubclassOf<USaveGame>> GetDefaultClasses() const override
+		{
+			return { UGameSaveSoakTestSave::StaticClass(), UGameSaveSoakTestSave_Large::StaticClass() };
+		}
+
+		virtual bool CanUseClass(TSubclassOf<USaveGame> Class) const override
+		{
+			return Class && Class->IsChildOf<UGlobalSave>() && !Class->HasAnyClassFlags(CLASS_Abstract) && UGlobalSave::GetDefaultSaveSlotName(Class.Get()).IsEmpty();
+		}
+
+		virtual USaveGame* FindActiveSave(const FString& SlotName) const override
+		{
+			return Subsystem->GetActiveSaves().FindRef(SlotName);
+		}
+
+		virtual USaveGame* SyncLoad(TSubclassOf<USaveGame> Class, const FString& SlotName, bool bForceLoad) override
+		{
+			return Subsystem->SyncLoadGlobalSave(Class.Get(), SlotName, bForceLoad);
+		}
+
+		virtual bool AsyncLoad(TSubclassOf<USaveGame> Class, const FString& SlotName, bool bForceLoad, FSaveEventFunc OnLoaded) override
+		{
+			return Subsystem->AsyncLoadGlobalSave(Class.Get(), SlotName, bForceLoad, FGlobalSaveEventDelegate::CreateLambda(MoveTemp(OnLoaded)));
+		}
+
+		virtual bool SyncSave(TSubclassOf<USaveGame> Class, const FString& SlotName) override
+		{
+			return Subsystem->SyncSaveGameToSlot(Class.Get(), SlotName);
+		}
+
+		virtual bool AsyncSave(TSubclassOf<USaveGame> Class, const FString& SlotName, FSaveEventFunc OnSaved) override
+		{
+			return Subsystem->AsyncSaveGameToSlot(Class.Get(), SlotName, FGlobalSaveEventDelegate::CreateLambda(MoveTemp(OnSaved)));
+		}
+
+		virtual void Release(TSubclassOf<USaveGame> Class, const FString& SlotName) override
+		{
+			Subsystem->ReleaseSave(Class.Get(), SlotName);
+		}
+
+		virtual void Delete(TSubclassOf<USaveGame> Class, const FString& SlotName) override
+		{
+			Subsystem->DeleteSave(Class.Get(), SlotName);
+		}
+
+		virtual bool HasPendingLoad() const override { return Subsystem->HasPendingLoad(); }
+
+		virtual bool HasPendingSave() const override { return Subsystem->HasPendingSave(); }
+
+		virtual bool HasQueuedPostLoad() const override { return Subsystem->HasQueuedPostLoad(); }
+
+		virtual void Mutate(USaveGame* SaveObject, FRandomStream& Random) const override
+		{
+			if (auto* SoakSave{ Cast<UGameSaveSoakTestSave>(SaveObject) })
+			{
+				SoakSave->Mutate(Random);
+			}
+			else if (auto* GlobalSave{ Cast<UGlobalSave>(SaveObject) })
+			{
+				GlobalSave->MarkDirty();
+			}
+		}
+
+		virtual FString GetSlotName(const USaveGame* SaveObject) const override
+		{
+			const auto* GlobalSave{ Cast<UGlobalSave>(SaveObject) };
+			return GlobalSave ? GlobalSave->GetSaveSlotName() : FString();
+		}
+	};
+
+
+	/**
+	 * Soak test target of UPlayerSaveSubsystem
+	 */
+	class FPlayerSaveTarget : public IGameSaveSoakTestTarget
+	{
+	public:
+		explicit FPlayerSaveTarget(UPlayerSaveSubsystem* InSubsystem) : Subsystem(InSubsystem) {}
+
+	protected:
+		TWeakObjectPtr<UPlayerSaveSubsystem> Subsystem;
+
+	public:
+		virtual bool IsValid() const override { return Subsystem.IsValid(); }
+
+		virtual TArray<TSubclassOf<USaveGame>> GetDefaultClasses() const override
+		{
+			return { UGameSaveSoakTestPlayerSave::StaticClass(), UGameSaveSoakTestPlayerSave_Large::StaticClass() };
+		}
+
+		virtual bool CanUseClass(TSubclassOf<USaveGame> Class) const override
+		{
+			return Class && Class->IsChildOf<UPlayerSave>() && !Class->HasAnyClassFlags(CLASS_Abstract) && UPlayerSave::GetDefaultSaveSlotName(Class.Get()).IsEmpty();
+		}
+
+		virtual USaveGame* FindActiveSave(const FString& SlotName) const override
+		{
+			return Subsystem->GetActiveSaves().FindRef(SlotName);
+		}
+
+		virtual USaveGame* SyncLoad(TSubclassOf<USaveGame> Class, const FString& SlotName, bool bForceLoad) override
+		{
+			return Subsystem->SyncLoadPlayerSave(Class.Get(), SlotName, bForceLoad);
+		}
+
+		virtual bool AsyncLoad(TSubclassOf<USaveGame> Class, const FString& SlotName, bool bForceLoad, FSaveEventFunc OnLoaded) override
+		{
+			return Subsystem->AsyncLoadPlayerSave(Class.Get(), SlotName, bForceLoad, FPlayerSaveEventDelegate::CreateLambda(MoveTemp(OnLoaded)));
+		}
+
+		virtual bool SyncSave(TSubclassOf<USaveGame> Class, const FString& SlotName) override
+		{
+			return Subsystem->SyncSaveGameToSlot(Class.Get(), SlotName);
+		}
+
+		virtual bool AsyncSave(TSubclassOf<USaveGame> Class, const FString& SlotName, FSaveEventFunc OnSaved) override
+		{
+			return Subsystem->AsyncSaveGameToSlot(Class.Get(), SlotName, FPlayerSaveEventDelegate::CreateLambda(MoveTemp(OnSaved)));
+		}
+
+		virtual void Release(TSubclassOf<USaveGame> Class, const FString& SlotName) override
+		{
+			Subsystem->ReleaseSave(Class.Get(), SlotName);
+		}
+
+		virtual void Delete(TSubclassOf<USaveGame> Class, const FString& SlotName) override
+		{
+			Subsystem->DeleteSave(Class.Get(), SlotName);
+		}
+
+		virtual bool HasPendingLoad() const override { return Subsystem->HasPendingLoad(); }
+
+		virtual bool HasPendingSave() const override { return Subsystem->HasPendingSave(); }
+
+		virtual bool HasQueuedPostLoad() const override { return Subsystem->HasQueuedPostLoad(); }
+
+		virtual void Mutate(USaveGame* SaveObject, FRandomStream& Random) const override
+		{
+			if (auto* SoakSave{ Cast<UGameSaveSoakTestPlayerSave>(SaveObject) })
+			{
+				SoakSave->Mutate(Random);
+			}
+			else if (auto* PlayerSave{ Cast<UPlayerSave>(SaveObject) })
+			{
+				PlayerSave->MarkDirty();
+			}
+		}
+
+		virtual FString GetSlotName(const USaveGame* SaveObject) const override
+		{
+			const auto* PlayerSave{ Cast<UPlayerSave>(SaveObject) };
+			return PlayerSave ? PlayerSave->GetSaveSlotName() : FString();
+		}
+	};
+
+
+#if !UE_BUILD_SHIPPING
+	static TSharedPtr<FGameSaveSoakTest> RunningSoakTest;
+
+	static void StartSoakTest(const TCHAR* CommandName, const TSharedPtr<IGameSaveSoakTestTarget>& Target, const TArray<FString>& Args, FOutputDevice& Ar)
+	{
+		if (!Target.IsValid())
+		{
+			Ar.Logf(TEXT("%s: No save subsystem"), CommandName);
+			return;
+		}
+
+		if (RunningSoakTest.IsValid() && !RunningSoakTest->IsFinished())
+		{
+			Ar.Logf(TEXT("%s: A soak test is already running"), CommandName);
+			return;
+		}
+
+		FGameSaveSoakTestSettings Settings;
+		Settings.NumOperations = Args.IsValidIndex(0) ? FCString::Atoi(*Args[0]) : Settings.NumOperations;
+		Settings.NumSlotsPerClass = Args.IsValidIndex(1) ? FCString::Atoi(*Args[1]) : Settings.NumSlotsPerClass;
+		Settings.Seed = Args.IsValidIndex(2) ? FCString::Atoi(*Args[2]) : FPlatformTime::Cycles();
+
+		Ar.Logf(TEXT("%s: Started %d operations over %d slots per class with seed %d, the result is logged when it finishes"),
+			CommandName, Settings.NumOperations, Settings.NumSlotsPerClass, Settings.Seed);
+
+		RunningSoakTest = FGameSaveSoakTest::Start(Target.ToSharedRef(), Settings);
+	}
+
+	static void HandleSoakTestCommand(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		const auto* GameInstance{ World ? World->GetGameInstance() : nullptr };
+		auto* Subsystem{ GameInstance ? GameInstance->GetSubsystem<UGlobalSaveSubsystem>() : nullptr };
+
+		StartSoakTest(TEXT("GameSave.SoakTest"), Subsystem ? TSharedPtr<IGameSaveSoakTestTarget>(IGameSaveSoakTestTarget::Create(Subsystem)) : nullptr, Args, Ar);
+	}
+
+	static void HandlePlayerSoakTestCommand(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		const auto* GameInstance{ World ? World->GetGameInstance() : nullptr };
+		const auto* LocalPlayer{ GameInstance ? GameInstance->GetFirstGamePlayer() : nullptr };
+		auto* Subsystem{ LocalPlayer ? LocalPlayer->GetSubsystem<UPlayerSaveSubsystem>() : nullptr };
+
+		StartSoakTest(TEXT("GameSave.PlayerSoakTest"), Subsystem ? TSharedPtr<IGameSaveSoakTestTarget>(IGameSaveSoakTestTarget::Create(Subsystem)) : nullptr, Args, Ar);
+	}
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice SoakTestCommand(
+		TEXT("GameSave.SoakTest"),
+		TEXT("Runs random concurrent loads, saves and releases on the global save subsystem and logs the stalls and latencies. Usage: GameSave.SoakTest [NumOperations] [NumSlotsPerClass] [Seed]"),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&HandleSoakTestCommand));
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice PlayerSoakTestCommand(
+		TEXT("GameSave.PlayerSoakTest"),
+		TEXT("Runs random concurrent loads, saves and releases on the player save subsystem of the first local player. Usage: GameSave.PlayerSoakTest [NumOperations] [NumSlotsPerClass] [Seed]"),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&HandlePlayerSoakTestCommand));
+#endif
+}
+
+
+TSharedRef<IGameSaveSoakTestTarget> IGameSaveSoakTestTarget::Create(UGlobalSaveSubsystem* Subsystem)
+{
+	return MakeShared<GameSaveSoakTest::FGlobalSaveTarget>(Subsystem);
+}
+
+TSharedRef<IGameSaveSoakTestTarget> IGameSaveSoakTestTarget::Create(UPlayerSaveSubsystem* Subsystem)
+{
+	return MakeShared<GameSaveSoakTest::FPlayerSaveTarget>(Subsystem);
+}
+
+
+FGameSaveLatencyStats FGameSaveLatencyStats::FromSamples(TArray<double> SamplesSeconds)
+{
+	FGameSaveLatencyStats Stats;
+	Stats.NumSamples = SamplesSeconds.Num();
+
+	if (SamplesSeconds.IsEmpty())
+	{
+		return Stats;
+	}
+
+	SamplesSeconds.Sort();
+
+	auto GetPercentileMs
+	{
+		[&SamplesSeconds](double Percentile)
+		{
+			const auto Index{ FMath::Clamp(FMath::CeilToInt(Percentile * SamplesSeconds.Num()) - 1, 0, SamplesSeconds.Num() - 1) };
+			return SamplesSeconds[Index] * 1000.0;
+		}
+	};
+
+	Stats.P50Ms = GetPercentileMs(0.50);
+	Stats.P99Ms = GetPercentileMs(0.99);
+	Stats.MaxMs = SamplesSeconds.Last() * 1000.0;
+
+	return Stats;
+}
+
+FString FGameSaveLatencyStats::ToString() const
+{
+	return FString::Printf(TEXT("p50(%.3f ms) p99(%.3f ms) max(%.3f ms) samples(%d)"), P50Ms, P99Ms, MaxMs, NumSamples);
+}
+
+
+void FGameSaveSoakTestResult::Log(FOutputDevice& Ar) const
+{
+	Ar.Logf(TEXT("Soak test %s: Operations(%d) Errors(%d)"), IsSuccess() ? TEXT("passed") : TEXT("failed"), NumOperations, Errors.Num());
+	Ar.Logf(TEXT("  Game thread stall: %s"), *Stall.ToString());
+	Ar.Logf(TEXT("  End-to-end latency: %s"), *Latency.ToString());
+
+	for (const auto& Error : Errors)
+	{
+		Ar.Logf(TEXT("  Error: %s"), *Error);
+	}
+}
+
+
+FGameSaveSoakTest::FGameSaveSoakTest(const TSharedRef<IGameSaveSoakTestTarget>& InTarget, const FGameSaveSoakTestSettings& InSettings)
+	: Target(InTarget)
+	, Settings(InSettings)
+	, Random(InSettings.Seed)
+{
+	auto Classes{ Settings.Classes };
+
+	if (Classes.IsEmpty())
+	{
+		Classes = Target->GetDefaultClasses();
+	}
+
+	for (const auto& Class : Classes)
+	{
+		// Classes with a fixed slot name would use the slots of the game
+
+		if (!Target->CanUseClass(Class))
+		{
+			UE_LOG(LogGameCore_Save, Warning, TEXT("FGameSaveSoakTest: Skipped class(%s) that is abstract, of another subsystem or has a fixed slot name"), *GetNameSafe(Class));
+			continue;
+		}
+
+		for (int32 Index{ 0 }; Index < Settings.NumSlotsPerClass; ++Index)
+		{
+			auto& Slot{ Slots.AddDefaulted_GetRef() };
+			Slot.Class = Class;
+			Slot.SlotName = FString::Printf(TEXT("%s_%s_%d"), GameSaveSoakTest::SLOT_PREFIX, *Class->GetName(), Index);
+		}
+	}
+}
+
+FGameSaveSoakTest::~FGameSaveSoakTest()
+{
+	if (TickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+	}
+}
+
+TSharedRef<FGameSaveSoakTest> FGameSaveSoakTest::Start(const TSharedRef<IGameSaveSoakTestTarget>& InTarget, const FGameSaveSoakTestSettings& InSettings)
+{
+	auto SoakTest{ MakeShared<FGameSaveSoakTest>(InTarget, InSettings) };
+
+	if (!InTarget->IsValid() || SoakTest->Slots.IsEmpty())
+	{
+		SoakTest->AddError(TEXT("No subsystem or no class to test"));
+		SoakTest->Finish();
+
+		return SoakTest;
+	}
+
+	// Slots left over by an aborted run would make the first loads differ between runs
+
+	for (const auto& Slot : SoakTest->Slots)
+	{
+		InTarget->Delete(Slot.Class, Slot.SlotName);
+	}
+
+	SoakTest->TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateSP(SoakTest, &FGameSaveSoakTest::Tick));
+
+	return SoakTest;
+}
+
+TSharedRef<FGameSaveSoakTest> FGameSaveSoakTest::Start(UGlobalSaveSubsystem* InSubsystem, const FGameSaveSoakTestSettings& InSettings)
+{
+	return Start(IGameSaveSoakTestTarget::Create(InSubsystem), InSettings);
+}
+
+TSharedRef<FGameSaveSoakTest> FGameSaveSoakTest::Start(UPlayerSaveSubsystem* InSubsystem, const FGameSaveSoakTestSettings& InSettings)
+{
+	return Start(IGameSaveSoakTestTarget::Create(InSubsystem), InSettings);
+}
+
+
+bool FGameSaveSoakTest::Tick(float DeltaTime)
+{
+	if (!Target->IsValid())
+	{
+		AddError(TEXT("The subsystem was destroyed during the run"));
+	}
+	else if (NumIssued < Settings.NumOperations)
+	{
+		const auto NumToIssue{ FMath::Min(Settings.OperationsPerFrame, Settings.NumOperations - NumIssued) };
+
+		for (int32 Index{ 0 }; Index < NumToIssue; ++Index)
+		{
+			IssueRandomOperation();
+		}
+
+		DrainStartTime = FPlatformTime::Seconds();
+
+		return true;
+	}
+	else if ((NumInFlight > 0) || Target->HasQueuedPostLoad())
+	{
+		// Wait for the async operations and their post-loads to complete
+
+		if ((FPlatformTime::Seconds() - DrainStartTime) < Settings.TimeoutSeconds)
+		{
+			return true;
+		}
+
+		AddError(FString::Printf(TEXT("%d operations did not complete within %.1f seconds"), NumInFlight, Settings.TimeoutSeconds));
+	}
+	else
+	{
+		Verify();
+	}
+
+	TickerHandle.Reset();
+	Finish();
+
+	return false;
+}
+
+void FGameSaveSoakTest::IssueRandomOperation()
+{
+	const auto SlotIndex{ Random.RandHelper(Slots.Num()) };
+	const auto& Slot{ Slots[SlotIndex] };
+	const auto Operation{ Random.RandHelper(static_cast<int32>(EOperation::MAX)) };
+	const auto* OperationName{ GameSaveSoakTest::GetOperationName(Operation) };
+
+	auto* ActiveSave{ Target->FindActiveSave(Slot.SlotName) };
+
+	NumIssued++;
+
+	// Async operations are counted until their callback is called
+
+	auto MakeCallback
+	{
+		[this, SlotIndex, OperationName](double StartTime, TFunction<void()> OnSucceeded = nullptr)
+		{
+			NumInFlight++;
+
+			return
+				[WeakThis = TWeakPtr<FGameSaveSoakTest>(AsShared()), SlotIndex, OperationName, StartTime, OnSucceeded = MoveTemp(OnSucceeded)](USaveGame* SaveObject, bool bSuccess)
+				{
+					const auto This{ WeakThis.Pin() };
+					if (!This)
+					{
+						return;
+					}
+
+					This->NumInFlight--;
+					This->LatencySamples.Add(FPlatformTime::Seconds() - StartTime);
+
+					This->CheckSave(This->Slots[SlotIndex], SaveObject, bSuccess, OperationName);
+
+					if (bSuccess && OnSucceeded)
+					{
+						OnSucceeded();
+					}
+				};
+		}
+	};
+
+	// Saves are given their order and the data they write when they are issued
+
+	const auto bSave{ (Operation == static_cast<int32>(EOperation::SyncSave)) || (Operation == static_cast<int32>(EOperation::AsyncSave)) };
+	const auto SaveIndex{ bSave ? NumSavesIssued++ : INDEX_NONE };
+	TMap<FName, uint32> SavedHashes;
+
+	if (bSave && ActiveSave)
+	{
+		Target->Mutate(ActiveSave, Random);
+		FGameSaveSerializer::GetPropertyHashes(ActiveSave, SavedHashes);
+	}
+
+	const auto StartTime{ FPlatformTime::Seconds() };
+	auto bIssued{ true };
+	auto bAsync{ false };
+
+	switch (static_cast<EOperation>(Operation))
+	{
+	case EOperation::SyncLoad:
+	{
+		auto* LoadedSave{ Target->SyncLoad(Slot.Class, Slot.SlotName, false) };
+		CheckSave(Slot, LoadedSave, LoadedSave != nullptr, OperationName);
+		break;
+	}
+	case EOperation::AsyncLoad:
+	case EOperation::ForceReload:
+	{
+		const auto bForceLoad{ Operation == static_cast<int32>(EOperation::ForceReload) };
+
+		bAsync = true;
+		bIssued = Target->AsyncLoad(Slot.Class, Slot.SlotName, bForceLoad, MakeCallback(StartTime));
+		break;
+	}
+	case EOperation::SyncSave:
+	{
+		// Saving a slot that is not loaded is rejected by design
+
+		if (!ActiveSave)
+		{
+			break;
+		}
+
+		if (Target->SyncSave(Slot.Class, Slot.SlotName))
+		{
+			RecordSave(SlotIndex, SaveIndex, MoveTemp(SavedHashes));
+		}
+		else
+		{
+			AddError(FString::Printf(TEXT("%s of loaded slot(%s) failed"), OperationName, *Slot.SlotName));
+		}
+		break;
+	}
+	case EOperation::AsyncSave:
+	{
+		if (ActiveSave)
+		{
+			bAsync = true;
+			bIssued = Target->AsyncSave(Slot.Class, Slot.SlotName,
+				MakeCallback(StartTime,
+					[this, SlotIndex, SaveIndex, SavedHashes]()
+					{
+						RecordSave(SlotIndex, SaveIndex, SavedHashes);
+					}
+				)
+			);
+		}
+		break;
+	}
+	case EOperation::Release:
+	{
+		Target->Release(Slot.Class, Slot.SlotName);
+		break;
+	}
+	case EOperation::Mutate:
+	{
+		if (ActiveSave)
+		{
+			Target->Mutate(ActiveSave, Random);
+		}
+		break;
+	}
+	default:
+		break;
+	}
+
+	const auto Duration{ FPlatformTime::Seconds() - StartTime };
+
+	StallSamples.Add(Duration);
+
+	if (!bAsync)
+	{
+		LatencySamples.Add(Duration);
+	}
+	else if (!bIssued)
+	{
+		// The callback is never called for a rejected request
+
+		NumInFlight--;
+
+		AddError(FString::Printf(TEXT("%s of slot(%s) was rejected"), OperationName, *Slot.SlotName));
+	}
+}
+
+void FGameSaveSoakTest::CheckSave(const FSoakSlot& Slot, const USaveGame* SaveObject, bool bSuccess, const TCHAR* OperationName)
+{
+	if (!bSuccess)
+	{
+		AddError(FString::Printf(TEXT("%s of slot(%s) failed"), OperationName, *Slot.SlotName));
+	}
+
+	if (SaveObject && (!SaveObject->IsA(Slot.Class) || (Target->GetSlotName(SaveObject) != Slot.SlotName)))
+	{
+		AddError(FString::Printf(TEXT("%s of slot(%s) returned save(%s) of class(%s) for slot(%s)"),
+			OperationName, *Slot.SlotName, *SaveObject->GetName(), *SaveObject->GetClass()->GetName(), *Target->GetSlotName(SaveObject)));
+	}
+}
+
+void FGameSaveSoakTest::RecordSave(int32 SlotIndex, int32 SaveIndex, TMap<FName, uint32> SavedHashes)
+{
+	auto& Slot{ Slots[SlotIndex] };
+
+	if (SaveIndex > Slot.ExpectedSaveIndex)
+	{
+		Slot.ExpectedHashes = MoveTemp(SavedHashes);
+		Slot.ExpectedSaveIndex = SaveIndex;
+	}
+}
+
+void FGameSaveSoakTest::Verify()
+{
+	// Nothing may be left pending once every operation has completed
+
+	if (Target->HasPendingLoad())
+	{
+		AddError(TEXT("Pending load list is not empty after all loads completed"));
+	}
+
+	if (Target->HasPendingSave())
+	{
+		AddError(TEXT("Pending save list is not empty after all saves completed"));
+	}
+
+	for (const auto& Slot : Slots)
+	{
+		if (const auto* ActiveSave{ Target->FindActiveSave(Slot.SlotName) })
+		{
+			CheckSave(Slot, ActiveSave, true, TEXT("Final state"));
+		}
+	}
+
+	// Every slot must hold the data of its last completed save, changes that were not saved are dropped by the release
+
+	for (const auto& Slot : Slots)
+	{
+		if (!Slot.ExpectedHashes.IsSet())
+		{
+			continue;
+		}
+
+		Target->Release(Slot.Class, Slot.SlotName);
+
+		const auto* LoadedSave{ Target->SyncLoad(Slot.Class, Slot.SlotName, true) };
+
+		TMap<FName, uint32> LoadedHashes;
+
+		if (LoadedSave)
+		{
+			FGameSaveSerializer::GetPropertyHashes(LoadedSave, LoadedHashes);
+		}
+
+		if (!LoadedSave || !Slot.ExpectedHashes->OrderIndependentCompareEqual(LoadedHashes))
+		{
+			AddError(FString::Printf(TEXT("Slot(%s) does not hold the data of its last completed save"), *Slot.SlotName));
+		}
+	}
+
+	// Every slot must read back exactly what was written last
+
+	for (const auto& Slot : Slots)
+	{
+		auto* SaveObject{ Target->SyncLoad(Slot.Class, Slot.SlotName, false) };
+
+		if (!SaveObject)
+		{
+			AddError(FString::Printf(TEXT("Slot(%s) could not be loaded for the round trip"), *Slot.SlotName));
+			continue;
+		}
+
+		Target->Mutate(SaveObject, Random);
+
+		TMap<FName, uint32> SavedHashes;
+		FGameSaveSerializer::GetPropertyHashes(SaveObject, SavedHashes);
+
+		if (!Target->SyncSave(Slot.Class, Slot.SlotName))
+		{
+			AddError(FString::Printf(TEXT("Slot(%s) could not be saved for the round trip"), *Slot.SlotName));
+			continue;
+		}
+
+		Target->Release(Slot.Class, Slot.SlotName);
+
+		const auto* ReloadedSave{ Target->SyncLoad(Slot.Class, Slot.SlotName, true) };
+
+		TMap<FName, uint32> LoadedHashes;
+
+		if (ReloadedSave)
+		{
+			FGameSaveSerializer::GetPropertyHashes(ReloadedSave, LoadedHashes);
+		}
+
+		if (!ReloadedSave || !SavedHashes.OrderIndependentCompareEqual(LoadedHashes))
+		{
+			AddError(FString::Printf(TEXT("Slot(%s) did not read back the data that was written"), *Slot.SlotName));
+		}
+	}
+}
+
+void FGameSaveSoakTest::Finish()
+{
+	Result.NumOperations = NumIssued;
+	Result.Stall = FGameSaveLatencyStats::FromSamples(MoveTemp(StallSamples));
+	Result.Latency = FGameSaveLatencyStats::FromSamples(MoveTemp(LatencySamples));
+
+	// Leave no slots of the run behind
+
+	if (Target->IsValid())
+	{
+		for (const auto& Slot : Slots)
+		{
+			Target->Delete(Slot.Class, Slot.SlotName);
+		}
+	}
+
+	bFinished = true;
+
+	Result.Log(*GLog);
+}
+
+void FGameSaveSoakTest::AddError(FString Error)
+{
+	UE_LOG(LogGameCore_Save, Warning, TEXT("FGameSaveSoakTest: %s"), *Error);
+
+	if (Result.Errors.Num() < GameSaveSoakTest::MAX_ERRORS)
+	{
+		Result.Errors.Add(MoveTemp(Error));
+	}
+}
@@ -0,0 +1,287 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Containers/Ticker.h"
+#include "Math/RandomStream.h"
+#include "Misc/Optional.h"
+#include "Templates/SubclassOf.h"
+
+class USaveGame;
+class UGlobalSaveSubsystem;
+class UPlayerSaveSubsystem;
+class FOutputDevice;
+
+
+/**
+ * Settings of a run of FGameSaveSoakTest
+ */
+struct FGameSaveSoakTestSettings
+{
+public:
+	FGameSaveSoakTestSettings() {}
+
+	//
+	// Classes whose saves are used, the soak test classes of the subsystem if empty
+	//
+	// Note:
+	//	Classes of another subsystem or with a fixed slot name are skipped so that the slots of the game are never touched
+	//
+	TArray<TSubclassOf<USaveGame>> Classes;
+
+	int32 NumSlotsPerClass{ 8 };
+
+	int32 NumOperations{ 2000 };
+
+	//
+	// Number of operations issued per frame
+	//
+	int32 OperationsPerFrame{ 16 };
+
+	int32 Seed{ 0 };
+
+	//
+	// Time in seconds the operations may take to complete after the last one was issued
+	//
+	double TimeoutSeconds{ 60.0 };
+
+};
+
+
+/**
+ * Percentiles of a set of durations
+ */
+struct GCSAVE_API FGameSaveLatencyStats
+{
+public:
+	FGameSaveLatencyStats() {}
+
+	int32 NumSamples{ 0 };
+
+	double P50Ms{ 0.0 };
+
+	double P99Ms{ 0.0 };
+
+	double MaxMs{ 0.0 };
+
+public:
+	static FGameSaveLatencyStats FromSamples(TArray<double> SamplesSeconds);
+
+	FString ToString() const;
+
+};
+
+
+/**
+ * Result of a run of FGameSaveSoakTest
+ */
+struct GCSAVE_API FGameSaveSoakTestResult
+{
+public:
+	FGameSaveSoakTestResult() {}
+
+	int32 NumOperations{ 0 };
+
+	//
+	// Inconsistencies found during or after the run, empty if it succeeded
+	//
+	TArray<FString> Errors;
+
+	//
+	// Time the game thread was blocked by each operation when it was issued
+	//
+	FGameSaveLatencyStats Stall;
+
+	//
+	// Time from issuing each operation to its completion
+	//
+	FGameSaveLatencyStats Latency;
+
+public:
+	bool IsSuccess() const { return Errors.IsEmpty(); }
+
+	void Log(FOutputDevice& Ar) const;
+
+};
+
+
+/**
+ * Save subsystem driven by FGameSaveSoakTest
+ *
+ * Tips:
+ *	UGlobalSaveSubsystem and UPlayerSaveSubsystem have the same operations on different save classes, see Create for each of them
+ */
+class GCSAVE_API IGameSaveSoakTestTarget
+{
+public:
+	using FSaveEventFunc = TFunction<void(USaveGame*, bool)>;
+
+	virtual ~IGameSaveSoakTestTarget() {}
+
+	static TSharedRef<IGameSaveSoakTestTarget> Create(UGlobalSaveSubsystem* Subsystem);
+	static TSharedRef<IGameSaveSoakTestTarget> Create(UPlayerSaveSubsystem* Subsystem);
+
+public:
+	/**
+	 * Returns false once the subsystem has been destroyed
+	 */
+	virtual bool IsValid() const = 0;
+
+	/**
+	 * Returns the classes used by a run that specifies none
+	 */
+	virtual TArray<TSubclassOf<USaveGame>> GetDefaultClasses() const = 0;
+
+	/**
+	 * Returns whether saves of the class can be used, classes of another subsystem or with a fixed slot name cannot
+	 */
+	virtual bool CanUseClass(TSubclassOf<USaveGame> Class) const = 0;
+
+	virtual USaveGame* FindActiveSave(const FString& SlotName) const = 0;
+
+	virtual USaveGame* SyncLoad(TSubclassOf<USaveGame> Class, const FString& SlotName, bool bForceLoad) = 0;
+
+	virtual bool AsyncLoad(TSubclassOf<USaveGame> Class, const FString& SlotName, bool bForceLoad, FSaveEventFunc OnLoaded) = 0;
+
+	virtual bool SyncSave(TSubclassOf<USaveGame> Class, const FString& SlotName) = 0;
+
+	virtual bool AsyncSave(TSubclassOf<USaveGame> Class, const FString& SlotName, FSaveEventFunc OnSaved) = 0;
+
+	virtual void Release(TSubclassOf<USaveGame> Class, const FString& SlotName) = 0;
+
+	virtual void Delete(TSubclassOf<USaveGame> Class, const FString& SlotName) = 0;
+
+	virtual bool HasPendingLoad() const = 0;
+
+	virtual bool HasPendingSave() const = 0;
+
+	virtual bool HasQueuedPostLoad() const = 0;
+
+	/**
+	 * Changes the data of the save so that the next save has something to write
+	 */
+	virtual void Mutate(USaveGame* SaveObject, FRandomStream& Random) const = 0;
+
+	virtual FString GetSlotName(const USaveGame* SaveObject) const = 0;
+
+};
+
+
+/**
+ * Runs random concurrent loads, saves, reloads and releases on a save subsystem and checks that its state stays consistent
+ *
+ * Tips:
+ *	Operations are issued over several frames so that async completions interleave with new requests.
+ *	The data of the last save of each slot that completed is tracked, and each slot must hold it once every operation has completed.
+ *	Then every slot is saved, released and loaded again to check that no data was lost.
+ *	All slots used by the run are deleted when it finishes.
+ */
+class GCSAVE_API FGameSaveSoakTest : public TSharedFromThis<FGameSaveSoakTest>
+{
+public:
+	FGameSaveSoakTest(const TSharedRef<IGameSaveSoakTestTarget>& InTarget, const FGameSaveSoakTestSettings& InSettings);
+	~FGameSaveSoakTest();
+
+	/**
+	 * Starts a run on the subsystem, it proceeds on the core ticker until IsFinished returns true
+	 */
+	static TSharedRef<FGameSaveSoakTest> Start(const TSharedRef<IGameSaveSoakTestTarget>& InTarget, const FGameSaveSoakTestSettings& InSettings);
+	static TSharedRef<FGameSaveSoakTest> Start(UGlobalSaveSubsystem* InSubsystem, const FGameSaveSoakTestSettings& InSettings);
+	static TSharedRef<FGameSaveSoakTest> Start(UPlayerSaveSubsystem* InSubsystem, const FGameSaveSoakTestSettings& InSettings);
+
+protected:
+	struct FSoakSlot
+	{
+		TSubclassOf<USaveGame> Class;
+
+		FString SlotName;
+
+		//
+		// Property hashes of the data the slot must hold, unset until a save of it has completed
+		//
+		TOptional<TMap<FName, uint32>> ExpectedHashes;
+
+		//
+		// Order in which the save of ExpectedHashes was issued, saves issued before it must not replace it
+		//
+		int32 ExpectedSaveIndex{ INDEX_NONE };
+	};
+
+	enum class EOperation : uint8
+	{
+		SyncLoad,
+		AsyncLoad,
+		ForceReload,
+		SyncSave,
+		AsyncSave,
+		Release,
+		Mutate,
+		MAX
+	};
+
+	TSharedRef<IGameSaveSoakTestTarget> Target;
+
+	FGameSaveSoakTestSettings Settings;
+
+	FRandomStream Random;
+
+	TArray<FSoakSlot> Slots;
+
+	FTSTicker::FDelegateHandle TickerHandle;
+
+	int32 NumIssued{ 0 };
+
+	//
+	// Number of saves issued, used to order them
+	//
+	int32 NumSavesIssued{ 0 };
+
+	//
+	// Number of async operations whose delegate has not been called yet
+	//
+	int32 NumInFlight{ 0 };
+
+	//
+	// Time the last operation was issued
+	//
+	double DrainStartTime{ 0.0 };
+
+	bool bFinished{ false };
+
+	TArray<double> StallSamples;
+
+	TArray<double> LatencySamples;
+
+	FGameSaveSoakTestResult Result;
+
+public:
+	bool IsFinished() const { return bFinished; }
+
+	const FGameSaveSoakTestResult& GetResult() const { return Result; }
+
+protected:
+	bool Tick(float DeltaTime);
+
+	void IssueRandomOperation();
+
+	/**
+	 * Checks a save reported by the subsystem for the slot
+	 */
+	void CheckSave(const FSoakSlot& Slot, const USaveGame* SaveObject, bool bSuccess, const TCHAR* OperationName);
+
+	/**
+	 * Records the data written by a completed save as the data the slot must hold, unless a later save has completed first
+	 */
+	void RecordSave(int32 SlotIndex, int32 SaveIndex, TMap<FName, uint32> SavedHashes);
+
+	/**
+	 * Checks the state of the subsystem after all operations have completed, that every slot holds the data of its last save
+	 * and that every slot survives a write and read
+	 */
+	void Verify();
+
+	void Finish();
+
+	void AddError(FString Error);
+
+};
@@ -0,0 +1,41 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "GameSaveSoakTestSave.h"
+
+#include "Math/RandomStream.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(GameSaveSoakTestSave)
+
+
+void UGameSaveSoakTestSave::Mutate(FRandomStream& Random)
+{
+	Revision++;
+
+	Values.SetNumUninitialized(Random.RandRange(0, GetMaxNumValues()));
+
+	for (auto& Value : Values)
+	{
+		Value = Random.RandHelper(MAX_int32);
+	}
+
+	Text = FString::Printf(TEXT("%s_%d"), *GetSaveSlotName(), Revision);
+
+	MarkDirty();
+}
+
+
+void UGameSaveSoakTestPlayerSave::Mutate(FRandomStream& Random)
+{
+	Revision++;
+
+	Values.SetNumUninitialized(Random.RandRange(0, GetMaxNumValues()));
+
+	for (auto& Value : Values)
+	{
+		Value = Random.RandHelper(MAX_int32);
+	}
+
+	Text = FString::Printf(TEXT("%s_%d"), *GetSaveSlotName(), Revision);
+
+	MarkDirty();
+}
@@ -0,0 +1,118 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "GlobalSave/GlobalSave.h"
+#include "PlayerSave/PlayerSave.h"
+
+#include "GameSaveSoakTestSave.generated.h"
+
+struct FRandomStream;
+
+
+/**
+ * Global save used by FGameSaveSoakTest
+ *
+ * Tips:
+ *	It has no fixed slot name, so the soak test can spread it over its own slots without touching the slots of the game
+ */
+UCLASS(NotBlueprintable, HideDropdown)
+class GCSAVE_API UGameSaveSoakTestSave : public UGlobalSave
+{
+	GENERATED_BODY()
+public:
+	UGameSaveSoakTestSave() {}
+
+protected:
+	//
+	// Incremented by every change
+	//
+	UPROPERTY()
+	int32 Revision{ 0 };
+
+	UPROPERTY()
+	TArray<int32> Values;
+
+	UPROPERTY()
+	FString Text;
+
+public:
+	/**
+	 * Changes the data to random values of up to GetMaxNumValues elements
+	 */
+	void Mutate(FRandomStream& Random);
+
+protected:
+	virtual int32 GetMaxNumValues() const { return 256; }
+
+};
+
+
+/**
+ * Larger global save used by FGameSaveSoakTest
+ */
+UCLASS(NotBlueprintable, HideDropdown)
+class GCSAVE_API UGameSaveSoakTestSave_Large : public UGameSaveSoakTestSave
+{
+	GENERATED_BODY()
+public:
+	UGameSaveSoakTestSave_Large() {}
+
+protected:
+	virtual int32 GetMaxNumValues() const override { return 64 * 1024; }
+
+};
+
+
+/**
+ * Player save used by FGameSaveSoakTest
+ *
+ * Tips:
+ *	It has no fixed slot name, so the soak test can spread it over its own slots without touching the slots of the game
+ */
+UCLASS(NotBlueprintable, HideDropdown)
+class GCSAVE_API UGameSaveSoakTestPlayerSave : public UPlayerSave
+{
+	GENERATED_BODY()
+public:
+	UGameSaveSoakTestPlayerSave() {}
+
+protected:
+	//
+	// Incremented by every change
+	//
+	UPROPERTY()
+	int32 Revision{ 0 };
+
+	UPROPERTY()
+	TArray<int32> Values;
+
+	UPROPERTY()
+	FString Text;
+
+public:
+	/**
+	 * Changes the data to random values of up to GetMaxNumValues elements
+	 */
+	void Mutate(FRandomStream& Random);
+
+protected:
+	virtual int32 GetMaxNumValues() const { return 256; }
+
+};
+
+
+/**
+ * Larger player save used by FGameSaveSoakTest
+ */
+UCLASS(NotBlueprintable, HideDropdown)
+class GCSAVE_API UGameSaveSoakTestPlayerSave_Large : public UGameSaveSoakTestPlayerSave
+{
+	GENERATED_BODY()
+public:
+	UGameSaveSoakTestPlayerSave_Large() {}
+
+protected:
+	virtual int32 GetMaxNumValues() const override { return 64 * 1024; }
+
+};
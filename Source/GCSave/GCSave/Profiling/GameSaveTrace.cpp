@@ -0,0 +1,303 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "GameSaveTrace.h"
+
+#include "GlobalSave/GlobalSaveSubsystem.h"
+#include "PlayerSave/PlayerSaveSubsystem.h"
+
+#include "Engine/GameInstance.h"
+#include "Engine/LocalPlayer.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+
+namespace GameSaveTrace
+{
+	static uint64 ToMicroseconds(double Seconds)
+	{
+		return static_cast<uint64>(FMath::Max(Seconds, 0.0) * 1000000.0 + 0.5);
+	}
+
+	static double ToSeconds(uint64 Microseconds)
+	{
+		return static_cast<double>(Microseconds) / 1000000.0;
+	}
+
+
+#if !UE_BUILD_SHIPPING
+	static void HandleTraceCommand(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		const auto* GameInstance{ World ? World->GetGameInstance() : nullptr };
+		if (!GameInstance)
+		{
+			Ar.Log(TEXT("GameSave.Trace: No game instance"));
+			return;
+		}
+
+		const auto bStart{ (Args.Num() > 0) && (Args[0] == TEXT("Start")) };
+		const auto bStop{ (Args.Num() > 0) && (Args[0] == TEXT("Stop")) };
+
+		if (!bStart && !bStop)
+		{
+			Ar.Log(TEXT("Usage: GameSave.Trace Start | Stop [Filename]"));
+			return;
+		}
+
+		// Each subsystem writes a file of its own
+
+		const auto BaseName{ (Args.Num() > 1) ? Args[1] : FString::Printf(TEXT("SaveTrace_%s"), *FDateTime::Now().ToString()) };
+
+		if (auto* GlobalSaveSubsystem{ GameInstance->GetSubsystem<UGlobalSaveSubsystem>() })
+		{
+			if (bStart)
+			{
+				GlobalSaveSubsystem->StartTraceRecording();
+			}
+			else if (GlobalSaveSubsystem->StopTraceRecording(BaseName + TEXT("_Global.gctrace")))
+			{
+				Ar.Logf(TEXT("GameSave.Trace: Wrote %s"), *FGameSaveTrace::ResolveFilename(BaseName + TEXT("_Global.gctrace")));
+			}
+		}
+
+		for (const auto* LocalPlayer : GameInstance->GetLocalPlayers())
+		{
+			auto* PlayerSaveSubsystem{ LocalPlayer ? LocalPlayer->GetSubsystem<UPlayerSaveSubsystem>() : nullptr };
+
+			if (!PlayerSaveSubsystem)
+			{
+				continue;
+			}
+
+			const auto Filename{ FString::Printf(TEXT("%s_Player%d.gctrace"), *BaseName, LocalPlayer->GetPlatformUserIndex()) };
+
+			if (bStart)
+			{
+				PlayerSaveSubsystem->StartTraceRecording();
+			}
+			else if (PlayerSaveSubsystem->StopTraceRecording(Filename))
+			{
+				Ar.Logf(TEXT("GameSave.Trace: Wrote %s"), *FGameSaveTrace::ResolveFilename(Filename));
+			}
+		}
+	}
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice TraceCommand(
+		TEXT("GameSave.Trace"),
+		TEXT("Starts or stops recording the save and load traffic of the save subsystems, usage: GameSave.Trace Start | Stop [Filename]"),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&HandleTraceCommand));
+#endif
+}
+
+
+const TCHAR* FGameSaveTraceEvent::GetOpName(EGameSaveTraceOp InOp)
+{
+	static const TCHAR* Names[]{ TEXT("SyncSave"), TEXT("AsyncSave"), TEXT("SyncLoad"), TEXT("AsyncLoad"), TEXT("Delete") };
+	static_assert(UE_ARRAY_COUNT(Names) == static_cast<int32>(EGameSaveTraceOp::MAX), "Names must match EGameSaveTraceOp");
+
+	return (InOp < EGameSaveTraceOp::MAX) ? Names[static_cast<int32>(InOp)] : TEXT("Unknown");
+}
+
+
+const uint32 FGameSaveTrace::MAGIC{ 0x52544347 };
+const int32 FGameSaveTrace::VERSION{ 1 };
+
+void FGameSaveTrace::Serialize(FArchive& Ar)
+{
+	auto Magic{ MAGIC };
+	auto Version{ VERSION };
+
+	Ar << Magic;
+	Ar << Version;
+
+	if ((Magic != MAGIC) || (Version < 1) || (Version > VERSION))
+	{
+		Ar.SetError();
+		return;
+	}
+
+	// Slot names and class paths are stored once and referenced by index
+
+	TArray<FString> Strings;
+	TMap<FString, uint32> StringIndices;
+
+	if (Ar.IsSaving())
+	{
+		for (const auto& Event : Events)
+		{
+			for (const auto* String : { &Event.SlotName, &Event.ClassPath })
+			{
+				if (!StringIndices.Contains(*String))
+				{
+					StringIndices.Add(*String, Strings.Add(*String));
+				}
+			}
+		}
+	}
+
+	Ar << Strings;
+
+	auto NumEvents{ static_cast<uint32>(Events.Num()) };
+	Ar.SerializeIntPacked(NumEvents);
+
+	if (Ar.IsLoading())
+	{
+		Events.Reset();
+		Events.SetNum(static_cast<int32>(NumEvents));
+	}
+
+	// Times are stored in microseconds, relative to the previous event
+
+	uint64 PreviousMicroseconds{ 0 };
+
+	for (auto& Event : Events)
+	{
+		const auto TimeMicroseconds{ GameSaveTrace::ToMicroseconds(Event.Time) };
+
+		auto TimeDelta{ TimeMicroseconds - FMath::Min(TimeMicroseconds, PreviousMicroseconds) };
+		auto Duration{ GameSaveTrace::ToMicroseconds(Event.Duration) };
+		auto SlotIndex{ Ar.IsSaving() ? StringIndices.FindRef(Event.SlotName) : 0 };
+		auto ClassIndex{ Ar.IsSaving() ? StringIndices.FindRef(Event.ClassPath) : 0 };
+		auto UserIndex{ static_cast<uint32>(Event.UserIndex) };
+		auto Op{ static_cast<uint8>(Event.Op) };
+		auto Priority{ static_cast<uint8>(Event.Priority) };
+		auto Outcome{ static_cast<uint8>(Event.Outcome) };
+		auto Size{ static_cast<uint64>(Event.Size) };
+
+		Ar.SerializeIntPacked64(TimeDelta);
+		Ar.SerializeIntPacked64(Duration);
+		Ar.SerializeIntPacked(SlotIndex);
+		Ar.SerializeIntPacked(ClassIndex);
+		Ar.SerializeIntPacked(UserIndex);
+		Ar << Op;
+		Ar << Priority;
+		Ar << Outcome;
+		Ar.SerializeIntPacked64(Size);
+
+		if (Ar.IsLoading())
+		{
+			if (!Strings.IsValidIndex(SlotIndex) || !Strings.IsValidIndex(ClassIndex) || (Op >= static_cast<uint8>(EGameSaveTraceOp::MAX)) || (Outcome >= static_cast<uint8>(EGameSaveTraceOutcome::MAX)))
+			{
+				Ar.SetError();
+				return;
+			}
+
+			Event.Time = GameSaveTrace::ToSeconds(PreviousMicroseconds + TimeDelta);
+			Event.Duration = GameSaveTrace::ToSeconds(Duration);
+			Event.SlotName = Strings[SlotIndex];
+			Event.ClassPath = Strings[ClassIndex];
+			Event.UserIndex = static_cast<int32>(UserIndex);
+			Event.Op = static_cast<EGameSaveTraceOp>(Op);
+			Event.Priority = static_cast<EGameSaveIOPriority>(Priority);
+			Event.Outcome = static_cast<EGameSaveTraceOutcome>(Outcome);
+			Event.Size = static_cast<int64>(Size);
+		}
+
+		PreviousMicroseconds += TimeDelta;
+
+		if (Ar.IsError())
+		{
+			return;
+		}
+	}
+}
+
+bool FGameSaveTrace::SaveToFile(const FString& Filename) const
+{
+	TArray<uint8> Data;
+	FMemoryWriter Writer(Data);
+
+	const_cast<FGameSaveTrace*>(this)->Serialize(Writer);
+
+	return !Writer.IsError() && FFileHelper::SaveArrayToFile(Data, *ResolveFilename(Filename));
+}
+
+bool FGameSaveTrace::LoadFromFile(const FString& Filename)
+{
+	TArray<uint8> Data;
+
+	if (!FFileHelper::LoadFileToArray(Data, *ResolveFilename(Filename)))
+	{
+		return false;
+	}
+
+	FMemoryReader Reader(Data);
+	Serialize(Reader);
+
+	return !Reader.IsError();
+}
+
+FString FGameSaveTrace::ResolveFilename(const FString& Filename)
+{
+	return FPaths::IsRelative(Filename) ? FPaths::ProjectSavedDir() / TEXT("GameSaveTraces") / Filename : Filename;
+}
+
+double FGameSaveTrace::GetDuration() const
+{
+	double EndTime{ 0.0 };
+
+	for (const auto& Event : Events)
+	{
+		EndTime = FMath::Max(EndTime, Event.Time + Event.Duration);
+	}
+
+	return Events.IsEmpty() ? 0.0 : EndTime - Events[0].Time;
+}
+
+
+FGameSaveTraceRecorder::FGameSaveTraceRecorder()
+	: StartTime(FPlatformTime::Seconds())
+{
+}
+
+FGameSaveTraceEvent FGameSaveTraceRecorder::BeginEvent(EGameSaveTraceOp Op, const FString& SlotName, int32 UserIndex, EGameSaveIOPriority Priority) const
+{
+	FGameSaveTraceEvent Event;
+	Event.Time = FPlatformTime::Seconds() - StartTime;
+	Event.SlotName = SlotName;
+	Event.UserIndex = UserIndex;
+	Event.Op = Op;
+	Event.Priority = Priority;
+
+	return Event;
+}
+
+void FGameSaveTraceRecorder::EndEvent(FGameSaveTraceEvent&& Event, EGameSaveTraceOutcome Outcome, int64 Size)
+{
+	Event.Duration = FPlatformTime::Seconds() - StartTime - Event.Time;
+	Event.Outcome = Outcome;
+	Event.Size = Size;
+
+	FScopeLock Lock(&TraceCS);
+
+	Trace.Events.Add(MoveTemp(Event));
+}
+
+FGameSaveTrace FGameSaveTraceRecorder::GetTrace() const
+{
+	FGameSaveTrace Result;
+	{
+		FScopeLock Lock(&TraceCS);
+
+		Result = Trace;
+	}
+
+	// Events are added as operations complete, which is not the order they were issued in
+
+	Result.Events.StableSort([](const FGameSaveTraceEvent& A, const FGameSaveTraceEvent& B) { return A.Time < B.Time; });
+
+	return Result;
+}
+
+int32 FGameSaveTraceRecorder::GetNumEvents() const
+{
+	FScopeLock Lock(&TraceCS);
+
+	return Trace.Events.Num();
+}
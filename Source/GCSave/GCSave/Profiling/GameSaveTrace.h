@@ -0,0 +1,173 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "GameSaveTypes.h"
+
+#include "HAL/CriticalSection.h"
+
+class FArchive;
+
+
+/**
+ * Operations recorded in a FGameSaveTrace
+ */
+enum class EGameSaveTraceOp : uint8
+{
+	SyncSave,
+	AsyncSave,
+	SyncLoad,
+	AsyncLoad,
+	Delete,
+	MAX
+};
+
+
+/**
+ * Outcomes of operations recorded in a FGameSaveTrace
+ */
+enum class EGameSaveTraceOutcome : uint8
+{
+	Failed,
+	Succeeded,
+
+	// A save that was skipped because the slot already held the same data
+	Unchanged,
+	MAX
+};
+
+
+/**
+ * One operation of a FGameSaveTrace
+ */
+struct FGameSaveTraceEvent
+{
+public:
+	FGameSaveTraceEvent() {}
+
+	//
+	// Time in seconds the operation was issued, relative to the start of the recording
+	//
+	double Time{ 0.0 };
+
+	//
+	// Time in seconds from issuing the operation to the call of its delegate
+	//
+	double Duration{ 0.0 };
+
+	FString SlotName;
+
+	int32 UserIndex{ 0 };
+
+	//
+	// Path of the class of the saved or loaded object, empty if there was none
+	//
+	FString ClassPath;
+
+	EGameSaveTraceOp Op{ EGameSaveTraceOp::SyncSave };
+
+	EGameSaveIOPriority Priority{ EGameSaveIOPriority::Critical };
+
+	EGameSaveTraceOutcome Outcome{ EGameSaveTraceOutcome::Failed };
+
+	//
+	// Size of the serialized data that was written or read, 0 if none
+	//
+	int64 Size{ 0 };
+
+public:
+	bool IsSuccess() const { return Outcome != EGameSaveTraceOutcome::Failed; }
+
+	static const TCHAR* GetOpName(EGameSaveTraceOp InOp);
+
+};
+
+
+/**
+ * Recorded save and load traffic, used to benchmark changes against real access patterns
+ *
+ * Tips:
+ *	A trace holds no save data, only the time, slot, class, operation, size, priority and outcome of each operation.
+ *	Slot names and class paths are stored once and times are stored as deltas, so a trace takes a few bytes per operation.
+ *	Replay a trace headless with "-run=GameSaveTraceReplay -Trace=<file>", see UGameSaveTraceReplayCommandlet.
+ */
+struct GCSAVE_API FGameSaveTrace
+{
+public:
+	FGameSaveTrace() {}
+
+	//
+	// Tag used to identify trace files ("GCTR")
+	//
+	static const uint32 MAGIC;
+
+	static const int32 VERSION;
+
+public:
+	//
+	// Operations in the order they were issued
+	//
+	TArray<FGameSaveTraceEvent> Events;
+
+public:
+	/**
+	 * Reads or writes the trace, the archive is set to the error state if the data is not a trace of a supported version
+	 */
+	void Serialize(FArchive& Ar);
+
+	bool SaveToFile(const FString& Filename) const;
+
+	bool LoadFromFile(const FString& Filename);
+
+	/**
+	 * Returns the path of the trace file, relative paths are relative to the Saved/GameSaveTraces directory of the project
+	 */
+	static FString ResolveFilename(const FString& Filename);
+
+	/**
+	 * Returns the time in seconds from the first operation being issued to the last one completing
+	 */
+	double GetDuration() const;
+
+};
+
+
+/**
+ * Collects the operations of the pipelines it is set on into a trace
+ *
+ * Tips:
+ *	Events are begun when an operation is issued and ended when its delegate is called, from any thread
+ */
+class GCSAVE_API FGameSaveTraceRecorder
+{
+public:
+	FGameSaveTraceRecorder();
+
+protected:
+	double StartTime{ 0.0 };
+
+	FGameSaveTrace Trace;
+
+	mutable FCriticalSection TraceCS;
+
+public:
+	/**
+	 * Returns an event of an operation issued now
+	 */
+	FGameSaveTraceEvent BeginEvent(EGameSaveTraceOp Op, const FString& SlotName, int32 UserIndex, EGameSaveIOPriority Priority = EGameSaveIOPriority::Critical) const;
+
+	/**
+	 * Completes the event now and adds it to the trace, can be called from any thread
+	 */
+	void EndEvent(FGameSaveTraceEvent&& Event, EGameSaveTraceOutcome Outcome, int64 Size);
+
+	/**
+	 * Returns a copy of the recorded trace with its events in the order they were issued
+	 */
+	FGameSaveTrace GetTrace() const;
+
+	int32 GetNumEvents() const;
+
+};
+
+using FGameSaveTraceRecorderPtr = TSharedPtr<FGameSaveTraceRecorder, ESPMode::ThreadSafe>;
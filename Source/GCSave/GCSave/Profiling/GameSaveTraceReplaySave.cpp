@@ -0,0 +1,24 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "GameSaveTraceReplaySave.h"
+
+#include "Math/RandomStream.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(GameSaveTraceReplaySave)
+
+
+void UGameSaveTraceReplaySave::SetSerializedSize(int64 Size, int64 Overhead, FRandomStream& Random)
+{
+	const auto NumBytes{ static_cast<int32>(FMath::Clamp<int64>(Size - Overhead, 0, MAX_int32)) };
+
+	Payload.SetNumUninitialized(NumBytes);
+
+	// Random bytes keep blocks of different saves from being alike
+
+	for (int32 Index{ 0 }; Index < NumBytes; Index += sizeof(uint32))
+	{
+		const auto Value{ Random.GetUnsignedInt() };
+
+		FMemory::Memcpy(Payload.GetData() + Index, &Value, FMath::Min<int32>(sizeof(uint32), NumBytes - Index));
+	}
+}
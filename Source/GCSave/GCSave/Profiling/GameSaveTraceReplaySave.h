@@ -0,0 +1,38 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "GameFramework/SaveGame.h"
+
+#include "GameSaveTraceReplaySave.generated.h"
+
+struct FRandomStream;
+
+
+/**
+ * Save used by UGameSaveTraceReplayCommandlet in place of the recorded classes
+ *
+ * Tips:
+ *	The payload is random bytes, so the serialized data has the recorded size without any data of the game
+ */
+UCLASS(NotBlueprintable, HideDropdown)
+class GCSAVE_API UGameSaveTraceReplaySave : public USaveGame
+{
+	GENERATED_BODY()
+public:
+	UGameSaveTraceReplaySave() {}
+
+protected:
+	UPROPERTY()
+	TArray<uint8> Payload;
+
+public:
+	/**
+	 * Fills the payload with random bytes so that the serialized data has about the size
+	 *
+	 * Tips:
+	 *	Overhead is the serialized size of a save with an empty payload
+	 */
+	void SetSerializedSize(int64 Size, int64 Overhead, FRandomStream& Random);
+
+};
@@ -0,0 +1,630 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "ServerPlayerSaveSubsystem.h"
+
+#include "PlayerSave/PlayerSave.h"
+#include "Format/GameSaveHeader.h"
+#include "Pipeline/GameSaveCompletionQueue.h"
+#include "Pipeline/GameSaveIOQueue.h"
+#include "Pipeline/GameSavePipeline.h"
+#include "Storage/GameSaveStorage_Directory.h"
+#include "GameSaveDeveloperSettings.h"
+#include "GCSaveLogs.h"
+
+#include "GameFramework/Controller.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/PlayerState.h"
+#include "Kismet/GameplayStatics.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/Crc.h"
+#include "Misc/Paths.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(ServerPlayerSaveSubsystem)
+
+
+namespace ServerPlayerSaveSubsystem
+{
+	//
+	// User index passed to the pipelines, the directory storage of each player ignores it
+	//
+	static constexpr int32 SLOT_ServerPlayerSave{ 0 };
+
+	//
+	// Maximum time in seconds to wait for the writes in progress on shutdown
+	//
+	static constexpr double SHUTDOWN_TIMEOUT{ 30.0 };
+}
+
+
+bool UServerPlayerSaveSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	if (!Super::ShouldCreateSubsystem(Outer))
+	{
+		return false;
+	}
+
+	return IsRunningDedicatedServer() || GetDefault<UGameSaveDeveloperSettings>()->bServerPlayerSavesOutsideDedicatedServer;
+}
+
+void UServerPlayerSaveSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	const auto* DevSetting{ GetDefault<UGameSaveDeveloperSettings>() };
+
+	IOQueue = MakeShared<FGameSaveIOQueue>(DevSetting->ServerPlayerSaveIOWorkers);
+	CompletionQueue = MakeShared<FGameSaveCompletionQueue>();
+
+	NextWriteBackTime = FPlatformTime::Seconds() + DevSetting->ServerPlayerSaveWriteBackInterval;
+	WriteBackTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::TickWriteBack));
+
+	LogoutHandle = FGameModeEvents::GameModeLogoutEvent.AddUObject(this, &ThisClass::HandleLogout);
+}
+
+void UServerPlayerSaveSubsystem::Deinitialize()
+{
+	FGameModeEvents::GameModeLogoutEvent.Remove(LogoutHandle);
+
+	if (WriteBackTickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(WriteBackTickerHandle);
+		WriteBackTickerHandle.Reset();
+	}
+
+	// Let the writes in progress finish and dispatch their completions, so that the post-save of every finished write has run
+	// before what has changed since is written synchronously. Completions may start the follow-up writes of their slots.
+
+	const auto EndTime{ FPlatformTime::Seconds() + ServerPlayerSaveSubsystem::SHUTDOWN_TIMEOUT };
+
+	while (true)
+	{
+		if (!IOQueue->WaitUntilIdle(FMath::Max(EndTime - FPlatformTime::Seconds(), 0.0)))
+		{
+			UE_LOG(LogGameCore_PlayerSave, Error, TEXT("UServerPlayerSaveSubsystem::Deinitialize: Writes of player saves did not finish in time"));
+			break;
+		}
+
+		if (CompletionQueue->DispatchAll() == 0)
+		{
+			break;
+		}
+	}
+
+	for (const auto& PlayerKVP : Players)
+	{
+		TMap<FString, UPlayerSave*> SavesToWrite;
+
+		for (const auto& FollowUpKVP : PlayerKVP.Value.FollowUpSaves)
+		{
+			SavesToWrite.Add(FollowUpKVP.Key, FollowUpKVP.Value.SaveObject);
+		}
+
+		for (const auto& SaveKVP : PlayerKVP.Value.ActiveSaves)
+		{
+			SavesToWrite.Add(SaveKVP.Key, SaveKVP.Value);
+		}
+
+		for (const auto& SaveKVP : SavesToWrite)
+		{
+			auto* SaveObject{ SaveKVP.Value };
+
+			if (SaveObject && SaveObject->IsDirty())
+			{
+				SaveObject->HandlePreSave();
+
+				const auto bSuccess{ PlayerKVP.Value.Pipeline->SaveGameToSlot(
+					SaveObject, SaveObject->GetSavedDataVersion(), SaveObject->UseUnversionedSerialization(), SaveKVP.Key, ServerPlayerSaveSubsystem::SLOT_ServerPlayerSave) };
+
+				SaveObject->HandlePostSave(bSuccess);
+			}
+		}
+	}
+
+	Players.Reset();
+	WriteBackQueue.Reset();
+
+	Super::Deinitialize();
+}
+
+
+FString UServerPlayerSaveSubsystem::GetPlayerKey(const APlayerState* PlayerState)
+{
+	if (!PlayerState || !PlayerState->GetUniqueId().IsValid())
+	{
+		return FString();
+	}
+
+	return PlayerState->GetUniqueId().ToString();
+}
+
+FString UServerPlayerSaveSubsystem::GetPlayerDirectory(const FString& PlayerKey) const
+{
+	const auto* DevSetting{ GetDefault<UGameSaveDeveloperSettings>() };
+
+	// Players are spread over the shards by the hash of their key
+
+	const auto NumShards{ static_cast<uint32>(FMath::Max(DevSetting->ServerPlayerSaveShards, 1)) };
+	const auto Shard{ FCrc::StrCrc32(*PlayerKey) % NumShards };
+
+	return FPaths::ProjectSavedDir()
+		/ TEXT("SaveGames")
+		/ DevSetting->ServerPlayerSaveDirectory
+		/ FString::Printf(TEXT("%03X"), Shard)
+		/ FPaths::MakeValidFileName(PlayerKey, TEXT('_'));
+}
+
+void UServerPlayerSaveSubsystem::ReleasePlayer(const FString& PlayerKey, bool bSaveChanges)
+{
+	auto* Player{ Players.Find(PlayerKey) };
+	if (!Player)
+	{
+		return;
+	}
+
+	// Saves whose slot is being written are kept as follow-ups, so that changes made during the write are not lost
+
+	if (bSaveChanges)
+	{
+		for (const auto& KVP : Player->ActiveSaves)
+		{
+			if (KVP.Value)
+			{
+				AsyncSavePlayerSaveInternal(PlayerKey, KVP.Value, KVP.Key, FPlayerSaveEventDelegate(), EGameSaveIOPriority::Critical);
+			}
+		}
+	}
+
+	Player->ActiveSaves.Reset();
+	Player->bReleased = true;
+
+	WriteBackQueue.RemoveAll([&PlayerKey](const TPair<FString, FString>& Entry) { return Entry.Key == PlayerKey; });
+
+	RemovePlayerIfIdle(PlayerKey);
+}
+
+FServerPlayerSaves& UServerPlayerSaveSubsystem::FindOrAddPlayer(const FString& PlayerKey)
+{
+	auto& Player{ Players.FindOrAdd(PlayerKey) };
+	Player.bReleased = false;
+
+	if (!Player.Pipeline.IsValid())
+	{
+		Player.Pipeline = MakeShared<FGameSavePipeline>(MakeShared<FGameSaveStorage_Directory>(GetPlayerDirectory(PlayerKey)));
+		Player.Pipeline->SetIOQueue(IOQueue);
+		Player.Pipeline->SetCompletionQueue(CompletionQueue.ToSharedRef());
+	}
+
+	return Player;
+}
+
+void UServerPlayerSaveSubsystem::RemovePlayerIfIdle(const FString& PlayerKey)
+{
+	const auto* Player{ Players.Find(PlayerKey) };
+
+	if (Player && Player->bReleased && Player->PendingSaves.IsEmpty() && Player->FollowUpSaves.IsEmpty() && Player->LoadsAfterPendingSaves.IsEmpty())
+	{
+		Players.Remove(PlayerKey);
+	}
+}
+
+void UServerPlayerSaveSubsystem::HandleLogout(AGameModeBase* GameMode, AController* Exiting)
+{
+	const auto PlayerKey{ GetPlayerKey(Exiting ? Exiting->GetPlayerState<APlayerState>() : nullptr) };
+
+	if (!PlayerKey.IsEmpty())
+	{
+		ReleasePlayer(PlayerKey, true);
+	}
+}
+
+
+UPlayerSave* UServerPlayerSaveSubsystem::GetPlayerSave(const FString& PlayerKey, TSubclassOf<UPlayerSave> PlayerSaveClass, const FString& SlotName) const
+{
+	const auto* Player{ Players.Find(PlayerKey) };
+
+	return Player ? Player->ActiveSaves.FindRef(ResolveSlotName(PlayerSaveClass, SlotName)) : nullptr;
+}
+
+UPlayerSave* UServerPlayerSaveSubsystem::SyncLoadPlayerSave(const FString& PlayerKey, TSubclassOf<UPlayerSave> PlayerSaveClass, const FString& SlotName, bool bForceLoad)
+{
+	// Suspend if no valid player key or slot name
+
+	const auto SlotNameToUse{ ResolveSlotName(PlayerSaveClass, SlotName) };
+	if (PlayerKey.IsEmpty() || SlotNameToUse.IsEmpty())
+	{
+		UE_LOG(LogGameCore_PlayerSave, Error, TEXT("UServerPlayerSaveSubsystem::SyncLoadPlayerSave: No valid player key or slot name"));
+		return nullptr;
+	}
+
+	auto& Player{ FindOrAddPlayer(PlayerKey) };
+
+	if (!bForceLoad)
+	{
+		// If already loaded, return it.
+
+		if (auto FoundSave{ Player.ActiveSaves.FindRef(SlotNameToUse) })
+		{
+			return FoundSave;
+		}
+	}
+
+	// The save waiting for its follow-up write is newer than the slot
+
+	if (auto* FollowUpSave{ ReclaimFollowUpSave(Player, SlotNameToUse) })
+	{
+		return FollowUpSave;
+	}
+
+	// Writes of the slot must finish before it is read, writes of other slots and players are not waited for
+
+	auto Pipeline{ Player.Pipeline };
+
+	if (!Pipeline->WaitForPendingWrites(SlotNameToUse, ServerPlayerSaveSubsystem::SLOT_ServerPlayerSave, ServerPlayerSaveSubsystem::SHUTDOWN_TIMEOUT))
+	{
+		UE_LOG(LogGameCore_PlayerSave, Warning, TEXT("UServerPlayerSaveSubsystem::SyncLoadPlayerSave: Writes of slot(%s) of player(%s) did not finish in time"), *SlotNameToUse, *PlayerKey);
+	}
+
+	// Saves rejected by their header are not deserialized and replaced by a new save
+
+	const auto HeaderFilter
+	{
+		[PlayerSaveClass](const FString& SlotName, const FGameSaveHeader& Header)
+		{
+			return Header.CanLoadAs<UPlayerSave>(PlayerSaveClass, SlotName);
+		}
+	};
+
+	auto* BaseSave{ Pipeline->LoadGameFromSlot(SlotNameToUse, ServerPlayerSaveSubsystem::SLOT_ServerPlayerSave, HeaderFilter) };
+
+	return ProcessLoadedSave(BaseSave, PlayerKey, SlotNameToUse, PlayerSaveClass);
+}
+
+bool UServerPlayerSaveSubsystem::AsyncLoadPlayerSave(const FString& PlayerKey, TSubclassOf<UPlayerSave> PlayerSaveClass, const FString& SlotName, bool bForceLoad, FPlayerSaveEventDelegate Delegate)
+{
+	// Suspend if no valid player key or slot name
+
+	const auto SlotNameToUse{ ResolveSlotName(PlayerSaveClass, SlotName) };
+	if (PlayerKey.IsEmpty() || SlotNameToUse.IsEmpty())
+	{
+		UE_LOG(LogGameCore_PlayerSave, Error, TEXT("UServerPlayerSaveSubsystem::AsyncLoadPlayerSave: No valid player key or slot name"));
+		return false;
+	}
+
+	auto& Player{ FindOrAddPlayer(PlayerKey) };
+
+	if (!bForceLoad)
+	{
+		// If already loaded, return it.
+
+		if (auto FoundSave{ Player.ActiveSaves.FindRef(SlotNameToUse) })
+		{
+			Delegate.ExecuteIfBound(FoundSave, true);
+			return true;
+		}
+	}
+
+	// The save waiting for its follow-up write is newer than the slot
+
+	if (auto* FollowUpSave{ ReclaimFollowUpSave(Player, SlotNameToUse) })
+	{
+		Delegate.ExecuteIfBound(FollowUpSave, true);
+		return true;
+	}
+
+	// Writes of the slot must finish before it is read
+
+	if (Player.PendingSaves.Contains(SlotNameToUse))
+	{
+		Player.LoadsAfterPendingSaves.Add(
+			[this, PlayerKey, PlayerSaveClass, SlotNameToUse, Delegate]()
+			{
+				AsyncLoadPlayerSaveInternal(PlayerKey, PlayerSaveClass, SlotNameToUse, Delegate);
+			}
+		);
+
+		return true;
+	}
+
+	AsyncLoadPlayerSaveInternal(PlayerKey, PlayerSaveClass, SlotNameToUse, Delegate);
+	return true;
+}
+
+bool UServerPlayerSaveSubsystem::AsyncSavePlayerSave(const FString& PlayerKey, TSubclassOf<UPlayerSave> PlayerSaveClass, const FString& SlotName)
+{
+	return AsyncSavePlayerSave(PlayerKey, PlayerSaveClass, SlotName, FPlayerSaveEventDelegate());
+}
+
+bool UServerPlayerSaveSubsystem::AsyncSavePlayerSave(const FString& PlayerKey, TSubclassOf<UPlayerSave> PlayerSaveClass, const FString& SlotName, FPlayerSaveEventDelegate Delegate)
+{
+	// Suspend if no valid slot name
+
+	const auto SlotNameToUse{ ResolveSlotName(PlayerSaveClass, SlotName) };
+	if (SlotNameToUse.IsEmpty())
+	{
+		UE_LOG(LogGameCore_PlayerSave, Error, TEXT("UServerPlayerSaveSubsystem::AsyncSavePlayerSave: No valid slot name"));
+		return false;
+	}
+
+	// If already loaded, save it.
+
+	if (auto* FoundSave{ GetPlayerSave(PlayerKey, PlayerSaveClass, SlotNameToUse) })
+	{
+		AsyncSavePlayerSaveInternal(PlayerKey, FoundSave, SlotNameToUse, Delegate, EGameSaveIOPriority::Critical);
+
+		return true;
+	}
+
+	return false;
+}
+
+FString UServerPlayerSaveSubsystem::ResolveSlotName(TSubclassOf<UPlayerSave> PlayerSaveClass, const FString& SlotName) const
+{
+	// Returns the slot name from the class if available
+
+	auto SlotName_FromClass{ PlayerSaveClass ? PlayerSaveClass.GetDefaultObject()->GetSaveSlotName() : FString() };
+
+	if (!SlotName_FromClass.IsEmpty())
+	{
+		return SlotName_FromClass;
+	}
+
+	// Returns the slot name of the argument if it could not be obtained from the class
+
+	return SlotName;
+}
+
+
+void UServerPlayerSaveSubsystem::AsyncLoadPlayerSaveInternal(const FString& PlayerKey, TSubclassOf<UPlayerSave> PlayerSaveClass, const FString& SlotName, FPlayerSaveEventDelegate Delegate)
+{
+	auto Pipeline{ FindOrAddPlayer(PlayerKey).Pipeline };
+
+	auto Lambda
+	{
+		FAsyncLoadGameFromSlotDelegate::CreateWeakLambda(this,
+			[this, PlayerKey, PlayerSaveClass, Delegate](const FString& SlotName, const int32 Slot, USaveGame* BaseSave)
+			{
+				// Discard the result if the player was released while loading
+
+				const auto* Player{ Players.Find(PlayerKey) };
+
+				if (!Player || Player->bReleased)
+				{
+					Delegate.ExecuteIfBound(nullptr, false);
+					return;
+				}
+
+				auto* LoadedSave{ ProcessLoadedSave(BaseSave, PlayerKey, SlotName, PlayerSaveClass) };
+
+				Delegate.ExecuteIfBound(LoadedSave, IsValid(LoadedSave));
+			}
+		)
+	};
+
+	// Saves rejected by their header are not deserialized and replaced by a new save
+
+	auto HeaderFilter
+	{
+		[PlayerSaveClass](const FString& SlotName, const FGameSaveHeader& Header)
+		{
+			return Header.CanLoadAs<UPlayerSave>(PlayerSaveClass, SlotName);
+		}
+	};
+
+	Pipeline->AsyncLoadGameFromSlot(SlotName, ServerPlayerSaveSubsystem::SLOT_ServerPlayerSave, Lambda, MoveTemp(HeaderFilter));
+}
+
+void UServerPlayerSaveSubsystem::AsyncSavePlayerSaveInternal(const FString& PlayerKey, UPlayerSave* SaveObject, const FString& SlotName, FPlayerSaveEventDelegate Delegate, EGameSaveIOPriority Priority)
+{
+	// Complete immediately if nothing has changed since the last successful save
+
+	if (!SaveObject->IsDirty())
+	{
+		UE_LOG(LogGameCore_PlayerSave, Verbose, TEXT("Skipped saving clean game(%s) of player(%s) to slot(%s)"), *SaveObject->GetName(), *PlayerKey, *SlotName);
+
+		Delegate.ExecuteIfBound(SaveObject, true);
+		return;
+	}
+
+	auto* Player{ Players.Find(PlayerKey) };
+	if (!Player)
+	{
+		Delegate.ExecuteIfBound(SaveObject, false);
+		return;
+	}
+
+	// Writes of a slot are chained so that the pre-save and post-save of one write never overlap with another
+
+	if (Player->PendingSaves.Contains(SlotName))
+	{
+		auto& FollowUp{ Player->FollowUpSaves.FindOrAdd(SlotName) };
+		FollowUp.SaveObject = SaveObject;
+		FollowUp.Delegates.Add(Delegate);
+
+		if (Priority == EGameSaveIOPriority::Critical)
+		{
+			FollowUp.Priority = EGameSaveIOPriority::Critical;
+		}
+
+		return;
+	}
+
+	Player->PendingSaves.Add(SlotName);
+
+	SaveObject->HandlePreSave();
+
+	// The save may be released before the write finishes, only the serialized data is needed for the write
+
+	auto SavedDelegate
+	{
+		FAsyncSaveGameToSlotDelegate::CreateWeakLambda(this,
+			[this, PlayerKey, WeakSaveObject = TWeakObjectPtr<UPlayerSave>(SaveObject), Delegate](const FString& SlotName, const int32 UserIndex, bool bSuccess)
+			{
+				if (auto* SaveObject{ WeakSaveObject.Get() })
+				{
+					SaveObject->HandlePostSave(bSuccess);
+				}
+
+				Delegate.ExecuteIfBound(WeakSaveObject.Get(), bSuccess);
+
+				HandleSaveFinished(PlayerKey, SlotName);
+			}
+		)
+	};
+
+	Player->Pipeline->AsyncSaveGameToSlot(
+		SaveObject, SaveObject->GetSavedDataVersion(), SaveObject->UseUnversionedSerialization(), SlotName, ServerPlayerSaveSubsystem::SLOT_ServerPlayerSave, SavedDelegate, Priority);
+}
+
+UPlayerSave* UServerPlayerSaveSubsystem::ReclaimFollowUpSave(FServerPlayerSaves& Player, const FString& SlotName)
+{
+	const auto* FollowUp{ Player.FollowUpSaves.Find(SlotName) };
+	auto* SaveObject{ FollowUp ? FollowUp->SaveObject.Get() : nullptr };
+
+	if (SaveObject && !Player.ActiveSaves.Contains(SlotName))
+	{
+		Player.ActiveSaves.Emplace(SlotName, SaveObject);
+		return SaveObject;
+	}
+
+	return nullptr;
+}
+
+UPlayerSave* UServerPlayerSaveSubsystem::ProcessLoadedSave(USaveGame* BaseSave, const FString& PlayerKey, const FString& SlotName, TSubclassOf<UPlayerSave> SaveGameClass)
+{
+	auto* LoadedSave{ Cast<UPlayerSave>(BaseSave) };
+
+	if (SaveGameClass && (!LoadedSave || !LoadedSave->IsA(SaveGameClass.Get())))
+	{
+		UE_LOG(LogGameCore_PlayerSave, Warning, TEXT("UServerPlayerSaveSubsystem::ProcessLoadedSave: Found invalid save game object(%s) of player(%s) in slot(%s)"), *GetNameSafe(LoadedSave), *PlayerKey, *SlotName);
+		LoadedSave = nullptr;
+	}
+
+	if (!LoadedSave)
+	{
+		return CreateNewSaveObject(PlayerKey, SaveGameClass, SlotName);
+	}
+
+	LoadedSave->InitializeSaveGame(nullptr, SlotName);
+
+	FindOrAddPlayer(PlayerKey).ActiveSaves.Emplace(SlotName, LoadedSave);
+
+	return LoadedSave;
+}
+
+UPlayerSave* UServerPlayerSaveSubsystem::CreateNewSaveObject(const FString& PlayerKey, TSubclassOf<UPlayerSave> PlayerSaveClass, const FString& SlotName)
+{
+	auto* LoadedSave{ Cast<UPlayerSave>(UGameplayStatics::CreateSaveGameObject(PlayerSaveClass)) };
+
+	if (ensure(LoadedSave))
+	{
+		LoadedSave->ResetToDefault();
+		LoadedSave->InitializeSaveGame(nullptr, SlotName);
+
+		FindOrAddPlayer(PlayerKey).ActiveSaves.Emplace(SlotName, LoadedSave);
+	}
+
+	return LoadedSave;
+}
+
+void UServerPlayerSaveSubsystem::HandleSaveFinished(const FString& PlayerKey, const FString& SlotName)
+{
+	auto* Player{ Players.Find(PlayerKey) };
+	if (!Player)
+	{
+		return;
+	}
+
+	Player->PendingSaves.Remove(SlotName);
+
+	// Start the write requested while this one was in progress, loads keep waiting for it
+
+	FServerPlayerSaveFollowUp FollowUp;
+
+	if (Player->FollowUpSaves.RemoveAndCopyValue(SlotName, FollowUp) && FollowUp.SaveObject)
+	{
+		auto FollowUpDelegate
+		{
+			FPlayerSaveEventDelegate::CreateLambda(
+				[Delegates = MoveTemp(FollowUp.Delegates)](UPlayerSave* SaveObject, bool bSuccess)
+				{
+					for (const auto& Delegate : Delegates)
+					{
+						Delegate.ExecuteIfBound(SaveObject, bSuccess);
+					}
+				}
+			)
+		};
+
+		AsyncSavePlayerSaveInternal(PlayerKey, FollowUp.SaveObject, SlotName, FollowUpDelegate, FollowUp.Priority);
+
+		Player = Players.Find(PlayerKey);
+	}
+
+	// Start the loads that were waiting for the writes of the player
+
+	if (Player->PendingSaves.IsEmpty() && !Player->LoadsAfterPendingSaves.IsEmpty())
+	{
+		const auto Loads{ MoveTemp(Player->LoadsAfterPendingSaves) };
+		Player->LoadsAfterPendingSaves.Reset();
+
+		for (const auto& Load : Loads)
+		{
+			Load();
+		}
+	}
+
+	RemovePlayerIfIdle(PlayerKey);
+}
+
+
+bool UServerPlayerSaveSubsystem::TickWriteBack(float DeltaTime)
+{
+	const auto* DevSetting{ GetDefault<UGameSaveDeveloperSettings>() };
+
+	// Start a new write-back once the previous one has finished
+
+	if ((DevSetting->ServerPlayerSaveWriteBackInterval > 0.0f) && WriteBackQueue.IsEmpty() && (FPlatformTime::Seconds() >= NextWriteBackTime))
+	{
+		NextWriteBackTime = FPlatformTime::Seconds() + DevSetting->ServerPlayerSaveWriteBackInterval;
+
+		RequestWriteBack();
+	}
+
+	// Serialize a limited number of saves per frame, the writes run on the IO queue
+
+	const auto NumToWrite{ FMath::Min(WriteBackQueue.Num(), DevSetting->ServerPlayerSaveWriteBackBatchSize) };
+
+	for (int32 Index{ 0 }; Index < NumToWrite; ++Index)
+	{
+		const auto& Entry{ WriteBackQueue[Index] };
+		const auto* Player{ Players.Find(Entry.Key) };
+
+		if (Player && !Player->PendingSaves.Contains(Entry.Value))
+		{
+			if (auto* SaveObject{ Player->ActiveSaves.FindRef(Entry.Value).Get() })
+			{
+				AsyncSavePlayerSaveInternal(Entry.Key, SaveObject, Entry.Value, FPlayerSaveEventDelegate(), EGameSaveIOPriority::Background);
+			}
+		}
+	}
+
+	WriteBackQueue.RemoveAt(0, NumToWrite);
+
+	return true;
+}
+
+void UServerPlayerSaveSubsystem::RequestWriteBack()
+{
+	for (const auto& PlayerKVP : Players)
+	{
+		for (const auto& SaveKVP : PlayerKVP.Value.ActiveSaves)
+		{
+			if (SaveKVP.Value && SaveKVP.Value->IsDirty() && !PlayerKVP.Value.PendingSaves.Contains(SaveKVP.Key))
+			{
+				WriteBackQueue.AddUnique(TPair<FString, FString>(PlayerKVP.Key, SaveKVP.Key));
+			}
+		}
+	}
+
+	UE_LOG(LogGameCore_PlayerSave, Verbose, TEXT("UServerPlayerSaveSubsystem::RequestWriteBack: Queued %d changed player saves"), WriteBackQueue.Num());
+}
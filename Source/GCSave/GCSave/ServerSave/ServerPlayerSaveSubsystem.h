@@ -0,0 +1,282 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Subsystems/GameInstanceSubsystem.h"
+
+#include "PlayerSave/PlayerSaveSubsystem.h"
+
+#include "Containers/Ticker.h"
+
+#include "ServerPlayerSaveSubsystem.generated.h"
+
+class USaveGame;
+class UPlayerSave;
+class APlayerState;
+class AController;
+class AGameModeBase;
+class FGameSavePipeline;
+class FGameSaveIOQueue;
+class FGameSaveCompletionQueue;
+
+
+/**
+ * Save requested while a write of its slot is in progress, written once that write has finished
+ */
+USTRUCT()
+struct FServerPlayerSaveFollowUp
+{
+	GENERATED_BODY()
+public:
+	FServerPlayerSaveFollowUp() {}
+
+	UPROPERTY()
+	TObjectPtr<UPlayerSave> SaveObject{ nullptr };
+
+	//
+	// Delegates of all requests merged into this write
+	//
+	TArray<FPlayerSaveEventDelegate> Delegates;
+
+	//
+	// Critical if any of the merged requests was critical
+	//
+	EGameSaveIOPriority Priority{ EGameSaveIOPriority::Background };
+
+};
+
+
+/**
+ * Saves of one player connected to the server
+ */
+USTRUCT()
+struct FServerPlayerSaves
+{
+	GENERATED_BODY()
+public:
+	FServerPlayerSaves() {}
+
+	//
+	// List of saved game objects currently loaded
+	//
+	UPROPERTY()
+	TMap<FString, TObjectPtr<UPlayerSave>> ActiveSaves;
+
+	//
+	// Pipeline over the directory of the player
+	//
+	TSharedPtr<FGameSavePipeline> Pipeline;
+
+	//
+	// Slot names currently being written, each slot has at most one write in progress
+	//
+	TSet<FString> PendingSaves;
+
+	//
+	// Saves requested while their slot was being written, by slot name
+	//
+	// Tips:
+	//	Also keeps the saves of a released player alive until their changes made during the write have been written
+	//
+	UPROPERTY()
+	TMap<FString, FServerPlayerSaveFollowUp> FollowUpSaves;
+
+	//
+	// Loads waiting for the writes of the player to finish, so that they never read older data
+	//
+	TArray<TFunction<void()>> LoadsAfterPendingSaves;
+
+	//
+	// Whether the player has been released and is only kept until its writes finish
+	//
+	bool bReleased{ false };
+
+};
+
+
+/**
+ * Subsystem that manages the PlayerSave of every player connected to a server
+ *
+ * Tips:
+ *	Saves are identified by a player key, usually the unique net id of the player, instead of a local player.
+ *	Each player has its own directory, and the directories are spread over ServerPlayerSaveShards subdirectories.
+ *	All reads and writes go through one queue limited to ServerPlayerSaveIOWorkers at the same time,
+ *	and changed saves are written back every ServerPlayerSaveWriteBackInterval seconds in batches, with background priority so that FGameSaveThrottle can pace them.
+ *	Players are released and their changes are written when they log out.
+ *
+ * Note:
+ *	Existing UPlayerSave classes can be used unchanged, GetLocalPlayer of saves managed by this subsystem returns nullptr
+ */
+UCLASS()
+class GCSAVE_API UServerPlayerSaveSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+public:
+	UServerPlayerSaveSubsystem() {}
+
+	//////////////////////////////////////////////////////////////////
+	// Initialization
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+
+	//////////////////////////////////////////////////////////////////
+	// Players
+protected:
+	//
+	// Saves of each player by player key
+	//
+	UPROPERTY(Transient)
+	TMap<FString, FServerPlayerSaves> Players;
+
+	//
+	// Queue shared by the pipelines of all players
+	//
+	TSharedPtr<FGameSaveIOQueue> IOQueue;
+
+	//
+	// Completion queue shared by the pipelines of all players so that the per-frame cap applies to the whole server
+	//
+	// Note:
+	//	Slots of the same name of different players are dispatched in a common order
+	//
+	TSharedPtr<FGameSaveCompletionQueue> CompletionQueue;
+
+	FDelegateHandle LogoutHandle;
+
+public:
+	/**
+	 * Returns the key that identifies the saves of the player, empty if the player has no valid unique net id
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Server Player Save")
+	static FString GetPlayerKey(const APlayerState* PlayerState);
+
+	/**
+	 * Returns the directory where the saves of the player are stored
+	 */
+	FString GetPlayerDirectory(const FString& PlayerKey) const;
+
+	/**
+	 * Returns the number of players that have loaded saves or writes in progress
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Server Player Save")
+	int32 GetNumPlayers() const { return Players.Num(); }
+
+	/**
+	 * Writes the changed saves of the player and releases all of its saves
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Server Player Save", meta = (AdvancedDisplay = "bSaveChanges"))
+	void ReleasePlayer(const FString& PlayerKey, bool bSaveChanges = true);
+
+protected:
+	FServerPlayerSaves& FindOrAddPlayer(const FString& PlayerKey);
+
+	/**
+	 * Removes the player if it has been released and nothing is in progress
+	 */
+	void RemovePlayerIfIdle(const FString& PlayerKey);
+
+	void HandleLogout(AGameModeBase* GameMode, AController* Exiting);
+
+
+	//////////////////////////////////////////////////////////////////
+	// Load Get Save
+public:
+	/**
+	 * Returns the loaded save of the player
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Server Player Save", meta = (DeterminesOutputType = "PlayerSaveClass"))
+	UPlayerSave* GetPlayerSave(const FString& PlayerKey, TSubclassOf<UPlayerSave> PlayerSaveClass, const FString& SlotName) const;
+
+	/**
+	 * Load the save of the player synchronously.
+	 *
+	 * Note:
+	 *	Blocks until the writes in progress of the slot have finished, so that older data is never read.
+	 *	A save of a released player still waiting for its last write is returned instead of being read, since it holds the newest data.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Server Player Save", meta = (AdvancedDisplay = "bForceLoad", DeterminesOutputType = "PlayerSaveClass"))
+	UPlayerSave* SyncLoadPlayerSave(const FString& PlayerKey, TSubclassOf<UPlayerSave> PlayerSaveClass, const FString& SlotName, bool bForceLoad = false);
+
+	/**
+	 * Load the save of the player asynchronously.
+	 */
+	bool AsyncLoadPlayerSave(
+		const FString& PlayerKey
+		, TSubclassOf<UPlayerSave> PlayerSaveClass
+		, const FString& SlotName
+		, bool bForceLoad = false
+		, FPlayerSaveEventDelegate Delegate = FPlayerSaveEventDelegate());
+
+	/**
+	 * Save the loaded save of the player asynchronously
+	 *
+	 * Note:
+	 *	Cannot save if the specified save game has not yet been loaded
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Server Player Save", meta = (DisplayName = "Async Save Server Player Save"))
+	bool AsyncSavePlayerSave(const FString& PlayerKey, TSubclassOf<UPlayerSave> PlayerSaveClass, const FString& SlotName);
+
+	bool AsyncSavePlayerSave(
+		const FString& PlayerKey
+		, TSubclassOf<UPlayerSave> PlayerSaveClass
+		, const FString& SlotName
+		, FPlayerSaveEventDelegate Delegate);
+
+	/**
+	 * Returns the slot name of the class if it has one, otherwise SlotName
+	 */
+	FString ResolveSlotName(TSubclassOf<UPlayerSave> PlayerSaveClass, const FString& SlotName) const;
+
+protected:
+	void AsyncLoadPlayerSaveInternal(const FString& PlayerKey, TSubclassOf<UPlayerSave> PlayerSaveClass, const FString& SlotName, FPlayerSaveEventDelegate Delegate);
+	/**
+	 * Writes the save, or merges it into the follow-up write of the slot if a write of the slot is in progress
+	 */
+	void AsyncSavePlayerSaveInternal(const FString& PlayerKey, UPlayerSave* SaveObject, const FString& SlotName, FPlayerSaveEventDelegate Delegate, EGameSaveIOPriority Priority);
+
+	/**
+	 * Moves the save waiting for a follow-up write of a released player back to the active saves, returns nullptr if there is none
+	 */
+	UPlayerSave* ReclaimFollowUpSave(FServerPlayerSaves& Player, const FString& SlotName);
+
+	UPlayerSave* ProcessLoadedSave(USaveGame* BaseSave, const FString& PlayerKey, const FString& SlotName, TSubclassOf<UPlayerSave> SaveGameClass);
+	UPlayerSave* CreateNewSaveObject(const FString& PlayerKey, TSubclassOf<UPlayerSave> PlayerSaveClass, const FString& SlotName);
+
+	void HandleSaveFinished(const FString& PlayerKey, const FString& SlotName);
+
+
+	//////////////////////////////////////////////////////////////////
+	// Write Back
+protected:
+	//
+	// Saves waiting to be written back, as pairs of player key and slot name
+	//
+	TArray<TPair<FString, FString>> WriteBackQueue;
+
+	FTSTicker::FDelegateHandle WriteBackTickerHandle;
+
+	double NextWriteBackTime{ 0.0 };
+
+protected:
+	/**
+	 * Starts a write-back every interval, and writes up to ServerPlayerSaveWriteBackBatchSize saves of it per frame
+	 */
+	bool TickWriteBack(float DeltaTime);
+
+public:
+	/**
+	 * Queues the changed saves of all players for the write-back
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Server Player Save")
+	void RequestWriteBack();
+
+	/**
+	 * Returns whether there are saves waiting to be written back
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Server Player Save")
+	bool IsWritingBack() const { return WriteBackQueue.Num() > 0; }
+
+};
@@ -0,0 +1,81 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "GameSaveStorage.h"
+
+#include "Storage/GameSaveStorage_Memory.h"
+#include "Storage/GameSaveStorage_Packed.h"
+#include "Storage/GameSaveStorage_PlatformFile.h"
+#include "GameSaveDeveloperSettings.h"
+#include "GCSaveLogs.h"
+
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+
+
+TSharedRef<IGameSaveStorage> IGameSaveStorage::Create(EGameSaveStorageType StorageType)
+{
+	switch (StorageType)
+	{
+	case EGameSaveStorageType::Memory:
+		return MakeShared<FGameSaveStorage_Memory>();
+
+	case EGameSaveStorageType::Packed:
+		if (auto PackedStorage{ FGameSaveStorage_Packed::FindOrCreate(FGameSaveStorage_Packed::GetDefaultContainerPath()) })
+		{
+			return PackedStorage.ToSharedRef();
+		}
+
+		UE_LOG(LogGameCore_Save, Error, TEXT("IGameSaveStorage::Create: Failed to open the packed container, falling back to the platform file storage"));
+		return MakeShared<FGameSaveStorage_PlatformFile>();
+
+	case EGameSaveStorageType::PlatformFile:
+	default:
+		return MakeShared<FGameSaveStorage_PlatformFile>();
+	}
+}
+
+bool IGameSaveStorage::ReadSlotPrefix(const FString& SlotName, int32 UserIndex, int64 MaxSize, TArray<uint8>& OutData)
+{
+	if (!ReadSlot(SlotName, UserIndex, OutData))
+	{
+		return false;
+	}
+
+	if (OutData.Num() > MaxSize)
+	{
+		OutData.SetNum(static_cast<int32>(MaxSize));
+	}
+
+	return true;
+}
+
+bool IGameSaveStorage::WriteSlotChunked(const FString& SlotName, int32 UserIndex, const TArray<uint8>& InData, int64 ChunkSize, TFunctionRef<void(int64)> BeforeChunk)
+{
+	// The slot can only be written at once, so the chunks only pace the write
+
+	for (int64 Offset{ 0 }; Offset < InData.Num(); Offset += ChunkSize)
+	{
+		BeforeChunk(FMath::Min<int64>(ChunkSize, InData.Num() - Offset));
+	}
+
+	return WriteSlot(SlotName, UserIndex, InData);
+}
+
+EGameSaveStorageType IGameSaveStorage::GetDefaultStorageType()
+{
+	FString TypeName;
+
+	if (FParse::Value(FCommandLine::Get(), TEXT("GameSaveStorage="), TypeName))
+	{
+		const auto Value{ StaticEnum<EGameSaveStorageType>()->GetValueByNameString(TypeName) };
+
+		if (Value != INDEX_NONE)
+		{
+			return static_cast<EGameSaveStorageType>(Value);
+		}
+
+		UE_LOG(LogGameCore_Save, Warning, TEXT("IGameSaveStorage::GetDefaultStorageType: Unknown storage type(%s) on the command line"), *TypeName);
+	}
+
+	return GetDefault<UGameSaveDeveloperSettings>()->StorageType;
+}
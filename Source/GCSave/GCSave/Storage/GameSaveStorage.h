@@ -0,0 +1,70 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "GameSaveTypes.h"
+
+#include "Templates/Function.h"
+
+
+/**
+ * Interface of the place where serialized save data is stored
+ *
+ * Tips:
+ *	Slots are identified by the slot name and the user index, as in UGameplayStatics.
+ *
+ * Note:
+ *	All functions may be called from any thread, so implementations must be thread-safe
+ */
+class GCSAVE_API IGameSaveStorage
+{
+public:
+	virtual ~IGameSaveStorage() {}
+
+	/**
+	 * Creates the storage of the type
+	 */
+	static TSharedRef<IGameSaveStorage> Create(EGameSaveStorageType StorageType);
+
+	/**
+	 * Returns the type of the storage set in UGameSaveDeveloperSettings, can be overridden by "-GameSaveStorage=<Type>" on the command line
+	 */
+	static EGameSaveStorageType GetDefaultStorageType();
+
+public:
+	/**
+	 * Returns the name of the storage for logs
+	 */
+	virtual FString GetStorageName() const = 0;
+
+	virtual bool DoesSlotExist(const FString& SlotName, int32 UserIndex) = 0;
+
+	virtual bool ReadSlot(const FString& SlotName, int32 UserIndex, TArray<uint8>& OutData) = 0;
+
+	/**
+	 * Reads up to MaxSize bytes from the start of the slot
+	 *
+	 * Tips:
+	 *	Reads the whole slot by default, override if the storage can read a part of a slot
+	 */
+	virtual bool ReadSlotPrefix(const FString& SlotName, int32 UserIndex, int64 MaxSize, TArray<uint8>& OutData);
+
+	virtual bool WriteSlot(const FString& SlotName, int32 UserIndex, const TArray<uint8>& InData) = 0;
+
+	/**
+	 * Writes the slot in chunks of ChunkSize bytes and calls BeforeChunk with the size of each chunk before it is written
+	 *
+	 * Tips:
+	 *	Used by throttled writes, BeforeChunk may block to pace the write.
+	 *	Calls BeforeChunk for all chunks and then writes the whole slot by default, override if the storage can write a slot in parts.
+	 */
+	virtual bool WriteSlotChunked(const FString& SlotName, int32 UserIndex, const TArray<uint8>& InData, int64 ChunkSize, TFunctionRef<void(int64)> BeforeChunk);
+
+	virtual bool DeleteSlot(const FString& SlotName, int32 UserIndex) = 0;
+
+	/**
+	 * Returns the names of all slots of the user
+	 */
+	virtual bool GetSlotNames(int32 UserIndex, TArray<FString>& OutSlotNames) = 0;
+
+};
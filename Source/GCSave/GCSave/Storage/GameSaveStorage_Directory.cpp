@@ -0,0 +1,153 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "GameSaveStorage_Directory.h"
+
+#include "GCSaveLogs.h"
+
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Guid.h"
+#include "Misc/Paths.h"
+
+
+namespace GameSaveStorage_Directory
+{
+	static const TCHAR* SLOT_EXTENSION{ TEXT(".sav") };
+	static const TCHAR* TEMP_EXTENSION{ TEXT(".tmp") };
+}
+
+
+FGameSaveStorage_Directory::FGameSaveStorage_Directory(const FString& InDirectory)
+	: Directory(InDirectory)
+{
+}
+
+
+bool FGameSaveStorage_Directory::DoesSlotExist(const FString& SlotName, int32 UserIndex)
+{
+	return (SlotName.Len() > 0) && IFileManager::Get().FileExists(*GetSlotPath(SlotName));
+}
+
+bool FGameSaveStorage_Directory::ReadSlot(const FString& SlotName, int32 UserIndex, TArray<uint8>& OutData)
+{
+	return (SlotName.Len() > 0) && FFileHelper::LoadFileToArray(OutData, *GetSlotPath(SlotName), FILEREAD_Silent);
+}
+
+bool FGameSaveStorage_Directory::ReadSlotPrefix(const FString& SlotName, int32 UserIndex, int64 MaxSize, TArray<uint8>& OutData)
+{
+	TUniquePtr<FArchive> Reader{ (SlotName.Len() > 0) ? IFileManager::Get().CreateFileReader(*GetSlotPath(SlotName), FILEREAD_Silent) : nullptr };
+
+	if (!Reader)
+	{
+		return false;
+	}
+
+	const auto ReadSize{ FMath::Min(Reader->TotalSize(), MaxSize) };
+	OutData.SetNumUninitialized(static_cast<int32>(ReadSize));
+	Reader->Serialize(OutData.GetData(), ReadSize);
+
+	return Reader->Close();
+}
+
+bool FGameSaveStorage_Directory::WriteSlot(const FString& SlotName, int32 UserIndex, const TArray<uint8>& InData)
+{
+	if ((SlotName.Len() <= 0) || (InData.Num() <= 0))
+	{
+		return false;
+	}
+
+	// Write next to the slot and replace it only once the data is complete, concurrent writes of the slot use their own file
+
+	const auto SlotPath{ GetSlotPath(SlotName) };
+	const auto TempPath{ MakeTempPath(SlotPath) };
+
+	if (!FFileHelper::SaveArrayToFile(InData, *TempPath))
+	{
+		UE_LOG(LogGameCore_Save, Error, TEXT("FGameSaveStorage_Directory::WriteSlot: Failed to write file(%s)"), *TempPath);
+		return false;
+	}
+
+	return ReplaceSlotFile(SlotPath, TempPath);
+}
+
+bool FGameSaveStorage_Directory::WriteSlotChunked(const FString& SlotName, int32 UserIndex, const TArray<uint8>& InData, int64 ChunkSize, TFunctionRef<void(int64)> BeforeChunk)
+{
+	if ((SlotName.Len() <= 0) || (InData.Num() <= 0))
+	{
+		return false;
+	}
+
+	const auto SlotPath{ GetSlotPath(SlotName) };
+	const auto TempPath{ MakeTempPath(SlotPath) };
+
+	bool bWritten{ false };
+
+	if (TUniquePtr<FArchive> Writer{ IFileManager::Get().CreateFileWriter(*TempPath, FILEWRITE_Silent) })
+	{
+		// Each chunk is flushed so that it reaches the disk before the next one waits for budget
+
+		for (int64 Offset{ 0 }; (Offset < InData.Num()) && !Writer->IsError(); Offset += ChunkSize)
+		{
+			const auto Size{ FMath::Min<int64>(ChunkSize, InData.Num() - Offset) };
+
+			BeforeChunk(Size);
+
+			Writer->Serialize(const_cast<uint8*>(InData.GetData() + Offset), Size);
+			Writer->Flush();
+		}
+
+		bWritten = Writer->Close();
+	}
+
+	if (!bWritten)
+	{
+		UE_LOG(LogGameCore_Save, Error, TEXT("FGameSaveStorage_Directory::WriteSlotChunked: Failed to write file(%s)"), *TempPath);
+
+		IFileManager::Get().Delete(*TempPath, false, false, true);
+		return false;
+	}
+
+	return ReplaceSlotFile(SlotPath, TempPath);
+}
+
+bool FGameSaveStorage_Directory::DeleteSlot(const FString& SlotName, int32 UserIndex)
+{
+	return (SlotName.Len() > 0) && IFileManager::Get().Delete(*GetSlotPath(SlotName), false, false, true);
+}
+
+bool FGameSaveStorage_Directory::GetSlotNames(int32 UserIndex, TArray<FString>& OutSlotNames)
+{
+	TArray<FString> FileNames;
+	IFileManager::Get().FindFiles(FileNames, *(Directory / FString(TEXT("*")) + GameSaveStorage_Directory::SLOT_EXTENSION), true, false);
+
+	for (const auto& FileName : FileNames)
+	{
+		OutSlotNames.Add(FPaths::GetBaseFilename(FileName));
+	}
+
+	return true;
+}
+
+
+FString FGameSaveStorage_Directory::GetSlotPath(const FString& SlotName) const
+{
+	return Directory / (SlotName + GameSaveStorage_Directory::SLOT_EXTENSION);
+}
+
+FString FGameSaveStorage_Directory::MakeTempPath(const FString& SlotPath) const
+{
+	return FString::Printf(TEXT("%s.%s%s"), *SlotPath, *FGuid::NewGuid().ToString(), GameSaveStorage_Directory::TEMP_EXTENSION);
+}
+
+bool FGameSaveStorage_Directory::ReplaceSlotFile(const FString& SlotPath, const FString& TempPath) const
+{
+	if (!IFileManager::Get().Move(*SlotPath, *TempPath, true, true))
+	{
+		UE_LOG(LogGameCore_Save, Error, TEXT("FGameSaveStorage_Directory::ReplaceSlotFile: Failed to replace file(%s)"), *SlotPath);
+
+		IFileManager::Get().Delete(*TempPath, false, false, true);
+		return false;
+	}
+
+	return true;
+}
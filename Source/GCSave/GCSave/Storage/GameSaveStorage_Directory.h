@@ -0,0 +1,58 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Storage/GameSaveStorage.h"
+
+
+/**
+ * Storage that keeps each slot as a file in one directory
+ *
+ * Tips:
+ *	Each slot is written to a temporary file first and then moved over the old file, so a failed write never leaves a broken slot.
+ *	Used by the server player saves, where each player has a directory of its own.
+ *
+ * Note:
+ *	The user index is ignored, all users share the directory
+ */
+class GCSAVE_API FGameSaveStorage_Directory : public IGameSaveStorage
+{
+public:
+	explicit FGameSaveStorage_Directory(const FString& InDirectory);
+
+protected:
+	FString Directory;
+
+public:
+	const FString& GetDirectory() const { return Directory; }
+
+	virtual FString GetStorageName() const override { return TEXT("Directory"); }
+
+	virtual bool DoesSlotExist(const FString& SlotName, int32 UserIndex) override;
+
+	virtual bool ReadSlot(const FString& SlotName, int32 UserIndex, TArray<uint8>& OutData) override;
+
+	virtual bool ReadSlotPrefix(const FString& SlotName, int32 UserIndex, int64 MaxSize, TArray<uint8>& OutData) override;
+
+	virtual bool WriteSlot(const FString& SlotName, int32 UserIndex, const TArray<uint8>& InData) override;
+
+	virtual bool WriteSlotChunked(const FString& SlotName, int32 UserIndex, const TArray<uint8>& InData, int64 ChunkSize, TFunctionRef<void(int64)> BeforeChunk) override;
+
+	virtual bool DeleteSlot(const FString& SlotName, int32 UserIndex) override;
+
+	virtual bool GetSlotNames(int32 UserIndex, TArray<FString>& OutSlotNames) override;
+
+protected:
+	FString GetSlotPath(const FString& SlotName) const;
+
+	/**
+	 * Returns a unique path next to the slot where its new data is written
+	 */
+	FString MakeTempPath(const FString& SlotPath) const;
+
+	/**
+	 * Moves the completely written temporary file over the slot, the temporary file is deleted if it fails
+	 */
+	bool ReplaceSlotFile(const FString& SlotPath, const FString& TempPath) const;
+
+};
@@ -0,0 +1,80 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "GameSaveStorage_Memory.h"
+
+#include "Misc/ScopeRWLock.h"
+
+
+bool FGameSaveStorage_Memory::DoesSlotExist(const FString& SlotName, int32 UserIndex)
+{
+	FReadScopeLock ReadLock(SlotsLock);
+
+	const auto* UserSlots{ Slots.Find(UserIndex) };
+	return UserSlots && UserSlots->Contains(SlotName);
+}
+
+bool FGameSaveStorage_Memory::ReadSlot(const FString& SlotName, int32 UserIndex, TArray<uint8>& OutData)
+{
+	FReadScopeLock ReadLock(SlotsLock);
+
+	const auto* UserSlots{ Slots.Find(UserIndex) };
+	const auto* Data{ UserSlots ? UserSlots->Find(SlotName) : nullptr };
+
+	if (Data)
+	{
+		OutData = *Data;
+		return true;
+	}
+
+	return false;
+}
+
+bool FGameSaveStorage_Memory::ReadSlotPrefix(const FString& SlotName, int32 UserIndex, int64 MaxSize, TArray<uint8>& OutData)
+{
+	FReadScopeLock ReadLock(SlotsLock);
+
+	const auto* UserSlots{ Slots.Find(UserIndex) };
+	const auto* Data{ UserSlots ? UserSlots->Find(SlotName) : nullptr };
+
+	if (Data)
+	{
+		OutData = TArray<uint8>(Data->GetData(), static_cast<int32>(FMath::Min<int64>(Data->Num(), MaxSize)));
+		return true;
+	}
+
+	return false;
+}
+
+bool FGameSaveStorage_Memory::WriteSlot(const FString& SlotName, int32 UserIndex, const TArray<uint8>& InData)
+{
+	if (SlotName.IsEmpty() || (InData.Num() <= 0))
+	{
+		return false;
+	}
+
+	FWriteScopeLock WriteLock(SlotsLock);
+
+	Slots.FindOrAdd(UserIndex).Add(SlotName, InData);
+
+	return true;
+}
+
+bool FGameSaveStorage_Memory::DeleteSlot(const FString& SlotName, int32 UserIndex)
+{
+	FWriteScopeLock WriteLock(SlotsLock);
+
+	auto* UserSlots{ Slots.Find(UserIndex) };
+	return UserSlots && (UserSlots->Remove(SlotName) > 0);
+}
+
+bool FGameSaveStorage_Memory::GetSlotNames(int32 UserIndex, TArray<FString>& OutSlotNames)
+{
+	FReadScopeLock ReadLock(SlotsLock);
+
+	if (const auto* UserSlots{ Slots.Find(UserIndex) })
+	{
+		UserSlots->GetKeys(OutSlotNames);
+	}
+
+	return true;
+}
@@ -0,0 +1,44 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Storage/GameSaveStorage.h"
+
+#include "HAL/CriticalSection.h"
+
+
+/**
+ * Storage that keeps the data in memory without touching the disk
+ *
+ * Tips:
+ *	Used to measure the cost of serialization in isolation and to run tests
+ */
+class GCSAVE_API FGameSaveStorage_Memory : public IGameSaveStorage
+{
+public:
+	FGameSaveStorage_Memory() {}
+
+protected:
+	//
+	// Data of each slot by user index
+	//
+	TMap<int32, TMap<FString, TArray<uint8>>> Slots;
+
+	FRWLock SlotsLock;
+
+public:
+	virtual FString GetStorageName() const override { return TEXT("Memory"); }
+
+	virtual bool DoesSlotExist(const FString& SlotName, int32 UserIndex) override;
+
+	virtual bool ReadSlot(const FString& SlotName, int32 UserIndex, TArray<uint8>& OutData) override;
+
+	virtual bool ReadSlotPrefix(const FString& SlotName, int32 UserIndex, int64 MaxSize, TArray<uint8>& OutData) override;
+
+	virtual bool WriteSlot(const FString& SlotName, int32 UserIndex, const TArray<uint8>& InData) override;
+
+	virtual bool DeleteSlot(const FString& SlotName, int32 UserIndex) override;
+
+	virtual bool GetSlotNames(int32 UserIndex, TArray<FString>& OutSlotNames) override;
+
+};
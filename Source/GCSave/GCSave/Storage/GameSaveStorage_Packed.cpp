@@ -0,0 +1,607 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "GameSaveStorage_Packed.h"
+
+#include "GCSaveLogs.h"
+
+#include "Async/Async.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Crc.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+
+namespace GameSaveStorage_Packed
+{
+	//
+	// "GCPK", written at the beginning of the container
+	//
+	static constexpr uint32 CONTAINER_MAGIC{ 0x4B504347 };
+	static constexpr int32 CONTAINER_VERSION{ 1 };
+	static constexpr int64 CONTAINER_HEADER_SIZE{ sizeof(CONTAINER_MAGIC) + sizeof(CONTAINER_VERSION) };
+
+	//
+	// "GCRC", written at the beginning of each record
+	//
+	static constexpr uint32 RECORD_MAGIC{ 0x43524347 };
+
+	//
+	// Compaction does not run until the dead records take up at least this size
+	//
+	static constexpr int64 MIN_COMPACTION_BYTES{ 64 * 1024 };
+
+	static FCriticalSection InstancesCS;
+	static TMap<FString, TWeakPtr<FGameSaveStorage_Packed>> Instances;
+
+	/**
+	 * Header of a record, the data of the slot follows it
+	 */
+	struct FRecordHeader
+	{
+	public:
+		int32 UserIndex{ INDEX_NONE };
+		FString SlotName;
+		int64 DataSize{ 0 };
+		uint32 DataCrc{ 0 };
+		bool bDeleted{ false };
+
+	public:
+		friend FArchive& operator<<(FArchive& Ar, FRecordHeader& Header)
+		{
+			Ar << Header.UserIndex;
+			Ar << Header.SlotName;
+			Ar << Header.DataSize;
+			Ar << Header.DataCrc;
+			Ar << Header.bDeleted;
+
+			return Ar;
+		}
+	};
+
+	static FString GetTempPath(const FString& ContainerPath)
+	{
+		return ContainerPath + TEXT(".tmp");
+	}
+
+	static FString GetBackupPath(const FString& ContainerPath)
+	{
+		return ContainerPath + TEXT(".bak");
+	}
+}
+
+
+FGameSaveStorage_Packed::FGameSaveStorage_Packed(const FString& InContainerPath)
+	: ContainerPath(InContainerPath)
+{
+}
+
+FGameSaveStorage_Packed::~FGameSaveStorage_Packed()
+{
+	FScopeLock Lock(&ContainerCS);
+
+	FileHandle.Reset();
+}
+
+TSharedPtr<FGameSaveStorage_Packed> FGameSaveStorage_Packed::FindOrCreate(const FString& InContainerPath)
+{
+	const auto FullPath{ FPaths::ConvertRelativePathToFull(InContainerPath) };
+
+	FScopeLock Lock(&GameSaveStorage_Packed::InstancesCS);
+
+	if (auto Existing{ GameSaveStorage_Packed::Instances.FindRef(FullPath).Pin() })
+	{
+		return Existing;
+	}
+
+	auto NewStorage{ MakeShared<FGameSaveStorage_Packed>(FullPath) };
+
+	const auto OpenResult{ NewStorage->OpenContainer() };
+
+	if (OpenResult == EGameSavePackedOpenResult::Failed)
+	{
+		return nullptr;
+	}
+
+	// Drop the broken records right away so that new records are not appended after them
+
+	if (OpenResult == EGameSavePackedOpenResult::BrokenTail)
+	{
+		NewStorage->Compact();
+	}
+
+	GameSaveStorage_Packed::Instances.Add(FullPath, NewStorage);
+
+	return NewStorage;
+}
+
+FString FGameSaveStorage_Packed::GetDefaultContainerPath()
+{
+	return FPaths::ProjectSavedDir() / TEXT("SaveGames") / TEXT("SaveGames.pack");
+}
+
+
+bool FGameSaveStorage_Packed::DoesSlotExist(const FString& SlotName, int32 UserIndex)
+{
+	FScopeLock Lock(&ContainerCS);
+
+	return Index.Contains(MakeSlotKey(SlotName, UserIndex));
+}
+
+bool FGameSaveStorage_Packed::ReadSlot(const FString& SlotName, int32 UserIndex, TArray<uint8>& OutData)
+{
+	FScopeLock Lock(&ContainerCS);
+
+	const auto* Location{ Index.Find(MakeSlotKey(SlotName, UserIndex)) };
+
+	if (!Location || !FileHandle)
+	{
+		return false;
+	}
+
+	if (!ReadRecordData(*FileHandle, *Location, OutData))
+	{
+		UE_LOG(LogGameCore_Save, Error, TEXT("FGameSaveStorage_Packed::ReadSlot: Record of slot(%s) in container(%s) is broken"), *SlotName, *ContainerPath);
+		return false;
+	}
+
+	return true;
+}
+
+bool FGameSaveStorage_Packed::ReadSlotPrefix(const FString& SlotName, int32 UserIndex, int64 MaxSize, TArray<uint8>& OutData)
+{
+	FScopeLock Lock(&ContainerCS);
+
+	const auto* Location{ Index.Find(MakeSlotKey(SlotName, UserIndex)) };
+
+	if (!Location || !FileHandle)
+	{
+		return false;
+	}
+
+	// The checksum covers the whole record, so a part of it cannot be verified
+
+	const auto ReadSize{ FMath::Min(Location->DataSize, MaxSize) };
+	OutData.SetNumUninitialized(static_cast<int32>(ReadSize));
+
+	return FileHandle->Seek(Location->DataOffset) && FileHandle->Read(OutData.GetData(), ReadSize);
+}
+
+bool FGameSaveStorage_Packed::WriteSlot(const FString& SlotName, int32 UserIndex, const TArray<uint8>& InData)
+{
+	if (SlotName.IsEmpty() || (InData.Num() <= 0))
+	{
+		return false;
+	}
+
+	FScopeLock Lock(&ContainerCS);
+
+	if (!FileHandle)
+	{
+		return false;
+	}
+
+	FRecordLocation NewLocation;
+
+	if (!WriteRecord(*FileHandle, UserIndex, SlotName, InData.GetData(), InData.Num(), false, NewLocation))
+	{
+		UE_LOG(LogGameCore_Save, Error, TEXT("FGameSaveStorage_Packed::WriteSlot: Failed to append slot(%s) to container(%s)"), *SlotName, *ContainerPath);
+		return false;
+	}
+
+	UpdateIndex(MakeSlotKey(SlotName, UserIndex), &NewLocation, NewLocation.RecordSize);
+
+	RequestCompactionIfNeeded();
+
+	return true;
+}
+
+bool FGameSaveStorage_Packed::DeleteSlot(const FString& SlotName, int32 UserIndex)
+{
+	FScopeLock Lock(&ContainerCS);
+
+	const auto SlotKey{ MakeSlotKey(SlotName, UserIndex) };
+
+	if (!FileHandle || !Index.Contains(SlotKey))
+	{
+		return false;
+	}
+
+	// Append a tombstone so that the slot stays deleted when the index is rebuilt
+
+	FRecordLocation Tombstone;
+
+	if (!WriteRecord(*FileHandle, UserIndex, SlotName, nullptr, 0, true, Tombstone))
+	{
+		UE_LOG(LogGameCore_Save, Error, TEXT("FGameSaveStorage_Packed::DeleteSlot: Failed to append tombstone of slot(%s) to container(%s)"), *SlotName, *ContainerPath);
+		return false;
+	}
+
+	UpdateIndex(SlotKey, nullptr, Tombstone.RecordSize);
+
+	RequestCompactionIfNeeded();
+
+	return true;
+}
+
+bool FGameSaveStorage_Packed::GetSlotNames(int32 UserIndex, TArray<FString>& OutSlotNames)
+{
+	FScopeLock Lock(&ContainerCS);
+
+	for (const auto& KVP : Index)
+	{
+		if (KVP.Value.UserIndex == UserIndex)
+		{
+			OutSlotNames.Add(KVP.Value.SlotName);
+		}
+	}
+
+	return true;
+}
+
+
+void FGameSaveStorage_Packed::Compact()
+{
+	{
+		FScopeLock Lock(&ContainerCS);
+
+		if (bCompacting)
+		{
+			return;
+		}
+
+		bCompacting = true;
+	}
+
+	RunCompaction();
+}
+
+int64 FGameSaveStorage_Packed::GetDeadBytes() const
+{
+	FScopeLock Lock(&ContainerCS);
+
+	return DeadBytes;
+}
+
+
+EGameSavePackedOpenResult FGameSaveStorage_Packed::OpenContainer()
+{
+	auto& PlatformFile{ FPlatformFileManager::Get().GetPlatformFile() };
+
+	// Restore the previous container if the last compaction was interrupted while swapping
+
+	const auto BackupPath{ GameSaveStorage_Packed::GetBackupPath(ContainerPath) };
+
+	if (!PlatformFile.FileExists(*ContainerPath) && PlatformFile.FileExists(*BackupPath))
+	{
+		PlatformFile.MoveFile(*ContainerPath, *BackupPath);
+	}
+
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(ContainerPath));
+
+	FileHandle.Reset(PlatformFile.OpenWrite(*ContainerPath, true, true));
+
+	if (!FileHandle)
+	{
+		UE_LOG(LogGameCore_Save, Error, TEXT("FGameSaveStorage_Packed::OpenContainer: Failed to open container(%s)"), *ContainerPath);
+		return EGameSavePackedOpenResult::Failed;
+	}
+
+	Index.Reset();
+	DeadBytes = 0;
+	LiveBytes = 0;
+
+	const auto FileSize{ FileHandle->Size() };
+
+	// Write the header to a new container, a partial header is left by an interrupted creation and is written again
+
+	if (FileSize < GameSaveStorage_Packed::CONTAINER_HEADER_SIZE)
+	{
+		if (FileSize > 0)
+		{
+			UE_LOG(LogGameCore_Save, Warning, TEXT("FGameSaveStorage_Packed::OpenContainer: Recreating container(%s) with a partial header of %lld bytes"), *ContainerPath, FileSize);
+
+			FileHandle.Reset(PlatformFile.OpenWrite(*ContainerPath, false, true));
+		}
+
+		if (!FileHandle || !WriteContainerHeader(*FileHandle))
+		{
+			UE_LOG(LogGameCore_Save, Error, TEXT("FGameSaveStorage_Packed::OpenContainer: Failed to write the header of container(%s)"), *ContainerPath);
+
+			FileHandle.Reset();
+			return EGameSavePackedOpenResult::Failed;
+		}
+
+		return EGameSavePackedOpenResult::Opened;
+	}
+
+	uint32 Magic{ 0 };
+	int32 Version{ 0 };
+
+	FileHandle->Seek(0);
+
+	if (!FileHandle->Read(reinterpret_cast<uint8*>(&Magic), sizeof(Magic)) ||
+		!FileHandle->Read(reinterpret_cast<uint8*>(&Version), sizeof(Version)) ||
+		(Magic != GameSaveStorage_Packed::CONTAINER_MAGIC) || (Version > GameSaveStorage_Packed::CONTAINER_VERSION))
+	{
+		UE_LOG(LogGameCore_Save, Error, TEXT("FGameSaveStorage_Packed::OpenContainer: File(%s) is not a supported container"), *ContainerPath);
+
+		FileHandle.Reset();
+		return EGameSavePackedOpenResult::Failed;
+	}
+
+	// Rebuild the index by scanning the record headers
+
+	auto Offset{ FileHandle->Tell() };
+
+	while (Offset < FileSize)
+	{
+		uint32 RecordMagic{ 0 };
+		int32 HeaderSize{ 0 };
+
+		FileHandle->Seek(Offset);
+
+		if (!FileHandle->Read(reinterpret_cast<uint8*>(&RecordMagic), sizeof(RecordMagic)) ||
+			!FileHandle->Read(reinterpret_cast<uint8*>(&HeaderSize), sizeof(HeaderSize)) ||
+			(RecordMagic != GameSaveStorage_Packed::RECORD_MAGIC) || (HeaderSize <= 0) || (FileHandle->Tell() + HeaderSize > FileSize))
+		{
+			break;
+		}
+
+		TArray<uint8> HeaderBytes;
+		HeaderBytes.SetNumUninitialized(HeaderSize);
+
+		if (!FileHandle->Read(HeaderBytes.GetData(), HeaderSize))
+		{
+			break;
+		}
+
+		GameSaveStorage_Packed::FRecordHeader Header;
+		FMemoryReader Reader(HeaderBytes);
+		Reader << Header;
+
+		FRecordLocation Location;
+		Location.UserIndex = Header.UserIndex;
+		Location.SlotName = Header.SlotName;
+		Location.RecordOffset = Offset;
+		Location.DataOffset = FileHandle->Tell();
+		Location.DataSize = Header.DataSize;
+		Location.DataCrc = Header.DataCrc;
+		Location.RecordSize = (Location.DataOffset - Offset) + Header.DataSize;
+
+		if (Reader.IsError() || (Header.DataSize < 0) || (Location.DataOffset + Header.DataSize > FileSize))
+		{
+			break;
+		}
+
+		UpdateIndex(MakeSlotKey(Header.SlotName, Header.UserIndex), Header.bDeleted ? nullptr : &Location, Location.RecordSize);
+
+		Offset += Location.RecordSize;
+	}
+
+	if (Offset < FileSize)
+	{
+		UE_LOG(LogGameCore_Save, Warning, TEXT("FGameSaveStorage_Packed::OpenContainer: Found a broken record at offset(%lld) in container(%s), %lld bytes after it are ignored"), Offset, *ContainerPath, FileSize - Offset);
+		return EGameSavePackedOpenResult::BrokenTail;
+	}
+
+	UE_LOG(LogGameCore_Save, Log, TEXT("Opened container(%s) with %d slots, live(%lld bytes) dead(%lld bytes)"), *ContainerPath, Index.Num(), LiveBytes, DeadBytes);
+
+	return EGameSavePackedOpenResult::Opened;
+}
+
+void FGameSaveStorage_Packed::RunCompaction()
+{
+	auto& PlatformFile{ FPlatformFileManager::Get().GetPlatformFile() };
+	const auto TempPath{ GameSaveStorage_Packed::GetTempPath(ContainerPath) };
+	const auto BackupPath{ GameSaveStorage_Packed::GetBackupPath(ContainerPath) };
+
+	// Copy the live records to a new file without holding the lock
+
+	TMap<FString, FRecordLocation> SnapshotIndex;
+	{
+		FScopeLock Lock(&ContainerCS);
+
+		SnapshotIndex = Index;
+	}
+
+	TUniquePtr<IFileHandle> Reader(PlatformFile.OpenRead(*ContainerPath, true));
+	TUniquePtr<IFileHandle> Writer(PlatformFile.OpenWrite(*TempPath, false, false));
+
+	auto bSuccess{ Reader && Writer && WriteContainerHeader(*Writer) };
+
+	TMap<FString, FRecordLocation> NewIndex;
+	TArray<uint8> Data;
+
+	for (auto It{ SnapshotIndex.CreateConstIterator() }; bSuccess && It; ++It)
+	{
+		FRecordLocation NewLocation;
+
+		if (!ReadRecordData(*Reader, It->Value, Data))
+		{
+			UE_LOG(LogGameCore_Save, Warning, TEXT("FGameSaveStorage_Packed::RunCompaction: Dropped broken record of slot(%s) in container(%s)"), *It->Value.SlotName, *ContainerPath);
+			continue;
+		}
+
+		bSuccess = WriteRecord(*Writer, It->Value.UserIndex, It->Value.SlotName, Data.GetData(), Data.Num(), false, NewLocation);
+
+		NewIndex.Add(It->Key, NewLocation);
+	}
+
+	Reader.Reset();
+
+	// Apply the writes made while copying and swap in the new file
+
+	FScopeLock Lock(&ContainerCS);
+
+	for (auto It{ Index.CreateConstIterator() }; bSuccess && FileHandle && It; ++It)
+	{
+		const auto* SnapshotLocation{ SnapshotIndex.Find(It->Key) };
+
+		if (SnapshotLocation && (SnapshotLocation->RecordOffset == It->Value.RecordOffset))
+		{
+			continue;
+		}
+
+		FRecordLocation NewLocation;
+
+		bSuccess = ReadRecordData(*FileHandle, It->Value, Data) && WriteRecord(*Writer, It->Value.UserIndex, It->Value.SlotName, Data.GetData(), Data.Num(), false, NewLocation);
+
+		NewIndex.Add(It->Key, NewLocation);
+	}
+
+	for (auto It{ NewIndex.CreateIterator() }; It; ++It)
+	{
+		if (!Index.Contains(It->Key))
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	bSuccess = bSuccess && Writer->Flush();
+	Writer.Reset();
+
+	if (bSuccess)
+	{
+		FileHandle.Reset();
+
+		bSuccess = PlatformFile.MoveFile(*BackupPath, *ContainerPath) && PlatformFile.MoveFile(*ContainerPath, *TempPath);
+
+		if (bSuccess)
+		{
+			PlatformFile.DeleteFile(*BackupPath);
+		}
+		else if (!PlatformFile.FileExists(*ContainerPath))
+		{
+			PlatformFile.MoveFile(*ContainerPath, *BackupPath);
+		}
+
+		FileHandle.Reset(PlatformFile.OpenWrite(*ContainerPath, true, true));
+	}
+
+	PlatformFile.DeleteFile(*TempPath);
+
+	if (bSuccess)
+	{
+		UE_LOG(LogGameCore_Save, Log, TEXT("Compacted container(%s), removed %lld bytes"), *ContainerPath, DeadBytes);
+
+		Index = MoveTemp(NewIndex);
+		DeadBytes = 0;
+		LiveBytes = 0;
+
+		for (const auto& KVP : Index)
+		{
+			LiveBytes += KVP.Value.RecordSize;
+		}
+	}
+	else
+	{
+		UE_LOG(LogGameCore_Save, Error, TEXT("FGameSaveStorage_Packed::RunCompaction: Failed to compact container(%s)"), *ContainerPath);
+	}
+
+	bCompacting = false;
+}
+
+void FGameSaveStorage_Packed::UpdateIndex(const FString& SlotKey, const FRecordLocation* NewLocation, int64 AppendedBytes)
+{
+	if (const auto* OldLocation{ Index.Find(SlotKey) })
+	{
+		LiveBytes -= OldLocation->RecordSize;
+		DeadBytes += OldLocation->RecordSize;
+	}
+
+	if (NewLocation)
+	{
+		Index.Add(SlotKey, *NewLocation);
+		LiveBytes += AppendedBytes;
+	}
+	else
+	{
+		Index.Remove(SlotKey);
+		DeadBytes += AppendedBytes;
+	}
+}
+
+void FGameSaveStorage_Packed::RequestCompactionIfNeeded()
+{
+	if (bCompacting || (DeadBytes < GameSaveStorage_Packed::MIN_COMPACTION_BYTES) || (DeadBytes < LiveBytes))
+	{
+		return;
+	}
+
+	bCompacting = true;
+
+	AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask,
+		[This = AsShared()]()
+		{
+			This->RunCompaction();
+		}
+	);
+}
+
+bool FGameSaveStorage_Packed::WriteContainerHeader(IFileHandle& Handle)
+{
+	auto Magic{ GameSaveStorage_Packed::CONTAINER_MAGIC };
+	auto Version{ GameSaveStorage_Packed::CONTAINER_VERSION };
+
+	return Handle.Write(reinterpret_cast<const uint8*>(&Magic), sizeof(Magic))
+		&& Handle.Write(reinterpret_cast<const uint8*>(&Version), sizeof(Version))
+		&& Handle.Flush();
+}
+
+bool FGameSaveStorage_Packed::WriteRecord(IFileHandle& Handle, int32 UserIndex, const FString& SlotName, const uint8* Data, int64 DataSize, bool bDeleted, FRecordLocation& OutLocation)
+{
+	GameSaveStorage_Packed::FRecordHeader Header;
+	Header.UserIndex = UserIndex;
+	Header.SlotName = SlotName;
+	Header.DataSize = DataSize;
+	Header.DataCrc = (DataSize > 0) ? FCrc::MemCrc32(Data, DataSize) : 0;
+	Header.bDeleted = bDeleted;
+
+	TArray<uint8> HeaderBytes;
+	FMemoryWriter Writer(HeaderBytes);
+	Writer << Header;
+
+	auto RecordMagic{ GameSaveStorage_Packed::RECORD_MAGIC };
+	auto HeaderSize{ HeaderBytes.Num() };
+
+	// Reads move the position, so always append at the end
+
+	if (!Handle.SeekFromEnd(0))
+	{
+		return false;
+	}
+
+	OutLocation.UserIndex = UserIndex;
+	OutLocation.SlotName = SlotName;
+	OutLocation.RecordOffset = Handle.Tell();
+	OutLocation.DataOffset = OutLocation.RecordOffset + sizeof(RecordMagic) + sizeof(HeaderSize) + HeaderSize;
+	OutLocation.DataSize = DataSize;
+	OutLocation.DataCrc = Header.DataCrc;
+	OutLocation.RecordSize = (OutLocation.DataOffset - OutLocation.RecordOffset) + DataSize;
+
+	return Handle.Write(reinterpret_cast<const uint8*>(&RecordMagic), sizeof(RecordMagic))
+		&& Handle.Write(reinterpret_cast<const uint8*>(&HeaderSize), sizeof(HeaderSize))
+		&& Handle.Write(HeaderBytes.GetData(), HeaderSize)
+		&& ((DataSize <= 0) || Handle.Write(Data, DataSize))
+		&& Handle.Flush();
+}
+
+bool FGameSaveStorage_Packed::ReadRecordData(IFileHandle& Handle, const FRecordLocation& Location, TArray<uint8>& OutData)
+{
+	OutData.SetNumUninitialized(Location.DataSize);
+
+	if (!Handle.Seek(Location.DataOffset) || !Handle.Read(OutData.GetData(), Location.DataSize))
+	{
+		return false;
+	}
+
+	return FCrc::MemCrc32(OutData.GetData(), OutData.Num()) == Location.DataCrc;
+}
+
+FString FGameSaveStorage_Packed::MakeSlotKey(const FString& SlotName, int32 UserIndex)
+{
+	return FString::Printf(TEXT("%d/%s"), UserIndex, *SlotName);
+}
@@ -0,0 +1,163 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Storage/GameSaveStorage.h"
+
+#include "HAL/CriticalSection.h"
+
+class IFileHandle;
+
+
+/**
+ * Result of FGameSaveStorage_Packed::OpenContainer
+ */
+enum class EGameSavePackedOpenResult : uint8
+{
+	// Every record of the container has been indexed
+	Opened,
+
+	// Records after a broken record are ignored until the container is compacted
+	BrokenTail,
+
+	// The container could not be opened or is not a supported container
+	Failed,
+};
+
+
+/**
+ * Storage that packs all slots into one container file
+ *
+ * Tips:
+ *	Each write appends a record with the data of the slot, and the index of the latest record of each slot is kept in memory.
+ *	The index is rebuilt by scanning the record headers when the container is opened.
+ *	Records that have been replaced or deleted are removed by a compaction that runs in the background once they take up more than the live data.
+ *
+ * Note:
+ *	Every subsystem that uses the same container shares one instance, see FindOrCreate
+ */
+class GCSAVE_API FGameSaveStorage_Packed : public IGameSaveStorage, public TSharedFromThis<FGameSaveStorage_Packed>
+{
+public:
+	explicit FGameSaveStorage_Packed(const FString& InContainerPath);
+	virtual ~FGameSaveStorage_Packed();
+
+	/**
+	 * Returns the storage of the container, opening it if no one is using it
+	 *
+	 * Note:
+	 *	Return nullptr if the container could not be opened or is not a supported container
+	 */
+	static TSharedPtr<FGameSaveStorage_Packed> FindOrCreate(const FString& InContainerPath);
+
+	/**
+	 * Returns the path of the container in the SaveGames directory of the project
+	 */
+	static FString GetDefaultContainerPath();
+
+protected:
+	//
+	// Location of the data of a slot in the container
+	//
+	struct FRecordLocation
+	{
+		int32 UserIndex{ INDEX_NONE };
+		FString SlotName;
+		int64 RecordOffset{ 0 };
+		int64 RecordSize{ 0 };
+		int64 DataOffset{ 0 };
+		int64 DataSize{ 0 };
+		uint32 DataCrc{ 0 };
+	};
+
+	FString ContainerPath;
+
+	//
+	// Handle of the container opened for appending and reading
+	//
+	TUniquePtr<IFileHandle> FileHandle;
+
+	//
+	// Latest record of each slot by slot key
+	//
+	TMap<FString, FRecordLocation> Index;
+
+	//
+	// Total size of the records that are no longer referenced by the index
+	//
+	int64 DeadBytes{ 0 };
+
+	//
+	// Total size of the records referenced by the index
+	//
+	int64 LiveBytes{ 0 };
+
+	bool bCompacting{ false };
+
+	mutable FCriticalSection ContainerCS;
+
+public:
+	virtual FString GetStorageName() const override { return TEXT("Packed"); }
+
+	virtual bool DoesSlotExist(const FString& SlotName, int32 UserIndex) override;
+
+	virtual bool ReadSlot(const FString& SlotName, int32 UserIndex, TArray<uint8>& OutData) override;
+
+	virtual bool ReadSlotPrefix(const FString& SlotName, int32 UserIndex, int64 MaxSize, TArray<uint8>& OutData) override;
+
+	virtual bool WriteSlot(const FString& SlotName, int32 UserIndex, const TArray<uint8>& InData) override;
+
+	virtual bool DeleteSlot(const FString& SlotName, int32 UserIndex) override;
+
+	virtual bool GetSlotNames(int32 UserIndex, TArray<FString>& OutSlotNames) override;
+
+public:
+	/**
+	 * Rewrites the container with only the latest record of each slot
+	 *
+	 * Note:
+	 *	Blocks the calling thread, reads and writes are only blocked while the new container is swapped in
+	 */
+	void Compact();
+
+	/**
+	 * Returns the total size of the records that will be removed by the next compaction
+	 */
+	int64 GetDeadBytes() const;
+
+protected:
+	/**
+	 * Opens the container and rebuilds the index
+	 *
+	 * Tips:
+	 *	A container that is shorter than its header was interrupted while being created and is started again.
+	 */
+	EGameSavePackedOpenResult OpenContainer();
+
+	/**
+	 * Compacts the container, bCompacting must have been set by the caller
+	 */
+	void RunCompaction();
+
+	/**
+	 * Replaces the record of the slot in the index and accounts for the replaced record
+	 */
+	void UpdateIndex(const FString& SlotKey, const FRecordLocation* NewLocation, int64 AppendedBytes);
+
+	/**
+	 * Starts a compaction in the background if there are enough dead records, the lock must be held
+	 */
+	void RequestCompactionIfNeeded();
+
+	static bool WriteContainerHeader(IFileHandle& Handle);
+
+	/**
+	 * Appends a record at the end of the file
+	 */
+	static bool WriteRecord(IFileHandle& Handle, int32 UserIndex, const FString& SlotName, const uint8* Data, int64 DataSize, bool bDeleted, FRecordLocation& OutLocation);
+
+	static bool ReadRecordData(IFileHandle& Handle, const FRecordLocation& Location, TArray<uint8>& OutData);
+
+	static FString MakeSlotKey(const FString& SlotName, int32 UserIndex);
+
+};
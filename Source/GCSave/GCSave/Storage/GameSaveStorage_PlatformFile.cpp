@@ -0,0 +1,42 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "GameSaveStorage_PlatformFile.h"
+
+#include "PlatformFeatures.h"
+#include "SaveGameSystem.h"
+
+
+bool FGameSaveStorage_PlatformFile::DoesSlotExist(const FString& SlotName, int32 UserIndex)
+{
+	auto* SaveSystem{ IPlatformFeaturesModule::Get().GetSaveGameSystem() };
+
+	return SaveSystem && SaveSystem->DoesSaveGameExist(*SlotName, UserIndex);
+}
+
+bool FGameSaveStorage_PlatformFile::ReadSlot(const FString& SlotName, int32 UserIndex, TArray<uint8>& OutData)
+{
+	auto* SaveSystem{ IPlatformFeaturesModule::Get().GetSaveGameSystem() };
+
+	return SaveSystem && (SlotName.Len() > 0) && SaveSystem->LoadGame(false, *SlotName, UserIndex, OutData);
+}
+
+bool FGameSaveStorage_PlatformFile::WriteSlot(const FString& SlotName, int32 UserIndex, const TArray<uint8>& InData)
+{
+	auto* SaveSystem{ IPlatformFeaturesModule::Get().GetSaveGameSystem() };
+
+	return SaveSystem && (SlotName.Len() > 0) && (InData.Num() > 0) && SaveSystem->SaveGame(false, *SlotName, UserIndex, InData);
+}
+
+bool FGameSaveStorage_PlatformFile::DeleteSlot(const FString& SlotName, int32 UserIndex)
+{
+	auto* SaveSystem{ IPlatformFeaturesModule::Get().GetSaveGameSystem() };
+
+	return SaveSystem && SaveSystem->DeleteGame(false, *SlotName, UserIndex);
+}
+
+bool FGameSaveStorage_PlatformFile::GetSlotNames(int32 UserIndex, TArray<FString>& OutSlotNames)
+{
+	auto* SaveSystem{ IPlatformFeaturesModule::Get().GetSaveGameSystem() };
+
+	return SaveSystem && SaveSystem->GetSaveGameNames(OutSlotNames, UserIndex);
+}
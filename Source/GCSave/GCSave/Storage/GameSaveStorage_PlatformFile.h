@@ -0,0 +1,32 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Storage/GameSaveStorage.h"
+
+
+/**
+ * Storage that uses the save game system of the platform
+ *
+ * Tips:
+ *	On desktop platforms each slot is a file in the SaveGames directory of the project
+ */
+class GCSAVE_API FGameSaveStorage_PlatformFile : public IGameSaveStorage
+{
+public:
+	FGameSaveStorage_PlatformFile() {}
+
+public:
+	virtual FString GetStorageName() const override { return TEXT("PlatformFile"); }
+
+	virtual bool DoesSlotExist(const FString& SlotName, int32 UserIndex) override;
+
+	virtual bool ReadSlot(const FString& SlotName, int32 UserIndex, TArray<uint8>& OutData) override;
+
+	virtual bool WriteSlot(const FString& SlotName, int32 UserIndex, const TArray<uint8>& InData) override;
+
+	virtual bool DeleteSlot(const FString& SlotName, int32 UserIndex) override;
+
+	virtual bool GetSlotNames(int32 UserIndex, TArray<FString>& OutSlotNames) override;
+
+};
@@ -0,0 +1,155 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "Profiling/GameSaveSoakTest.h"
+
+#include "GlobalSave/GlobalSaveSubsystem.h"
+#include "PlayerSave/PlayerSaveSubsystem.h"
+
+#include "Engine/Engine.h"
+#include "Engine/GameInstance.h"
+#include "Engine/LocalPlayer.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+
+namespace GameSaveSoakAutomationTest
+{
+	/**
+	 * Returns the game instance of a running game or play in editor session
+	 */
+	static UGameInstance* FindRunningGameInstance()
+	{
+		for (const auto& Context : GEngine->GetWorldContexts())
+		{
+			if (((Context.WorldType == EWorldType::Game) || (Context.WorldType == EWorldType::PIE)) && Context.OwningGameInstance)
+			{
+				return Context.OwningGameInstance;
+			}
+		}
+
+		return nullptr;
+	}
+
+	/**
+	 * Returns the game instance of a running game, otherwise creates a standalone one that is returned in OutOwnedGameInstance
+	 */
+	static UGameInstance* FindOrCreateGameInstance(UGameInstance*& OutOwnedGameInstance)
+	{
+		if (auto* GameInstance{ FindRunningGameInstance() })
+		{
+			return GameInstance;
+		}
+
+		OutOwnedGameInstance = NewObject<UGameInstance>(GEngine);
+		OutOwnedGameInstance->AddToRoot();
+		OutOwnedGameInstance->InitializeStandalone();
+
+		return OutOwnedGameInstance;
+	}
+
+	static void ShutdownOwnedGameInstance(UGameInstance* OwnedGameInstance)
+	{
+		if (OwnedGameInstance)
+		{
+			OwnedGameInstance->Shutdown();
+			OwnedGameInstance->RemoveFromRoot();
+		}
+	}
+}
+
+
+/**
+ * Waits for the soak test to finish and reports its result to the automation test
+ */
+DEFINE_LATENT_AUTOMATION_COMMAND_THREE_PARAMETER(FWaitForGameSaveSoakTest, TSharedRef<FGameSaveSoakTest>, SoakTest, FAutomationTestBase*, Test, UGameInstance*, OwnedGameInstance);
+
+bool FWaitForGameSaveSoakTest::Update()
+{
+	if (!SoakTest->IsFinished())
+	{
+		return false;
+	}
+
+	const auto& Result{ SoakTest->GetResult() };
+
+	Test->AddInfo(FString::Printf(TEXT("Operations: %d"), Result.NumOperations));
+	Test->AddInfo(FString::Printf(TEXT("Game thread stall: %s"), *Result.Stall.ToString()));
+	Test->AddInfo(FString::Printf(TEXT("End-to-end latency: %s"), *Result.Latency.ToString()));
+
+	for (const auto& Error : Result.Errors)
+	{
+		Test->AddError(Error);
+	}
+
+	// The game instance created for the test is shut down with it
+
+	GameSaveSoakAutomationTest::ShutdownOwnedGameInstance(OwnedGameInstance);
+
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FGameSaveSoakTestAutomationTest, "GameSaveCore.Soak.ConcurrentSaveLoad",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::StressFilter)
+
+bool FGameSaveSoakTestAutomationTest::RunTest(const FString& Parameters)
+{
+	// Use the running game if there is one, otherwise a standalone game instance that lives for the test
+
+	UGameInstance* OwnedGameInstance{ nullptr };
+	auto* GameInstance{ GameSaveSoakAutomationTest::FindOrCreateGameInstance(OwnedGameInstance) };
+
+	auto* Subsystem{ GameInstance->GetSubsystem<UGlobalSaveSubsystem>() };
+
+	if (!TestNotNull(TEXT("Global save subsystem"), Subsystem))
+	{
+		GameSaveSoakAutomationTest::ShutdownOwnedGameInstance(OwnedGameInstance);
+		return false;
+	}
+
+	FGameSaveSoakTestSettings Settings;
+	Settings.Seed = 12345;
+
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForGameSaveSoakTest(FGameSaveSoakTest::Start(Subsystem, Settings), this, OwnedGameInstance));
+
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FGameSavePlayerSoakTestAutomationTest, "GameSaveCore.Soak.ConcurrentPlayerSaveLoad",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::StressFilter)
+
+bool FGameSavePlayerSoakTestAutomationTest::RunTest(const FString& Parameters)
+{
+	// Use the first local player of the running game, a standalone game instance gets a local player for the test
+
+	UGameInstance* OwnedGameInstance{ nullptr };
+	auto* GameInstance{ GameSaveSoakAutomationTest::FindOrCreateGameInstance(OwnedGameInstance) };
+
+	auto* LocalPlayer{ GameInstance->GetFirstGamePlayer() };
+
+	if (!LocalPlayer)
+	{
+		FString Error;
+		LocalPlayer = GameInstance->CreateLocalPlayer(0, Error, false);
+	}
+
+	auto* Subsystem{ LocalPlayer ? LocalPlayer->GetSubsystem<UPlayerSaveSubsystem>() : nullptr };
+
+	if (!TestNotNull(TEXT("Player save subsystem"), Subsystem))
+	{
+		GameSaveSoakAutomationTest::ShutdownOwnedGameInstance(OwnedGameInstance);
+		return false;
+	}
+
+	FGameSaveSoakTestSettings Settings;
+	Settings.Seed = 12345;
+
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForGameSaveSoakTest(FGameSaveSoakTest::Start(Subsystem, Settings), this, OwnedGameInstance));
+
+	return true;
+}
+
+
+#endif
@@ -4,3 +4,4 @@
 
 DEFINE_LOG_CATEGORY(LogGameCore_GlobalSave);
 DEFINE_LOG_CATEGORY(LogGameCore_PlayerSave);
+DEFINE_LOG_CATEGORY(LogGameCore_Save);
@@ -6,3 +6,4 @@
 
 GCSAVE_API DECLARE_LOG_CATEGORY_EXTERN(LogGameCore_GlobalSave, Log, All);
 GCSAVE_API DECLARE_LOG_CATEGORY_EXTERN(LogGameCore_PlayerSave, Log, All);
+GCSAVE_API DECLARE_LOG_CATEGORY_EXTERN(LogGameCore_Save, Log, All);